@@ -57,6 +57,30 @@ defined in linker script */
 Reset_Handler:
   ldr   r0, =_estack
   mov   sp, r0          /* set stack pointer */
+/* Enable the FPU (full access to CP10 and CP11) before any C code can use it and
+   set the exception stacking, lazy unless FPU_STACKING says otherwise (1 always,
+   2 never). Only when the image is compiled for the FPU, the assembler must get
+   the same -mfpu/-mfloat-abi. */
+#if defined(__ARM_FP)
+#ifndef FPU_STACKING
+#define FPU_STACKING 0          /* FPU_STACKING_LAZY */
+#endif
+  ldr r0, =0xE000ED88   /* CPACR */
+  ldr r1, [r0]
+  orr r1, r1, #0x00F00000   /* CP10, CP11 full access */
+  str r1, [r0]
+  ldr r0, =0xE000EF34   /* FPCCR */
+  ldr r1, [r0]
+  bic r1, r1, #0xC0000000   /* ASPEN, LSPEN */
+#if FPU_STACKING == 0
+  orr r1, r1, #0xC0000000   /* lazy */
+#elif FPU_STACKING == 1
+  orr r1, r1, #0x80000000   /* always */
+#endif
+  str r1, [r0]
+  dsb
+  isb
+#endif
 /* Call the clock system initialization function.*/
   bl  SystemInit
 
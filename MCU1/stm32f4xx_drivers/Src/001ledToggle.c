@@ -23,7 +23,11 @@
 #include <stdio.h>
 
 void delay(void){
-	for(uint32_t i = 0; i < 200000; i++);
+	SYSTICK_DelayMs(150);
+}
+
+void SysTick_Handler(void){
+	SYSTICK_IRQHandling();
 }
 
 int main(void)
@@ -60,6 +64,8 @@ int main(void)
 	LED6.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_NO_PUPD;
 	LED6.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_PP;
 
+	SYSTICK_Init(15);
+
 	GPIO_PeriClockControl(GPIOD, ENABLE);
 	GPIO_Init(&LED4);
 	GPIO_Init(&LED3);
@@ -25,8 +25,13 @@
 
 void EXTI0_IRQHandler(void);
 
-void delay(void){
-	for(uint32_t i = 0; i < 250000; i++);
+// Button edges before this tick are contact bounce
+#define DEBOUNCE_MS		200
+
+static uint32_t debounceDeadline;
+
+void SysTick_Handler(void){
+	SYSTICK_IRQHandling();
 }
 
 int main(void)
@@ -47,6 +52,9 @@ int main(void)
 	USRPB.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_FAST;
 	USRPB.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_NO_PUPD;
 
+	SYSTICK_Init(15);
+	debounceDeadline = SYSTICK_Deadline(0);
+
 	GPIO_PeriClockControl(GPIOD, ENABLE);
 	GPIO_PeriClockControl(GPIOA, ENABLE);
 	GPIO_Init(&LED1);
@@ -59,7 +67,12 @@ int main(void)
 }
 
 void EXTI0_IRQHandler(void){
-	delay();
 	GPIO_IRQHandling(GPIO_PIN_NO_0);
+
+	// Ignore the bounce instead of waiting it out in the handler
+	if(!SYSTICK_Expired(debounceDeadline))
+		return;
+	debounceDeadline = SYSTICK_Deadline(DEBOUNCE_MS);
+
 	GPIO_ToggleOutputPin(GPIOD, GPIO_PIN_NO_12);
 }
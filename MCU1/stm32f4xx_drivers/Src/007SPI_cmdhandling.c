@@ -33,7 +33,11 @@ extern void initialise_monitor_handles(void);
 #define LED_PIN		9
 
 void delay(void){
-	for(uint32_t i = 0; i < 50000; i++);
+	SYSTICK_DelayMs(40);
+}
+
+void SysTick_Handler(void){
+	SYSTICK_IRQHandling();
 }
 
 typedef struct {
@@ -170,6 +174,8 @@ int main(void){
 	uint8_t dummy_read;
 	uint8_t dummy_write;
 
+	SYSTICK_Init(15);
+
 	// Initialize the appropriate GPIO pins on port B
 	SPI_GPIO_Pins_t spi2Pins;
 	SPI2_GPIO_Inits(&spi2Pins);
@@ -7,7 +7,6 @@
 
 #include "stm32f407xx.h"
 #include <string.h>
-#include <stdlib.h>
 #include <stdio.h>
 
 extern void initialise_monitor_handles(void);
@@ -89,7 +88,9 @@ uint8_t getLength(){
 
 // Retrieves the string itself
 uint8_t* getData(uint8_t len){
-	uint8_t* data = (uint8_t*)malloc((len * sizeof(uint8_t)) + 1);
+	uint8_t* data = (uint8_t*)POOL_Malloc((len * sizeof(uint8_t)) + 1);
+	if(data == NULL)
+		return NULL;
 
 	sendCommand(CMD_READDATA);
 
@@ -105,16 +106,23 @@ void readFromArduino(){
 	uint8_t* data = getData(len);
 	I2C_PeripheralControl(&myI2CHandle, DISABLE);
 
+	if(data == NULL){
+		printf("No buffer for %u bytes\n", len);
+		return;
+	}
+
 	data[len] = '\0';
 
 	printf("Received string: %s\n", (char*)data);
 
-	free(data);
+	POOL_Release(data);
 }
 
 int main(){
 	initialise_monitor_handles();
 
+	POOL_ClassesInit();
+
 	// Initialize the GPIO's to be used for I2C
 	I2CGPIOHandle_t I2C1GPIOs;
 	I2C1_GPIOInits(&I2C1GPIOs);
@@ -7,7 +7,6 @@
 
 #include "stm32f407xx.h"
 #include <string.h>
-#include <stdlib.h>
 #include <stdio.h>
 
 extern void initialise_monitor_handles(void);
@@ -22,11 +21,19 @@ typedef struct {
 	GPIO_Handle_t SCL;
 } I2CGPIOHandle_t;
 
-// Global handle for use with the interrupt
-I2C_Handle_t myI2CHandle;
+// Bound to the I2C1 interrupts with I2C_IRQBind, no forwarding handlers needed
+static I2C_Handle_t myI2CHandle;
 
-void delay(uint16_t ms){
-	for(uint32_t i = 0; i < (ms*1000); i++);
+// Button edges before this tick are contact bounce
+#define DEBOUNCE_MS		200
+
+static uint32_t debounceDeadline;
+
+static void button_event_handle(EVT_Event_t *pEvent);
+static void i2c_event_handle(EVT_Event_t *pEvent);
+
+void SysTick_Handler(void){
+	SYSTICK_IRQHandling();
 }
 
 void I2C1_GPIOInits(I2CGPIOHandle_t *pI2CGPIOHandle){
@@ -89,7 +96,9 @@ uint8_t getLength(){
 
 // Retrieves the string itself
 uint8_t* getData(uint8_t len){
-	uint8_t* data = (uint8_t*)malloc((len * sizeof(uint8_t)) + 1);
+	uint8_t* data = (uint8_t*)POOL_Malloc((len * sizeof(uint8_t)) + 1);
+	if(data == NULL)
+		return NULL;
 
 	sendCommand(CMD_READDATA);
 
@@ -105,16 +114,31 @@ void readFromArduino(){
 	uint8_t* data = getData(len);
 	I2C_PeripheralControl(&myI2CHandle, DISABLE);
 
+	if(data == NULL){
+		printf("No buffer for %u bytes\n", len);
+		return;
+	}
+
 	data[len] = '\0';
 
 	printf("Received string: %s\n", (char*)data);
 
-	free(data);
+	POOL_Release(data);
 }
 
 int main(){
 	initialise_monitor_handles();
 
+	POOL_ClassesInit();
+
+	LOG_Init();
+	SYSTICK_Init(15);
+
+	EVT_Init(EVT_DISPATCH_MAIN, 15);
+	EVT_RegisterHandler(EVT_TYPE_GPIO, button_event_handle);
+	EVT_RegisterHandler(EVT_TYPE_I2C, i2c_event_handle);
+	debounceDeadline = SYSTICK_Deadline(0);
+
 	// Initialize the GPIO's to be used for I2C
 	I2CGPIOHandle_t I2C1GPIOs;
 	I2C1_GPIOInits(&I2C1GPIOs);
@@ -123,6 +147,7 @@ int main(){
 	I2C1_Init(&myI2CHandle);
 
 	// I2C IRQ Configurations
+	I2C_IRQBind(&myI2CHandle);
 	I2C_IRQInterruptConfig(IRQ_NO_I2C1_ER, 0, ENABLE);
 	I2C_IRQInterruptConfig(IRQ_NO_I2C1_EV, 0, ENABLE);
 
@@ -130,49 +155,73 @@ int main(){
 	GPIO_Handle_t USRPB;
 	USRBTN_Init(&USRPB);
 
-	while(1);
+	// The interrupts only post events and log records, the work happens here
+	while(1){
+		EVT_Dispatch();
+		LOG_Process();
+	}
 }
 
 void EXTI0_IRQHandler(void){
-	delay(200);
 	GPIO_IRQHandling(GPIO_PIN_NO_0);
-	readFromArduino();
-}
 
-void I2C1_ER_IRQHandler(void){
-	I2C_ER_IRQHandling(&myI2CHandle);
+	// Ignore the bounce instead of waiting it out in the handler
+	if(!SYSTICK_Expired(debounceDeadline))
+		return;
+	debounceDeadline = SYSTICK_Deadline(DEBOUNCE_MS);
+
+	// The read waits for the I2C interrupts, it must not run in here
+	EVT_Post(EVT_TYPE_GPIO, GPIO_PIN_NO_0, NULL, 0);
 }
 
-void I2C1_EV_IRQHandler(void){
-	I2C_EV_IRQHandling(&myI2CHandle);
+static void button_event_handle(EVT_Event_t *pEvent){
+	EVT_Stats_t stats;
+
+	readFromArduino();
+
+	EVT_GetStats(&stats);
+	printf("Events: %lu dispatched, %lu dropped, max depth %lu, max latency %lu cycles\n",
+			stats.Dispatched, stats.Dropped, stats.HighWater, stats.LatencyMax);
 }
 
 void I2C_ApplicationEventCallback(I2C_Handle_t *pI2CHandle, uint8_t EvorEr){
+	if(EvorEr == I2C_ERROR_AF){
+		// In master mode, ACK faiure happens when the slave fails to send ACK
+		// for the byte sent from the master. The bus is released right away,
+		// anything waiting for I2C_READY would otherwise wait forever
+		I2C_CloseSendData(pI2CHandle);
+
+		// Generate the stop condition to release the bus
+		I2C_GenerateStopCondition(pI2CHandle->pI2Cx);
+	}
+
+	// Everything else happens in i2c_event_handle, outside of the interrupt
+	EVT_Post(EVT_TYPE_I2C, EvorEr, pI2CHandle, 0);
+}
+
+static void i2c_event_handle(EVT_Event_t *pEvent){
+	uint8_t EvorEr = pEvent->Code;
+
 	if(EvorEr == I2C_EV_TX_CMPLT){
-		printf("Tx is completed\n");
+		LOG_PRINT("Tx is completed");
 	} else if (EvorEr == I2C_EV_RX_CMPLT){
-		printf("Rx is completed\n");
+		LOG_PRINT("Rx is completed");
 	} else if (EvorEr == I2C_EV_STOP){
-		printf("Communications have been stopped\n");
+		LOG_PRINT("Communications have been stopped");
 	} else if (EvorEr == I2C_ERROR_BERR){
-		printf("Error: Bus error\n");
+		LOG_PRINT("Error: Bus error");
 	} else if (EvorEr == I2C_ERROR_ARLO){
-		printf("Error: Arbitration lost\n");
+		LOG_PRINT("Error: Arbitration lost");
 	} else if (EvorEr == I2C_ERROR_AF){
-		// In master mode, ACK faiure happens when the slave fails to send ACK
-		// for the byte sent from the master
-		printf("Error: ACK failure\n");
-		I2C_CloseSendData(pI2CHandle);
-
-		// Generate the stop condition to release the bus
-		I2C_GenerateStopCondition(pI2CHandle->pI2Cx);
+		LOG_PRINT("Error: ACK failure");
 
-		// Hang in infinite loop
-		while(1);
+		// Hang in infinite loop, the interrupts keep running
+		while(1)
+			LOG_Process();
 
 	} else if (EvorEr == I2C_ERROR_OVR){
-		printf("Error: Overrun/underrun\n");
+		LOG_PRINT("Error: Overrun/underrun");
 	} else if (EvorEr == I2C_ERROR_TIMEOUT){
-		printf("Error: Timeout\n");
+		LOG_PRINT("Error: Timeout");
 	}
 }
@@ -9,11 +9,10 @@
 #include "ds1307.h"
 
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
-char* getDayOfWeek(RTC_date_t* rtc_date);
-char* getMonth(RTC_date_t* rtc_date);
+const char* getDayOfWeek(RTC_date_t* rtc_date);
+const char* getMonth(RTC_date_t* rtc_date);
 
 char* dateToString(RTC_date_t* rtc_date);
 char* timeToString(RTC_time_t* rtc_time);
@@ -28,6 +27,10 @@ int main(void){
 							.month = JANUARY,
 							.year = 2000 };
 
+	char* text;
+
+	POOL_ClassesInit();
+
 	printf("RTC Test:\n");
 
 	if(ds1307_init()){
@@ -41,9 +44,13 @@ int main(void){
 	ds1307_get_current_time(&rtc_time);
 	ds1307_get_current_date(&rtc_date);
 
-	printf("Current time: %s\n", timeToString(&rtc_time));
+	text = timeToString(&rtc_time);
+	printf("Current time: %s\n", text);
+	POOL_Release(text);
 
-	printf("Current date: %s\n", dateToString(&rtc_date));
+	text = dateToString(&rtc_date);
+	printf("Current date: %s\n", text);
+	POOL_Release(text);
 
 	return 0;
 }
@@ -55,29 +62,35 @@ char* timeToString(RTC_time_t* rtc_time){
 	else
 		ampm = "";
 
-	char* output = (char*)malloc(sizeof(char) * 10);
-	sprintf(output, "%d:%d:%d%s",	rtc_time->hours,
-									rtc_time->minutes,
-									rtc_time->seconds,
-									ampm);
+	// "hh:mm:ss PM" with its terminator fits the 16 byte pool class
+	char* output = (char*)POOL_Malloc(16);
+	if(output == NULL)
+		return NULL;
+
+	snprintf(output, 16, "%d:%d:%d%s",	rtc_time->hours,
+										rtc_time->minutes,
+										rtc_time->seconds,
+										ampm);
 
 	return output;
 }
 
 char* dateToString(RTC_date_t* rtc_date){
-	char* output = (char*)malloc(sizeof(char) * 20);
+	// "Wednesday, September 30, 2000" needs 30 bytes
+	char* output = (char*)POOL_Malloc(32);
+	if(output == NULL)
+		return NULL;
 
-	sprintf(output, "%s, %s %d, %d",	getDayOfWeek(rtc_date),
-										getMonth(rtc_date),
-										rtc_date->date,
-										rtc_date->year);
+	snprintf(output, 32, "%s, %s %d, %d",	getDayOfWeek(rtc_date),
+											getMonth(rtc_date),
+											rtc_date->date,
+											rtc_date->year);
 
 	return output;
 }
 
-char* getDayOfWeek(RTC_date_t* rtc_date){
-
-	char* dayOfWeek = (char*)malloc(sizeof(char) * 15);
+const char* getDayOfWeek(RTC_date_t* rtc_date){
+	const char* dayOfWeek = "";
 
 	switch (rtc_date->dayOfWeek) {
 		case SUNDAY:
@@ -106,8 +119,8 @@ char* getDayOfWeek(RTC_date_t* rtc_date){
 	return dayOfWeek;
 }
 
-char* getMonth(RTC_date_t* rtc_date){
-	char* month = (char*)malloc(sizeof(char) * 15);
+const char* getMonth(RTC_date_t* rtc_date){
+	const char* month = "";
 
 	switch (rtc_date->month) {
 		case JANUARY:
@@ -0,0 +1,156 @@
+/*
+ * 013spi_dma_benchmark.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Compares a polled SPI_SendData against SPI_SendDataDMA on SPI2 (PB12-PB15)
+ * - Cycles spent by the CPU on the polled transfer
+ * - Cycles spent setting up the DMA transfer
+ * - How much CPU work gets done while the DMA transfer runs
+ * Nothing needs to be connected, MOSI can be probed with a logic analyzer.
+ */
+
+#define BENCH_LEN		4096
+
+// DWT cycle counter
+#define DEMCR			(*(__vo uint32_t*)0xE000EDFC)
+#define DWT_CTRL		(*(__vo uint32_t*)0xE0001000)
+#define DWT_CYCCNT		(*(__vo uint32_t*)0xE0001004)
+#define DEMCR_TRCENA	24
+
+static __dma_buffer uint8_t txBuf[BENCH_LEN];
+
+static SPI_Handle_t SPI2Handle;
+static DMA_Handle_t SPI2DMATx;
+static DMA_Handle_t SPI2DMARx;
+
+static __vo uint8_t dmaDone = 0;
+
+void delay(void){
+	for(uint32_t i = 0; i < 500000; i++);
+}
+
+void DWT_Init(void){
+	DEMCR |= (1 << DEMCR_TRCENA);
+	DWT_CYCCNT = 0;
+	DWT_CTRL |= 1;
+}
+
+void SPI2_GPIO_Inits(void){
+	GPIO_Handle_t SPIPins;
+
+	SPIPins.pGPIOx = GPIOB;
+	SPIPins.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_ALTFN;
+	SPIPins.GPIO_PinConfig.GPIO_PinAltFunMode = 5;
+	SPIPins.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_HIGH;
+	SPIPins.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_NO_PUPD;
+	SPIPins.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_PP;
+
+	GPIO_PeriClockControl(GPIOB, ENABLE);
+
+	// NSS
+	SPIPins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_12;
+	GPIO_Init(&SPIPins);
+
+	// SCLK
+	SPIPins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_13;
+	GPIO_Init(&SPIPins);
+
+	// MISO
+	SPIPins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_14;
+	GPIO_Init(&SPIPins);
+
+	// MOSI
+	SPIPins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_15;
+	GPIO_Init(&SPIPins);
+}
+
+void SPI2_Inits(void){
+	SPI2Handle.pSPIx = SPI2;
+	SPI2Handle.SPIConfig.DeviceMode = SPI_DEVICE_MODE_MASTER;
+	SPI2Handle.SPIConfig.BusConfig = SPI_BUS_CONFIG_FD;
+	SPI2Handle.SPIConfig.SclkSpeed = SPI_SCLK_SPEED_DIV2;
+	SPI2Handle.SPIConfig.DFF = SPI_DFF_8BITS;
+	SPI2Handle.SPIConfig.CPOL = SPI_CPOL_LOW;
+	SPI2Handle.SPIConfig.CPHA = SPI_CPHA_FIRST;
+	SPI2Handle.SPIConfig.SSM = SPI_SSM_SW;
+	SPI2Handle.SPIConfig.FrameFormat = SPI_FRAME_FORMAT_MSBFIRST;
+
+	SPI_PeriClockControl(SPI2, ENABLE);
+	SPI_Init(&SPI2Handle);
+	SPI_SSIControl(SPI2, ENABLE);
+
+	if(SPI_DMAInit(&SPI2Handle, &SPI2DMATx, &SPI2DMARx) != DMA_OK)
+		printf("No DMA stream available for SPI2\n");
+
+	// The IRQs of whichever streams were allocated go straight to their handles
+	DMA_IRQBind(&SPI2DMATx);
+	DMA_IRQBind(&SPI2DMARx);
+	DMA_IRQInterruptConfig(DMA_GetIRQNumber(&SPI2DMATx), 2, ENABLE);
+	DMA_IRQInterruptConfig(DMA_GetIRQNumber(&SPI2DMARx), 2, ENABLE);
+}
+
+static void spi_wait_idle(void){
+	while(SPI_GetFlagStatus(SPI2, SPI_BSY_FLAG));
+}
+
+int main(void){
+	uint32_t start, polledCycles, setupCycles, dmaCycles;
+	uint32_t freeLoops = 0;
+
+	initialise_monitor_handles();
+
+	for(uint32_t i = 0; i < BENCH_LEN; i++)
+		txBuf[i] = (uint8_t)i;
+
+	DWT_Init();
+	SPI2_GPIO_Inits();
+	SPI2_Inits();
+
+	while(1){
+		// 1. Polled transfer, the CPU is busy for the whole duration
+		SPI_PeripheralControl(SPI2, ENABLE);
+		start = DWT_CYCCNT;
+		SPI_SendData(SPI2, txBuf, BENCH_LEN);
+		spi_wait_idle();
+		polledCycles = DWT_CYCCNT - start;
+		SPI_PeripheralControl(SPI2, DISABLE);
+
+		// 2. DMA transfer, count how often the CPU gets around the loop meanwhile
+		dmaDone = 0;
+		freeLoops = 0;
+		SPI_PeripheralControl(SPI2, ENABLE);
+		start = DWT_CYCCNT;
+		SPI_SendDataDMA(&SPI2Handle, txBuf, BENCH_LEN);
+		setupCycles = DWT_CYCCNT - start;
+		while(!dmaDone)
+			freeLoops++;
+		spi_wait_idle();
+		dmaCycles = DWT_CYCCNT - start;
+		SPI_PeripheralControl(SPI2, DISABLE);
+
+		printf("Polled: %lu cycles for %d bytes\n", polledCycles, BENCH_LEN);
+		printf("DMA:    %lu cycles total, %lu cycles setup, %lu free loop iterations\n",
+				dmaCycles, setupCycles, freeLoops);
+
+		delay();
+	}
+
+	return 0;
+}
+
+void SPI_ApplicationEventCallback(SPI_Handle_t *pSPIHandle, uint8_t AppEv){
+	if(AppEv == SPI_EVENT_TX_CMPLT)
+		dmaDone = 1;
+	else if(AppEv == SPI_EVENT_DMA_ERR)
+		printf("DMA error\n");
+}
@@ -0,0 +1,140 @@
+/*
+ * 014spi_txrx_benchmark.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Measures the idle time between back-to-back frames on SPI2 (PB12-PB15)
+ * - Old way: SPI_SendData then SPI_ReceiveData for every frame, like 007SPI_cmdhandling
+ * - New way: a single SPI_TransmitReceive over the whole buffer
+ * Connect MOSI (PB15) to MISO (PB14) to also check the received data.
+ */
+
+#define BENCH_LEN		256
+
+// One frame takes 8 bits * SPI prescaler(2) PCLK1 cycles, PCLK1 = HCLK out of reset
+#define CYCLES_PER_FRAME	16
+
+// DWT cycle counter
+#define DEMCR			(*(__vo uint32_t*)0xE000EDFC)
+#define DWT_CTRL		(*(__vo uint32_t*)0xE0001000)
+#define DWT_CYCCNT		(*(__vo uint32_t*)0xE0001004)
+#define DEMCR_TRCENA	24
+
+static uint8_t txBuf[BENCH_LEN];
+static uint8_t rxBuf[BENCH_LEN];
+
+void delay(void){
+	for(uint32_t i = 0; i < 500000; i++);
+}
+
+void DWT_Init(void){
+	DEMCR |= (1 << DEMCR_TRCENA);
+	DWT_CYCCNT = 0;
+	DWT_CTRL |= 1;
+}
+
+void SPI2_GPIO_Inits(void){
+	GPIO_Handle_t SPIPins;
+
+	SPIPins.pGPIOx = GPIOB;
+	SPIPins.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_ALTFN;
+	SPIPins.GPIO_PinConfig.GPIO_PinAltFunMode = 5;
+	SPIPins.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_HIGH;
+	SPIPins.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_NO_PUPD;
+	SPIPins.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_PP;
+
+	GPIO_PeriClockControl(GPIOB, ENABLE);
+
+	// SCLK
+	SPIPins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_13;
+	GPIO_Init(&SPIPins);
+
+	// MISO
+	SPIPins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_14;
+	GPIO_Init(&SPIPins);
+
+	// MOSI
+	SPIPins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_15;
+	GPIO_Init(&SPIPins);
+}
+
+void SPI2_Inits(void){
+	SPI_Handle_t SPI2Handle;
+
+	SPI2Handle.pSPIx = SPI2;
+	SPI2Handle.SPIConfig.DeviceMode = SPI_DEVICE_MODE_MASTER;
+	SPI2Handle.SPIConfig.BusConfig = SPI_BUS_CONFIG_FD;
+	SPI2Handle.SPIConfig.SclkSpeed = SPI_SCLK_SPEED_DIV2;
+	SPI2Handle.SPIConfig.DFF = SPI_DFF_8BITS;
+	SPI2Handle.SPIConfig.CPOL = SPI_CPOL_LOW;
+	SPI2Handle.SPIConfig.CPHA = SPI_CPHA_FIRST;
+	SPI2Handle.SPIConfig.SSM = SPI_SSM_SW;
+	SPI2Handle.SPIConfig.FrameFormat = SPI_FRAME_FORMAT_MSBFIRST;
+
+	SPI_PeriClockControl(SPI2, ENABLE);
+	SPI_Init(&SPI2Handle);
+	SPI_SSIControl(SPI2, ENABLE);
+}
+
+static void bench_report(const char *name, uint32_t cycles){
+	uint32_t busy = BENCH_LEN * CYCLES_PER_FRAME;
+	uint32_t gap = (cycles > busy) ? (cycles - busy) / BENCH_LEN : 0;
+	uint32_t errors = 0;
+
+	for(uint32_t i = 0; i < BENCH_LEN; i++)
+		if(rxBuf[i] != txBuf[i])
+			errors++;
+
+	printf("%s: %lu cycles, %lu cycles gap per frame, %lu loopback errors\n", name, cycles, gap, errors);
+}
+
+int main(void){
+	uint32_t start, cycles;
+
+	initialise_monitor_handles();
+
+	for(uint32_t i = 0; i < BENCH_LEN; i++)
+		txBuf[i] = (uint8_t)(i ^ 0x5A);
+
+	DWT_Init();
+	SPI2_GPIO_Inits();
+	SPI2_Inits();
+
+	while(1){
+		// 1. Send one frame, then collect its answer, one frame at a time
+		memset(rxBuf, 0, sizeof(rxBuf));
+		SPI_PeripheralControl(SPI2, ENABLE);
+		start = DWT_CYCCNT;
+		for(uint32_t i = 0; i < BENCH_LEN; i++){
+			SPI_SendData(SPI2, &txBuf[i], 1);
+			SPI_ReceiveData(SPI2, &rxBuf[i], 1);
+		}
+		cycles = DWT_CYCCNT - start;
+		while(SPI_GetFlagStatus(SPI2, SPI_BSY_FLAG));
+		SPI_PeripheralControl(SPI2, DISABLE);
+		bench_report("SendData/ReceiveData", cycles);
+
+		// 2. Pipelined full-duplex transfer
+		memset(rxBuf, 0, sizeof(rxBuf));
+		SPI_PeripheralControl(SPI2, ENABLE);
+		start = DWT_CYCCNT;
+		SPI_TransmitReceive(SPI2, txBuf, rxBuf, BENCH_LEN);
+		cycles = DWT_CYCCNT - start;
+		while(SPI_GetFlagStatus(SPI2, SPI_BSY_FLAG));
+		SPI_PeripheralControl(SPI2, DISABLE);
+		bench_report("TransmitReceive     ", cycles);
+
+		delay();
+	}
+
+	return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * 015spi_queue_sensors.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Polls two SPI sensors sharing SPI2 (PB13 SCLK, PB14 MISO, PB15 MOSI) through the transfer queue
+ * - Sensor A chip select on PB12, sensor B chip select on PB11
+ * - Each descriptor re-queues itself from its callback, so the bus runs without the main loop
+ * - Releasing CS and the CS delays run from PendSV through the event queue, not from the SPI ISR
+ * The main loop only prints how many samples arrived.
+ */
+
+#define SENSOR_CMD_READ		0x80
+#define SENSOR_SAMPLE_LEN	7
+
+static SPI_Handle_t SPI2Handle;
+
+static uint8_t sensorACmd[SENSOR_SAMPLE_LEN] = { SENSOR_CMD_READ | 0x28 };
+static uint8_t sensorBCmd[SENSOR_SAMPLE_LEN] = { SENSOR_CMD_READ | 0x3B };
+static uint8_t sensorASample[SENSOR_SAMPLE_LEN];
+static uint8_t sensorBSample[SENSOR_SAMPLE_LEN];
+
+static SPI_Transfer_t sensorAXfer;
+static SPI_Transfer_t sensorBXfer;
+
+static __vo uint32_t sensorACount = 0;
+static __vo uint32_t sensorBCount = 0;
+static __vo uint32_t sensorErrors = 0;
+
+void delay(void){
+	for(uint32_t i = 0; i < 500000; i++);
+}
+
+void PendSV_Handler(void){
+	EVT_Dispatch();
+}
+
+void SPI2_GPIO_Inits(void){
+	GPIO_Handle_t Pins;
+
+	GPIO_PeriClockControl(GPIOB, ENABLE);
+
+	Pins.pGPIOx = GPIOB;
+	Pins.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_ALTFN;
+	Pins.GPIO_PinConfig.GPIO_PinAltFunMode = 5;
+	Pins.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_HIGH;
+	Pins.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_NO_PUPD;
+	Pins.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_PP;
+
+	// SCLK, MISO, MOSI
+	Pins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_13;
+	GPIO_Init(&Pins);
+	Pins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_14;
+	GPIO_Init(&Pins);
+	Pins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_15;
+	GPIO_Init(&Pins);
+
+	// Chip selects, idle high
+	Pins.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_OUT;
+	Pins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_12;
+	GPIO_Init(&Pins);
+	GPIO_WriteToOutputPin(GPIOB, GPIO_PIN_NO_12, GPIO_PIN_SET);
+	Pins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_11;
+	GPIO_Init(&Pins);
+	GPIO_WriteToOutputPin(GPIOB, GPIO_PIN_NO_11, GPIO_PIN_SET);
+}
+
+void SPI2_Inits(void){
+	SPI2Handle.pSPIx = SPI2;
+	SPI2Handle.SPIConfig.DeviceMode = SPI_DEVICE_MODE_MASTER;
+	SPI2Handle.SPIConfig.BusConfig = SPI_BUS_CONFIG_FD;
+	SPI2Handle.SPIConfig.SclkSpeed = SPI_SCLK_SPEED_DIV8;
+	SPI2Handle.SPIConfig.DFF = SPI_DFF_8BITS;
+	SPI2Handle.SPIConfig.CPOL = SPI_CPOL_HIGH;
+	SPI2Handle.SPIConfig.CPHA = SPI_CPHA_SECOND;
+	SPI2Handle.SPIConfig.SSM = SPI_SSM_SW;
+	SPI2Handle.SPIConfig.FrameFormat = SPI_FRAME_FORMAT_MSBFIRST;
+
+	SPI_PeriClockControl(SPI2, ENABLE);
+	SPI_Init(&SPI2Handle);
+	SPI_SSIControl(SPI2, ENABLE);
+
+	SPI_IRQBind(&SPI2Handle);
+	SPI_IRQInterruptConfig(IRQ_NO_SPI2, 3, ENABLE);
+}
+
+static void sensor_done(SPI_Handle_t *pSPIHandle, SPI_Transfer_t *pXfer){
+	if(pXfer->Status != SPI_XFER_OK)
+		sensorErrors++;
+	else if(pXfer == &sensorAXfer)
+		sensorACount++;
+	else
+		sensorBCount++;
+
+	// Go around again, the queue takes it behind the other sensor
+	SPI_QueueTransfer(pSPIHandle, pXfer);
+}
+
+static void sensor_xfer_init(SPI_Transfer_t *pXfer, uint8_t *pCmd, uint8_t *pSample, uint8_t csPin){
+	memset(pXfer, 0, sizeof(*pXfer));
+	pXfer->pTxBuffer = pCmd;
+	pXfer->pRxBuffer = pSample;
+	pXfer->len = SENSOR_SAMPLE_LEN;
+	pXfer->pCSPort = GPIOB;
+	pXfer->CSPin = csPin;
+	pXfer->CSSetupDelay = 2;		// Microseconds
+	pXfer->CSHoldDelay = 2;
+	pXfer->Callback = sensor_done;
+}
+
+int main(void){
+	initialise_monitor_handles();
+
+	EVT_Init(EVT_DISPATCH_PENDSV, 15);
+
+	SPI2_GPIO_Inits();
+	SPI2_Inits();
+
+	sensor_xfer_init(&sensorAXfer, sensorACmd, sensorASample, GPIO_PIN_NO_12);
+	sensor_xfer_init(&sensorBXfer, sensorBCmd, sensorBSample, GPIO_PIN_NO_11);
+
+	SPI_QueueTransfer(&SPI2Handle, &sensorAXfer);
+	SPI_QueueTransfer(&SPI2Handle, &sensorBXfer);
+
+	while(1){
+		delay();
+		printf("Sensor A: %lu samples, Sensor B: %lu samples, %lu errors\n", sensorACount, sensorBCount, sensorErrors);
+	}
+
+	return 0;
+}
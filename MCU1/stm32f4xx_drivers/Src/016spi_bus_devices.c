@@ -0,0 +1,146 @@
+/*
+ * 016spi_bus_devices.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Two devices with different SPI settings on SPI2 (PB13 SCLK, PB14 MISO, PB15 MOSI)
+ * - Device A: mode 0, 8-bit, DIV4, CS on PB12
+ * - Device B: mode 3, 16-bit, DIV16, CS on PB11
+ * Measures the cost of switching between them against a full SPI_Init.
+ */
+
+// DWT cycle counter
+#define DEMCR			(*(__vo uint32_t*)0xE000EDFC)
+#define DWT_CTRL		(*(__vo uint32_t*)0xE0001000)
+#define DWT_CYCCNT		(*(__vo uint32_t*)0xE0001004)
+#define DEMCR_TRCENA	24
+
+SPI_Handle_t SPI2Handle;
+SPI_Bus_t SPI2Bus;
+SPI_Device_t DeviceA;
+SPI_Device_t DeviceB;
+
+void delay(void){
+	for(uint32_t i = 0; i < 500000; i++);
+}
+
+void DWT_Init(void){
+	DEMCR |= (1 << DEMCR_TRCENA);
+	DWT_CYCCNT = 0;
+	DWT_CTRL |= 1;
+}
+
+void SPI2_GPIO_Inits(void){
+	GPIO_Handle_t Pins;
+
+	GPIO_PeriClockControl(GPIOB, ENABLE);
+
+	Pins.pGPIOx = GPIOB;
+	Pins.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_ALTFN;
+	Pins.GPIO_PinConfig.GPIO_PinAltFunMode = 5;
+	Pins.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_HIGH;
+	Pins.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_NO_PUPD;
+	Pins.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_PP;
+
+	// SCLK, MISO, MOSI
+	Pins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_13;
+	GPIO_Init(&Pins);
+	Pins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_14;
+	GPIO_Init(&Pins);
+	Pins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_15;
+	GPIO_Init(&Pins);
+
+	// Chip selects
+	Pins.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_OUT;
+	Pins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_12;
+	GPIO_Init(&Pins);
+	Pins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_11;
+	GPIO_Init(&Pins);
+}
+
+void SPI2_Inits(void){
+	SPI2Handle.pSPIx = SPI2;
+	SPI2Handle.SPIConfig.DeviceMode = SPI_DEVICE_MODE_MASTER;
+	SPI2Handle.SPIConfig.BusConfig = SPI_BUS_CONFIG_FD;
+	SPI2Handle.SPIConfig.SclkSpeed = SPI_SCLK_SPEED_DIV4;
+	SPI2Handle.SPIConfig.DFF = SPI_DFF_8BITS;
+	SPI2Handle.SPIConfig.CPOL = SPI_CPOL_LOW;
+	SPI2Handle.SPIConfig.CPHA = SPI_CPHA_FIRST;
+	SPI2Handle.SPIConfig.SSM = SPI_SSM_SW;
+	SPI2Handle.SPIConfig.FrameFormat = SPI_FRAME_FORMAT_MSBFIRST;
+
+	SPI_PeriClockControl(SPI2, ENABLE);
+	SPI_Init(&SPI2Handle);
+	SPI_BusInit(&SPI2Bus, &SPI2Handle);
+
+	DeviceA.SclkSpeed = SPI_SCLK_SPEED_DIV4;
+	DeviceA.DFF = SPI_DFF_8BITS;
+	DeviceA.CPOL = SPI_CPOL_LOW;
+	DeviceA.CPHA = SPI_CPHA_FIRST;
+	DeviceA.FrameFormat = SPI_FRAME_FORMAT_MSBFIRST;
+	DeviceA.pCSPort = GPIOB;
+	DeviceA.CSPin = GPIO_PIN_NO_12;
+	SPI_BusAddDevice(&SPI2Bus, &DeviceA);
+
+	DeviceB.SclkSpeed = SPI_SCLK_SPEED_DIV16;
+	DeviceB.DFF = SPI_DFF_16BITS;
+	DeviceB.CPOL = SPI_CPOL_HIGH;
+	DeviceB.CPHA = SPI_CPHA_SECOND;
+	DeviceB.FrameFormat = SPI_FRAME_FORMAT_MSBFIRST;
+	DeviceB.pCSPort = GPIOB;
+	DeviceB.CSPin = GPIO_PIN_NO_11;
+	SPI_BusAddDevice(&SPI2Bus, &DeviceB);
+}
+
+int main(void){
+	uint8_t cmdA[2] = { 0x9F, 0x00 };
+	uint8_t respA[2];
+	uint16_t cmdB[2] = { 0x8000, 0x0000 };
+	uint16_t respB[2];
+	uint32_t start, sameCycles, switchCycles, initCycles;
+
+	initialise_monitor_handles();
+
+	DWT_Init();
+	SPI2_GPIO_Inits();
+	SPI2_Inits();
+
+	while(1){
+		// 1. Same device twice, the cached CR1 matches so nothing is written
+		SPI_BusTransfer(&SPI2Bus, &DeviceA, cmdA, respA, 2);
+		start = DWT_CYCCNT;
+		SPI_BusAcquire(&SPI2Bus, &DeviceA);
+		sameCycles = DWT_CYCCNT - start;
+		SPI_BusRelease(&SPI2Bus);
+
+		// 2. Switch to the other device
+		start = DWT_CYCCNT;
+		SPI_BusAcquire(&SPI2Bus, &DeviceB);
+		switchCycles = DWT_CYCCNT - start;
+		SPI_TransmitReceive(SPI2, (uint8_t*)cmdB, (uint8_t*)respB, 2);
+		SPI_BusRelease(&SPI2Bus);
+
+		// 3. What the same switch costs with a full re-init
+		start = DWT_CYCCNT;
+		SPI_Init(&SPI2Handle);
+		SPI_PeripheralControl(SPI2, ENABLE);
+		initCycles = DWT_CYCCNT - start;
+		SPI_BusInit(&SPI2Bus, &SPI2Handle);
+
+		printf("Same device: %lu cycles, switch: %lu cycles, SPI_Init: %lu cycles\n",
+				sameCycles, switchCycles, initCycles);
+
+		delay();
+	}
+
+	return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * 017i2c_dma_fifo_read.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Drains the FIFO of an MPU6050 style sensor on I2C1 (PB6 SCL, PB7 SDA) with DMA
+ * - The FIFO count is read with the polled API
+ * - The FIFO contents (up to 1024 bytes) are read with I2C_MasterReceiveDataDMA
+ * The CPU only sees SB, ADDR and the DMA transfer complete interrupt.
+ */
+
+#define SLAVEADDR			0x68
+#define REG_FIFO_COUNT_H	0x72
+#define REG_FIFO_R_W		0x74
+#define FIFO_MAX			1024
+
+static I2C_Handle_t I2C1Handle;
+static DMA_Handle_t I2C1DMATx;
+static DMA_Handle_t I2C1DMARx;
+
+static __noinit uint8_t fifoData[FIFO_MAX];
+static __vo uint8_t rxDone = 0;
+
+void delay(void){
+	for(uint32_t i = 0; i < 500000; i++);
+}
+
+void I2C1_GPIOInits(void){
+	GPIO_Handle_t I2CPins;
+
+	I2CPins.pGPIOx = GPIOB;
+	I2CPins.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_ALTFN;
+	I2CPins.GPIO_PinConfig.GPIO_PinAltFunMode = 4;
+	I2CPins.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_OD;
+	I2CPins.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_PU;
+	I2CPins.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_FAST;
+
+	GPIO_PeriClockControl(GPIOB, ENABLE);
+
+	// SCL
+	I2CPins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_6;
+	GPIO_Init(&I2CPins);
+
+	// SDA
+	I2CPins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_7;
+	GPIO_Init(&I2CPins);
+}
+
+void I2C1_Inits(void){
+	I2C1Handle.pI2Cx = I2C1;
+	I2C1Handle.I2C_Config.AckControl = I2C_ACK_ENABLE;
+	I2C1Handle.I2C_Config.DeviceAddress = 0x3F;
+	I2C1Handle.I2C_Config.FMDutyCycle = I2C_FM_DUTY_2;
+	I2C1Handle.I2C_Config.SCLSpeed = I2C_SCL_SPEED_FM4K;
+
+	I2C_Init(&I2C1Handle);
+
+	if(I2C_DMAInit(&I2C1Handle, &I2C1DMATx, &I2C1DMARx) != DMA_OK)
+		printf("No DMA stream available for I2C1\n");
+
+	I2C_IRQBind(&I2C1Handle);
+	DMA_IRQBind(&I2C1DMATx);
+	DMA_IRQBind(&I2C1DMARx);
+
+	I2C_IRQInterruptConfig(IRQ_NO_I2C1_EV, 1, ENABLE);
+	I2C_IRQInterruptConfig(IRQ_NO_I2C1_ER, 1, ENABLE);
+	DMA_IRQInterruptConfig(DMA_GetIRQNumber(&I2C1DMATx), 2, ENABLE);
+	DMA_IRQInterruptConfig(DMA_GetIRQNumber(&I2C1DMARx), 2, ENABLE);
+}
+
+static uint16_t read_fifo_count(void){
+	uint8_t reg = REG_FIFO_COUNT_H;
+	uint8_t count[2];
+
+	I2C_MasterSendData(&I2C1Handle, &reg, 1, SLAVEADDR, I2C_ENABLE_RS);
+	I2C_MasterReceiveData(&I2C1Handle, count, 2, SLAVEADDR, I2C_DISABLE_RS);
+
+	return ((uint16_t)count[0] << 8) | count[1];
+}
+
+int main(void){
+	uint8_t reg = REG_FIFO_R_W;
+	uint16_t count;
+	uint32_t checksum;
+
+	initialise_monitor_handles();
+
+	I2C1_GPIOInits();
+	I2C1_Inits();
+	I2C_PeripheralControl(&I2C1Handle, ENABLE);
+
+	while(1){
+		count = read_fifo_count();
+		if(count > FIFO_MAX)
+			count = FIFO_MAX;
+
+		if(count > 0){
+			// Register address, then a repeated start straight into the DMA read
+			rxDone = 0;
+			I2C_MasterSendData(&I2C1Handle, &reg, 1, SLAVEADDR, I2C_ENABLE_RS);
+			I2C_MasterReceiveDataDMA(&I2C1Handle, fifoData, count, SLAVEADDR, I2C_DISABLE_RS);
+
+			while(!rxDone);
+
+			checksum = 0;
+			for(uint16_t i = 0; i < count; i++)
+				checksum += fifoData[i];
+			printf("Read %u FIFO bytes, checksum %lu\n", count, checksum);
+		}
+
+		delay();
+	}
+
+	return 0;
+}
+
+void I2C_ApplicationEventCallback(I2C_Handle_t *pI2CHandle, uint8_t AppEv){
+	if(AppEv == I2C_EV_RX_CMPLT){
+		rxDone = 1;
+	} else if(AppEv == I2C_ERROR_AF || AppEv == I2C_ERROR_DMA){
+		printf("Error %d, releasing the bus\n", AppEv);
+		I2C_GenerateStopCondition(pI2CHandle->pI2Cx);
+		rxDone = 1;
+	}
+}
@@ -0,0 +1,131 @@
+/*
+ * 018i2c_job_queue.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Two devices sharing I2C1 (PB6 SCL, PB7 SDA) through the job queue
+ * - DS1307 RTC at 0x68: register 0x00, 7 bytes of time and date
+ * - 24C32 EEPROM at 0x50: 16-bit address 0x0000, 32 bytes
+ * Each job re-queues itself from its callback, main only prints the counters.
+ * The next START waits for the previous STOP from PendSV through the event queue.
+ */
+
+#define RTC_ADDR		0x68
+#define EEPROM_ADDR		0x50
+
+static I2C_Handle_t I2C1Handle;
+
+static uint8_t rtcReg = 0x00;
+static uint8_t rtcData[7];
+static uint8_t eepromReg[2] = { 0x00, 0x00 };
+static uint8_t eepromData[32];
+
+static I2C_Job_t rtcJob;
+static I2C_Job_t eepromJob;
+
+static __vo uint32_t rtcCount = 0;
+static __vo uint32_t eepromCount = 0;
+static __vo uint32_t errorCount = 0;
+
+void delay(void){
+	for(uint32_t i = 0; i < 500000; i++);
+}
+
+void PendSV_Handler(void){
+	EVT_Dispatch();
+}
+
+void I2C1_GPIOInits(void){
+	GPIO_Handle_t I2CPins;
+
+	I2CPins.pGPIOx = GPIOB;
+	I2CPins.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_ALTFN;
+	I2CPins.GPIO_PinConfig.GPIO_PinAltFunMode = 4;
+	I2CPins.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_OD;
+	I2CPins.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_PU;
+	I2CPins.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_FAST;
+
+	GPIO_PeriClockControl(GPIOB, ENABLE);
+
+	// SCL
+	I2CPins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_6;
+	GPIO_Init(&I2CPins);
+
+	// SDA
+	I2CPins.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_7;
+	GPIO_Init(&I2CPins);
+}
+
+void I2C1_Inits(void){
+	I2C1Handle.pI2Cx = I2C1;
+	I2C1Handle.I2C_Config.AckControl = I2C_ACK_ENABLE;
+	I2C1Handle.I2C_Config.DeviceAddress = 0x3F;
+	I2C1Handle.I2C_Config.FMDutyCycle = I2C_FM_DUTY_2;
+	I2C1Handle.I2C_Config.SCLSpeed = I2C_SCL_SPEED_SM;
+
+	I2C_Init(&I2C1Handle);
+
+	I2C_IRQBind(&I2C1Handle);
+	I2C_IRQInterruptConfig(IRQ_NO_I2C1_EV, 1, ENABLE);
+	I2C_IRQInterruptConfig(IRQ_NO_I2C1_ER, 1, ENABLE);
+}
+
+static void job_done(I2C_Handle_t *pI2CHandle, I2C_Job_t *pJob, uint8_t AppEv){
+	if(AppEv != I2C_EV_RX_CMPLT)
+		errorCount++;
+	else if(pJob == &rtcJob)
+		rtcCount++;
+	else
+		eepromCount++;
+
+	// Straight back into the queue, behind the other device
+	I2C_QueueJob(pI2CHandle, pJob);
+}
+
+int main(void){
+	initialise_monitor_handles();
+
+	EVT_Init(EVT_DISPATCH_PENDSV, 15);
+
+	I2C1_GPIOInits();
+	I2C1_Inits();
+	I2C_PeripheralControl(&I2C1Handle, ENABLE);
+
+	memset(&rtcJob, 0, sizeof(rtcJob));
+	rtcJob.SlaveAddr = RTC_ADDR;
+	rtcJob.pTxBuffer = &rtcReg;
+	rtcJob.TxLen = 1;
+	rtcJob.pRxBuffer = rtcData;
+	rtcJob.RxLen = sizeof(rtcData);
+	rtcJob.sr = I2C_ENABLE_RS;
+	rtcJob.Callback = job_done;
+
+	memset(&eepromJob, 0, sizeof(eepromJob));
+	eepromJob.SlaveAddr = EEPROM_ADDR;
+	eepromJob.pTxBuffer = eepromReg;
+	eepromJob.TxLen = sizeof(eepromReg);
+	eepromJob.pRxBuffer = eepromData;
+	eepromJob.RxLen = sizeof(eepromData);
+	eepromJob.sr = I2C_ENABLE_RS;
+	eepromJob.Callback = job_done;
+
+	I2C_QueueJob(&I2C1Handle, &rtcJob);
+	I2C_QueueJob(&I2C1Handle, &eepromJob);
+
+	while(1){
+		delay();
+		printf("RTC reads: %lu, EEPROM reads: %lu, errors: %lu, seconds register: %02x\n",
+				rtcCount, eepromCount, errorCount, rtcData[0]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * 019usart_dma_idle_rx.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Receives a continuous stream on USART2 (PA2 TX, PA3 RX) at 921600 baud
+ * - DMA1 stream 5 fills a 512 byte ring in circular mode
+ * - Idle line, half and full transfer events hand out the new bytes in place
+ * Feed it from a USB-serial adapter, e.g. a large file sent with no pacing.
+ */
+
+#define RX_RING_SIZE		512
+
+// The CPU-side state lives in CCM RAM, off the SRAM bus the DMA writes rxRing through
+static __ccmram_bss USART_Handle_t usart2_handle;
+static __ccmram_bss DMA_Handle_t usart2DMARx;
+
+// Written by the DMA before the CPU reads it, so the startup code does not clear it
+static __noinit uint8_t rxRing[RX_RING_SIZE];
+
+static __ccmram_bss __vo uint32_t rxBytes;
+static __ccmram_bss __vo uint32_t rxSpans;
+static __ccmram_bss __vo uint32_t rxChecksum;
+static __ccmram_bss __vo uint32_t rxErrors;
+
+void delay(void){
+	for(uint32_t i = 0; i < 500000; i++);
+}
+
+void USART2_GPIOInit(void){
+	GPIO_Handle_t usart_gpios;
+
+	usart_gpios.pGPIOx = GPIOA;
+	usart_gpios.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_ALTFN;
+	usart_gpios.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_PP;
+	usart_gpios.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_PU;
+	usart_gpios.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_FAST;
+	usart_gpios.GPIO_PinConfig.GPIO_PinAltFunMode = 7;
+
+	GPIO_PeriClockControl(GPIOA, ENABLE);
+
+	// USART2 TX
+	usart_gpios.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_2;
+	GPIO_Init(&usart_gpios);
+
+	// USART2 RX
+	usart_gpios.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_3;
+	GPIO_Init(&usart_gpios);
+}
+
+void USART2_Init(void){
+	usart2_handle.pUSARTx = USART2;
+	usart2_handle.USART_Config.baudRate = USART_STD_BAUD_921600;
+	usart2_handle.USART_Config.HWFlowControl = USART_HW_FLOW_CTRL_NONE;
+	usart2_handle.USART_Config.mode = USART_MODE_TXRX;
+	usart2_handle.USART_Config.noOfStopBits = USART_STOPBITS_1;
+	usart2_handle.USART_Config.wordLength = USART_WORDLEN_8BITS;
+	usart2_handle.USART_Config.parityControl = USART_PARITY_DISABLE;
+	USART_Init(&usart2_handle);
+
+	if(USART_DMAInit(&usart2_handle, &usart2DMARx) != DMA_OK)
+		printf("No DMA stream available for USART2 Rx\n");
+
+	USART_IRQBind(&usart2_handle);
+	DMA_IRQBind(&usart2DMARx);
+
+	// Same priority for both, they share the ring read position
+	USART_IRQInterruptConfig(IRQ_NO_USART2, ENABLE);
+	USART_IRQPriorityConfig(IRQ_NO_USART2, 2);
+	DMA_IRQInterruptConfig(DMA_GetIRQNumber(&usart2DMARx), 2, ENABLE);
+}
+
+int main(void){
+	initialise_monitor_handles();
+
+	USART2_GPIOInit();
+	USART2_Init();
+	USART_PeripheralControl(USART2, ENABLE);
+
+	USART_ReceiveToIdleDMA(&usart2_handle, rxRing, RX_RING_SIZE);
+
+	while(1){
+		delay();
+		printf("Received %lu bytes in %lu spans, checksum %lu, errors %lu\n",
+				rxBytes, rxSpans, rxChecksum, rxErrors);
+	}
+
+	return 0;
+}
+
+void USART_ApplicationEventCallback(USART_Handle_t *pUSARTHandle, uint8_t AppEv){
+	if(AppEv == USART_EVENT_RX_SPAN){
+		// Consume in place, DMA keeps writing behind us
+		for(uint16_t i = 0; i < pUSARTHandle->RxSpanLen; i++)
+			rxChecksum += pUSARTHandle->pRxSpan[i];
+		rxBytes += pUSARTHandle->RxSpanLen;
+		rxSpans++;
+	} else if(AppEv == USART_ERREVENT_ORE || AppEv == USART_ERREVENT_FE || AppEv == USART_ERREVENT_NE){
+		rxErrors++;
+	} else if(AppEv == USART_ERREVENT_DMA){
+		rxErrors++;
+		USART_ReceiveToIdleDMA(pUSARTHandle, rxRing, RX_RING_SIZE);
+	}
+}
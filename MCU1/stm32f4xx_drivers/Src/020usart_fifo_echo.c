@@ -0,0 +1,106 @@
+/*
+ * 020usart_fifo_echo.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#include "stm32f407xx.h"
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Echo plus log traffic sharing USART2 (PA2 TX, PA3 RX) at 115200 baud
+ * - Everything received is echoed back through the Tx FIFO
+ * - A status line is queued every loop, it interleaves with the echo
+ * Neither path waits for the line, only the final USART_Flush does.
+ */
+
+#define TX_FIFO_SIZE		512
+#define RX_FIFO_SIZE		128
+
+static USART_Handle_t usart2_handle;
+
+// Only the CPU touches the FIFOs, CCM RAM has no wait states
+static __ccmram_bss uint8_t txFifo[TX_FIFO_SIZE];
+static __ccmram_bss uint8_t rxFifo[RX_FIFO_SIZE];
+
+static __vo uint32_t rxDropped = 0;
+
+void delay(void){
+	for(uint32_t i = 0; i < 500000; i++);
+}
+
+void USART2_GPIOInit(void){
+	GPIO_Handle_t usart_gpios;
+
+	usart_gpios.pGPIOx = GPIOA;
+	usart_gpios.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_ALTFN;
+	usart_gpios.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_PP;
+	usart_gpios.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_PU;
+	usart_gpios.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_FAST;
+	usart_gpios.GPIO_PinConfig.GPIO_PinAltFunMode = 7;
+
+	GPIO_PeriClockControl(GPIOA, ENABLE);
+
+	// USART2 TX
+	usart_gpios.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_2;
+	GPIO_Init(&usart_gpios);
+
+	// USART2 RX
+	usart_gpios.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_3;
+	GPIO_Init(&usart_gpios);
+}
+
+void USART2_Init(void){
+	usart2_handle.pUSARTx = USART2;
+	usart2_handle.USART_Config.baudRate = USART_STD_BAUD_115200;
+	usart2_handle.USART_Config.HWFlowControl = USART_HW_FLOW_CTRL_NONE;
+	usart2_handle.USART_Config.mode = USART_MODE_TXRX;
+	usart2_handle.USART_Config.noOfStopBits = USART_STOPBITS_1;
+	usart2_handle.USART_Config.wordLength = USART_WORDLEN_8BITS;
+	usart2_handle.USART_Config.parityControl = USART_PARITY_DISABLE;
+	USART_Init(&usart2_handle);
+
+	USART_IRQBind(&usart2_handle);
+	USART_IRQInterruptConfig(IRQ_NO_USART2, ENABLE);
+	USART_FifoInit(&usart2_handle, txFifo, TX_FIFO_SIZE, rxFifo, RX_FIFO_SIZE);
+}
+
+int main(void){
+	uint8_t buf[32];
+	char line[64];
+	uint32_t len, loops = 0;
+
+	USART2_GPIOInit();
+	USART2_Init();
+	USART_PeripheralControl(USART2, ENABLE);
+
+	while(1){
+		// Protocol side: echo whatever came in
+		while((len = USART_Read(&usart2_handle, buf, sizeof(buf))) > 0)
+			USART_Write(&usart2_handle, buf, len);
+
+		// Logging side
+		len = snprintf(line, sizeof(line), "\r\nloop %lu, dropped %lu\r\n", loops++, rxDropped);
+		USART_Write(&usart2_handle, (uint8_t*)line, len);
+
+		if(loops == 1000){
+			const char *bye = "bye\r\n";
+			USART_Write(&usart2_handle, (const uint8_t*)bye, strlen(bye));
+			// Make sure the last byte is out before the transmitter goes away
+			USART_Flush(&usart2_handle);
+			USART_PeripheralControl(USART2, DISABLE);
+			while(1);
+		}
+
+		delay();
+	}
+
+	return 0;
+}
+
+void USART_ApplicationEventCallback(USART_Handle_t *pUSARTHandle, uint8_t AppEv){
+	if(AppEv == USART_ERREVENT_RX_FIFO)
+		rxDropped++;
+}
@@ -0,0 +1,126 @@
+/*
+ * 021rcc_168mhz.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Runs the core at 168 MHz from the 8 MHz HSE through the PLL
+ * - PLL: M = 8, N = 336, P = 2, Q = 7 (48 MHz for USB)
+ * - HCLK 168 MHz, PCLK1 42 MHz, PCLK2 84 MHz
+ * The same message goes out on USART2 (PA2) at 115200 before and after the switch,
+ * both must be readable, which shows USART_SetBaudRate picks up the new PCLK1.
+ */
+
+// DWT cycle counter
+#define DEMCR			(*(__vo uint32_t*)0xE000EDFC)
+#define DWT_CTRL		(*(__vo uint32_t*)0xE0001000)
+#define DWT_CYCCNT		(*(__vo uint32_t*)0xE0001004)
+#define DEMCR_TRCENA	24
+
+USART_Handle_t usart2_handle;
+
+static const char msg[] = "The quick brown fox jumps over the lazy dog\r\n";
+
+void DWT_Init(void){
+	DEMCR |= (1 << DEMCR_TRCENA);
+	DWT_CYCCNT = 0;
+	DWT_CTRL |= 1;
+}
+
+void USART2_GPIOInit(void){
+	GPIO_Handle_t usart_gpios;
+
+	usart_gpios.pGPIOx = GPIOA;
+	usart_gpios.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_ALTFN;
+	usart_gpios.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_PP;
+	usart_gpios.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_PU;
+	usart_gpios.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_FAST;
+	usart_gpios.GPIO_PinConfig.GPIO_PinAltFunMode = 7;
+
+	GPIO_PeriClockControl(GPIOA, ENABLE);
+
+	// USART2 TX
+	usart_gpios.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_2;
+	GPIO_Init(&usart_gpios);
+}
+
+void USART2_Init(void){
+	usart2_handle.pUSARTx = USART2;
+	usart2_handle.USART_Config.baudRate = USART_STD_BAUD_115200;
+	usart2_handle.USART_Config.HWFlowControl = USART_HW_FLOW_CTRL_NONE;
+	usart2_handle.USART_Config.mode = USART_MODE_ONLY_TX;
+	usart2_handle.USART_Config.noOfStopBits = USART_STOPBITS_1;
+	usart2_handle.USART_Config.wordLength = USART_WORDLEN_8BITS;
+	usart2_handle.USART_Config.parityControl = USART_PARITY_DISABLE;
+	USART_Init(&usart2_handle);
+	USART_PeripheralControl(USART2, ENABLE);
+}
+
+static void print_clocks(void){
+	printf("SYSCLK %lu, HCLK %lu, PCLK1 %lu, PCLK2 %lu, BRR 0x%04lx\n",
+			RCC_GetSYSCLKValue(), RCC_GetHCLKValue(), RCC_GetPCLK1Value(), RCC_GetPCLK2Value(),
+			USART2->BRR);
+}
+
+static uint32_t bench_loop(void){
+	__vo uint32_t sum = 0;
+	uint32_t start = DWT_CYCCNT;
+
+	for(uint32_t i = 0; i < 100000; i++)
+		sum += i;
+
+	return DWT_CYCCNT - start;
+}
+
+int main(void){
+	RCC_ClkConfig_t clk;
+	uint32_t cycles;
+	uint8_t status;
+
+	initialise_monitor_handles();
+
+	DWT_Init();
+	USART2_GPIOInit();
+
+	// 1. Reset clock, HSI 16 MHz
+	USART2_Init();
+	print_clocks();
+	USART_SendData(&usart2_handle, (uint8_t*)msg, strlen(msg));
+	cycles = bench_loop();
+	printf("Loop at 16 MHz: %lu cycles\n", cycles);
+
+	// 2. PLL from HSE
+	clk.ClockSource = RCC_CLK_SRC_PLL;
+	clk.PLLSource = RCC_PLL_SRC_HSE;
+	clk.PLLM = 8;
+	clk.PLLN = 336;
+	clk.PLLP = 2;
+	clk.PLLQ = 7;
+	clk.AHBPrescaler = RCC_AHB_DIV1;
+	clk.APB1Prescaler = RCC_APB_DIV4;
+	clk.APB2Prescaler = RCC_APB_DIV2;
+	clk.VoltageScale = RCC_VOS_SCALE1;
+
+	status = RCC_ConfigSystemClock(&clk);
+	if(status != RCC_OK)
+		printf("RCC_ConfigSystemClock failed: %d\n", status);
+
+	// The dividers were computed for 16 MHz, redo them
+	USART2_Init();
+	print_clocks();
+	USART_SendData(&usart2_handle, (uint8_t*)msg, strlen(msg));
+	cycles = bench_loop();
+	printf("Loop at 168 MHz: %lu cycles\n", cycles);
+
+	while(1);
+
+	return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * 022flash_art_benchmark.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Cycle counts of the bubble and insertion sorts from 002SampleApp at 168 MHz (5 wait states)
+ * - with prefetch and both caches off, which is the flash reset state
+ * - prefetch only, caches only, everything on
+ * and at 16 MHz with zero wait states as a reference.
+ * The code runs from flash, the array lives in SRAM.
+ */
+
+#define SORT_LEN		256
+
+// DWT cycle counter
+#define DEMCR			(*(__vo uint32_t*)0xE000EDFC)
+#define DWT_CTRL		(*(__vo uint32_t*)0xE0001000)
+#define DWT_CYCCNT		(*(__vo uint32_t*)0xE0001004)
+#define DEMCR_TRCENA	24
+
+static int numbers[SORT_LEN];
+
+void DWT_Init(void){
+	DEMCR |= (1 << DEMCR_TRCENA);
+	DWT_CYCCNT = 0;
+	DWT_CTRL |= 1;
+}
+
+static void array_fill_numbers(int *pNumbers, unsigned int len){
+	srand(1);
+	for(unsigned int i = 0; i < len; i++)
+		pNumbers[i] = rand() % 1000;
+}
+
+static void swap_numbers(int *x, int *y){
+	int temp = *x;
+	*x = *y;
+	*y = temp;
+}
+
+static void bubble_sort(int *pNumbers, unsigned int len){
+	int i, j, flag = 0;
+
+	for(i = 0; i < len - 1; i++){
+		flag = 0;
+		for(j = 0; j < len - 1 - i; j++){
+			if(pNumbers[j] > pNumbers[j + 1]){
+				swap_numbers(&pNumbers[j], &pNumbers[j + 1]);
+				flag = 1;
+			}
+		}
+		if(flag == 0)
+			break;
+	}
+}
+
+static void insertion_sort(int *pNumbers, unsigned int len){
+	int i, j, num;
+
+	for(i = 1; i < len; i++){
+		j = i - 1;
+		num = pNumbers[i];
+		while((j > -1) && (pNumbers[j] > num)){
+			pNumbers[j + 1] = pNumbers[j];
+			j--;
+		}
+		pNumbers[j + 1] = num;
+	}
+}
+
+static void run_bench(const char *name){
+	uint32_t start, bubble, insertion;
+
+	array_fill_numbers(numbers, SORT_LEN);
+	start = DWT_CYCCNT;
+	bubble_sort(numbers, SORT_LEN);
+	bubble = DWT_CYCCNT - start;
+
+	array_fill_numbers(numbers, SORT_LEN);
+	start = DWT_CYCCNT;
+	insertion_sort(numbers, SORT_LEN);
+	insertion = DWT_CYCCNT - start;
+
+	printf("%-22s LATENCY %lu, ACR 0x%03lx: bubble %lu cycles, insertion %lu cycles\n",
+			name, (FLASH->ACR >> FLASH_ACR_LATENCY) & 0b111, FLASH->ACR, bubble, insertion);
+}
+
+int main(void){
+	RCC_ClkConfig_t clk;
+
+	initialise_monitor_handles();
+
+	DWT_Init();
+
+	// 1. Reference, 16 MHz HSI with no wait states
+	FLASH_AcceleratorControl(DISABLE, DISABLE, DISABLE);
+	run_bench("16 MHz, no ART:");
+
+	// 2. 168 MHz from the PLL, the accelerator stays off for now
+	clk.ClockSource = RCC_CLK_SRC_PLL;
+	clk.PLLSource = RCC_PLL_SRC_HSE;
+	clk.PLLM = 8;
+	clk.PLLN = 336;
+	clk.PLLP = 2;
+	clk.PLLQ = 7;
+	clk.AHBPrescaler = RCC_AHB_DIV1;
+	clk.APB1Prescaler = RCC_APB_DIV4;
+	clk.APB2Prescaler = RCC_APB_DIV2;
+	clk.VoltageScale = RCC_VOS_SCALE1;
+	RCC_ConfigSystemClock(&clk);
+	run_bench("168 MHz, no ART:");
+
+	FLASH_AcceleratorControl(ENABLE, DISABLE, DISABLE);
+	run_bench("168 MHz, prefetch:");
+
+	FLASH_AcceleratorControl(DISABLE, ENABLE, ENABLE);
+	run_bench("168 MHz, I/D cache:");
+
+	FLASH_AcceleratorControl(ENABLE, ENABLE, ENABLE);
+	run_bench("168 MHz, all:");
+
+	while(1);
+
+	return 0;
+}
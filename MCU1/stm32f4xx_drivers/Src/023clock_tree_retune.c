@@ -0,0 +1,106 @@
+/*
+ * 023clock_tree_retune.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Same as 021rcc_168mhz, but USART2 and I2C1 are initialised once with clock tracking on.
+ * After the switch to 168 MHz the drivers re-tune themselves from the clock change
+ * notification, the message on USART2 (PA2) at 115200 must stay readable and the
+ * I2C1 CCR/TRISE printed before and after must follow PCLK1.
+ */
+
+USART_Handle_t usart2_handle;
+I2C_Handle_t i2c1_handle;
+
+static const char msg[] = "The quick brown fox jumps over the lazy dog\r\n";
+
+void USART2_GPIOInit(void){
+	GPIO_Handle_t usart_gpios;
+
+	usart_gpios.pGPIOx = GPIOA;
+	usart_gpios.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_ALTFN;
+	usart_gpios.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_PP;
+	usart_gpios.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_PU;
+	usart_gpios.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_FAST;
+	usart_gpios.GPIO_PinConfig.GPIO_PinAltFunMode = 7;
+
+	GPIO_PeriClockControl(GPIOA, ENABLE);
+
+	// USART2 TX
+	usart_gpios.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_2;
+	GPIO_Init(&usart_gpios);
+}
+
+void USART2_Init(void){
+	usart2_handle.pUSARTx = USART2;
+	usart2_handle.USART_Config.baudRate = USART_STD_BAUD_115200;
+	usart2_handle.USART_Config.HWFlowControl = USART_HW_FLOW_CTRL_NONE;
+	usart2_handle.USART_Config.mode = USART_MODE_ONLY_TX;
+	usart2_handle.USART_Config.noOfStopBits = USART_STOPBITS_1;
+	usart2_handle.USART_Config.wordLength = USART_WORDLEN_8BITS;
+	usart2_handle.USART_Config.parityControl = USART_PARITY_DISABLE;
+	USART_Init(&usart2_handle);
+	USART_PeripheralControl(USART2, ENABLE);
+}
+
+void I2C1_Init(void){
+	i2c1_handle.pI2Cx = I2C1;
+	i2c1_handle.I2C_Config.AckControl = I2C_ACK_ENABLE;
+	i2c1_handle.I2C_Config.DeviceAddress = 0x61;
+	i2c1_handle.I2C_Config.FMDutyCycle = I2C_FM_DUTY_2;
+	i2c1_handle.I2C_Config.SCLSpeed = I2C_SCL_SPEED_FM4K;
+	I2C_Init(&i2c1_handle);
+}
+
+static void print_clocks(void){
+	const RCC_ClockTree_t *pClocks = RCC_GetClockTree();
+
+	printf("HCLK %lu, PCLK1 %lu: USART2 BRR 0x%04lx, I2C1 CCR 0x%04lx TRISE %lu\n",
+			pClocks->HCLK, pClocks->PCLK1, USART2->BRR, I2C1->CCR, I2C1->TRISE);
+}
+
+int main(void){
+	RCC_ClkConfig_t clk;
+
+	initialise_monitor_handles();
+
+	USART2_GPIOInit();
+	USART2_Init();
+	I2C1_Init();
+
+	USART_ClockTrackingControl(&usart2_handle, ENABLE);
+	I2C_ClockTrackingControl(&i2c1_handle, ENABLE);
+
+	// 1. Reset clock, HSI 16 MHz
+	print_clocks();
+	USART_SendData(&usart2_handle, (uint8_t*)msg, strlen(msg));
+
+	// 2. PLL from HSE, no re-init afterwards
+	clk.ClockSource = RCC_CLK_SRC_PLL;
+	clk.PLLSource = RCC_PLL_SRC_HSE;
+	clk.PLLM = 8;
+	clk.PLLN = 336;
+	clk.PLLP = 2;
+	clk.PLLQ = 7;
+	clk.AHBPrescaler = RCC_AHB_DIV1;
+	clk.APB1Prescaler = RCC_APB_DIV4;
+	clk.APB2Prescaler = RCC_APB_DIV2;
+	clk.VoltageScale = RCC_VOS_SCALE1;
+	RCC_ConfigSystemClock(&clk);
+
+	print_clocks();
+	USART_SendData(&usart2_handle, (uint8_t*)msg, strlen(msg));
+
+	while(1);
+
+	return 0;
+}
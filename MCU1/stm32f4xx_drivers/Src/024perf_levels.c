@@ -0,0 +1,89 @@
+/*
+ * 024perf_levels.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Burst-then-idle pattern with RCC_SetPerformanceLevel
+ * USART2 (PA2, 115200) streams from its Tx FIFO while the clock steps through every
+ * operating point and back down. The driver tracks the clock, each switch waits for the
+ * FIFO to drain, so the text on the terminal must stay intact. The switch latency in
+ * core cycles is printed for every step.
+ */
+
+static USART_Handle_t usart2_handle;
+
+static uint8_t txFifoBuf[256];
+
+static const char msg[] = "The quick brown fox jumps over the lazy dog\r\n";
+
+static const uint8_t levels[] = { RCC_PERF_HSE8, RCC_PERF_PLL84, RCC_PERF_PLL120, RCC_PERF_PLL168,
+								  RCC_PERF_PLL84, RCC_PERF_HSI16 };
+
+void USART2_GPIOInit(void){
+	GPIO_Handle_t usart_gpios;
+
+	usart_gpios.pGPIOx = GPIOA;
+	usart_gpios.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_ALTFN;
+	usart_gpios.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_PP;
+	usart_gpios.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_PU;
+	usart_gpios.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_FAST;
+	usart_gpios.GPIO_PinConfig.GPIO_PinAltFunMode = 7;
+
+	GPIO_PeriClockControl(GPIOA, ENABLE);
+
+	// USART2 TX
+	usart_gpios.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_2;
+	GPIO_Init(&usart_gpios);
+}
+
+void USART2_Init(void){
+	usart2_handle.pUSARTx = USART2;
+	usart2_handle.USART_Config.baudRate = USART_STD_BAUD_115200;
+	usart2_handle.USART_Config.HWFlowControl = USART_HW_FLOW_CTRL_NONE;
+	usart2_handle.USART_Config.mode = USART_MODE_ONLY_TX;
+	usart2_handle.USART_Config.noOfStopBits = USART_STOPBITS_1;
+	usart2_handle.USART_Config.wordLength = USART_WORDLEN_8BITS;
+	usart2_handle.USART_Config.parityControl = USART_PARITY_DISABLE;
+	USART_Init(&usart2_handle);
+	USART_FifoInit(&usart2_handle, txFifoBuf, sizeof(txFifoBuf), NULL, 0);
+	USART_PeripheralControl(USART2, ENABLE);
+}
+
+int main(void){
+	uint32_t cycles;
+	uint8_t status;
+
+	initialise_monitor_handles();
+
+	USART2_GPIOInit();
+	USART2_Init();
+	USART_IRQBind(&usart2_handle);
+	USART_IRQInterruptConfig(IRQ_NO_USART2, ENABLE);
+	USART_ClockTrackingControl(&usart2_handle, ENABLE);
+
+	for(uint32_t i = 0; i < sizeof(levels); i++){
+		// Burst of output still in the FIFO when the switch is requested
+		USART_Write(&usart2_handle, (const uint8_t*)msg, strlen(msg));
+
+		status = RCC_SetPerformanceLevel(levels[i], &cycles);
+		if(status != RCC_OK){
+			printf("Level %d failed: %d\n", levels[i], status);
+			continue;
+		}
+
+		printf("Level %d: HCLK %lu, switch took %lu cycles\n", levels[i], RCC_GetHCLKValue(), cycles);
+	}
+
+	while(1);
+
+	return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * 025nvic_preemption.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <stdio.h>
+
+/*
+ * Nested preemption with the NVIC driver, no hardware needed
+ * EXTI0 and EXTI1 are triggered from software with NVIC_SetPending.
+ * With 2 preempt bits, EXTI1 (preempt 1) interrupts EXTI0 (preempt 2): inside EXTI1
+ * both IRQs show up as active. Then EXTI1 is moved to the same preempt level with a
+ * better sub-priority, it now has to wait until EXTI0 returns.
+ */
+
+static __vo uint8_t nested;
+
+void EXTI0_IRQHandler(void){
+	nested = 0;
+	NVIC_SetPending(IRQ_NO_EXTI1);
+	// Give EXTI1 the chance to preempt
+	for(__vo uint32_t i = 0; i < 100; i++);
+}
+
+void EXTI1_IRQHandler(void){
+	nested = NVIC_GetActive(IRQ_NO_EXTI0);
+}
+
+static void run(const char *name){
+	NVIC_SetPending(IRQ_NO_EXTI0);
+	while(NVIC_GetPending(IRQ_NO_EXTI0) || NVIC_GetPending(IRQ_NO_EXTI1) ||
+			NVIC_GetActive(IRQ_NO_EXTI0) || NVIC_GetActive(IRQ_NO_EXTI1));
+	printf("%s: EXTI1 %s EXTI0\n", name, nested ? "preempted" : "waited for");
+}
+
+int main(void){
+	initialise_monitor_handles();
+
+	NVIC_SetPriorityGrouping(NVIC_PRIGROUP_2_2);
+
+	NVIC_IRQPriorityConfig(IRQ_NO_EXTI0, NVIC_EncodePriority(2, 0));
+	NVIC_IRQPriorityConfig(IRQ_NO_EXTI1, NVIC_EncodePriority(1, 3));
+	NVIC_IRQInterruptConfig(IRQ_NO_EXTI0, ENABLE);
+	NVIC_IRQInterruptConfig(IRQ_NO_EXTI1, ENABLE);
+	run("Preempt 1 vs 2");
+
+	NVIC_IRQPriorityConfig(IRQ_NO_EXTI1, NVIC_EncodePriority(2, 0));
+	NVIC_IRQPriorityConfig(IRQ_NO_EXTI0, NVIC_EncodePriority(2, 3));
+	run("Same preempt, better sub");
+
+	printf("EXTI0 priority %lu, EXTI1 priority %lu\n", NVIC_GetPriority(IRQ_NO_EXTI0), NVIC_GetPriority(IRQ_NO_EXTI1));
+
+	while(1);
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * 026systick_timers.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <stdio.h>
+
+/*
+ * SysTick timebase with software timers
+ * - The four discovery LEDs blink from periodic timers at 100, 200, 400 and 800 ms
+ * - A one-shot timer requests the switch to 168 MHz after 5 s, the blink rates must not change
+ * - The main loop sleeps and prints the measured length of a 1 s delay and a 500 us delay
+ */
+
+typedef struct{
+	SYSTICK_Timer_t Timer;
+	uint8_t Pin;
+} LedTimer_t;
+
+static LedTimer_t ledTimers[4];
+static SYSTICK_Timer_t clockTimer;
+static __vo uint8_t clockSwitch = 0;
+
+void SysTick_Handler(void){
+	SYSTICK_IRQHandling();
+}
+
+static void led_timer_callback(SYSTICK_Timer_t *pTimer){
+	LedTimer_t *pLed = (LedTimer_t*)pTimer->pContext;
+
+	GPIO_ToggleOutputPin(GPIOD, pLed->Pin);
+}
+
+static void clock_timer_callback(SYSTICK_Timer_t *pTimer){
+	// RCC must not be reconfigured from interrupt context, leave it to the main loop
+	clockSwitch = 1;
+}
+
+void LED_GPIOInit(void){
+	GPIO_Handle_t leds;
+
+	leds.pGPIOx = GPIOD;
+	leds.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_OUT;
+	leds.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_FAST;
+	leds.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_NO_PUPD;
+	leds.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_PP;
+
+	GPIO_PeriClockControl(GPIOD, ENABLE);
+
+	for(uint8_t pin = GPIO_PIN_NO_12; pin <= GPIO_PIN_NO_15; pin++){
+		leds.GPIO_PinConfig.GPIO_PinNumber = pin;
+		GPIO_Init(&leds);
+	}
+}
+
+int main(void){
+	uint32_t start, ms, us;
+
+	initialise_monitor_handles();
+
+	SYSTICK_Init(15);
+	LED_GPIOInit();
+
+	for(uint8_t i = 0; i < 4; i++){
+		ledTimers[i].Pin = GPIO_PIN_NO_12 + i;
+		ledTimers[i].Timer.Callback = led_timer_callback;
+		ledTimers[i].Timer.pContext = &ledTimers[i];
+		SYSTICK_TimerStart(&ledTimers[i].Timer, 100 << i, 100 << i);
+	}
+
+	clockTimer.Callback = clock_timer_callback;
+	SYSTICK_TimerStart(&clockTimer, 5000, 0);
+
+	while(1){
+		if(clockSwitch){
+			clockSwitch = 0;
+			RCC_SetPerformanceLevel(RCC_PERF_PLL168, NULL);
+		}
+
+		start = SYSTICK_GetMicros();
+		SYSTICK_DelayMs(1000);
+		ms = SYSTICK_GetMicros() - start;
+
+		start = SYSTICK_GetMicros();
+		SYSTICK_DelayUs(500);
+		us = SYSTICK_GetMicros() - start;
+
+		printf("HCLK %lu: 1000 ms delay took %lu us, 500 us delay took %lu us\n", RCC_GetHCLKValue(), ms, us);
+	}
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * 027isr_profile.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * ISR profiling with the DWT cycle counter
+ * Build with -DPROF_IRQ_INSTRUMENTATION=1 so that USART_IRQHandling is timed.
+ * USART2 (PA2/PA3, 115200) echoes through its FIFOs, a SYSTICK timer pends the USART2
+ * IRQ every 10 ms to sample its entry latency, and the main loop times its own echo
+ * step with a named probe. Every 5 s all probes are dumped over semihosting.
+ */
+
+#if !PROF_IRQ_INSTRUMENTATION
+#warning "PROF_IRQ_INSTRUMENTATION is off, only the main loop probe will have samples"
+#endif
+
+static USART_Handle_t usart2_handle;
+
+static uint8_t txFifoBuf[256];
+static uint8_t rxFifoBuf[256];
+
+static PROF_Probe_t echoProbe;
+static SYSTICK_Timer_t latencyTimer;
+
+void SysTick_Handler(void){
+	SYSTICK_IRQHandling();
+}
+
+static void latency_timer_callback(SYSTICK_Timer_t *pTimer){
+#if PROF_IRQ_INSTRUMENTATION
+	PROF_IRQTrigger(&PROF_USART_IRQProbe, IRQ_NO_USART2);
+#endif
+}
+
+void USART2_GPIOInit(void){
+	GPIO_Handle_t usart_gpios;
+
+	usart_gpios.pGPIOx = GPIOA;
+	usart_gpios.GPIO_PinConfig.GPIO_PinMode = GPIO_MODE_ALTFN;
+	usart_gpios.GPIO_PinConfig.GPIO_PinOPType = GPIO_OP_TYPE_PP;
+	usart_gpios.GPIO_PinConfig.GPIO_PinPuPdControl = GPIO_PU;
+	usart_gpios.GPIO_PinConfig.GPIO_PinSpeed = GPIO_SPEED_FAST;
+	usart_gpios.GPIO_PinConfig.GPIO_PinAltFunMode = 7;
+
+	GPIO_PeriClockControl(GPIOA, ENABLE);
+
+	// USART2 TX
+	usart_gpios.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_2;
+	GPIO_Init(&usart_gpios);
+
+	// USART2 RX
+	usart_gpios.GPIO_PinConfig.GPIO_PinNumber = GPIO_PIN_NO_3;
+	GPIO_Init(&usart_gpios);
+}
+
+void USART2_Init(void){
+	usart2_handle.pUSARTx = USART2;
+	usart2_handle.USART_Config.baudRate = USART_STD_BAUD_115200;
+	usart2_handle.USART_Config.HWFlowControl = USART_HW_FLOW_CTRL_NONE;
+	usart2_handle.USART_Config.mode = USART_MODE_TXRX;
+	usart2_handle.USART_Config.noOfStopBits = USART_STOPBITS_1;
+	usart2_handle.USART_Config.wordLength = USART_WORDLEN_8BITS;
+	usart2_handle.USART_Config.parityControl = USART_PARITY_DISABLE;
+	USART_Init(&usart2_handle);
+	USART_FifoInit(&usart2_handle, txFifoBuf, sizeof(txFifoBuf), rxFifoBuf, sizeof(rxFifoBuf));
+	USART_PeripheralControl(USART2, ENABLE);
+}
+
+int main(void){
+	uint8_t buf[32];
+	uint32_t len, dumpDeadline;
+
+	initialise_monitor_handles();
+
+	PROF_Init();
+	PROF_ProbeInit(&echoProbe, "main loop echo");
+
+	SYSTICK_Init(15);
+
+	USART2_GPIOInit();
+	USART2_Init();
+	USART_IRQPriorityConfig(IRQ_NO_USART2, 5);
+	USART_IRQBind(&usart2_handle);
+	USART_IRQInterruptConfig(IRQ_NO_USART2, ENABLE);
+
+	latencyTimer.Callback = latency_timer_callback;
+	SYSTICK_TimerStart(&latencyTimer, 10, 10);
+
+	dumpDeadline = SYSTICK_Deadline(5000);
+
+	while(1){
+		PROF_Begin(&echoProbe);
+		len = USART_Read(&usart2_handle, buf, sizeof(buf));
+		if(len)
+			USART_Write(&usart2_handle, buf, len);
+		PROF_End(&echoProbe);
+
+		if(SYSTICK_Expired(dumpDeadline)){
+			PROF_Dump();
+			PROF_ResetAll();
+			dumpDeadline = SYSTICK_Deadline(5000);
+		}
+	}
+
+	return 0;
+}
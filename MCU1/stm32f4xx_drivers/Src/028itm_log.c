@@ -0,0 +1,61 @@
+/*
+ * 028itm_log.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <stdio.h>
+
+/*
+ * Cost of a log line, LOG_PRINT against printf over semihosting
+ * Both are timed with the DWT cycle counter and the results printed every 2 s.
+ * The LOG_PRINT records come out on ITM port 1, decode them with
+ *   tools/log_decode.py Debug/stm32f4xx_drivers.elf swo.bin
+ */
+
+static PROF_Probe_t logProbe;
+static PROF_Probe_t printfProbe;
+
+void SysTick_Handler(void){
+	SYSTICK_IRQHandling();
+}
+
+int main(void){
+	initialise_monitor_handles();
+
+	PROF_Init();
+	PROF_ProbeInit(&logProbe, "LOG_PRINT");
+	PROF_ProbeInit(&printfProbe, "printf");
+
+	LOG_Init();
+	SYSTICK_Init(15);
+
+	uint32_t count = 0;
+	uint32_t deadline = SYSTICK_Deadline(2000);
+
+	while(1){
+		PROF_Begin(&logProbe);
+		LOG_PRINT("count %lu, tick %lu", count, SYSTICK_GetTick());
+		PROF_End(&logProbe);
+
+		// Sending the records happens outside of the measurement
+		LOG_Process();
+
+		if(SYSTICK_Expired(deadline)){
+			PROF_Begin(&printfProbe);
+			printf("count %lu, tick %lu\n", count, SYSTICK_GetTick());
+			PROF_End(&printfProbe);
+
+			printf("Dropped log records: %lu\n", LOG_GetDropped());
+			PROF_Dump();
+
+			deadline = SYSTICK_Deadline(2000);
+		}
+
+		count++;
+	}
+}
@@ -0,0 +1,95 @@
+/*
+ * 029evt_deferred.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <stdio.h>
+
+/*
+ * Deferred work from PendSV
+ * A SYSTICK timer posts an event every millisecond and a second one posts bursts of
+ * BURST_LEN events every 100 ms, both from the SysTick interrupt. The handlers run from
+ * PendSV at the lowest priority and take WORK_US each, which would be far too long for
+ * the interrupt itself. Every 2 s the queue depth and latency figures are printed.
+ */
+
+#define EVT_TYPE_TICK		(EVT_TYPE_USER + 0)
+#define EVT_TYPE_BURST		(EVT_TYPE_USER + 1)
+
+#define BURST_LEN			8
+#define WORK_US				100
+
+static SYSTICK_Timer_t tickTimer;
+static SYSTICK_Timer_t burstTimer;
+
+static __vo uint32_t tickEvents = 0;
+static __vo uint32_t burstEvents = 0;
+
+void SysTick_Handler(void){
+	SYSTICK_IRQHandling();
+}
+
+void PendSV_Handler(void){
+	EVT_Dispatch();
+}
+
+static void tick_timer_callback(SYSTICK_Timer_t *pTimer){
+	EVT_Post(EVT_TYPE_TICK, 0, NULL, SYSTICK_GetTick());
+}
+
+static void burst_timer_callback(SYSTICK_Timer_t *pTimer){
+	for(uint8_t i = 0; i < BURST_LEN; i++)
+		EVT_Post(EVT_TYPE_BURST, i, NULL, SYSTICK_GetTick());
+}
+
+static void tick_event_handle(EVT_Event_t *pEvent){
+	SYSTICK_DelayUs(WORK_US);
+	tickEvents++;
+}
+
+static void burst_event_handle(EVT_Event_t *pEvent){
+	SYSTICK_DelayUs(WORK_US);
+	burstEvents++;
+}
+
+int main(void){
+	EVT_Stats_t stats;
+	uint32_t deadline;
+
+	initialise_monitor_handles();
+
+	SYSTICK_Init(0);
+
+	EVT_Init(EVT_DISPATCH_PENDSV, 15);
+	EVT_RegisterHandler(EVT_TYPE_TICK, tick_event_handle);
+	EVT_RegisterHandler(EVT_TYPE_BURST, burst_event_handle);
+
+	tickTimer.Callback = tick_timer_callback;
+	burstTimer.Callback = burst_timer_callback;
+	SYSTICK_TimerStart(&tickTimer, 1, 1);
+	SYSTICK_TimerStart(&burstTimer, 100, 100);
+
+	deadline = SYSTICK_Deadline(2000);
+
+	while(1){
+		// Sleeps in WFI, the events are handled in between
+		while(!SYSTICK_Expired(deadline))
+			SYSTICK_DelayMs(10);
+
+		EVT_GetStats(&stats);
+		EVT_ResetStats();
+
+		printf("Posted %lu, dispatched %lu (tick %lu, burst %lu), dropped %lu\n",
+				stats.Posted, stats.Dispatched, tickEvents, burstEvents, stats.Dropped);
+		printf("Depth max %lu of %d, latency mean %lu max %lu cycles\n",
+				stats.HighWater, EVT_QUEUE_DEPTH,
+				stats.Dispatched ? (uint32_t)(stats.LatencyTotal / stats.Dispatched) : 0, stats.LatencyMax);
+
+		deadline = SYSTICK_Deadline(2000);
+	}
+}
@@ -0,0 +1,117 @@
+/*
+ * 030ramfunc_isr_latency.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <stdio.h>
+
+/*
+ * Interrupt handlers in flash against handlers in SRAM at 168 MHz (5 wait states)
+ * EXTI1_IRQHandler runs from flash, EXTI2_IRQHandler is the same code placed in SRAM with
+ * __ramfunc. Both are pended from software RUNS times and timed with the DWT cycle counter:
+ * - latency, from the pend to the first handler instruction
+ * - duration of the (branch heavy) handler body
+ * for the ART accelerator on and off, with the vector table in flash and in SRAM.
+ * Build with -DISR_IN_RAM=1 to move the driver IRQ handling paths to SRAM as well.
+ */
+
+#define RUNS			1000
+
+static PROF_IRQProbe_t flashProbe;
+static PROF_IRQProbe_t ramProbe;
+
+static __vo uint32_t isrSink = 1;
+
+// Forced inline so that each handler carries its own copy of the code
+static inline __attribute__((always_inline)) void isr_measure(PROF_IRQProbe_t *pProbe){
+	uint32_t acc, entry = *CORE_DWT_CYCCNT;
+
+	if(pProbe->Triggered){
+		pProbe->Triggered = 0;
+		PROF_Record(&pProbe->Latency, entry - pProbe->TriggerStamp);
+	}
+
+	PROF_Begin(&pProbe->Duration);
+
+	acc = isrSink;
+	for(uint32_t i = 0; i < 16; i++){
+		switch((acc + i) & 3){
+			case 0:
+				acc += i;
+				break;
+			case 1:
+				acc ^= i << 3;
+				break;
+			case 2:
+				acc -= i;
+				break;
+			default:
+				acc = (acc << 1) | (acc >> 31);
+				break;
+		}
+	}
+	isrSink = acc;
+
+	PROF_End(&pProbe->Duration);
+}
+
+void EXTI1_IRQHandler(void){
+	isr_measure(&flashProbe);
+}
+
+__ramfunc void EXTI2_IRQHandler(void){
+	isr_measure(&ramProbe);
+}
+
+static void run_bench(const char *name){
+	PROF_ResetAll();
+
+	for(uint32_t i = 0; i < RUNS; i++){
+		PROF_IRQTrigger(&flashProbe, IRQ_NO_EXTI1);
+		PROF_IRQTrigger(&ramProbe, IRQ_NO_EXTI2);
+	}
+
+	printf("%-30s flash: latency %lu (max %lu), body %lu | SRAM: latency %lu (max %lu), body %lu cycles\n",
+			name,
+			PROF_GetMean(&flashProbe.Latency), flashProbe.Latency.Max, PROF_GetMean(&flashProbe.Duration),
+			PROF_GetMean(&ramProbe.Latency), ramProbe.Latency.Max, PROF_GetMean(&ramProbe.Duration));
+}
+
+int main(void){
+	initialise_monitor_handles();
+
+	PROF_Init();
+	PROF_IRQProbeInit(&flashProbe, "EXTI1 (flash)", "EXTI1 (flash) latency");
+	PROF_IRQProbeInit(&ramProbe, "EXTI2 (SRAM)", "EXTI2 (SRAM) latency");
+
+	NVIC_IRQInterruptConfig(IRQ_NO_EXTI1, ENABLE);
+	NVIC_IRQInterruptConfig(IRQ_NO_EXTI2, ENABLE);
+
+	RCC_SetPerformanceLevel(RCC_PERF_PLL168, NULL);
+
+	FLASH_AcceleratorControl(DISABLE, DISABLE, DISABLE);
+	run_bench("No ART, vectors in flash:");
+
+	FLASH_AcceleratorControl(ENABLE, ENABLE, ENABLE);
+	run_bench("ART, vectors in flash:");
+
+	NVIC_RelocateVectorTable();
+
+	FLASH_AcceleratorControl(DISABLE, DISABLE, DISABLE);
+	run_bench("No ART, vectors in SRAM:");
+
+	FLASH_AcceleratorControl(ENABLE, ENABLE, ENABLE);
+	run_bench("ART, vectors in SRAM:");
+
+	// Histograms of the last run
+	PROF_Dump();
+
+	while(1);
+
+	return 0;
+}
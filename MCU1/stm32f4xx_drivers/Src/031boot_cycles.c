@@ -0,0 +1,67 @@
+/*
+ * 031boot_cycles.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <stdio.h>
+
+/*
+ * Boot-to-main time
+ * Reset_Handler starts the DWT cycle counter from zero before SystemInit, so the first thing
+ * main reads is the number of core cycles spent in SystemInit, the .data/.ccmram copies,
+ * the .bss/.ccmram_bss fills and the static constructors.
+ * Compare the images:
+ * - default build, RAM initialized at the 16 MHz HSI
+ * - -DRCC_EARLY_PLL=1, SystemInit switches to 168 MHz first (includes the HSE start-up)
+ * - -DBOOT_BUF_NOINIT=0, the 16 KB receive buffer below is zeroed with .bss
+ */
+
+#ifndef BOOT_BUF_NOINIT
+#define BOOT_BUF_NOINIT		1
+#endif
+
+#define BOOT_BUF_SIZE		16384
+
+#if BOOT_BUF_NOINIT
+static __noinit uint8_t bootRxBuf[BOOT_BUF_SIZE];
+#else
+static uint8_t bootRxBuf[BOOT_BUF_SIZE];
+#endif
+
+// Section bounds from the linker script
+extern uint32_t _sdata, _edata, _sbss, _ebss;
+extern uint32_t _sccmram, _eccmram, _sccmbss, _eccmbss;
+extern uint32_t _snoinit, _enoinit;
+
+static uint32_t section_size(uint32_t *pStart, uint32_t *pEnd){
+	return (uint32_t)pEnd - (uint32_t)pStart;
+}
+
+int main(void){
+	uint32_t bootCycles = *CORE_DWT_CYCCNT;
+	uint32_t sysclk, initBytes;
+
+	initialise_monitor_handles();
+
+	sysclk = RCC_GetSYSCLKValue();
+	initBytes = section_size(&_sdata, &_edata) + section_size(&_sbss, &_ebss) +
+				section_size(&_sccmram, &_eccmram) + section_size(&_sccmbss, &_eccmbss);
+
+	printf("SYSCLK at main    : %lu Hz (early PLL %s)\n", sysclk, RCC_EARLY_PLL ? "on" : "off");
+	printf(".data %lu, .bss %lu, .ccmram %lu, .ccmram_bss %lu, .noinit %lu bytes\n",
+			section_size(&_sdata, &_edata), section_size(&_sbss, &_ebss),
+			section_size(&_sccmram, &_eccmram), section_size(&_sccmbss, &_eccmbss),
+			section_size(&_snoinit, &_enoinit));
+	printf("Reset to main     : %lu cycles, %lu us at SYSCLK\n", bootCycles, bootCycles / (sysclk / 1000000UL));
+	printf("Initialized bytes : %lu, receive buffer at %p %s\n", initBytes, (void*)bootRxBuf,
+			BOOT_BUF_NOINIT ? "(not cleared)" : "(cleared with .bss)");
+
+	while(1);
+
+	return 0;
+}
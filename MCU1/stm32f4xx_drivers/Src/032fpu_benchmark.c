@@ -0,0 +1,182 @@
+/*
+ * 032fpu_benchmark.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+extern void initialise_monitor_handles(void);
+
+#include "stm32f407xx.h"
+#include <stdio.h>
+
+/*
+ * Float-heavy code with and without the FPU, and the interrupt latency it costs
+ * Build once as configured (-mfpu=fpv4-sp-d16 -mfloat-abi=hard) and once with
+ * -mfloat-abi=soft for the "before" figures. Three workloads are timed at 168 MHz:
+ * - a biquad low-pass over a block of samples
+ * - scaling raw accelerometer readings to mg
+ * - USART baud rate divisors computed in float
+ * Then EXTI1 (no FPU use) and EXTI2 (uses the FPU) are pended from code which has
+ * just used the FPU, for each stacking mode. With FPU_STACKING_LAZY the EXTI1 latency
+ * must match the soft-float build.
+ */
+
+#define RUNS			100
+#define IRQ_RUNS		1000
+#define BLOCK_LEN		64
+
+static PROF_Probe_t biquadProbe;
+static PROF_Probe_t scaleProbe;
+static PROF_Probe_t baudProbe;
+static PROF_IRQProbe_t intProbe;
+static PROF_IRQProbe_t fpuProbe;
+
+static float samples[BLOCK_LEN];
+static float filtered[BLOCK_LEN];
+static int16_t rawAccel[BLOCK_LEN];
+static int32_t accelMg[BLOCK_LEN];
+
+static __vo float fpuSink = 1.0f;
+
+static void irq_latency(PROF_IRQProbe_t *pProbe){
+	uint32_t entry = *CORE_DWT_CYCCNT;
+
+	if(pProbe->Triggered){
+		pProbe->Triggered = 0;
+		PROF_Record(&pProbe->Latency, entry - pProbe->TriggerStamp);
+	}
+}
+
+// Integer only, must not pay for the FPU context
+void EXTI1_IRQHandler(void){
+	irq_latency(&intProbe);
+}
+
+// Uses the FPU, with lazy stacking this is where the registers get saved
+void EXTI2_IRQHandler(void){
+	irq_latency(&fpuProbe);
+	fpuSink = fpuSink * 1.0001f;
+}
+
+// Second order low-pass, fc = fs / 10, direct form I
+static void biquad(const float *pIn, float *pOut, uint32_t len){
+	const float b0 = 0.0675f, b1 = 0.1349f, b2 = 0.0675f, a1 = -1.1430f, a2 = 0.4128f;
+	float x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+
+	for(uint32_t i = 0; i < len; i++){
+		float y = b0 * pIn[i] + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+		x2 = x1;
+		x1 = pIn[i];
+		y2 = y1;
+		y1 = y;
+		pOut[i] = y;
+	}
+}
+
+// +-2 g range, 0.061 mg per LSB, with an offset and gain calibration
+static void scale_accel(const int16_t *pRaw, int32_t *pMg, uint32_t len){
+	const float lsb = 0.061f, offset = -12.5f, gain = 1.013f;
+
+	for(uint32_t i = 0; i < len; i++)
+		pMg[i] = (int32_t)(((float)pRaw[i] * lsb + offset) * gain);
+}
+
+// USARTDIV = fPCLK / (16 * baud), mantissa and 4-bit fraction as BRR wants them
+static uint32_t baud_divisors(uint32_t pclk){
+	static const uint32_t bauds[] = { 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600 };
+	uint32_t sum = 0;
+
+	for(uint32_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++){
+		float div = (float)pclk / (16.0f * (float)bauds[i]);
+		uint32_t mantissa = (uint32_t)div;
+		uint32_t fraction = (uint32_t)((div - (float)mantissa) * 16.0f + 0.5f);
+		sum += (mantissa << 4) + fraction;
+	}
+	return sum;
+}
+
+static void run_irq_bench(const char *name){
+	PROF_Reset(&intProbe.Latency);
+	PROF_Reset(&fpuProbe.Latency);
+
+	for(uint32_t i = 0; i < IRQ_RUNS; i++){
+		// The interrupted code has an FPU context (CONTROL.FPCA) on FPU builds
+		fpuSink = fpuSink * 0.9999f;
+		PROF_IRQTrigger(&intProbe, IRQ_NO_EXTI1);
+
+		fpuSink = fpuSink * 0.9999f;
+		PROF_IRQTrigger(&fpuProbe, IRQ_NO_EXTI2);
+	}
+
+	printf("%-22s latency no FPU use %lu (max %lu), FPU use %lu (max %lu) cycles\n", name,
+			PROF_GetMean(&intProbe.Latency), intProbe.Latency.Max,
+			PROF_GetMean(&fpuProbe.Latency), fpuProbe.Latency.Max);
+}
+
+int main(void){
+	uint32_t baudSum = 0;
+
+	initialise_monitor_handles();
+
+	PROF_Init();
+	PROF_ProbeInit(&biquadProbe, "biquad 64 samples");
+	PROF_ProbeInit(&scaleProbe, "accel scaling 64 samples");
+	PROF_ProbeInit(&baudProbe, "8 baud divisors");
+	PROF_IRQProbeInit(&intProbe, "EXTI1 (no FPU)", "EXTI1 (no FPU) latency");
+	PROF_IRQProbeInit(&fpuProbe, "EXTI2 (FPU)", "EXTI2 (FPU) latency");
+
+	RCC_SetPerformanceLevel(RCC_PERF_PLL168, NULL);
+
+	for(uint32_t i = 0; i < BLOCK_LEN; i++){
+		samples[i] = (i & 8) ? 1.0f : -1.0f;
+		rawAccel[i] = (int16_t)(i * 509 - 16000);
+	}
+
+#if defined(__ARM_FP)
+	printf("Hard-float build, FPU %s\n", FPU_IsEnabled() ? "enabled" : "DISABLED");
+#else
+	printf("Soft-float build\n");
+#endif
+
+	for(uint32_t i = 0; i < RUNS; i++){
+		PROF_Begin(&biquadProbe);
+		biquad(samples, filtered, BLOCK_LEN);
+		PROF_End(&biquadProbe);
+
+		PROF_Begin(&scaleProbe);
+		scale_accel(rawAccel, accelMg, BLOCK_LEN);
+		PROF_End(&scaleProbe);
+
+		PROF_Begin(&baudProbe);
+		baudSum += baud_divisors(RCC_GetPCLK2Value());
+		PROF_End(&baudProbe);
+	}
+
+	printf("biquad %lu, scaling %lu, baud divisors %lu cycles (check %ld %ld %lu)\n",
+			PROF_GetMean(&biquadProbe), PROF_GetMean(&scaleProbe), PROF_GetMean(&baudProbe),
+			(int32_t)(filtered[BLOCK_LEN - 1] * 1000.0f), accelMg[BLOCK_LEN - 1], baudSum / RUNS);
+
+	NVIC_IRQInterruptConfig(IRQ_NO_EXTI1, ENABLE);
+	NVIC_IRQInterruptConfig(IRQ_NO_EXTI2, ENABLE);
+
+#if defined(__ARM_FP)
+	FPU_SetStacking(FPU_STACKING_LAZY);
+	run_irq_bench("Lazy stacking:");
+
+	FPU_SetStacking(FPU_STACKING_ALWAYS);
+	run_irq_bench("Always stacking:");
+
+	// EXTI2 clobbers the FPU registers of main here, fpuSink is volatile and survives
+	FPU_SetStacking(FPU_STACKING_NONE);
+	run_irq_bench("No stacking:");
+
+	FPU_SetStacking(FPU_STACKING);
+#else
+	run_irq_bench("No FPU:");
+#endif
+
+	while(1);
+
+	return 0;
+}
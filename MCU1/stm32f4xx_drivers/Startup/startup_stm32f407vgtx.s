@@ -41,6 +41,17 @@ defined in linker script */
 .word _sbss
 /* end address for the .bss section. defined in linker script */
 .word _ebss
+/* start address for the initialization values of the .ccmram section.
+defined in linker script */
+.word _siccmram
+/* start address for the .ccmram section. defined in linker script */
+.word _sccmram
+/* end address for the .ccmram section. defined in linker script */
+.word _eccmram
+/* start address for the .ccmram_bss section. defined in linker script */
+.word _sccmbss
+/* end address for the .ccmram_bss section. defined in linker script */
+.word _eccmbss
 
 /**
  * @brief  This is the code that gets called when the processor first
@@ -57,6 +68,40 @@ defined in linker script */
 Reset_Handler:
   ldr   r0, =_estack
   mov   sp, r0          /* set stack pointer */
+/* Start the DWT cycle counter from zero, main reads the boot time from it */
+  ldr r0, =0xE000EDFC   /* DEMCR */
+  ldr r1, [r0]
+  orr r1, r1, #0x01000000   /* TRCENA */
+  str r1, [r0]
+  ldr r0, =0xE0001000   /* DWT_CTRL */
+  movs r1, #0
+  str r1, [r0, #4]      /* DWT_CYCCNT, not cleared by a system reset */
+  ldr r1, [r0]
+  orr r1, r1, #1        /* CYCCNTENA */
+  str r1, [r0]
+/* Enable the FPU (full access to CP10 and CP11) before any C code can use it and
+   set the exception stacking, see stm32f407xx_fpu_driver.h. Only when the image
+   is compiled for the FPU, the assembler must get the same -mfpu/-mfloat-abi. */
+#if defined(__ARM_FP)
+#ifndef FPU_STACKING
+#define FPU_STACKING 0          /* FPU_STACKING_LAZY */
+#endif
+  ldr r0, =0xE000ED88   /* CPACR */
+  ldr r1, [r0]
+  orr r1, r1, #0x00F00000   /* CP10, CP11 full access */
+  str r1, [r0]
+  ldr r0, =0xE000EF34   /* FPCCR */
+  ldr r1, [r0]
+  bic r1, r1, #0xC0000000   /* ASPEN, LSPEN */
+#if FPU_STACKING == 0
+  orr r1, r1, #0xC0000000   /* lazy */
+#elif FPU_STACKING == 1
+  orr r1, r1, #0x80000000   /* always */
+#endif
+  str r1, [r0]
+  dsb
+  isb
+#endif
 /* Call the clock system initialization function.*/
   bl  SystemInit
 
@@ -64,32 +109,23 @@ Reset_Handler:
   ldr r0, =_sdata
   ldr r1, =_edata
   ldr r2, =_sidata
-  movs r3, #0
-  b LoopCopyDataInit
-
-CopyDataInit:
-  ldr r4, [r2, r3]
-  str r4, [r0, r3]
-  adds r3, r3, #4
-
-LoopCopyDataInit:
-  adds r4, r0, r3
-  cmp r4, r1
-  bcc CopyDataInit
+  bl CopyWords
 
 /* Zero fill the bss segment. */
-  ldr r2, =_sbss
-  ldr r4, =_ebss
-  movs r3, #0
-  b LoopFillZerobss
+  ldr r0, =_sbss
+  ldr r1, =_ebss
+  bl ZeroWords
 
-FillZerobss:
-  str  r3, [r2]
-  adds r2, r2, #4
+/* Copy the ccmram segment initializers from flash to CCMRAM */
+  ldr r0, =_sccmram
+  ldr r1, =_eccmram
+  ldr r2, =_siccmram
+  bl CopyWords
 
-LoopFillZerobss:
-  cmp r2, r4
-  bcc FillZerobss
+/* Zero fill the ccmram_bss segment. */
+  ldr r0, =_sccmbss
+  ldr r1, =_eccmbss
+  bl ZeroWords
 
 /* Call static constructors */
   bl __libc_init_array
@@ -99,6 +135,64 @@ LoopFillZerobss:
 LoopForever:
     b LoopForever
 
+/* Copy r1 - r0 bytes from r2 to r0, both word aligned. Moves 8 words per
+   LDM/STM pair, the remaining 0-7 words one at a time. Uses r3-r11. */
+CopyWords:
+  subs r3, r1, r0
+  bic r3, r3, #31
+  adds r3, r3, r0       /* end of the 32-byte blocks */
+  b LoopCopyBlocks
+
+CopyBlocks:
+  ldmia r2!, {r4-r11}
+  stmia r0!, {r4-r11}
+
+LoopCopyBlocks:
+  cmp r0, r3
+  bcc CopyBlocks
+  b LoopCopyTail
+
+CopyTail:
+  ldr r4, [r2], #4
+  str r4, [r0], #4
+
+LoopCopyTail:
+  cmp r0, r1
+  bcc CopyTail
+  bx lr
+
+/* Zero r1 - r0 bytes from r0, word aligned. Stores 8 words per STM,
+   the remaining 0-7 words one at a time. Uses r3-r11. */
+ZeroWords:
+  subs r3, r1, r0
+  bic r3, r3, #31
+  adds r3, r3, r0       /* end of the 32-byte blocks */
+  movs r4, #0
+  movs r5, #0
+  movs r6, #0
+  movs r7, #0
+  mov r8, r4
+  mov r9, r4
+  mov r10, r4
+  mov r11, r4
+  b LoopZeroBlocks
+
+ZeroBlocks:
+  stmia r0!, {r4-r11}
+
+LoopZeroBlocks:
+  cmp r0, r3
+  bcc ZeroBlocks
+  b LoopZeroTail
+
+ZeroTail:
+  str r4, [r0], #4
+
+LoopZeroTail:
+  cmp r0, r1
+  bcc ZeroTail
+  bx lr
+
   .size Reset_Handler, .-Reset_Handler
 
 /**
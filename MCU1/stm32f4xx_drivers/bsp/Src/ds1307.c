@@ -113,16 +113,18 @@ void ds1307_get_current_time(RTC_time_t* rtc_time){
 
 	uint8_t tempReg = 0x00;
 
+	// Seconds, minutes and hours in one burst so they belong to the same instant
+	uint8_t regs[3];
+	I2C_MemRead(&g_ds1307I2cHandle, DS1307_I2C_ADDRESS, DS1307_ADDR_SEC, I2C_MEMADD_SIZE_8BIT, regs, 3);
+
 	// Retrieve seconds
-	tempReg = ds1307_read(DS1307_ADDR_SEC);
-	rtc_time->seconds = BCDToBinary(tempReg);
+	rtc_time->seconds = BCDToBinary(regs[0]);
 
 	// Retrieve minutes
-	tempReg = ds1307_read(DS1307_ADDR_MIN);
-	rtc_time->minutes = BCDToBinary(tempReg);
+	rtc_time->minutes = BCDToBinary(regs[1]);
 
 	// Retrieve time format
-	tempReg = ds1307_read(DS1307_ADDR_HRS);
+	tempReg = regs[2];
 	timeFormat = (tempReg >> 6) & 0x01;
 	rtc_time->time_format = timeFormat;
 
@@ -188,23 +190,21 @@ void ds1307_set_current_date(RTC_date_t* rtc_date){
  * @Note              - None
  */
 void ds1307_get_current_date(RTC_date_t* rtc_date){
-	uint8_t tempReg = 0x00;
+	// Day, date, month and year are consecutive registers, read them in one burst
+	uint8_t regs[4];
+	I2C_MemRead(&g_ds1307I2cHandle, DS1307_I2C_ADDRESS, DS1307_ADDR_DAY, I2C_MEMADD_SIZE_8BIT, regs, 4);
 
 	// Get day of the week
-	tempReg = ds1307_read(DS1307_ADDR_DAY);
-	rtc_date->dayOfWeek = tempReg;
+	rtc_date->dayOfWeek = regs[0];
 
 	// Get date of the month
-	tempReg = ds1307_read(DS1307_ADDR_DATE);
-	rtc_date->date = BCDToBinary(tempReg);
+	rtc_date->date = BCDToBinary(regs[1]);
 
 	// Get month
-	tempReg = ds1307_read(DS1307_ADDR_MONTH);
-	rtc_date->month = BCDToBinary(tempReg);
+	rtc_date->month = BCDToBinary(regs[2]);
 
 	// Get year
-	tempReg = ds1307_read(DS1307_ADDR_YEAR);
-	rtc_date->year = BCDToBinary(tempReg) + 2000;
+	rtc_date->year = BCDToBinary(regs[3]) + 2000;
 }
 
 /*********************************************************************
@@ -287,11 +287,9 @@ static void ds1307_write(uint8_t value, uint8_t reg_address){
  */
 static uint8_t ds1307_read(uint8_t regAddress){
 	uint8_t data;
-	// 1. Send word address to read from
-	I2C_MasterSendData(&g_ds1307I2cHandle, &regAddress, 1, DS1307_I2C_ADDRESS, 1);
 
-	// 2. Read data from that address
-	I2C_MasterReceiveData(&g_ds1307I2cHandle, &data, 1, DS1307_I2C_ADDRESS, 0);
+	// Word address, repeated start and the read in one transaction
+	I2C_MemRead(&g_ds1307I2cHandle, DS1307_I2C_ADDRESS, regAddress, I2C_MEMADD_SIZE_8BIT, &data, 1);
 
 	return data;
 }
@@ -14,6 +14,38 @@
 #define __vo volatile
 #define __weak __attribute__((weak))
 
+/*
+ * Memory placement, see the .ccmram sections of the linker scripts
+ * CCM RAM is only wired to the CPU data bus: no wait states and no contention with DMA,
+ * but the DMA controllers can not reach it. DMA buffers are marked with __dma_buffer,
+ * combining it with a CCM placement is a compile error and the DMA driver refuses to
+ * start a transfer on a CCM address.
+ * __noinit data stays in SRAM and is neither copied nor zeroed at start-up, for large
+ * buffers which are always written before they are read (e.g. DMA receive rings).
+ */
+#define __ccmram			__attribute__((section(".ccmram")))				// Initialized, copied at start-up
+#define __ccmram_bss		__attribute__((section(".ccmram_bss")))			// Zeroed at start-up
+#define __ccmram_noinit		__attribute__((section(".ccmram_noinit")))		// Not touched at start-up
+#define __dma_buffer		__attribute__((section(".bss.dma_buffer")))		// Zeroed, always in SRAM
+#define __noinit			__attribute__((section(".noinit")))				// Not touched at start-up, always in SRAM
+
+/*
+ * Code placement
+ * __ramfunc code is copied to SRAM with .data and runs without flash wait states.
+ * Build with -DISR_IN_RAM=1 to place the driver IRQ handling paths there (__isr_ramfunc).
+ */
+#define __ramfunc			__attribute__((section(".RamFunc")))
+
+#ifndef ISR_IN_RAM
+#define ISR_IN_RAM			0
+#endif
+
+#if ISR_IN_RAM
+#define __isr_ramfunc		__ramfunc
+#else
+#define __isr_ramfunc
+#endif
+
 //***************** PROCESSOR SPECIFIC DETAILS **********************//
 // ARM Cortex Mx Processor NVIC ISERx register Addresses
 
@@ -35,12 +67,115 @@
 // ARM Cortex Mx Processor number of priority bits implemented in Priority Register
 #define NO_PRIORITY_BITS_IMPLEMENTED 	4
 
+// ARM Cortex Mx Processor NVIC register map, used by the NVIC driver
+typedef struct {
+	__vo uint32_t ISER[8];			// Interrupt set-enable, write 1 to enable						0x000-0x01C
+	uint32_t RESERVED0[24];
+	__vo uint32_t ICER[8];			// Interrupt clear-enable, write 1 to disable					0x080-0x09C
+	uint32_t RESERVED1[24];
+	__vo uint32_t ISPR[8];			// Interrupt set-pending										0x100-0x11C
+	uint32_t RESERVED2[24];
+	__vo uint32_t ICPR[8];			// Interrupt clear-pending										0x180-0x19C
+	uint32_t RESERVED3[24];
+	__vo uint32_t IABR[8];			// Interrupt active bit, read only								0x200-0x21C
+	uint32_t RESERVED4[56];
+	__vo uint8_t IP[240];			// Interrupt priority, one byte per IRQ							0x300-0x3EF
+} NVIC_RegDef_t;
+
+#define NVIC_BASEADDR				0xE000E100UL
+#define NVIC						( (NVIC_RegDef_t*) NVIC_BASEADDR )
+
+// ARM Cortex Mx Processor SCB application interrupt and reset control register
+#define SCB_AIRCR					( (__vo uint32_t*) 0xE000ED0CUL )
+#define SCB_AIRCR_PRIGROUP			8
+#define SCB_AIRCR_VECTKEY			16
+#define SCB_AIRCR_VECTKEY_VALUE		0x05FAUL
+
+// ARM Cortex Mx Processor SCB interrupt control and state register
+#define SCB_ICSR					( (__vo uint32_t*) 0xE000ED04UL )
+#define SCB_ICSR_PENDSTSET			26
+#define SCB_ICSR_PENDSVSET			28
+
+// ARM Cortex Mx Processor SCB vector table offset register
+#define SCB_VTOR					( (__vo uint32_t*) 0xE000ED08UL )
+
+// ARM Cortex Mx Processor SysTick priority, byte 3 of SHPR3
+#define SCB_SHPR_SYSTICK			( (__vo uint8_t*) 0xE000ED23UL )
+
+// ARM Cortex Mx Processor PendSV priority, byte 2 of SHPR3
+#define SCB_SHPR_PENDSV				( (__vo uint8_t*) 0xE000ED22UL )
+
+// ARM Cortex Mx Processor coprocessor access control, full access to CP10 and CP11 enables the FPU
+#define SCB_CPACR					( (__vo uint32_t*) 0xE000ED88UL )
+#define SCB_CPACR_CP10				20
+#define SCB_CPACR_CP11				22
+
+// ARM Cortex M4 FPU context control, how exception entry saves the FPU registers
+#define FPU_FPCCR					( (__vo uint32_t*) 0xE000EF34UL )
+#define FPU_FPCCR_LSPACT			0
+#define FPU_FPCCR_LSPEN				30
+#define FPU_FPCCR_ASPEN				31
+
+// ARM Cortex Mx Processor SysTick timer
+typedef struct {
+	__vo uint32_t CTRL;				// Control and status											0x00
+	__vo uint32_t LOAD;				// Reload value, 24 bits										0x04
+	__vo uint32_t VAL;				// Current value, counts down									0x08
+	__vo uint32_t CALIB;			// Calibration value											0x0C
+} SYSTICK_RegDef_t;
+
+#define SYSTICK_BASEADDR			0xE000E010UL
+#define SYSTICK						( (SYSTICK_RegDef_t*) SYSTICK_BASEADDR )
+
+#define SYSTICK_CTRL_ENABLE			0
+#define SYSTICK_CTRL_TICKINT		1
+#define SYSTICK_CTRL_CLKSOURCE		2
+#define SYSTICK_CTRL_COUNTFLAG		16
+
+// ARM Cortex Mx Processor critical section, masks every configurable interrupt and
+// returns the previous PRIMASK so that sections can nest
+static inline uint32_t IRQ_SaveAndDisable(void){
+	uint32_t primask;
+	__asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+	return primask;
+}
+
+static inline void IRQ_Restore(uint32_t primask){
+	__asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+}
+
+// ARM Cortex Mx Processor data memory barrier, orders buffer writes before the index
+// which publishes them to an interrupt handler (or the other way round)
+static inline void MEM_Barrier(void){
+	__asm volatile ("dmb" ::: "memory");
+}
+
+// ARM Cortex Mx Processor DWT cycle counter, counts core clock cycles once TRCENA and CYCCNTENA are set
+#define CORE_DHCSR					( (__vo uint32_t*) 0xE000EDF0UL )
+#define CORE_DEMCR					( (__vo uint32_t*) 0xE000EDFCUL )
+#define CORE_DWT_CTRL				( (__vo uint32_t*) 0xE0001000UL )
+#define CORE_DWT_CYCCNT				( (__vo uint32_t*) 0xE0001004UL )
+
+#define CORE_DHCSR_C_DEBUGEN		0
+#define CORE_DEMCR_TRCENA			24
+#define CORE_DWT_CTRL_CYCCNTENA		0
+
+// ARM Cortex Mx Processor ITM, stimulus port writes go out on SWO once TRCENA is set
+#define ITM_STIM(port)				( (__vo uint32_t*) (0xE0000000UL + (4 * (port))) )
+#define ITM_TER						( (__vo uint32_t*) 0xE0000E00UL )
+#define ITM_TCR						( (__vo uint32_t*) 0xE0000E80UL )
+#define ITM_LAR						( (__vo uint32_t*) 0xE0000FB0UL )
+
+#define ITM_TCR_ITMENA				0
+#define ITM_LAR_KEY					0xC5ACCE55UL
+
 // **************** BASE ADDRESSES ****************** //
 
 // MEMORY BASE ADDRESSES
 #define FLASH_BASEADDR				0x08000000UL
 #define SRAM1_BASEADDR				0x20000000UL
 #define SRAM2_BASEADDR				0x2001C000UL
+#define CCMRAM_BASEADDR				0x10000000UL
 #define ROM_BASEADDR				0x1FFF0000UL
 #define SRAM						SRAM1_BASEADDR
 
@@ -63,6 +198,10 @@
 #define GPIOI_BASEADDR				(AHB1PERIPH_BASEADDR + 0x2000UL)
 
 #define RCC_BASEADDR				(AHB1PERIPH_BASEADDR + 0x3800UL)
+#define FLASH_R_BASEADDR			(AHB1PERIPH_BASEADDR + 0x3C00UL)
+
+#define DMA1_BASEADDR				(AHB1PERIPH_BASEADDR + 0x6000UL)
+#define DMA2_BASEADDR				(AHB1PERIPH_BASEADDR + 0x6400UL)
 
 // APB1 PERIPHERAL ADDRESSES
 #define I2C1_BASEADDR				(APB1PERIPH_BASEADDR + 0x5400UL)
@@ -77,6 +216,8 @@
 #define UART4_BASEADDR				(APB1PERIPH_BASEADDR + 0x4C00UL)
 #define UART5_BASEADDR				(APB1PERIPH_BASEADDR + 0x5000UL)
 
+#define PWR_BASEADDR				(APB1PERIPH_BASEADDR + 0x7000UL)
+
 // APB2 PERIPHERAL ADDRESSES
 #define SPI1_BASEADDR				(APB2PERIPH_BASEADDR + 0x3000UL)
 
@@ -183,6 +324,41 @@ typedef struct {
 	__vo uint32_t DCKCFGR;				// Dedicated Clock Configuration Register						0x8C
 } RCC_RegDef_t;
 
+// PWR
+typedef struct {
+	__vo uint32_t CR;				// Power control register
+	__vo uint32_t CSR;				// Power control/status register
+} PWR_RegDef_t;
+
+// FLASH interface
+typedef struct {
+	__vo uint32_t ACR;				// Access control register
+	__vo uint32_t KEYR;				// Key register
+	__vo uint32_t OPTKEYR;			// Option key register
+	__vo uint32_t SR;				// Status register
+	__vo uint32_t CR;				// Control register
+	__vo uint32_t OPTCR;			// Option control register
+} FLASH_RegDef_t;
+
+
+// DMA Stream Registers
+typedef struct {
+	__vo uint32_t CR;					// Stream x configuration register								0x10 + 0x18 * x
+	__vo uint32_t NDTR;					// Stream x number of data register								0x14 + 0x18 * x
+	__vo uint32_t PAR;					// Stream x peripheral address register							0x18 + 0x18 * x
+	__vo uint32_t M0AR;					// Stream x memory 0 address register							0x1C + 0x18 * x
+	__vo uint32_t M1AR;					// Stream x memory 1 address register							0x20 + 0x18 * x
+	__vo uint32_t FCR;					// Stream x FIFO control register								0x24 + 0x18 * x
+} DMA_Stream_RegDef_t;
+
+// DMA Registers
+typedef struct {
+	__vo uint32_t LISR;					// Low interrupt status register								0x00
+	__vo uint32_t HISR;					// High interrupt status register								0x04
+	__vo uint32_t LIFCR;				// Low interrupt flag clear register							0x08
+	__vo uint32_t HIFCR;				// High interrupt flag clear register							0x0C
+	DMA_Stream_RegDef_t STREAM[8];		// Stream 0-7 registers											0x10-0xCC
+} DMA_RegDef_t;
 
 // EXTI Registers
 typedef struct {
@@ -216,6 +392,8 @@ typedef struct {
 #define GPIOI		( (GPIO_RegDef_t*) GPIOI_BASEADDR )
 
 #define RCC			( (RCC_RegDef_t*) RCC_BASEADDR )
+#define PWR			( (PWR_RegDef_t*) PWR_BASEADDR )
+#define FLASH		( (FLASH_RegDef_t*) FLASH_R_BASEADDR )
 
 #define SPI1		( (SPI_RegDef_t*) SPI1_BASEADDR )
 #define SPI2		( (SPI_RegDef_t*) SPI2_BASEADDR )
@@ -225,6 +403,9 @@ typedef struct {
 #define I2C2		( (I2C_RegDef_t*) I2C2_BASEADDR )
 #define I2C3		( (I2C_RegDef_t*) I2C3_BASEADDR )
 
+#define DMA1		( (DMA_RegDef_t*) DMA1_BASEADDR )
+#define DMA2		( (DMA_RegDef_t*) DMA2_BASEADDR )
+
 #define USART1		( (USART_RegDef_t*) USART1_BASEADDR )
 #define USART2		( (USART_RegDef_t*) USART2_BASEADDR )
 #define USART3		( (USART_RegDef_t*) USART3_BASEADDR )
@@ -257,6 +438,10 @@ typedef struct {
 #define GPIOH_PCLK_EN() 	( RCC->AHB1ENR |= (1 << 7) )
 #define GPIOI_PCLK_EN() 	( RCC->AHB1ENR |= (1 << 8) )
 
+// DMA ENABLE
+#define DMA1_PCLK_EN()		( RCC->AHB1ENR |= (1 << 21) )
+#define DMA2_PCLK_EN()		( RCC->AHB1ENR |= (1 << 22) )
+
 // I2C ENABLE
 #define I2C1_PCLK_EN()		( RCC->APB1ENR |= (1 << 21) )
 #define I2C2_PCLK_EN()		( RCC->APB1ENR |= (1 << 22) )
@@ -278,6 +463,9 @@ typedef struct {
 // SYSCFG ENABLE
 #define SYSCFG_PCLK_EN()	( RCC->APB2ENR |= (1 << 14) )
 
+// PWR ENABLE
+#define PWR_PCLK_EN()		( RCC->APB1ENR |= (1 << 28) )
+
 //************ CLOCK DISABLE MACROS *****************//
 
 // GPIO DISABLE
@@ -291,6 +479,10 @@ typedef struct {
 #define GPIOH_PCLK_DI() 	( RCC->AHB1ENR &= ~(1 << 7) )
 #define GPIOI_PCLK_DI() 	( RCC->AHB1ENR &= ~(1 << 8) )
 
+// DMA DISABLE
+#define DMA1_PCLK_DI()		( RCC->AHB1ENR &= ~(1 << 21) )
+#define DMA2_PCLK_DI()		( RCC->AHB1ENR &= ~(1 << 22) )
+
 // I2C DISABLE
 #define I2C1_PCLK_DI()		( RCC->APB1ENR &= ~(1 << 21) )
 #define I2C2_PCLK_DI()		( RCC->APB1ENR &= ~(1 << 22) )
@@ -312,6 +504,9 @@ typedef struct {
 // SYSCFG DISABLE
 #define SYSCFG_PCLK_DI()	( RCC->APB2ENR &= ~(1 << 14) )
 
+// PWR DISABLE
+#define PWR_PCLK_DI()		( RCC->APB1ENR &= ~(1 << 28) )
+
 //************ MACROS TO RESET GPIOX PERIPHERALS *****************//
 #define GPIOA_REG_RESET()		do{ (RCC->AHB1RSTR |= (1 << 0)); (RCC->AHB1RSTR &= ~(1 << 0)); } while(0)
 #define GPIOB_REG_RESET()		do{ (RCC->AHB1RSTR |= (1 << 1)); (RCC->AHB1RSTR &= ~(1 << 1)); } while(0)
@@ -333,6 +528,10 @@ typedef struct {
 #define I2C2_REG_RESET()		do{ (RCC->APB1RSTR |= (1 << 22)); (RCC->APB1RSTR &= ~(1 << 22)); } while(0)
 #define I2C3_REG_RESET()		do{ (RCC->APB1RSTR |= (1 << 23)); (RCC->AHB1RSTR &= ~(1 << 23)); } while(0)
 
+//************ MACROS TO RESET DMAX PERIPHERALS *****************//
+#define DMA1_REG_RESET()		do{ (RCC->AHB1RSTR |= (1 << 21)); (RCC->AHB1RSTR &= ~(1 << 21)); } while(0)
+#define DMA2_REG_RESET()		do{ (RCC->AHB1RSTR |= (1 << 22)); (RCC->AHB1RSTR &= ~(1 << 22)); } while(0)
+
 //***************** GET PORT CODE ********************//
 
 #define GPIO_BASEADDR_TO_CODE(x)   ((x == GPIOA) ? 0 :\
@@ -375,6 +574,24 @@ typedef struct {
 #define IRQ_NO_UART5		53
 #define IRQ_NO_USART6		71
 
+// DMA Interrupt Numbers
+#define IRQ_NO_DMA1_STREAM0	11
+#define IRQ_NO_DMA1_STREAM1	12
+#define IRQ_NO_DMA1_STREAM2	13
+#define IRQ_NO_DMA1_STREAM3	14
+#define IRQ_NO_DMA1_STREAM4	15
+#define IRQ_NO_DMA1_STREAM5	16
+#define IRQ_NO_DMA1_STREAM6	17
+#define IRQ_NO_DMA1_STREAM7	47
+#define IRQ_NO_DMA2_STREAM0	56
+#define IRQ_NO_DMA2_STREAM1	57
+#define IRQ_NO_DMA2_STREAM2	58
+#define IRQ_NO_DMA2_STREAM3	59
+#define IRQ_NO_DMA2_STREAM4	60
+#define IRQ_NO_DMA2_STREAM5	68
+#define IRQ_NO_DMA2_STREAM6	69
+#define IRQ_NO_DMA2_STREAM7	70
+
 // GENERIC MACROS
 #define ENABLE 			1
 #define DISABLE 		0
@@ -538,10 +755,84 @@ typedef struct {
 #define USART_GTPR_PSC			0
 #define USART_GTPR_GT			8
 
+// Bit position definitions of DMA Peripheral
+#define DMA_SxCR_EN				0
+#define DMA_SxCR_DMEIE			1
+#define DMA_SxCR_TEIE			2
+#define DMA_SxCR_HTIE			3
+#define DMA_SxCR_TCIE			4
+#define DMA_SxCR_PFCTRL			5
+#define DMA_SxCR_DIR			6
+#define DMA_SxCR_CIRC			8
+#define DMA_SxCR_PINC			9
+#define DMA_SxCR_MINC			10
+#define DMA_SxCR_PSIZE			11
+#define DMA_SxCR_MSIZE			13
+#define DMA_SxCR_PINCOS			15
+#define DMA_SxCR_PL				16
+#define DMA_SxCR_DBM			18
+#define DMA_SxCR_CT				19
+#define DMA_SxCR_PBURST			21
+#define DMA_SxCR_MBURST			23
+#define DMA_SxCR_CHSEL			25
+
+#define DMA_SxFCR_FTH			0
+#define DMA_SxFCR_DMDIS			2
+#define DMA_SxFCR_FS			3
+#define DMA_SxFCR_FEIE			7
+
+// Flag bit positions inside the 6-bit group each stream owns in LISR/HISR (and LIFCR/HIFCR)
+#define DMA_ISR_FEIF			0
+#define DMA_ISR_DMEIF			2
+#define DMA_ISR_TEIF			3
+#define DMA_ISR_HTIF			4
+#define DMA_ISR_TCIF			5
+
+// Bit position definitions of RCC Peripheral
+#define RCC_CR_HSION			0
+#define RCC_CR_HSIRDY			1
+#define RCC_CR_HSEON			16
+#define RCC_CR_HSERDY			17
+#define RCC_CR_HSEBYP			18
+#define RCC_CR_PLLON			24
+#define RCC_CR_PLLRDY			25
+
+#define RCC_PLLCFGR_PLLM		0
+#define RCC_PLLCFGR_PLLN		6
+#define RCC_PLLCFGR_PLLP		16
+#define RCC_PLLCFGR_PLLSRC		22
+#define RCC_PLLCFGR_PLLQ		24
+
+#define RCC_CFGR_SW				0
+#define RCC_CFGR_SWS			2
+#define RCC_CFGR_HPRE			4
+#define RCC_CFGR_PPRE1			10
+#define RCC_CFGR_PPRE2			13
+
+// Bit position definitions of PWR Peripheral
+#define PWR_CR_VOS				14
+
+// Bit position definitions of FLASH interface
+#define FLASH_ACR_LATENCY		0
+#define FLASH_ACR_PRFTEN		8
+#define FLASH_ACR_ICEN			9
+#define FLASH_ACR_DCEN			10
+#define FLASH_ACR_ICRST			11
+#define FLASH_ACR_DCRST			12
+
+#include "stm32f407xx_nvic_driver.h"
+#include "stm32f407xx_fpu_driver.h"
+#include "stm32f407xx_prof_driver.h"
+#include "stm32f407xx_log_driver.h"
+#include "stm32f407xx_evt_driver.h"
+#include "stm32f407xx_pool_driver.h"
 #include "stm32f407xx_gpio_driver.h"
+#include "stm32f407xx_dma_driver.h"
+#include "stm32f407xx_rcc_driver.h"
+#include "stm32f407xx_flash_driver.h"
+#include "stm32f407xx_systick_driver.h"
 #include "stm32f407xx_spi_driver.h"
 #include "stm32f407xx_i2c_driver.h"
 #include "stm32f407xx_usart_driver.h"
-#include "stm32f407xx_rcc_driver.h"
 
 #endif /* INC_STM32F407XX_H_ */
@@ -0,0 +1,198 @@
+/*
+ * stm32f407xx_dma_driver.h
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#ifndef INC_STM32F407XX_DMA_DRIVER_H_
+#define INC_STM32F407XX_DMA_DRIVER_H_
+
+#include "stm32f407xx.h"
+
+typedef struct{
+	uint8_t Direction;			/*!< possible values from @Direction>*/
+	uint8_t Mode;				/*!< possible values from @Mode>*/
+	uint8_t Priority;			/*!< possible values from @Priority>*/
+	uint8_t PeriphDataSize;		/*!< possible values from @DataSize>*/
+	uint8_t MemDataSize;		/*!< possible values from @DataSize>*/
+	uint8_t PeriphInc;			/*!< ENABLE or DISABLE>*/
+	uint8_t MemInc;				/*!< ENABLE or DISABLE>*/
+	uint8_t FIFOMode;			/*!< possible values from @FIFOMode>*/
+	uint8_t FIFOThreshold;		/*!< possible values from @FIFOThreshold>*/
+	uint8_t PeriphBurst;		/*!< possible values from @Burst>*/
+	uint8_t MemBurst;			/*!< possible values from @Burst>*/
+} DMA_Config_t;
+
+typedef struct DMA_Handle DMA_Handle_t;
+
+struct DMA_Handle{
+	DMA_RegDef_t	*pDMAx;		// DMA1 or DMA2 (or a simulated register block)
+	uint8_t			Stream;		// Stream number 0-7
+	uint8_t			Channel;	// Channel (request line) selected on that stream 0-7
+	DMA_Config_t	DMAConfig;
+	uint8_t			State;
+	void			*pParent;	// Peripheral handle which owns this stream, if any
+	void			(*XferEventCallback)(DMA_Handle_t *pDMAHandle, uint8_t AppEv);
+};
+
+/*
+ * @Direction
+ */
+#define DMA_DIR_PERIPH_TO_MEM	0
+#define DMA_DIR_MEM_TO_PERIPH	1
+#define DMA_DIR_MEM_TO_MEM		2
+
+/*
+ * @Mode
+ */
+#define DMA_MODE_NORMAL			0
+#define DMA_MODE_CIRCULAR		1
+#define DMA_MODE_DOUBLE_BUFFER	2
+
+/*
+ * @Priority
+ */
+#define DMA_PRIORITY_LOW		0
+#define DMA_PRIORITY_MEDIUM		1
+#define DMA_PRIORITY_HIGH		2
+#define DMA_PRIORITY_VERY_HIGH	3
+
+/*
+ * @DataSize
+ */
+#define DMA_DATA_SIZE_BYTE		0
+#define DMA_DATA_SIZE_HALFWORD	1
+#define DMA_DATA_SIZE_WORD		2
+
+/*
+ * @FIFOMode
+ */
+#define DMA_FIFO_MODE_DIRECT	0
+#define DMA_FIFO_MODE_ENABLED	1
+
+/*
+ * @FIFOThreshold
+ */
+#define DMA_FIFO_THRESHOLD_1QUARTER		0
+#define DMA_FIFO_THRESHOLD_HALF			1
+#define DMA_FIFO_THRESHOLD_3QUARTERS	2
+#define DMA_FIFO_THRESHOLD_FULL			3
+
+/*
+ * @Burst
+ */
+#define DMA_BURST_SINGLE		0
+#define DMA_BURST_INC4			1
+#define DMA_BURST_INC8			2
+#define DMA_BURST_INC16			3
+
+/*
+ * @Memory
+ * Memory target used in double buffer mode
+ */
+#define DMA_MEMORY_0			0
+#define DMA_MEMORY_1			1
+
+/*
+ * @Request
+ * Peripheral requests which can be routed to a stream by DMA_AllocateStream
+ */
+#define DMA_REQ_MEM_TO_MEM		0
+#define DMA_REQ_SPI1_RX			1
+#define DMA_REQ_SPI1_TX			2
+#define DMA_REQ_SPI2_RX			3
+#define DMA_REQ_SPI2_TX			4
+#define DMA_REQ_SPI3_RX			5
+#define DMA_REQ_SPI3_TX			6
+#define DMA_REQ_I2C1_RX			7
+#define DMA_REQ_I2C1_TX			8
+#define DMA_REQ_I2C2_RX			9
+#define DMA_REQ_I2C2_TX			10
+#define DMA_REQ_I2C3_RX			11
+#define DMA_REQ_I2C3_TX			12
+#define DMA_REQ_USART1_RX		13
+#define DMA_REQ_USART1_TX		14
+#define DMA_REQ_USART2_RX		15
+#define DMA_REQ_USART2_TX		16
+#define DMA_REQ_USART3_RX		17
+#define DMA_REQ_USART3_TX		18
+#define DMA_REQ_UART4_RX		19
+#define DMA_REQ_UART4_TX		20
+#define DMA_REQ_UART5_RX		21
+#define DMA_REQ_UART5_TX		22
+#define DMA_REQ_USART6_RX		23
+#define DMA_REQ_USART6_TX		24
+
+/*
+ * Status flag macros
+ * These are relative to the 6-bit group of the stream, the driver shifts them into place
+ */
+#define DMA_FEIF_FLAG			(1 << DMA_ISR_FEIF)
+#define DMA_DMEIF_FLAG			(1 << DMA_ISR_DMEIF)
+#define DMA_TEIF_FLAG			(1 << DMA_ISR_TEIF)
+#define DMA_HTIF_FLAG			(1 << DMA_ISR_HTIF)
+#define DMA_TCIF_FLAG			(1 << DMA_ISR_TCIF)
+#define DMA_ALL_FLAGS			(DMA_FEIF_FLAG | DMA_DMEIF_FLAG | DMA_TEIF_FLAG | DMA_HTIF_FLAG | DMA_TCIF_FLAG)
+
+// Allocation and start return values, the start functions may also return DMA_BUSY
+#define DMA_OK					0
+#define DMA_ERR_NO_STREAM		2	// No free stream, or no stream attached to the handle
+#define DMA_ERR_LENGTH			3	// 0 or more than DMA_MAX_ITEMS data items
+#define DMA_ERR_ADDRESS			4	// Memory address in CCM RAM, which is not on the DMA bus matrix
+
+// NDTR is 16 bits wide
+#define DMA_MAX_ITEMS			65535
+
+// CCM RAM (64 KB) sits on the core D-bus only, a stream pointed at it ends in a transfer error
+#define DMA_IS_CCM_ADDR(addr)	((uint32_t)(addr) >= CCMRAM_BASEADDR && (uint32_t)(addr) < (CCMRAM_BASEADDR + 0x10000UL))
+
+// DMA_GetIRQNumber for a handle which is not on DMA1 or DMA2
+#define DMA_IRQ_NO_INVALID		0xFF
+
+// DMA states
+#define DMA_READY				0
+#define DMA_BUSY				1
+
+// Possible DMA application events
+#define DMA_EVENT_HALF_CMPLT	0
+#define DMA_EVENT_FULL_CMPLT	1
+#define DMA_EVENT_TRANSFER_ERR	2
+#define DMA_EVENT_FIFO_ERR		3
+#define DMA_EVENT_DIRECT_ERR	4
+
+// Peripheral clock setup
+void DMA_PeriClockControl(DMA_RegDef_t *pDMAx, uint8_t EnorDi);
+
+// Init and de-init
+void DMA_Init(DMA_Handle_t *pDMAHandle);
+void DMA_DeInit(DMA_RegDef_t *pDMAx);
+
+// Stream allocation
+uint8_t DMA_AllocateStream(DMA_Handle_t *pDMAHandle, uint8_t request);
+void DMA_ReleaseStream(DMA_Handle_t *pDMAHandle);
+
+// Stream control
+void DMA_StreamControl(DMA_Handle_t *pDMAHandle, uint8_t EnorDi);
+uint8_t DMA_StartTransfer(DMA_Handle_t *pDMAHandle, uint32_t srcAddr, uint32_t dstAddr, uint32_t len);
+uint8_t DMA_StartDoubleBuffer(DMA_Handle_t *pDMAHandle, uint32_t periphAddr, uint32_t mem0Addr, uint32_t mem1Addr, uint32_t len);
+void DMA_ChangeMemoryAddress(DMA_Handle_t *pDMAHandle, uint32_t memAddr, uint8_t memory);
+uint8_t DMA_GetCurrentTarget(DMA_Handle_t *pDMAHandle);
+uint16_t DMA_GetRemaining(DMA_Handle_t *pDMAHandle);
+void DMA_Abort(DMA_Handle_t *pDMAHandle);
+
+// Flags
+uint8_t DMA_GetFlagStatus(DMA_Handle_t *pDMAHandle, uint32_t flagName);
+void DMA_ClearFlag(DMA_Handle_t *pDMAHandle, uint32_t flagName);
+
+// IRQ Configuration and ISR Handling
+uint8_t DMA_GetIRQNumber(DMA_Handle_t *pDMAHandle);
+uint8_t DMA_IRQBind(DMA_Handle_t *pDMAHandle);
+void DMA_IRQInterruptConfig(uint8_t IRQNumber, uint32_t IRQPriority, uint8_t EnorDi);
+void DMA_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority);
+void DMA_IRQHandling(DMA_Handle_t *pDMAHandle);
+
+// Application callback
+void DMA_ApplicationEventCallback(DMA_Handle_t *pDMAHandle, uint8_t AppEv);
+
+#endif /* INC_STM32F407XX_DMA_DRIVER_H_ */
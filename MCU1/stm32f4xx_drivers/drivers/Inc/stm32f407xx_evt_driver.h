@@ -0,0 +1,102 @@
+/*
+ * stm32f407xx_evt_driver.h
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#ifndef INC_STM32F407XX_EVT_DRIVER_H_
+#define INC_STM32F407XX_EVT_DRIVER_H_
+
+#include "stm32f407xx.h"
+
+/*
+ * Deferred work queue
+ * Interrupt handlers (e.g. the driver ApplicationEventCallbacks) post small event records
+ * with EVT_Post and return. EVT_Dispatch later runs the handler registered for the event
+ * type, either from PendSV at the lowest priority or from the main loop, so long work
+ * no longer blocks the other interrupts.
+ */
+
+// Queue depth in events, must be a power of two
+#ifndef EVT_QUEUE_DEPTH
+#define EVT_QUEUE_DEPTH			32
+#endif
+
+// Number of event types which can have a handler
+#define EVT_MAX_TYPES			16
+
+/*
+ * @EVT_TYPES
+ * Event types for the driver callbacks, the application takes its own from EVT_TYPE_USER
+ */
+#define EVT_TYPE_GPIO			0
+#define EVT_TYPE_SPI			1
+#define EVT_TYPE_I2C			2
+#define EVT_TYPE_USART			3
+#define EVT_TYPE_DMA			4
+#define EVT_TYPE_SPI_QUEUE		5	// Used by the SPI transfer queue for its chip-select timing
+#define EVT_TYPE_I2C_QUEUE		6	// Used by the I2C job queue to wait for STOP
+#define EVT_TYPE_USER			8
+
+/*
+ * @EVT_DISPATCH
+ * Where EVT_Dispatch is called from
+ */
+#define EVT_DISPATCH_PENDSV		0	// PendSV_Handler must call EVT_Dispatch, EVT_Post pends PendSV
+#define EVT_DISPATCH_MAIN		1	// The main loop calls EVT_Dispatch
+
+/*
+ * Return values
+ */
+#define EVT_OK					0
+#define EVT_ERR_FULL			1
+#define EVT_ERR_TYPE			2
+
+/*
+ * One queued event, copied into the queue by EVT_Post
+ */
+typedef struct{
+	uint8_t		Type;			// Selects the handler, from @EVT_TYPES
+	uint8_t		Code;			// Free for the poster, e.g. the AppEv of a driver callback
+	void		*pContext;		// Free for the poster, e.g. the driver handle
+	uint32_t	Data;			// Free for the poster
+	uint32_t	Stamp;			// Used by the driver, DWT cycle count when posted
+}EVT_Event_t;
+
+typedef void (*EVT_Handler_t)(EVT_Event_t *pEvent);
+
+/*
+ * Queue statistics, latency is in core clock cycles from EVT_Post to the handler call
+ */
+typedef struct{
+	uint32_t	Posted;
+	uint32_t	Dispatched;
+	uint32_t	Dropped;			// Posts which found the queue full
+	uint32_t	Unhandled;			// Events of a type without a handler
+	uint32_t	HighWater;			// Most events waiting at once
+	uint32_t	LatencyMax;
+	uint64_t	LatencyTotal;
+}EVT_Stats_t;
+
+/*
+ * Init and handlers
+ */
+void EVT_Init(uint8_t DispatchMode, uint8_t PendSVPriority);
+uint8_t EVT_RegisterHandler(uint8_t Type, EVT_Handler_t Handler);
+
+/*
+ * Post and dispatch
+ */
+uint8_t EVT_Post(uint8_t Type, uint8_t Code, void *pContext, uint32_t Data);
+uint32_t EVT_Dispatch(void);
+uint32_t EVT_GetPending(void);
+uint8_t EVT_IsReady(void);
+
+/*
+ * Statistics
+ */
+void EVT_GetStats(EVT_Stats_t *pStats);
+void EVT_ResetStats(void);
+
+#endif /* INC_STM32F407XX_EVT_DRIVER_H_ */
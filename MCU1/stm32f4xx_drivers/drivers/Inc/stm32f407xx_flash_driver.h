@@ -0,0 +1,46 @@
+/*
+ * stm32f407xx_flash_driver.h
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#ifndef INC_STM32F407XX_FLASH_DRIVER_H_
+#define INC_STM32F407XX_FLASH_DRIVER_H_
+
+#include "stm32f407xx.h"
+
+/*
+ * @VoltageRange
+ * Supply voltage range of the board, decides how many MHz one wait state covers
+ */
+#define FLASH_VRANGE_1V8_2V1		0		// 20 MHz per wait state, no prefetch
+#define FLASH_VRANGE_2V1_2V4		1		// 22 MHz per wait state
+#define FLASH_VRANGE_2V4_2V7		2		// 24 MHz per wait state
+#define FLASH_VRANGE_2V7_3V6		3		// 30 MHz per wait state
+
+// Highest LATENCY value of the F407
+#define FLASH_LATENCY_MAX			7
+
+// Returned by FLASH_GetLatency for an HCLK which needs more than FLASH_LATENCY_MAX wait states
+#define FLASH_LATENCY_INVALID		0xFF
+
+// FLASH_SetVoltageRange return values
+#define FLASH_OK					0
+#define FLASH_ERR_CONFIG			1
+
+/*
+ * Supply range and accelerator settings
+ */
+uint8_t FLASH_SetVoltageRange(uint8_t VoltageRange);
+uint8_t FLASH_GetVoltageRange(void);
+void FLASH_AcceleratorControl(uint8_t Prefetch, uint8_t ICache, uint8_t DCache);
+
+/*
+ * Wait states
+ */
+uint8_t FLASH_GetLatency(uint32_t hclk);
+void FLASH_SetLatency(uint8_t latency);
+void FLASH_ConfigForHCLK(uint32_t hclk);
+
+#endif /* INC_STM32F407XX_FLASH_DRIVER_H_ */
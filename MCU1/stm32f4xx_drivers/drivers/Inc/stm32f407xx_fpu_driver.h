@@ -0,0 +1,41 @@
+/*
+ * stm32f407xx_fpu_driver.h
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#ifndef INC_STM32F407XX_FPU_DRIVER_H_
+#define INC_STM32F407XX_FPU_DRIVER_H_
+
+#include "stm32f407xx.h"
+
+/*
+ * Cortex-M4 single precision FPU
+ * Reset_Handler enables CP10/CP11 whenever the image is compiled for the FPU (__ARM_FP,
+ * e.g. -mfpu=fpv4-sp-d16 -mfloat-abi=hard) and sets the stacking mode from FPU_STACKING,
+ * all before SystemInit or any other C code runs.
+ */
+
+/*
+ * @FPUStacking
+ * What exception entry does with the FPU registers of the interrupted code (FPCCR ASPEN/LSPEN)
+ */
+#define FPU_STACKING_LAZY		0	// Space is reserved, S0-S15/FPSCR are only saved if the handler uses the FPU (reset value)
+#define FPU_STACKING_ALWAYS		1	// S0-S15/FPSCR are saved on every entry from code which used the FPU
+#define FPU_STACKING_NONE		2	// Never saved, only safe if no handler uses the FPU
+
+/*
+ * Mode set by the startup code, the assembler needs the same -DFPU_STACKING as the compiler.
+ * With FPU_STACKING_LAZY a handler which does not touch the FPU is entered as fast as
+ * without an FPU.
+ */
+#ifndef FPU_STACKING
+#define FPU_STACKING			FPU_STACKING_LAZY
+#endif
+
+uint8_t FPU_IsEnabled(void);
+void FPU_SetStacking(uint8_t Mode);
+uint8_t FPU_GetStacking(void);
+
+#endif /* INC_STM32F407XX_FPU_DRIVER_H_ */
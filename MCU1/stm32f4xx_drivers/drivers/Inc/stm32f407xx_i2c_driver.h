@@ -36,7 +36,25 @@ typedef struct{
 #define I2C_FM_DUTY_2		0
 #define I2C_FM_DUTY_16_9	1
 
-typedef struct{
+typedef struct I2C_Handle I2C_Handle_t;
+typedef struct I2C_Job I2C_Job_t;
+
+/*
+ * Job descriptor for I2C_QueueJob
+ * The descriptor is linked into the queue, it must stay valid until its Callback has run
+ */
+struct I2C_Job{
+	uint8_t			SlaveAddr;
+	uint8_t			*pTxBuffer;		// Write segment, sent first
+	uint32_t		TxLen;			// 0 for a read-only job
+	uint8_t			*pRxBuffer;		// Read segment, received after the write segment
+	uint32_t		RxLen;			// 0 for a write-only job
+	uint8_t			sr;				// I2C_ENABLE_RS: repeated START between the segments, I2C_DISABLE_RS: STOP then START
+	void			(*Callback)(I2C_Handle_t *pI2CHandle, I2C_Job_t *pJob, uint8_t AppEv);	// Optional, from the I2C ISR or from EVT_Dispatch
+	I2C_Job_t		*pNext;			// Used by the driver
+};
+
+struct I2C_Handle{
 	I2C_RegDef_t 	*pI2Cx;
 	I2C_Config_t 	I2C_Config;
 	uint8_t 		*pTxBuffer;
@@ -47,7 +65,32 @@ typedef struct{
 	uint8_t 		DevAddr;
 	uint32_t 		RxSize;
 	uint8_t 		sr;
-} I2C_Handle_t;
+	DMA_Handle_t	*pDMATx;	// Stream feeding DR, NULL if DMA is not used for Tx
+	DMA_Handle_t	*pDMARx;	// Stream draining DR, NULL if DMA is not used for Rx
+	uint8_t			MemAddrBuf[2];	// Register address of a memory access, MSB first
+	uint8_t			MemMode;		// What follows the register address, see @MemMode
+	uint8_t			*pMemData;		// Data phase of a memory write
+	uint32_t		MemDataLen;
+	I2C_Job_t		*pJobHead;		// Job in progress, followed by the queued ones
+	I2C_Job_t		*pJobTail;
+	RCC_ClockListener_t ClockListener;	// Re-tunes CCR/TRISE on clock changes, see I2C_ClockTrackingControl
+};
+
+/*
+ * @MemAddrSize
+ */
+#define I2C_MEMADD_SIZE_8BIT	1
+#define I2C_MEMADD_SIZE_16BIT	2
+
+/*
+ * @MemMode
+ * Second phase of a memory access, run from I2C_EV_IRQHandling once the register address is out
+ */
+#define I2C_MEM_NONE			0
+#define I2C_MEM_WRITE_IT		1
+#define I2C_MEM_WRITE_DMA		2
+#define I2C_MEM_READ_IT			3
+#define I2C_MEM_READ_DMA		4
 
 // Status flag macros
 #define I2C_SB_FLAG 			(1 << I2C_SR1_SB)
@@ -83,6 +126,13 @@ typedef struct{
 #define I2C_BUSY_IN_TX			1
 #define I2C_BUSY_IN_RX			2
 
+// Returned by the DMA calls when no stream is attached or the length does not fit NDTR
+#define I2C_ERR_DMA				3
+// Returned by I2C_QueueJob while a transfer outside the queue owns the handle
+#define I2C_ERR_BUSY			4
+// Returned by I2C_QueueJob when the event queue is not ready (EVT_Init) or full
+#define I2C_ERR_QUEUE			5
+
 // I2c Application events macros
 #define I2C_EV_TX_CMPLT			0
 #define I2C_EV_RX_CMPLT			1
@@ -96,6 +146,8 @@ typedef struct{
 #define I2C_ERROR_AF    		7
 #define I2C_ERROR_OVR   		8
 #define I2C_ERROR_TIMEOUT 		9
+#define I2C_ERROR_DMA	 		10
+#define I2C_ERROR_QUEUE	 		11	// Job dropped, the event queue was full
 
 // Peripheral clock setup
 void I2C_PeriClockControl(I2C_RegDef_t *pI2Cx, uint8_t EnorDi);
@@ -103,6 +155,7 @@ void I2C_PeriClockControl(I2C_RegDef_t *pI2Cx, uint8_t EnorDi);
 // Init and de-enit
 void I2C_Init(I2C_Handle_t *pI2CHandle);
 void I2C_DeInit(I2C_RegDef_t *pI2Cx);
+void I2C_ClockTrackingControl(I2C_Handle_t *pI2CHandle, uint8_t EnorDi);
 
 // Function to enable and disable I2C
 void I2C_PeripheralControl(I2C_Handle_t* pI2CHandle, uint8_t EnorDi);
@@ -128,6 +181,23 @@ void I2C_GenerateStopCondition(I2C_RegDef_t *pI2Cx);
 uint8_t I2C_MasterSendDataIT(I2C_Handle_t *pI2CHandle, uint8_t *pTxbuffer, uint32_t len, uint8_t slaveAddr, uint8_t sr);
 uint8_t I2C_MasterReceiveDataIT(I2C_Handle_t *pI2CHandle, uint8_t *pRxBuffer, uint32_t len, uint8_t slaveAddr, uint8_t sr);
 
+// DMA send and receive
+uint8_t I2C_DMAInit(I2C_Handle_t *pI2CHandle, DMA_Handle_t *pDMATx, DMA_Handle_t *pDMARx);
+uint8_t I2C_MasterSendDataDMA(I2C_Handle_t *pI2CHandle, uint8_t *pTxbuffer, uint32_t len, uint8_t slaveAddr, uint8_t sr);
+uint8_t I2C_MasterReceiveDataDMA(I2C_Handle_t *pI2CHandle, uint8_t *pRxBuffer, uint32_t len, uint8_t slaveAddr, uint8_t sr);
+
+// Register (memory) access, the whole burst is one bus transaction
+void I2C_MemWrite(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t *pTxBuffer, uint32_t len);
+void I2C_MemRead(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t *pRxBuffer, uint32_t len);
+uint8_t I2C_MemWriteIT(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t *pTxBuffer, uint32_t len);
+uint8_t I2C_MemReadIT(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t *pRxBuffer, uint32_t len);
+uint8_t I2C_MemWriteDMA(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t *pTxBuffer, uint32_t len);
+uint8_t I2C_MemReadDMA(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t *pRxBuffer, uint32_t len);
+
+// Job queue
+uint8_t I2C_QueueJob(I2C_Handle_t *pI2CHandle, I2C_Job_t *pJob);
+uint8_t I2C_QueueIsIdle(I2C_Handle_t *pI2CHandle);
+
 // Closing data communications
 void I2C_CloseSendData(I2C_Handle_t *pI2CHandle);
 void I2C_CloseReceiveData(I2C_Handle_t *pI2CHandle);
@@ -139,6 +209,7 @@ uint8_t I2C_SlaveReceiveData(I2C_RegDef_t *pI2Cx);
 // IRQ Configuration and ISR Handling
 void I2C_IRQInterruptConfig(uint8_t IRQNumber, uint32_t IRQPriority, uint8_t EnorDi);
 void I2C_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority);
+uint8_t I2C_IRQBind(I2C_Handle_t *pI2CHandle);
 void I2C_EV_IRQHandling(I2C_Handle_t *pI2CHandle);
 void I2C_ER_IRQHandling(I2C_Handle_t *pI2CHandle);
 
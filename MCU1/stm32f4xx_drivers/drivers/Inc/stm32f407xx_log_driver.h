@@ -0,0 +1,83 @@
+/*
+ * stm32f407xx_log_driver.h
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#ifndef INC_STM32F407XX_LOG_DRIVER_H_
+#define INC_STM32F407XX_LOG_DRIVER_H_
+
+#include "stm32f407xx.h"
+
+/*
+ * Deferred binary logging
+ * LOG_PRINT stores the address of its format string and up to LOG_MAX_ARGS raw 32-bit
+ * arguments in a word buffer, nothing is formatted on the target. LOG_Process sends the
+ * records over an ITM stimulus port and tools/log_decode.py turns them back into text
+ * with the format strings from the .log_fmt section of the ELF file.
+ * Arguments must be 32-bit integers or pointers (%d %i %u %x %X %o %c %p), %s and
+ * floating point are not supported.
+ */
+
+// Buffer size in 32-bit words, must be a power of two
+#ifndef LOG_BUF_WORDS
+#define LOG_BUF_WORDS			256
+#endif
+
+// ITM stimulus port of the log stream, port 0 stays free for printf
+#ifndef LOG_ITM_PORT
+#define LOG_ITM_PORT			1
+#endif
+
+#define LOG_MAX_ARGS			4
+
+/*
+ * Record header: bit 31 marks a committed record, bits 26-24 the number of arguments,
+ * bits 23-0 the format string address in .log_fmt. The arguments follow.
+ */
+#define LOG_HDR_VALID			(1UL << 31)
+#define LOG_HDR_NARGS			24
+#define LOG_HDR_ID_MASK			0x00FFFFFFUL
+
+// Format ID of the record which reports records lost to a full buffer, one argument: the count
+#define LOG_ID_DROPPED			0x00FFFFFFUL
+
+// Counts the arguments of LOG_PRINT, 0 to 4
+#define LOG_NARGS(...)			LOG_NARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define LOG_NARGS_(_0, _1, _2, _3, _4, N, ...)	N
+
+// Converts every argument to a raw 32-bit word, through uintptr_t so that pointers (%p) convert cleanly
+#define LOG_ARG(x)				((uint32_t)(uintptr_t)(x))
+#define LOG_ARGS(...)			LOG_ARGS_SEL(LOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define LOG_ARGS_SEL(n)			LOG_ARGS_SEL_(n)
+#define LOG_ARGS_SEL_(n)		LOG_ARGS_##n
+#define LOG_ARGS_0()
+#define LOG_ARGS_1(a)			LOG_ARG(a)
+#define LOG_ARGS_2(a, b)		LOG_ARG(a), LOG_ARG(b)
+#define LOG_ARGS_3(a, b, c)		LOG_ARG(a), LOG_ARG(b), LOG_ARG(c)
+#define LOG_ARGS_4(a, b, c, d)	LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d)
+
+/*
+ * Logs a message from any context, main loop or interrupt
+ * The format string is kept out of flash, it only exists in the ELF file
+ */
+#define LOG_PRINT(fmt, ...)		do{ \
+	static const char logFmt[] __attribute__((section(".log_fmt"), used)) = fmt; \
+	_Static_assert(LOG_NARGS(__VA_ARGS__) <= LOG_MAX_ARGS, "too many LOG_PRINT arguments"); \
+	LOG_Write(LOG_ARG(logFmt), LOG_NARGS(__VA_ARGS__), (const uint32_t[LOG_MAX_ARGS]){ LOG_ARGS(__VA_ARGS__) }); \
+} while(0)
+
+/*
+ * Init and drain
+ */
+void LOG_Init(void);
+void LOG_Process(void);
+uint32_t LOG_GetDropped(void);
+
+/*
+ * Used by LOG_PRINT
+ */
+void LOG_Write(uint32_t id, uint32_t nargs, const uint32_t *pArgs);
+
+#endif /* INC_STM32F407XX_LOG_DRIVER_H_ */
@@ -0,0 +1,75 @@
+/*
+ * stm32f407xx_nvic_driver.h
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#ifndef INC_STM32F407XX_NVIC_DRIVER_H_
+#define INC_STM32F407XX_NVIC_DRIVER_H_
+
+#include "stm32f407xx.h"
+
+/*
+ * @PriorityGroup
+ * Split of the NO_PRIORITY_BITS_IMPLEMENTED priority bits into preempt and sub-priority,
+ * values match AIRCR PRIGROUP. Only the preempt part decides whether an IRQ can nest.
+ */
+#define NVIC_PRIGROUP_4_0		3		// 16 preempt levels, no sub-priority (reset value)
+#define NVIC_PRIGROUP_3_1		4		// 8 preempt levels, 2 sub-priorities
+#define NVIC_PRIGROUP_2_2		5		// 4 preempt levels, 4 sub-priorities
+#define NVIC_PRIGROUP_1_3		6		// 2 preempt levels, 8 sub-priorities
+#define NVIC_PRIGROUP_0_4		7		// No preemption, 16 sub-priorities
+
+// Vector table of the F407: 16 system exceptions and 82 IRQs
+#define NVIC_NUM_IRQS			82
+#define NVIC_NUM_VECTORS		(16 + NVIC_NUM_IRQS)
+
+/*
+ * Handler bound to an IRQ at run time with NVIC_IRQBind, gets the context given there.
+ * The driver IRQHandling functions fit this once cast, e.g.
+ * NVIC_IRQBind(IRQ_NO_I2C1_EV, (NVIC_IRQHandler_t)I2C_EV_IRQHandling, &i2c1Handle),
+ * the drivers wrap that in their own IRQBind functions.
+ */
+typedef void (*NVIC_IRQHandler_t)(void *pContext);
+
+// IRQ binding return values
+#define NVIC_OK					0
+#define NVIC_ERR_IRQ			1
+
+/*
+ * Enable, disable and priority
+ */
+void NVIC_IRQInterruptConfig(uint8_t IRQNumber, uint8_t EnorDi);
+void NVIC_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority);
+uint32_t NVIC_GetPriority(uint8_t IRQNumber);
+
+/*
+ * Priority grouping
+ */
+void NVIC_SetPriorityGrouping(uint8_t PriorityGroup);
+uint8_t NVIC_GetPriorityGrouping(void);
+uint32_t NVIC_EncodePriority(uint32_t PreemptPriority, uint32_t SubPriority);
+
+/*
+ * Pending and active state
+ */
+void NVIC_SetPending(uint8_t IRQNumber);
+void NVIC_ClearPending(uint8_t IRQNumber);
+uint8_t NVIC_GetPending(uint8_t IRQNumber);
+uint8_t NVIC_GetActive(uint8_t IRQNumber);
+
+/*
+ * Vector table
+ */
+void NVIC_RelocateVectorTable(void);
+void NVIC_SetVectorTable(const uint32_t *pTable);
+const uint32_t *NVIC_GetVectorTable(void);
+
+/*
+ * Run-time handler binding, uses the SRAM vector table
+ */
+uint8_t NVIC_IRQBind(uint8_t IRQNumber, NVIC_IRQHandler_t Handler, void *pContext);
+uint8_t NVIC_IRQUnbind(uint8_t IRQNumber);
+
+#endif /* INC_STM32F407XX_NVIC_DRIVER_H_ */
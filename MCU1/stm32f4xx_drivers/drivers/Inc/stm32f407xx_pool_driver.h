@@ -0,0 +1,127 @@
+/*
+ * stm32f407xx_pool_driver.h
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#ifndef INC_STM32F407XX_POOL_DRIVER_H_
+#define INC_STM32F407XX_POOL_DRIVER_H_
+
+#include "stm32f407xx.h"
+
+/*
+ * Fixed-block memory pools
+ * A pool hands out blocks of one size from a free list, so POOL_Alloc and POOL_Free take
+ * the same few cycles every time and the memory can not fragment. POOL_Malloc picks the
+ * smallest of the built-in size classes which fits, POOL_Release gives the block back.
+ * All functions are safe from interrupts.
+ */
+
+/*
+ * Built-in size classes, block sizes in bytes (multiples of 4, ascending) and block counts
+ */
+#ifndef POOL_CLASS0_SIZE
+#define POOL_CLASS0_SIZE		16
+#endif
+#ifndef POOL_CLASS0_BLOCKS
+#define POOL_CLASS0_BLOCKS		16
+#endif
+
+#ifndef POOL_CLASS1_SIZE
+#define POOL_CLASS1_SIZE		32
+#endif
+#ifndef POOL_CLASS1_BLOCKS
+#define POOL_CLASS1_BLOCKS		8
+#endif
+
+#ifndef POOL_CLASS2_SIZE
+#define POOL_CLASS2_SIZE		64
+#endif
+#ifndef POOL_CLASS2_BLOCKS
+#define POOL_CLASS2_BLOCKS		8
+#endif
+
+#ifndef POOL_CLASS3_SIZE
+#define POOL_CLASS3_SIZE		256
+#endif
+#ifndef POOL_CLASS3_BLOCKS
+#define POOL_CLASS3_BLOCKS		4
+#endif
+
+#define POOL_NUM_CLASSES		4
+
+/*
+ * Build with -DPOOL_IN_CCMRAM=1 to put the size classes into the 64 KB CCM RAM.
+ * The DMA controllers can not reach CCM RAM, blocks from there must not be DMA buffers.
+ */
+#ifndef POOL_IN_CCMRAM
+#define POOL_IN_CCMRAM			0
+#endif
+
+#if POOL_IN_CCMRAM
+#define POOL_SECTION			__ccmram_noinit
+#else
+#define POOL_SECTION
+#endif
+
+/*
+ * With POOL_DEBUG every pool keeps a bitmap of the blocks handed out, so that POOL_Free
+ * also refuses a block which is already free. On by default in the Debug build (DEBUG),
+ * only the first POOL_DEBUG_MAX_BLOCKS blocks of a pool are tracked.
+ */
+#ifndef POOL_DEBUG
+#ifdef DEBUG
+#define POOL_DEBUG				1
+#else
+#define POOL_DEBUG				0
+#endif
+#endif
+
+#ifndef POOL_DEBUG_MAX_BLOCKS
+#define POOL_DEBUG_MAX_BLOCKS	64
+#endif
+
+/*
+ * Declares word-aligned backing memory for a pool of NumBlocks blocks of BlockSize bytes
+ */
+#define POOL_BLOCK_SIZE(BlockSize)				((((BlockSize) < 4 ? 4 : (BlockSize)) + 3) & ~3UL)
+#define POOL_MEMORY(name, BlockSize, NumBlocks)	\
+	uint32_t name[(POOL_BLOCK_SIZE(BlockSize) * (NumBlocks)) / 4]
+
+/*
+ * One pool, the fields are used by the driver and may be read for statistics
+ */
+typedef struct{
+	void		*pFree;			// First free block, each free block holds the next one
+	uint8_t		*pStart;
+	uint8_t		*pEnd;
+	uint16_t	BlockSize;
+	uint16_t	NumBlocks;
+	uint16_t	Used;			// Blocks handed out right now
+	uint16_t	HighWater;		// Most blocks handed out at once
+	uint32_t	Failures;		// Allocations which found the pool empty
+	uint32_t	BadFrees;		// POOL_Free calls which were refused
+#if POOL_DEBUG
+	uint32_t	InUse[(POOL_DEBUG_MAX_BLOCKS + 31) / 32];
+#endif
+}POOL_Handle_t;
+
+/*
+ * Single pools
+ */
+void POOL_Init(POOL_Handle_t *pPool, void *pMem, uint16_t BlockSize, uint16_t NumBlocks);
+void *POOL_Alloc(POOL_Handle_t *pPool);
+void POOL_Free(POOL_Handle_t *pPool, void *pBlock);
+uint8_t POOL_Owns(POOL_Handle_t *pPool, void *pBlock);
+
+/*
+ * Size classes
+ */
+void POOL_ClassesInit(void);
+void *POOL_Malloc(uint32_t size);
+void POOL_Release(void *pBlock);
+POOL_Handle_t *POOL_GetClass(uint8_t Class);
+void POOL_Dump(void);
+
+#endif /* INC_STM32F407XX_POOL_DRIVER_H_ */
@@ -0,0 +1,117 @@
+/*
+ * stm32f407xx_prof_driver.h
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#ifndef INC_STM32F407XX_PROF_DRIVER_H_
+#define INC_STM32F407XX_PROF_DRIVER_H_
+
+#include "stm32f407xx.h"
+
+/*
+ * Build option: 1 times every driver IRQ handler (duration and entry latency),
+ * 0 compiles the instrumentation out completely
+ */
+#ifndef PROF_IRQ_INSTRUMENTATION
+#define PROF_IRQ_INSTRUMENTATION	0
+#endif
+
+// log2 histogram, one bucket per bit of the 32-bit cycle count
+#define PROF_HIST_BUCKETS			32
+
+typedef struct PROF_Probe PROF_Probe_t;
+
+/*
+ * Named measurement point, fed by PROF_Begin/PROF_End or PROF_Record
+ * The probe is linked into the dump list, it must stay valid for the lifetime of the program
+ */
+struct PROF_Probe{
+	const char		*pName;
+	uint32_t		Count;
+	uint32_t		Min;			// In cycles
+	uint32_t		Max;
+	uint64_t		Total;			// Sum of all samples, for the mean
+	uint32_t		Hist[PROF_HIST_BUCKETS];	// Bucket n counts samples of 2^n to 2^(n+1)-1 cycles (bucket 0 also 0)
+	uint32_t		Start;			// Used by PROF_Begin/PROF_End
+	PROF_Probe_t	*pNext;			// Used by the driver
+};
+
+/*
+ * Probe pair of an interrupt handler
+ * Latency is only sampled for entries triggered with PROF_IRQTrigger
+ */
+typedef struct{
+	PROF_Probe_t	Duration;		// Handler entry to exit
+	PROF_Probe_t	Latency;		// PROF_IRQTrigger to handler entry
+	__vo uint32_t	TriggerStamp;
+	__vo uint8_t	Triggered;
+} PROF_IRQProbe_t;
+
+/*
+ * Init and probes
+ */
+void PROF_Init(void);
+void PROF_ProbeInit(PROF_Probe_t *pProbe, const char *pName);
+void PROF_IRQProbeInit(PROF_IRQProbe_t *pProbe, const char *pName, const char *pLatencyName);
+void PROF_Reset(PROF_Probe_t *pProbe);
+void PROF_ResetAll(void);
+
+/*
+ * Measurement
+ */
+void PROF_Record(PROF_Probe_t *pProbe, uint32_t cycles);
+uint32_t PROF_GetMean(PROF_Probe_t *pProbe);
+void PROF_IRQTrigger(PROF_IRQProbe_t *pProbe, uint8_t IRQNumber);
+
+/*
+ * Results over the debug channel (printf)
+ */
+void PROF_Dump(void);
+
+// Marks the start of a measured section
+static inline void PROF_Begin(PROF_Probe_t *pProbe){
+	pProbe->Start = *CORE_DWT_CYCCNT;
+}
+
+// Ends the section started with PROF_Begin and records its length
+static inline void PROF_End(PROF_Probe_t *pProbe){
+	PROF_Record(pProbe, *CORE_DWT_CYCCNT - pProbe->Start);
+}
+
+/*
+ * Driver IRQ handler instrumentation
+ * PROF_IRQ_ENTER goes after the locals of the handler, PROF_IRQ_EXIT before every return
+ */
+#if PROF_IRQ_INSTRUMENTATION
+
+extern PROF_IRQProbe_t PROF_SPI_IRQProbe;
+extern PROF_IRQProbe_t PROF_I2C_EV_IRQProbe;
+extern PROF_IRQProbe_t PROF_I2C_ER_IRQProbe;
+extern PROF_IRQProbe_t PROF_USART_IRQProbe;
+extern PROF_IRQProbe_t PROF_DMA_IRQProbe;
+
+static inline uint32_t PROF_IRQEnter(PROF_IRQProbe_t *pProbe){
+	uint32_t now = *CORE_DWT_CYCCNT;
+
+	if(pProbe->Triggered){
+		pProbe->Triggered = 0;
+		PROF_Record(&pProbe->Latency, now - pProbe->TriggerStamp);
+		// Keep the bookkeeping out of the duration
+		now = *CORE_DWT_CYCCNT;
+	}
+	return now;
+}
+
+#define PROF_IRQ_ENTER(probe)		uint32_t profIrqStart = PROF_IRQEnter(&(probe))
+#define PROF_IRQ_EXIT(probe)		PROF_Record(&(probe).Duration, *CORE_DWT_CYCCNT - profIrqStart)
+
+#else
+
+#define PROF_IRQ_ENTER(probe)
+#define PROF_IRQ_EXIT(probe)
+
+#endif
+
+#endif /* INC_STM32F407XX_PROF_DRIVER_H_ */
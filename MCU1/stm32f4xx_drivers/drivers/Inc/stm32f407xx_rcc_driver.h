@@ -10,9 +10,143 @@
 
 #include "stm32f407xx.h"
 
+// Oscillator frequencies, HSE is the 8 MHz crystal of the discovery board
+#define HSI_VALUE				16000000UL
+#define HSE_VALUE				8000000UL
+
+typedef struct{
+	uint8_t ClockSource;		/*!< possible values from @ClockSource>*/
+	uint8_t PLLSource;			/*!< possible values from @PLLSource>*/
+	uint8_t PLLM;				/*!< VCO input = PLL source / PLLM, 2 to 63, keep it at 1-2 MHz>*/
+	uint16_t PLLN;				/*!< VCO output = VCO input * PLLN, 50 to 432, keep it at 100-432 MHz>*/
+	uint8_t PLLP;				/*!< SYSCLK = VCO output / PLLP, 2, 4, 6 or 8>*/
+	uint8_t PLLQ;				/*!< 48 MHz clock = VCO output / PLLQ, 2 to 15>*/
+	uint8_t AHBPrescaler;		/*!< possible values from @AHBPrescaler>*/
+	uint8_t APB1Prescaler;		/*!< possible values from @APBPrescaler, PCLK1 max 42 MHz>*/
+	uint8_t APB2Prescaler;		/*!< possible values from @APBPrescaler, PCLK2 max 84 MHz>*/
+	uint8_t VoltageScale;		/*!< possible values from @VoltageScale>*/
+} RCC_ClkConfig_t;
+
+/*
+ * @ClockSource
+ * SYSCLK source, values match CFGR SW
+ */
+#define RCC_CLK_SRC_HSI			0
+#define RCC_CLK_SRC_HSE			1
+#define RCC_CLK_SRC_PLL			2
+
+/*
+ * @PLLSource
+ */
+#define RCC_PLL_SRC_HSI			0
+#define RCC_PLL_SRC_HSE			1
+
+/*
+ * @AHBPrescaler
+ * Values match CFGR HPRE
+ */
+#define RCC_AHB_DIV1			0
+#define RCC_AHB_DIV2			8
+#define RCC_AHB_DIV4			9
+#define RCC_AHB_DIV8			10
+#define RCC_AHB_DIV16			11
+#define RCC_AHB_DIV64			12
+#define RCC_AHB_DIV128			13
+#define RCC_AHB_DIV256			14
+#define RCC_AHB_DIV512			15
+
+/*
+ * @APBPrescaler
+ * Values match CFGR PPRE1/PPRE2
+ */
+#define RCC_APB_DIV1			0
+#define RCC_APB_DIV2			4
+#define RCC_APB_DIV4			5
+#define RCC_APB_DIV8			6
+#define RCC_APB_DIV16			7
+
+/*
+ * @VoltageScale
+ * Scale 1 is needed above 144 MHz, values match PWR_CR VOS
+ */
+#define RCC_VOS_SCALE2			0
+#define RCC_VOS_SCALE1			1
+
+// Bus frequency limits with scale 1
+#define RCC_HCLK_MAX			168000000UL
+#define RCC_PCLK1_MAX			42000000UL
+#define RCC_PCLK2_MAX			84000000UL
+#define RCC_HCLK_MAX_SCALE2		144000000UL
+
+// Bus frequencies in Hz, cached by RCC_UpdateClockTree
+typedef struct{
+	uint32_t SYSCLK;
+	uint32_t HCLK;
+	uint32_t PCLK1;
+	uint32_t PCLK2;
+} RCC_ClockTree_t;
+
+typedef struct RCC_ClockListener RCC_ClockListener_t;
+
+/*
+ * Clock change listener for RCC_RegisterClockListener
+ * The listener is linked into the RCC list, it must stay valid until it is unregistered
+ */
+struct RCC_ClockListener{
+	void				*pParent;		// Peripheral handle which owns this listener
+	void				(*Callback)(RCC_ClockListener_t *pListener, const RCC_ClockTree_t *pClocks);
+	uint8_t				(*IsBusy)(RCC_ClockListener_t *pListener);	// Optional, 1 while a transfer must not see a clock change
+	RCC_ClockListener_t	*pNext;			// Used by the driver
+};
+
+// RCC_ConfigSystemClock return values
+#define RCC_OK					0
+#define RCC_ERR_CONFIG			1
+#define RCC_ERR_HSE_TIMEOUT		2
+#define RCC_ERR_PLL_TIMEOUT		3
+#define RCC_ERR_BUSY			4
+
+/*
+ * @PerformanceLevel
+ * Operating points of RCC_SetPerformanceLevel, the PLL runs from the 8 MHz HSE
+ */
+#define RCC_PERF_HSI16			0		// HSI 16 MHz, HSE and PLL off, scale 2
+#define RCC_PERF_HSE8			1		// HSE 8 MHz, PLL off, scale 2
+#define RCC_PERF_PLL84			2		// PCLK1 42 MHz, PCLK2 84 MHz, scale 2
+#define RCC_PERF_PLL120			3		// PCLK1 30 MHz, PCLK2 60 MHz, scale 2
+#define RCC_PERF_PLL168			4		// PCLK1 42 MHz, PCLK2 84 MHz, scale 1
+#define RCC_PERF_CUSTOM			0xFF	// Set with RCC_ConfigSystemClock
+
+/*
+ * Build with -DRCC_EARLY_PLL=1 to get a SystemInit which the startup code calls before the
+ * .data copy: the device then leaves reset at RCC_PERF_PLL168 and initializes its RAM at
+ * 168 MHz instead of the 16 MHz HSI
+ */
+#ifndef RCC_EARLY_PLL
+#define RCC_EARLY_PLL			0
+#endif
+
 uint32_t RCC_GetPCLK1Value(void);
 uint32_t RCC_GetPCLK2Value(void);
+uint32_t RCC_GetSYSCLKValue(void);
+uint32_t RCC_GetHCLKValue(void);
+
+uint32_t RCC_GetPLLOutputClock(void);
+
+uint8_t RCC_ConfigSystemClock(RCC_ClkConfig_t *pClkConfig);
+uint8_t RCC_SetPerformanceLevel(uint8_t Level, uint32_t *pCycles);
+uint8_t RCC_GetPerformanceLevel(void);
+
+/*
+ * Clock tree cache and change notification
+ */
+const RCC_ClockTree_t* RCC_GetClockTree(void);
+void RCC_UpdateClockTree(void);
+void RCC_RegisterClockListener(RCC_ClockListener_t *pListener);
+void RCC_UnregisterClockListener(RCC_ClockListener_t *pListener);
 
-uint32_t RCC_GetPLLOutputClock();
+#if RCC_EARLY_PLL
+void SystemInit(void);
+#endif
 
 #endif /* INC_STM32F407XX_RCC_DRIVER_H_ */
@@ -95,13 +95,43 @@ typedef struct{
 #define SPI_BUSY_IN_RX	1
 #define SPI_BUSY_IN_TX	2
 
+// Returned by the DMA calls when no stream is attached or the length does not fit NDTR
+#define SPI_ERR_DMA		3
+// Returned by SPI_QueueTransfer when the event queue can not take the chip-select timing
+#define SPI_ERR_QUEUE	4
+
 // Possible SPI Application events
 #define SPI_EVENT_TX_CMPLT	1
 #define SPI_EVENT_RX_CMPLT	2
 #define SPI_EVENT_OVR_ERR	3
 #define SPI_EVENT_CRC_ERR	4
+#define SPI_EVENT_DMA_ERR	5
+#define SPI_EVENT_QUEUE_ERR	6	// Queued descriptors dropped, the event queue was full
 
-typedef struct{
+// SPI_Transfer_t Status of a descriptor which completed without error
+#define SPI_XFER_OK			0
+
+typedef struct SPI_Handle SPI_Handle_t;
+typedef struct SPI_Transfer SPI_Transfer_t;
+
+/*
+ * Transfer descriptor for SPI_QueueTransfer
+ * The descriptor is linked into the queue, it must stay valid until its Callback has run
+ */
+struct SPI_Transfer{
+	uint8_t			*pTxBuffer;		// Data to send, NULL to send dummy frames
+	uint8_t			*pRxBuffer;		// Where to store the received data, NULL to discard it
+	uint32_t		len;			// Number of frames, must be at least 1
+	GPIO_RegDef_t	*pCSPort;		// Chip-select port, NULL if CS is not driven by the queue
+	uint8_t			CSPin;			// Chip-select pin, active low
+	uint16_t		CSSetupDelay;	// Microseconds between CS low and the first clock, never waited in the SPI/DMA ISR
+	uint16_t		CSHoldDelay;	// Microseconds between the last clock and CS high, never waited in the SPI/DMA ISR
+	void			(*Callback)(SPI_Handle_t *pSPIHandle, SPI_Transfer_t *pXfer);	// Optional, from the SPI/DMA ISR or from EVT_Dispatch
+	uint8_t			Status;			// SPI_XFER_OK, or the SPI_EVENT_*_ERR which ended the transfer, valid in Callback
+	SPI_Transfer_t	*pNext;			// Used by the driver
+};
+
+struct SPI_Handle{
 	SPI_RegDef_t 	*pSPIx;
 	SPI_Config_t	SPIConfig;
 	uint8_t			*pTxBuffer;	// To store the app. Tx buffer address
@@ -110,7 +140,41 @@ typedef struct{
 	uint32_t		RxLen;
 	uint8_t			TxState;
 	uint8_t			RxState;
-} SPI_Handle_t;
+	DMA_Handle_t	*pDMATx;	// Stream feeding DR, NULL if DMA is not used for Tx
+	DMA_Handle_t	*pDMARx;	// Stream draining DR, NULL if DMA is not used for Rx
+	SPI_Transfer_t	*pXferHead;	// Transfer in progress, followed by the queued ones
+	SPI_Transfer_t	*pXferTail;
+	uint32_t		SclkMaxHz;	// SCLK limit kept by clock tracking, see SPI_ClockTrackingControl
+	RCC_ClockListener_t ClockListener;
+};
+
+/*
+ * Device on a shared bus, see SPI_BusAddDevice
+ */
+typedef struct{
+	uint8_t			SclkSpeed;		/*!< possible values from @SclkSpeed>*/
+	uint8_t			DFF;			/*!< possible values from @DFF>*/
+	uint8_t			CPOL;			/*!< possible values from @CPOL>*/
+	uint8_t			CPHA;			/*!< possible values from @CPHA>*/
+	uint8_t			FrameFormat;	/*!< possible values from @FrameFormat>*/
+	GPIO_RegDef_t	*pCSPort;		// Chip-select port, NULL if the device has no CS
+	uint8_t			CSPin;			// Chip-select pin, active low
+	uint16_t		CR1;			// Cached CR1 value, filled in by SPI_BusAddDevice
+} SPI_Device_t;
+
+/*
+ * Several devices sharing one SPI peripheral
+ */
+typedef struct{
+	SPI_Handle_t	*pSPIHandle;
+	SPI_Device_t	*pActiveDevice;	// Device whose CS is currently low
+	uint16_t		CR1;			// Last value written to CR1, without SPE
+	uint16_t		BaseCR1;		// Bits shared by all devices
+} SPI_Bus_t;
+
+// CR1 bits which differ between devices on one bus
+#define SPI_BUS_DEVICE_CR1_MASK		((1 << SPI_CR1_CPHA) | (1 << SPI_CR1_CPOL) | (7 << SPI_CR1_BR) | \
+									 (1 << SPI_CR1_LSB_FIRST) | (1 << SPI_CR1_DFF))
 
 // Peripheral clock setup
 void SPI_PeriClockControl(SPI_RegDef_t *pSPIx, uint8_t EnorDi);
@@ -118,6 +182,7 @@ void SPI_PeriClockControl(SPI_RegDef_t *pSPIx, uint8_t EnorDi);
 // Init and de-enit
 void SPI_Init(SPI_Handle_t *pSPIHandle);
 void SPI_DeInit(SPI_RegDef_t *pSPIx);
+void SPI_ClockTrackingControl(SPI_Handle_t *pSPIHandle, uint8_t EnorDi);
 
 // Function to enable and disable SPI
 void SPI_PeripheralControl(SPI_RegDef_t* pSPIx, uint8_t EnorDi);
@@ -128,14 +193,33 @@ void SPI_SSOEControl(SPI_RegDef_t * pSPIx, uint8_t EnorDi);
 uint8_t SPI_GetFlagStatus(SPI_RegDef_t *pSPIx, uint32_t flagName);
 void SPI_SendData(SPI_RegDef_t *pSPIx, uint8_t* pTxBuffer, uint32_t len);
 void SPI_ReceiveData(SPI_RegDef_t *pSPIx, uint8_t* pRxBuffer, uint32_t len);
+void SPI_TransmitReceive(SPI_RegDef_t *pSPIx, uint8_t* pTxBuffer, uint8_t* pRxBuffer, uint32_t len);
 
 // Interrupt Data Send and Receive
 uint8_t SPI_SendDataIT(SPI_Handle_t *pSPIHandle, uint8_t* pTxBuffer, uint32_t len);
 uint8_t SPI_ReceiveDataIT(SPI_Handle_t *pSPIHandle, uint8_t* pRxBuffer, uint32_t len);
 
+// DMA Data Send and Receive
+uint8_t SPI_DMAInit(SPI_Handle_t *pSPIHandle, DMA_Handle_t *pDMATx, DMA_Handle_t *pDMARx);
+uint8_t SPI_SendDataDMA(SPI_Handle_t *pSPIHandle, uint8_t* pTxBuffer, uint32_t len);
+uint8_t SPI_ReceiveDataDMA(SPI_Handle_t *pSPIHandle, uint8_t* pRxBuffer, uint32_t len);
+uint8_t SPI_TransferDMA(SPI_Handle_t *pSPIHandle, uint8_t* pTxBuffer, uint8_t* pRxBuffer, uint32_t len);
+
+// Transfer queue
+uint8_t SPI_QueueTransfer(SPI_Handle_t *pSPIHandle, SPI_Transfer_t *pXfer);
+uint8_t SPI_QueueIsIdle(SPI_Handle_t *pSPIHandle);
+
+// Multi-device bus
+void SPI_BusInit(SPI_Bus_t *pBus, SPI_Handle_t *pSPIHandle);
+void SPI_BusAddDevice(SPI_Bus_t *pBus, SPI_Device_t *pDevice);
+uint8_t SPI_BusAcquire(SPI_Bus_t *pBus, SPI_Device_t *pDevice);
+void SPI_BusRelease(SPI_Bus_t *pBus);
+void SPI_BusTransfer(SPI_Bus_t *pBus, SPI_Device_t *pDevice, uint8_t* pTxBuffer, uint8_t* pRxBuffer, uint32_t len);
+
 // IRQ Configuration and ISR Handling
 void SPI_IRQInterruptConfig(uint8_t IRQNumber, uint32_t IRQPriority, uint8_t EnorDi);
 void SPI_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority);
+uint8_t SPI_IRQBind(SPI_Handle_t *pSPIHandle);
 void SPI_IRQHandling(SPI_Handle_t *pSPIHandle);
 
 void SPI_ClearOVRFlag(SPI_RegDef_t *pSPIHandle);
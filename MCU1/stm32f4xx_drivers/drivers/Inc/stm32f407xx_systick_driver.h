@@ -0,0 +1,61 @@
+/*
+ * stm32f407xx_systick_driver.h
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#ifndef INC_STM32F407XX_SYSTICK_DRIVER_H_
+#define INC_STM32F407XX_SYSTICK_DRIVER_H_
+
+#include "stm32f407xx.h"
+
+// Tick rate of the timebase
+#define SYSTICK_TICK_HZ			1000
+
+typedef struct SYSTICK_Timer SYSTICK_Timer_t;
+
+/*
+ * Software timer for SYSTICK_TimerStart
+ * The timer is linked into the active list, it must stay valid while it runs
+ */
+struct SYSTICK_Timer{
+	void				(*Callback)(SYSTICK_Timer_t *pTimer);	// Runs in interrupt context from SYSTICK_IRQHandling
+	void				*pContext;		// Free for the application
+	uint32_t			Expiry;			// Used by the driver
+	uint32_t			Period;			// Used by the driver, 0 for a one-shot timer
+	SYSTICK_Timer_t		*pNext;			// Used by the driver
+};
+
+/*
+ * Init
+ */
+void SYSTICK_Init(uint32_t IRQPriority);
+
+/*
+ * Time and delays
+ */
+uint32_t SYSTICK_GetTick(void);
+uint32_t SYSTICK_GetMicros(void);
+void SYSTICK_DelayMs(uint32_t ms);
+void SYSTICK_DelayUs(uint32_t us);
+
+/*
+ * Deadlines, valid for up to 2^31 ms ahead
+ */
+uint32_t SYSTICK_Deadline(uint32_t ms);
+uint8_t SYSTICK_Expired(uint32_t deadline);
+
+/*
+ * Software timers
+ */
+void SYSTICK_TimerStart(SYSTICK_Timer_t *pTimer, uint32_t ms, uint32_t periodMs);
+void SYSTICK_TimerStop(SYSTICK_Timer_t *pTimer);
+uint8_t SYSTICK_TimerIsActive(SYSTICK_Timer_t *pTimer);
+
+/*
+ * ISR handling, call from SysTick_Handler
+ */
+void SYSTICK_IRQHandling(void);
+
+#endif /* INC_STM32F407XX_SYSTICK_DRIVER_H_ */
@@ -19,6 +19,18 @@ typedef struct{
 	uint8_t HWFlowControl;
 } USART_Config_t;
 
+/*
+ * Single-producer/single-consumer byte FIFO
+ * head is only written by the producer, tail only by the consumer, so neither side
+ * has to mask interrupts. Indices run freely and are masked on access.
+ */
+typedef struct{
+	uint8_t*		pBuf;
+	uint32_t		mask;		// size - 1, size must be a power of two
+	__vo uint32_t	head;		// next slot to write
+	__vo uint32_t	tail;		// next slot to read
+} USART_Fifo_t;
+
 typedef struct{
 	USART_RegDef_t* pUSARTx;
 	USART_Config_t USART_Config;
@@ -29,6 +41,15 @@ typedef struct{
 	uint8_t 		sr;
 	uint8_t*		pTxBuffer;
 	uint8_t*		pRxBuffer;
+	DMA_Handle_t*	pDMARx;			// Stream used by USART_ReceiveToIdleDMA, NULL if none
+	uint8_t*		pRxRing;		// Circular buffer being filled by DMA
+	uint16_t		RxRingSize;
+	uint16_t		RxRingTail;		// Ring position up to which data has been handed out
+	uint8_t*		pRxSpan;		// Span reported with USART_EVENT_RX_SPAN, points into pRxRing
+	uint16_t		RxSpanLen;
+	USART_Fifo_t	TxFifo;			// Drained by the TXE interrupt, filled by USART_Write
+	USART_Fifo_t	RxFifo;			// Filled by the RXNE interrupt, drained by USART_Read
+	RCC_ClockListener_t ClockListener;	// Re-tunes BRR on clock changes, see USART_ClockTrackingControl
 } USART_Handle_t;
 
 /*
@@ -93,6 +114,12 @@ typedef struct{
 #define USART_READY					0
 #define USART_BUSY_IN_TX			1
 #define USART_BUSY_IN_RX			2
+#define USART_BUSY_IN_RX_DMA		3
+
+// Returned by USART_ReceiveToIdleDMA when no stream is attached or the ring can not be used by DMA
+#define USART_ERR_DMA				4
+// Returned by USART_FifoInit when a FIFO size is not a power of two
+#define USART_ERR_FIFO				5
 
 // Status flag macros
 #define USART_PE_FLAG		(1 << USART_SR_PE)
@@ -115,6 +142,9 @@ typedef struct{
 #define USART_ERREVENT_FE		5
 #define USART_ERREVENT_NE		6
 #define USART_ERREVENT_ORE		7
+#define USART_EVENT_RX_SPAN		8
+#define USART_ERREVENT_DMA		9
+#define USART_ERREVENT_RX_FIFO	10
 /*
  * Peripheral Clock setup
  */
@@ -135,11 +165,28 @@ void USART_ReceiveData(USART_Handle_t *pUSARTHandle, uint8_t *pRxBuffer, uint32_
 uint8_t USART_SendDataIT(USART_Handle_t *pUSARTHandle,uint8_t *pTxBuffer, uint32_t len);
 uint8_t USART_ReceiveDataIT(USART_Handle_t *pUSARTHandle, uint8_t *pRxBuffer, uint32_t len);
 void USART_SetBaudRate(USART_RegDef_t *pUSARTx, uint32_t BaudRate);
+void USART_ClockTrackingControl(USART_Handle_t *pUSARTHandle, uint8_t EnOrDi);
+
+/*
+ * Circular DMA reception
+ */
+uint8_t USART_DMAInit(USART_Handle_t *pUSARTHandle, DMA_Handle_t *pDMARx);
+uint8_t USART_ReceiveToIdleDMA(USART_Handle_t *pUSARTHandle, uint8_t *pRing, uint16_t size);
+void USART_StopReceiveDMA(USART_Handle_t *pUSARTHandle);
+
+/*
+ * Buffered (FIFO) send and receive
+ */
+uint8_t USART_FifoInit(USART_Handle_t *pUSARTHandle, uint8_t *pTxBuf, uint32_t txSize, uint8_t *pRxBuf, uint32_t rxSize);
+uint32_t USART_Write(USART_Handle_t *pUSARTHandle, const uint8_t *pData, uint32_t len);
+uint32_t USART_Read(USART_Handle_t *pUSARTHandle, uint8_t *pData, uint32_t len);
+void USART_Flush(USART_Handle_t *pUSARTHandle);
 /*
  * IRQ Configuration and ISR handling
  */
 void USART_IRQInterruptConfig(uint8_t IRQNumber, uint8_t EnOrDi);
 void USART_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority);
+uint8_t USART_IRQBind(USART_Handle_t *pUSARTHandle);
 void USART_IRQHandling(USART_Handle_t *pHandle);
 
 /*
@@ -0,0 +1,661 @@
+/*
+ * stm32f407xx_dma_driver.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#include "stm32f407xx.h"
+#include "stm32f407xx_dma_driver.h"
+
+// Entry of the request mapping table (RM0090 tables 42 and 43)
+typedef struct{
+	uint8_t request;
+	uint8_t controller;		// 1 = DMA1, 2 = DMA2
+	uint8_t stream;
+	uint8_t channel;
+} DMA_RequestMap_t;
+
+static const DMA_RequestMap_t dmaRequestMap[] = {
+	{ DMA_REQ_SPI1_RX,		2, 0, 3 }, { DMA_REQ_SPI1_RX,		2, 2, 3 },
+	{ DMA_REQ_SPI1_TX,		2, 3, 3 }, { DMA_REQ_SPI1_TX,		2, 5, 3 },
+	{ DMA_REQ_SPI2_RX,		1, 3, 0 },
+	{ DMA_REQ_SPI2_TX,		1, 4, 0 },
+	{ DMA_REQ_SPI3_RX,		1, 0, 0 }, { DMA_REQ_SPI3_RX,		1, 2, 0 },
+	{ DMA_REQ_SPI3_TX,		1, 5, 0 }, { DMA_REQ_SPI3_TX,		1, 7, 0 },
+	{ DMA_REQ_I2C1_RX,		1, 0, 1 }, { DMA_REQ_I2C1_RX,		1, 5, 1 },
+	{ DMA_REQ_I2C1_TX,		1, 6, 1 }, { DMA_REQ_I2C1_TX,		1, 7, 1 },
+	{ DMA_REQ_I2C2_RX,		1, 2, 7 }, { DMA_REQ_I2C2_RX,		1, 3, 7 },
+	{ DMA_REQ_I2C2_TX,		1, 7, 7 },
+	{ DMA_REQ_I2C3_RX,		1, 2, 3 },
+	{ DMA_REQ_I2C3_TX,		1, 4, 3 },
+	{ DMA_REQ_USART1_RX,	2, 2, 4 }, { DMA_REQ_USART1_RX,	2, 5, 4 },
+	{ DMA_REQ_USART1_TX,	2, 7, 4 },
+	{ DMA_REQ_USART2_RX,	1, 5, 4 },
+	{ DMA_REQ_USART2_TX,	1, 6, 4 },
+	{ DMA_REQ_USART3_RX,	1, 1, 4 },
+	{ DMA_REQ_USART3_TX,	1, 3, 4 }, { DMA_REQ_USART3_TX,	1, 4, 7 },
+	{ DMA_REQ_UART4_RX,		1, 2, 4 },
+	{ DMA_REQ_UART4_TX,		1, 4, 4 },
+	{ DMA_REQ_UART5_RX,		1, 0, 4 },
+	{ DMA_REQ_UART5_TX,		1, 7, 4 },
+	{ DMA_REQ_USART6_RX,	2, 1, 5 }, { DMA_REQ_USART6_RX,	2, 2, 5 },
+	{ DMA_REQ_USART6_TX,	2, 6, 5 }, { DMA_REQ_USART6_TX,	2, 7, 5 },
+};
+
+static const uint8_t dmaIRQNumbers[2][8] = {
+	{ IRQ_NO_DMA1_STREAM0, IRQ_NO_DMA1_STREAM1, IRQ_NO_DMA1_STREAM2, IRQ_NO_DMA1_STREAM3,
+	  IRQ_NO_DMA1_STREAM4, IRQ_NO_DMA1_STREAM5, IRQ_NO_DMA1_STREAM6, IRQ_NO_DMA1_STREAM7 },
+	{ IRQ_NO_DMA2_STREAM0, IRQ_NO_DMA2_STREAM1, IRQ_NO_DMA2_STREAM2, IRQ_NO_DMA2_STREAM3,
+	  IRQ_NO_DMA2_STREAM4, IRQ_NO_DMA2_STREAM5, IRQ_NO_DMA2_STREAM6, IRQ_NO_DMA2_STREAM7 },
+};
+
+// Offset of each stream's 6-bit flag group inside LISR/HISR
+static const uint8_t dmaFlagShift[4] = {0, 6, 16, 22};
+
+// One bit per stream, set while the stream is allocated
+static uint8_t dmaStreamsInUse[2];
+
+// HELPER FUNCTION PROTOTYPES
+static void dma_notify(DMA_Handle_t *pDMAHandle, uint8_t AppEv);
+
+/*****************************************************************
+ * @fn			- DMA_PeriClockControl
+ *
+ * @brief		- This function enables or disables peripheral clock for the given DMA controller
+ *
+ * @param[in]	- Base address of the DMA controller
+ * @param[in]	- ENABLE or DISABLE macros
+ *
+ * @return		- none
+ *
+ * @Note		- none
+ */
+void DMA_PeriClockControl(DMA_RegDef_t *pDMAx, uint8_t EnorDi){
+	if(EnorDi == ENABLE){
+		if(pDMAx == DMA1)
+			DMA1_PCLK_EN();
+		else if (pDMAx == DMA2)
+			DMA2_PCLK_EN();
+	} else if (EnorDi == DISABLE){
+		if(pDMAx == DMA1)
+			DMA1_PCLK_DI();
+		else if (pDMAx == DMA2)
+			DMA2_PCLK_DI();
+	}
+}
+
+/*****************************************************************
+ * @fn			- DMA_Init
+ *
+ * @brief		- This function configures a single DMA stream
+ *
+ * @param[in]	- DMA Handle struct
+ *
+ * @return		- none
+ *
+ * @Note		- The stream is disabled first, configuration registers are
+ * 				  write-protected while EN is set
+ */
+void DMA_Init(DMA_Handle_t *pDMAHandle){
+	DMA_Config_t *pConfig = &pDMAHandle->DMAConfig;
+	DMA_Stream_RegDef_t *pStream = &pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream];
+	uint32_t tempreg = 0;
+
+	DMA_PeriClockControl(pDMAHandle->pDMAx, ENABLE);
+
+	// 1. Make sure the stream is off before touching its configuration
+	DMA_StreamControl(pDMAHandle, DISABLE);
+
+	// 2. Channel selection
+	tempreg |= ((pDMAHandle->Channel & 0x7) << DMA_SxCR_CHSEL);
+
+	// 3. Direction, priority, data sizes and increments
+	tempreg |= ((pConfig->Direction & 0x3) << DMA_SxCR_DIR);
+	tempreg |= ((pConfig->Priority & 0x3) << DMA_SxCR_PL);
+	tempreg |= ((pConfig->PeriphDataSize & 0x3) << DMA_SxCR_PSIZE);
+	tempreg |= ((pConfig->MemDataSize & 0x3) << DMA_SxCR_MSIZE);
+
+	if(pConfig->PeriphInc == ENABLE)
+		tempreg |= (1 << DMA_SxCR_PINC);
+	if(pConfig->MemInc == ENABLE)
+		tempreg |= (1 << DMA_SxCR_MINC);
+
+	// 4. Mode. Double buffer mode implies circular mode.
+	//    Memory-to-memory transfers can't be circular.
+	if(pConfig->Direction != DMA_DIR_MEM_TO_MEM){
+		if(pConfig->Mode == DMA_MODE_CIRCULAR){
+			tempreg |= (1 << DMA_SxCR_CIRC);
+		} else if(pConfig->Mode == DMA_MODE_DOUBLE_BUFFER){
+			tempreg |= (1 << DMA_SxCR_CIRC);
+			tempreg |= (1 << DMA_SxCR_DBM);
+		}
+	}
+
+	// 5. FIFO and bursts. Memory-to-memory requires the FIFO, and bursts are
+	//    only meaningful when the FIFO is in use.
+	if(pConfig->FIFOMode == DMA_FIFO_MODE_ENABLED || pConfig->Direction == DMA_DIR_MEM_TO_MEM){
+		tempreg |= ((pConfig->PeriphBurst & 0x3) << DMA_SxCR_PBURST);
+		tempreg |= ((pConfig->MemBurst & 0x3) << DMA_SxCR_MBURST);
+
+		pStream->FCR = (1 << DMA_SxFCR_DMDIS) | ((pConfig->FIFOThreshold & 0x3) << DMA_SxFCR_FTH);
+	} else {
+		pStream->FCR = 0;
+	}
+
+	pStream->CR = tempreg;
+
+	DMA_ClearFlag(pDMAHandle, DMA_ALL_FLAGS);
+	pDMAHandle->State = DMA_READY;
+}
+
+/*****************************************************************
+ * @fn			- DMA_DeInit
+ *
+ * @brief		- This function resets a DMA controller
+ *
+ * @param[in]	- Pointer to DMA controller base address
+ *
+ * @return		- none
+ *
+ * @Note		- none
+ */
+void DMA_DeInit(DMA_RegDef_t *pDMAx){
+	if(pDMAx == DMA1){
+		DMA1_REG_RESET();
+		dmaStreamsInUse[0] = 0;
+	} else if (pDMAx == DMA2){
+		DMA2_REG_RESET();
+		dmaStreamsInUse[1] = 0;
+	}
+}
+
+/*****************************************************************
+ * @fn			- DMA_AllocateStream
+ *
+ * @brief		- Picks a free stream/channel pair which can serve the given request
+ *
+ * @param[in]	- DMA Handle struct
+ * @param[in]	- Request macro from @Request
+ *
+ * @return		- DMA_OK or DMA_ERR_NO_STREAM
+ *
+ * @Note		- Memory-to-memory transfers are only possible on DMA2
+ */
+uint8_t DMA_AllocateStream(DMA_Handle_t *pDMAHandle, uint8_t request){
+	if(request == DMA_REQ_MEM_TO_MEM){
+		for(uint8_t stream = 0; stream < 8; stream++){
+			if(!(dmaStreamsInUse[1] & (1 << stream))){
+				dmaStreamsInUse[1] |= (1 << stream);
+				pDMAHandle->pDMAx = DMA2;
+				pDMAHandle->Stream = stream;
+				pDMAHandle->Channel = 0;
+				return DMA_OK;
+			}
+		}
+		return DMA_ERR_NO_STREAM;
+	}
+
+	for(uint32_t i = 0; i < sizeof(dmaRequestMap) / sizeof(dmaRequestMap[0]); i++){
+		const DMA_RequestMap_t *pEntry = &dmaRequestMap[i];
+		uint8_t ctrl = pEntry->controller - 1;
+
+		if(pEntry->request != request)
+			continue;
+
+		if(!(dmaStreamsInUse[ctrl] & (1 << pEntry->stream))){
+			dmaStreamsInUse[ctrl] |= (1 << pEntry->stream);
+			pDMAHandle->pDMAx = (ctrl == 0) ? DMA1 : DMA2;
+			pDMAHandle->Stream = pEntry->stream;
+			pDMAHandle->Channel = pEntry->channel;
+			return DMA_OK;
+		}
+	}
+
+	return DMA_ERR_NO_STREAM;
+}
+
+/*****************************************************************
+ * @fn			- DMA_ReleaseStream
+ *
+ * @brief		- Stops the stream and returns it to the pool of free streams
+ *
+ * @param[in]	- DMA Handle struct
+ *
+ * @return		- none
+ *
+ * @Note		- none
+ */
+void DMA_ReleaseStream(DMA_Handle_t *pDMAHandle){
+	DMA_Abort(pDMAHandle);
+
+	if(pDMAHandle->pDMAx == DMA1)
+		dmaStreamsInUse[0] &= ~(1 << pDMAHandle->Stream);
+	else if(pDMAHandle->pDMAx == DMA2)
+		dmaStreamsInUse[1] &= ~(1 << pDMAHandle->Stream);
+
+	// Detached, the start functions refuse the handle until it is allocated again
+	pDMAHandle->pDMAx = NULL;
+}
+
+/*****************************************************************
+ * @fn			- DMA_StreamControl
+ *
+ * @brief		- This function enables or disables a DMA stream
+ *
+ * @param[in]	- DMA Handle struct
+ * @param[in]	- ENABLE or DISABLE
+ *
+ * @return		- none
+ *
+ * @Note		- On disable, waits until the hardware has really stopped the stream
+ */
+void DMA_StreamControl(DMA_Handle_t *pDMAHandle, uint8_t EnorDi){
+	DMA_Stream_RegDef_t *pStream = &pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream];
+
+	if(EnorDi == ENABLE){
+		pStream->CR |= (1 << DMA_SxCR_EN);
+	} else {
+		pStream->CR &= ~(1 << DMA_SxCR_EN);
+		while(pStream->CR & (1 << DMA_SxCR_EN));
+	}
+}
+
+/*****************************************************************
+ * @fn			- DMA_StartTransfer
+ *
+ * @brief		- Programs the addresses and length of a transfer and starts the stream
+ *
+ * @param[in]	- DMA Handle struct
+ * @param[in]	- Source address
+ * @param[in]	- Destination address
+ * @param[in]	- Number of data items (in units of the peripheral data size), 1 to DMA_MAX_ITEMS
+ *
+ * @return		- DMA_OK if the stream was started, otherwise DMA_BUSY, DMA_ERR_NO_STREAM,
+ * 				  DMA_ERR_LENGTH or DMA_ERR_ADDRESS and nothing was started
+ *
+ * @Note		- Completion is reported through the transfer callback from DMA_IRQHandling
+ */
+uint8_t DMA_StartTransfer(DMA_Handle_t *pDMAHandle, uint32_t srcAddr, uint32_t dstAddr, uint32_t len){
+	DMA_Stream_RegDef_t *pStream;
+	uint8_t state;
+
+	if(pDMAHandle == NULL || pDMAHandle->pDMAx == NULL)
+		return DMA_ERR_NO_STREAM;
+	if(len == 0 || len > DMA_MAX_ITEMS)
+		return DMA_ERR_LENGTH;
+	if(DMA_IS_CCM_ADDR(srcAddr) || DMA_IS_CCM_ADDR(dstAddr))
+		return DMA_ERR_ADDRESS;
+
+	pStream = &pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream];
+	state = pDMAHandle->State;
+
+	if(state != DMA_BUSY){
+		pDMAHandle->State = DMA_BUSY;
+
+		// 1. Program the addresses. PAR always holds the peripheral side, for
+		//    memory-to-memory it holds the source.
+		if(pDMAHandle->DMAConfig.Direction == DMA_DIR_MEM_TO_PERIPH){
+			pStream->PAR = dstAddr;
+			pStream->M0AR = srcAddr;
+		} else {
+			pStream->PAR = srcAddr;
+			pStream->M0AR = dstAddr;
+		}
+
+		// 2. Number of data items
+		pStream->NDTR = len;
+
+		// 3. Clear stale flags of a previous transfer, a set TCIF would stop the new one
+		DMA_ClearFlag(pDMAHandle, DMA_ALL_FLAGS);
+
+		// 4. Enable interrupts. Half transfer is only reported for continuous modes.
+		pStream->CR |= (1 << DMA_SxCR_TCIE) | (1 << DMA_SxCR_TEIE) | (1 << DMA_SxCR_DMEIE);
+		if(pDMAHandle->DMAConfig.Mode != DMA_MODE_NORMAL)
+			pStream->CR |= (1 << DMA_SxCR_HTIE);
+		if(pStream->FCR & (1 << DMA_SxFCR_DMDIS))
+			pStream->FCR |= (1 << DMA_SxFCR_FEIE);
+
+		// 5. Go
+		DMA_StreamControl(pDMAHandle, ENABLE);
+	}
+
+	return state;
+}
+
+/*****************************************************************
+ * @fn			- DMA_StartDoubleBuffer
+ *
+ * @brief		- Starts a double buffer transfer between a peripheral and two memory buffers
+ *
+ * @param[in]	- DMA Handle struct
+ * @param[in]	- Peripheral data register address
+ * @param[in]	- Memory 0 address
+ * @param[in]	- Memory 1 address
+ * @param[in]	- Number of data items per buffer, 1 to DMA_MAX_ITEMS
+ *
+ * @return		- Same as DMA_StartTransfer
+ *
+ * @Note		- The stream must have been initialized with DMA_MODE_DOUBLE_BUFFER.
+ * 				  The hardware swaps buffers on every transfer complete, DMA_GetCurrentTarget
+ * 				  tells which buffer is being filled.
+ */
+uint8_t DMA_StartDoubleBuffer(DMA_Handle_t *pDMAHandle, uint32_t periphAddr, uint32_t mem0Addr, uint32_t mem1Addr, uint32_t len){
+	DMA_Stream_RegDef_t *pStream;
+
+	if(pDMAHandle == NULL || pDMAHandle->pDMAx == NULL)
+		return DMA_ERR_NO_STREAM;
+	if(pDMAHandle->State == DMA_BUSY)
+		return DMA_BUSY;
+	if(DMA_IS_CCM_ADDR(mem1Addr))
+		return DMA_ERR_ADDRESS;
+
+	pStream = &pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream];
+
+	// Start from memory 0
+	pStream->CR &= ~(1 << DMA_SxCR_CT);
+	pStream->M1AR = mem1Addr;
+
+	if(pDMAHandle->DMAConfig.Direction == DMA_DIR_MEM_TO_PERIPH)
+		return DMA_StartTransfer(pDMAHandle, mem0Addr, periphAddr, len);
+	else
+		return DMA_StartTransfer(pDMAHandle, periphAddr, mem0Addr, len);
+}
+
+/*****************************************************************
+ * @fn			- DMA_ChangeMemoryAddress
+ *
+ * @brief		- Updates one of the two memory pointers of a double buffer stream
+ *
+ * @param[in]	- DMA Handle struct
+ * @param[in]	- New memory address
+ * @param[in]	- DMA_MEMORY_0 or DMA_MEMORY_1
+ *
+ * @return		- none
+ *
+ * @Note		- Only the buffer which is not the current target may be changed while the stream runs
+ */
+void DMA_ChangeMemoryAddress(DMA_Handle_t *pDMAHandle, uint32_t memAddr, uint8_t memory){
+	DMA_Stream_RegDef_t *pStream = &pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream];
+
+	if(memory == DMA_MEMORY_0)
+		pStream->M0AR = memAddr;
+	else
+		pStream->M1AR = memAddr;
+}
+
+/*****************************************************************
+ * @fn			- DMA_GetCurrentTarget
+ *
+ * @brief		- Returns which memory buffer the stream is currently accessing
+ *
+ * @param[in]	- DMA Handle struct
+ *
+ * @return		- DMA_MEMORY_0 or DMA_MEMORY_1
+ *
+ * @Note		- none
+ */
+uint8_t DMA_GetCurrentTarget(DMA_Handle_t *pDMAHandle){
+	DMA_Stream_RegDef_t *pStream = &pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream];
+
+	return (pStream->CR & (1 << DMA_SxCR_CT)) ? DMA_MEMORY_1 : DMA_MEMORY_0;
+}
+
+/*****************************************************************
+ * @fn			- DMA_GetRemaining
+ *
+ * @brief		- Returns the number of data items left in the current transfer
+ *
+ * @param[in]	- DMA Handle struct
+ *
+ * @return		- NDTR value
+ *
+ * @Note		- none
+ */
+uint16_t DMA_GetRemaining(DMA_Handle_t *pDMAHandle){
+	return (uint16_t)pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream].NDTR;
+}
+
+/*****************************************************************
+ * @fn			- DMA_Abort
+ *
+ * @brief		- Stops a running transfer without notifying the application
+ *
+ * @param[in]	- DMA Handle struct
+ *
+ * @return		- none
+ *
+ * @Note		- none
+ */
+void DMA_Abort(DMA_Handle_t *pDMAHandle){
+	DMA_Stream_RegDef_t *pStream = &pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream];
+
+	pStream->CR &= ~((1 << DMA_SxCR_TCIE) | (1 << DMA_SxCR_HTIE) | (1 << DMA_SxCR_TEIE) | (1 << DMA_SxCR_DMEIE));
+	pStream->FCR &= ~(1 << DMA_SxFCR_FEIE);
+
+	DMA_StreamControl(pDMAHandle, DISABLE);
+	DMA_ClearFlag(pDMAHandle, DMA_ALL_FLAGS);
+
+	pDMAHandle->State = DMA_READY;
+}
+
+/*****************************************************************
+ * @fn			- DMA_GetFlagStatus
+ *
+ * @brief		- This function checks the value of a flag of the handle's stream
+ *
+ * @param[in]	- DMA Handle struct
+ * @param[in]	- Flag name macro
+ *
+ * @return		- FLAG_SET or FLAG_RESET
+ *
+ * @Note		- none
+ */
+uint8_t DMA_GetFlagStatus(DMA_Handle_t *pDMAHandle, uint32_t flagName){
+	uint32_t isr;
+
+	if(pDMAHandle->Stream < 4)
+		isr = pDMAHandle->pDMAx->LISR;
+	else
+		isr = pDMAHandle->pDMAx->HISR;
+
+	if(isr & (flagName << dmaFlagShift[pDMAHandle->Stream % 4]))
+		return FLAG_SET;
+	else
+		return FLAG_RESET;
+}
+
+/*****************************************************************
+ * @fn			- DMA_ClearFlag
+ *
+ * @brief		- Clears one or more flags of the handle's stream
+ *
+ * @param[in]	- DMA Handle struct
+ * @param[in]	- Flag name macro(s)
+ *
+ * @return		- none
+ *
+ * @Note		- The clear registers are write-1-to-clear, so a plain store is enough
+ */
+void DMA_ClearFlag(DMA_Handle_t *pDMAHandle, uint32_t flagName){
+	uint32_t mask = (flagName & DMA_ALL_FLAGS) << dmaFlagShift[pDMAHandle->Stream % 4];
+
+	if(pDMAHandle->Stream < 4)
+		pDMAHandle->pDMAx->LIFCR = mask;
+	else
+		pDMAHandle->pDMAx->HIFCR = mask;
+}
+
+// IRQ Handling
+
+/*****************************************************************
+ * @fn			- DMA_GetIRQNumber
+ *
+ * @brief		- Returns the NVIC IRQ number of the handle's stream
+ *
+ * @param[in]	- DMA Handle struct
+ *
+ * @return		- IRQ number, DMA_IRQ_NO_INVALID if no stream of DMA1/DMA2 is attached
+ *
+ * @Note		- DMA_IRQBind, DMA_IRQInterruptConfig and DMA_IRQPriorityConfig ignore
+ * 				  DMA_IRQ_NO_INVALID
+ */
+uint8_t DMA_GetIRQNumber(DMA_Handle_t *pDMAHandle){
+	if(pDMAHandle->pDMAx == DMA1)
+		return dmaIRQNumbers[0][pDMAHandle->Stream & 0x7];
+	else if(pDMAHandle->pDMAx == DMA2)
+		return dmaIRQNumbers[1][pDMAHandle->Stream & 0x7];
+
+	return DMA_IRQ_NO_INVALID;
+}
+
+/*****************************************************************
+ * @fn			- DMA_IRQBind
+ *
+ * @brief		- Routes the IRQ of the handle's stream straight to DMA_IRQHandling
+ * 				  for this handle
+ *
+ * @param[in]	- DMA Handle struct, with its stream allocated
+ *
+ * @return		- NVIC_OK or NVIC_ERR_IRQ
+ *
+ * @Note		- Replaces a DMAx_Streamy_IRQHandler function in the application, see
+ * 				  NVIC_IRQBind. Bind again after DMA_AllocateStream picked another stream.
+ */
+uint8_t DMA_IRQBind(DMA_Handle_t *pDMAHandle){
+	return NVIC_IRQBind(DMA_GetIRQNumber(pDMAHandle), (NVIC_IRQHandler_t)DMA_IRQHandling, pDMAHandle);
+}
+
+/*****************************************************************
+ * @fn			- DMA_IRQInterruptConfig
+ *
+ * @brief		- This function configures the interrupt settings for a DMA stream
+ *
+ * @param[in]	- IRQ Number
+ * @param[in]	- Priority to set
+ * @param[in]	- ENABLE or DISABLE
+ *
+ * @return		- none
+ *
+ * @Note		- Forwards to the NVIC driver
+ */
+void DMA_IRQInterruptConfig(uint8_t IRQNumber, uint32_t IRQPriority, uint8_t EnorDi){
+	if(IRQNumber == DMA_IRQ_NO_INVALID)
+		return;
+
+	NVIC_IRQInterruptConfig(IRQNumber, EnorDi);
+	NVIC_IRQPriorityConfig(IRQNumber, IRQPriority);
+}
+
+/*****************************************************************
+ * @fn			- DMA_IRQPriorityConfig
+ *
+ * @brief		- This function sets the priority for a DMA IRQ number
+ *
+ * @param[in]	- IRQ Number
+ * @param[in]	- IRQ Priority to set from 0-15
+ *
+ * @return		- none
+ *
+ * @Note		- Forwards to NVIC_IRQPriorityConfig
+ */
+void DMA_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority){
+	if(IRQNumber == DMA_IRQ_NO_INVALID)
+		return;
+
+	NVIC_IRQPriorityConfig(IRQNumber, IRQPriority);
+}
+
+/*****************************************************************
+ * @fn			- DMA_IRQHandling
+ *
+ * @brief		- Handles the interrupt of one DMA stream
+ *
+ * @param[in]	- DMA Handle struct
+ *
+ * @return		- none
+ *
+ * @Note		- Call this from the DMAx_Streamy_IRQHandler of the stream
+ */
+__isr_ramfunc void DMA_IRQHandling(DMA_Handle_t *pDMAHandle){
+	DMA_Stream_RegDef_t *pStream = &pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream];
+	uint32_t isr, cr;
+	PROF_IRQ_ENTER(PROF_DMA_IRQProbe);
+
+	// Read the status once and bring this stream's flags down to bit 0
+	if(pDMAHandle->Stream < 4)
+		isr = pDMAHandle->pDMAx->LISR;
+	else
+		isr = pDMAHandle->pDMAx->HISR;
+	isr = (isr >> dmaFlagShift[pDMAHandle->Stream % 4]) & DMA_ALL_FLAGS;
+
+	cr = pStream->CR;
+
+	// Transfer error. The hardware has already disabled the stream.
+	if((isr & DMA_TEIF_FLAG) && (cr & (1 << DMA_SxCR_TEIE))){
+		DMA_ClearFlag(pDMAHandle, DMA_TEIF_FLAG);
+		pDMAHandle->State = DMA_READY;
+		dma_notify(pDMAHandle, DMA_EVENT_TRANSFER_ERR);
+	}
+
+	// FIFO error (overrun/underrun)
+	if((isr & DMA_FEIF_FLAG) && (pStream->FCR & (1 << DMA_SxFCR_FEIE))){
+		DMA_ClearFlag(pDMAHandle, DMA_FEIF_FLAG);
+		dma_notify(pDMAHandle, DMA_EVENT_FIFO_ERR);
+	}
+
+	// Direct mode error
+	if((isr & DMA_DMEIF_FLAG) && (cr & (1 << DMA_SxCR_DMEIE))){
+		DMA_ClearFlag(pDMAHandle, DMA_DMEIF_FLAG);
+		dma_notify(pDMAHandle, DMA_EVENT_DIRECT_ERR);
+	}
+
+	// Half transfer
+	if((isr & DMA_HTIF_FLAG) && (cr & (1 << DMA_SxCR_HTIE))){
+		DMA_ClearFlag(pDMAHandle, DMA_HTIF_FLAG);
+		dma_notify(pDMAHandle, DMA_EVENT_HALF_CMPLT);
+	}
+
+	// Transfer complete
+	if((isr & DMA_TCIF_FLAG) && (cr & (1 << DMA_SxCR_TCIE))){
+		DMA_ClearFlag(pDMAHandle, DMA_TCIF_FLAG);
+
+		// In normal mode the stream stops by itself, in circular/double buffer mode it keeps running
+		if(!(cr & (1 << DMA_SxCR_CIRC))){
+			pStream->CR &= ~((1 << DMA_SxCR_TCIE) | (1 << DMA_SxCR_HTIE) | (1 << DMA_SxCR_TEIE) | (1 << DMA_SxCR_DMEIE));
+			pDMAHandle->State = DMA_READY;
+		}
+
+		dma_notify(pDMAHandle, DMA_EVENT_FULL_CMPLT);
+	}
+
+	PROF_IRQ_EXIT(PROF_DMA_IRQProbe);
+}
+
+/*****************************************************************
+ * @fn			- DMA_ApplicationEventCallback
+ *
+ * @brief		- Default DMA event callback, meant to be overridden by the application
+ *
+ * @param[in]	- DMA Handle struct
+ * @param[in]	- Event macro
+ *
+ * @return		- none
+ *
+ * @Note		- Only called for handles which have no XferEventCallback installed
+ */
+__weak void DMA_ApplicationEventCallback(DMA_Handle_t *pDMAHandle, uint8_t AppEv){
+
+}
+
+// HELPER FUNCTION IMPLEMENTATIONS
+
+/*
+ * Routes an event either to the owning driver (SPI, I2C, USART...) or to the application
+ */
+static __isr_ramfunc void dma_notify(DMA_Handle_t *pDMAHandle, uint8_t AppEv){
+	if(pDMAHandle->XferEventCallback)
+		pDMAHandle->XferEventCallback(pDMAHandle, AppEv);
+	else
+		DMA_ApplicationEventCallback(pDMAHandle, AppEv);
+}
@@ -0,0 +1,279 @@
+/*
+ * stm32f407xx_evt_driver.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#include "stm32f407xx.h"
+#include "stm32f407xx_evt_driver.h"
+
+#define EVT_QUEUE_MASK		(EVT_QUEUE_DEPTH - 1)
+
+/*
+ * Queue slot
+ * Seq tells who owns the slot: it equals the position a producer may reserve, position + 1
+ * once the event is published, and position + EVT_QUEUE_DEPTH after the dispatcher took it.
+ */
+typedef struct{
+	EVT_Event_t		Event;
+	__vo uint32_t	Seq;
+}EVT_Slot_t;
+
+/*
+ * Multi-producer, single-consumer ring
+ * evtHead is advanced with LDREX/STREX to reserve a slot, so EVT_Post works from any
+ * priority without masking interrupts. evtTail is only written by EVT_Dispatch.
+ * Kept in CCM RAM, the CPU is the only one accessing it.
+ */
+static __ccmram_bss EVT_Slot_t evtQueue[EVT_QUEUE_DEPTH];
+static __ccmram_bss __vo uint32_t evtHead;
+static __ccmram_bss __vo uint32_t evtTail;
+
+static EVT_Handler_t evtHandlers[EVT_MAX_TYPES];
+static uint8_t evtDispatchMode = EVT_DISPATCH_MAIN;
+static uint8_t evtReady = 0;
+
+static EVT_Stats_t evtStats;
+
+// HELPER FUNCTION PROTOTYPES
+static void evt_high_water(uint32_t pending);
+
+/*****************************************************************
+ * @fn			- EVT_Init
+ *
+ * @brief		- Empties the queue and selects where events get dispatched
+ *
+ * @param[in]	- Dispatch mode from @EVT_DISPATCH
+ * @param[in]	- PendSV priority from 0-15, only used with EVT_DISPATCH_PENDSV
+ *
+ * @return		- none
+ *
+ * @Note		- Give PendSV the lowest priority (15) so handlers never hold off a
+ * 				  driver interrupt. Starts the DWT cycle counter for the latency figures.
+ * 				  Posts made before EVT_Init are dropped.
+ */
+void EVT_Init(uint8_t DispatchMode, uint8_t PendSVPriority){
+	evtReady = 0;
+
+	for(uint32_t i = 0; i < EVT_QUEUE_DEPTH; i++)
+		evtQueue[i].Seq = i;
+	evtHead = 0;
+	evtTail = 0;
+
+	evtDispatchMode = DispatchMode;
+	if(DispatchMode == EVT_DISPATCH_PENDSV)
+		*SCB_SHPR_PENDSV = (uint8_t)(PendSVPriority << (8 - NO_PRIORITY_BITS_IMPLEMENTED));
+
+	*CORE_DEMCR |= (1 << CORE_DEMCR_TRCENA);
+	*CORE_DWT_CTRL |= (1 << CORE_DWT_CTRL_CYCCNTENA);
+
+	EVT_ResetStats();
+
+	MEM_Barrier();
+	evtReady = 1;
+}
+
+/*****************************************************************
+ * @fn			- EVT_RegisterHandler
+ *
+ * @brief		- Sets the function which handles one event type
+ *
+ * @param[in]	- Event type from @EVT_TYPES
+ * @param[in]	- Handler, NULL to remove it
+ *
+ * @return		- EVT_OK or EVT_ERR_TYPE
+ *
+ * @Note		- The handler runs from EVT_Dispatch, it may block, print or wait for
+ * 				  other interrupts
+ */
+uint8_t EVT_RegisterHandler(uint8_t Type, EVT_Handler_t Handler){
+	if(Type >= EVT_MAX_TYPES)
+		return EVT_ERR_TYPE;
+
+	evtHandlers[Type] = Handler;
+	return EVT_OK;
+}
+
+/*****************************************************************
+ * @fn			- EVT_Post
+ *
+ * @brief		- Queues an event for its handler
+ *
+ * @param[in]	- Event type from @EVT_TYPES
+ * @param[in]	- Event code
+ * @param[in]	- Context pointer
+ * @param[in]	- Event data
+ *
+ * @return		- EVT_OK, or EVT_ERR_FULL if the event was dropped
+ *
+ * @Note		- Safe from any interrupt and from thread mode, never blocks.
+ * 				  With EVT_DISPATCH_PENDSV it pends PendSV.
+ */
+uint8_t EVT_Post(uint8_t Type, uint8_t Code, void *pContext, uint32_t Data){
+	uint32_t pos, seq;
+	EVT_Slot_t *pSlot;
+
+	if(!evtReady){
+		__atomic_fetch_add(&evtStats.Dropped, 1, __ATOMIC_RELAXED);
+		return EVT_ERR_FULL;
+	}
+
+	// 1. Reserve a slot, retried if another context reserved in between
+	while(1){
+		pos = evtHead;
+		pSlot = &evtQueue[pos & EVT_QUEUE_MASK];
+		seq = pSlot->Seq;
+
+		if(seq == pos){
+			if(__atomic_compare_exchange_n(&evtHead, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if((int32_t)(seq - pos) < 0){
+			// The dispatcher has not taken the event one lap behind yet
+			__atomic_fetch_add(&evtStats.Dropped, 1, __ATOMIC_RELAXED);
+			return EVT_ERR_FULL;
+		}
+	}
+
+	// 2. Fill the slot, then publish it
+	pSlot->Event.Type = Type;
+	pSlot->Event.Code = Code;
+	pSlot->Event.pContext = pContext;
+	pSlot->Event.Data = Data;
+	pSlot->Event.Stamp = *CORE_DWT_CYCCNT;
+
+	MEM_Barrier();
+	pSlot->Seq = pos + 1;
+
+	__atomic_fetch_add(&evtStats.Posted, 1, __ATOMIC_RELAXED);
+	evt_high_water(pos + 1 - evtTail);
+
+	if(evtDispatchMode == EVT_DISPATCH_PENDSV)
+		*SCB_ICSR = (1UL << SCB_ICSR_PENDSVSET);
+
+	return EVT_OK;
+}
+
+/*****************************************************************
+ * @fn			- EVT_Dispatch
+ *
+ * @brief		- Runs the handlers of all queued events
+ *
+ * @return		- Number of events dispatched
+ *
+ * @Note		- Single consumer: call it from PendSV_Handler or from the main loop,
+ * 				  never from both. Stops at an event which is still being posted, its
+ * 				  producer pends PendSV again when it is done. The slot is released
+ * 				  before the handler runs, so handlers may post events themselves.
+ */
+uint32_t EVT_Dispatch(void){
+	uint32_t pos, latency, count = 0;
+	EVT_Slot_t *pSlot;
+	EVT_Event_t event;
+	EVT_Handler_t handler;
+
+	while(1){
+		pos = evtTail;
+		pSlot = &evtQueue[pos & EVT_QUEUE_MASK];
+		if(pSlot->Seq != pos + 1)
+			break;
+		MEM_Barrier();
+
+		event = pSlot->Event;
+
+		MEM_Barrier();
+		pSlot->Seq = pos + EVT_QUEUE_DEPTH;
+		evtTail = pos + 1;
+
+		latency = *CORE_DWT_CYCCNT - event.Stamp;
+		evtStats.LatencyTotal += latency;
+		if(latency > evtStats.LatencyMax)
+			evtStats.LatencyMax = latency;
+		evtStats.Dispatched++;
+
+		handler = (event.Type < EVT_MAX_TYPES) ? evtHandlers[event.Type] : NULL;
+		if(handler != NULL)
+			handler(&event);
+		else
+			evtStats.Unhandled++;
+
+		count++;
+	}
+
+	return count;
+}
+
+/*****************************************************************
+ * @fn			- EVT_GetPending
+ *
+ * @brief		- Returns the number of events waiting for EVT_Dispatch
+ *
+ * @return		- Queue depth right now
+ *
+ * @Note		- Includes events whose post is still in progress
+ */
+uint32_t EVT_GetPending(void){
+	return evtHead - evtTail;
+}
+
+/*****************************************************************
+ * @fn			- EVT_IsReady
+ *
+ * @brief		- Tells whether EVT_Post can accept events
+ *
+ * @return		- 1 once EVT_Init has run, 0 before
+ *
+ * @Note		- A ready queue can still be full, EVT_Post reports that
+ */
+uint8_t EVT_IsReady(void){
+	return evtReady;
+}
+
+/*****************************************************************
+ * @fn			- EVT_GetStats
+ *
+ * @brief		- Copies the queue statistics
+ *
+ * @param[in]	- Destination
+ *
+ * @return		- none
+ *
+ * @Note		- The mean latency is LatencyTotal / Dispatched
+ */
+void EVT_GetStats(EVT_Stats_t *pStats){
+	uint32_t primask = IRQ_SaveAndDisable();
+	*pStats = evtStats;
+	IRQ_Restore(primask);
+}
+
+/*****************************************************************
+ * @fn			- EVT_ResetStats
+ *
+ * @brief		- Clears the queue statistics
+ *
+ * @return		- none
+ *
+ * @Note		- The high-water mark restarts from the events waiting right now
+ */
+void EVT_ResetStats(void){
+	uint32_t primask = IRQ_SaveAndDisable();
+
+	evtStats.Posted = 0;
+	evtStats.Dispatched = 0;
+	evtStats.Dropped = 0;
+	evtStats.Unhandled = 0;
+	evtStats.HighWater = evtHead - evtTail;
+	evtStats.LatencyMax = 0;
+	evtStats.LatencyTotal = 0;
+
+	IRQ_Restore(primask);
+}
+
+// Raises the high-water mark, posts of any priority may race here
+static void evt_high_water(uint32_t pending){
+	uint32_t mark = evtStats.HighWater;
+
+	while(pending > mark)
+		if(__atomic_compare_exchange_n(&evtStats.HighWater, &mark, pending, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+}
@@ -0,0 +1,167 @@
+/*
+ * stm32f407xx_flash_driver.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#include "stm32f407xx.h"
+#include "stm32f407xx_flash_driver.h"
+
+// HCLK covered by one wait state for each @VoltageRange (RM0090 table 10)
+static const uint32_t flashMHzPerWS[] = { 20000000UL, 22000000UL, 24000000UL, 30000000UL };
+
+// Board supply and the accelerator settings re-applied on every clock change
+static uint8_t flashVoltageRange = FLASH_VRANGE_2V7_3V6;
+static uint32_t flashAccelBits = (1 << FLASH_ACR_PRFTEN) | (1 << FLASH_ACR_ICEN) | (1 << FLASH_ACR_DCEN);
+
+// HELPER FUNCTION PROTOTYPES
+static void flash_apply_accelerator(uint8_t flush);
+
+/*****************************************************************
+ * @fn			- FLASH_SetVoltageRange
+ *
+ * @brief		- Tells the flash module which supply range the board runs at
+ *
+ * @param[in]	- Voltage range, possible values from @VoltageRange
+ *
+ * @return		- FLASH_OK, or FLASH_ERR_CONFIG for a value outside @VoltageRange
+ *
+ * @Note		- Defaults to 2.7-3.6 V. Takes effect at the next FLASH_ConfigForHCLK.
+ */
+uint8_t FLASH_SetVoltageRange(uint8_t VoltageRange){
+	if(VoltageRange >= (sizeof(flashMHzPerWS) / sizeof(flashMHzPerWS[0])))
+		return FLASH_ERR_CONFIG;
+
+	flashVoltageRange = VoltageRange;
+
+	return FLASH_OK;
+}
+
+/*****************************************************************
+ * @fn			- FLASH_GetVoltageRange
+ *
+ * @brief		- Returns the supply range set with FLASH_SetVoltageRange
+ *
+ * @return		- Voltage range, possible values from @VoltageRange
+ *
+ * @Note		- none
+ */
+uint8_t FLASH_GetVoltageRange(void){
+	return flashVoltageRange;
+}
+
+/*****************************************************************
+ * @fn			- FLASH_AcceleratorControl
+ *
+ * @brief		- Enables or disables the prefetch buffer and the instruction and data caches
+ *
+ * @param[in]	- Prefetch ENABLE or DISABLE
+ * @param[in]	- Instruction cache ENABLE or DISABLE
+ * @param[in]	- Data cache ENABLE or DISABLE
+ *
+ * @return		- none
+ *
+ * @Note		- The caches are flushed on the way. The setting is remembered and restored by
+ * 				  FLASH_ConfigForHCLK. Prefetch stays off in the 1.8-2.1 V range.
+ */
+void FLASH_AcceleratorControl(uint8_t Prefetch, uint8_t ICache, uint8_t DCache){
+	flashAccelBits = 0;
+	if(Prefetch == ENABLE)
+		flashAccelBits |= (1 << FLASH_ACR_PRFTEN);
+	if(ICache == ENABLE)
+		flashAccelBits |= (1 << FLASH_ACR_ICEN);
+	if(DCache == ENABLE)
+		flashAccelBits |= (1 << FLASH_ACR_DCEN);
+
+	flash_apply_accelerator(1);
+}
+
+/*****************************************************************
+ * @fn			- FLASH_GetLatency
+ *
+ * @brief		- Computes the wait states needed at a given HCLK
+ *
+ * @param[in]	- HCLK in Hz
+ *
+ * @return		- Number of wait states for the current voltage range, FLASH_LATENCY_INVALID
+ * 				  if the flash can not run at that HCLK in this range
+ *
+ * @Note		- none
+ */
+uint8_t FLASH_GetLatency(uint32_t hclk){
+	uint32_t latency;
+
+	if(hclk == 0)
+		return 0;
+
+	latency = (hclk - 1) / flashMHzPerWS[flashVoltageRange];
+	if(latency > FLASH_LATENCY_MAX)
+		return FLASH_LATENCY_INVALID;
+
+	return (uint8_t)latency;
+}
+
+/*****************************************************************
+ * @fn			- FLASH_SetLatency
+ *
+ * @brief		- Programs the number of flash wait states
+ *
+ * @param[in]	- Number of wait states 0-7
+ *
+ * @return		- none
+ *
+ * @Note		- Waits until the new value reads back, only then is it in effect.
+ * 				  Raise it before HCLK goes up and lower it after HCLK went down.
+ */
+void FLASH_SetLatency(uint8_t latency){
+	uint32_t tempreg = FLASH->ACR;
+
+	tempreg &= ~(0b111 << FLASH_ACR_LATENCY);
+	tempreg |= (latency << FLASH_ACR_LATENCY);
+	FLASH->ACR = tempreg;
+
+	while(((FLASH->ACR >> FLASH_ACR_LATENCY) & 0b111) != latency);
+}
+
+/*****************************************************************
+ * @fn			- FLASH_ConfigForHCLK
+ *
+ * @brief		- Sets the wait states for a new HCLK and turns the accelerator back on
+ *
+ * @param[in]	- HCLK in Hz, already in effect
+ *
+ * @return		- none
+ *
+ * @Note		- Called by RCC_ConfigSystemClock after every switch, which has already
+ * 				  refused an HCLK without a valid latency. Anything else gets the maximum.
+ */
+void FLASH_ConfigForHCLK(uint32_t hclk){
+	uint8_t latency = FLASH_GetLatency(hclk);
+
+	if(latency == FLASH_LATENCY_INVALID)
+		latency = FLASH_LATENCY_MAX;
+
+	FLASH_SetLatency(latency);
+	flash_apply_accelerator(0);
+}
+
+static void flash_apply_accelerator(uint8_t flush){
+	uint32_t enable = flashAccelBits;
+	uint32_t tempreg;
+
+	if(flashVoltageRange == FLASH_VRANGE_1V8_2V1)
+		enable &= ~(1 << FLASH_ACR_PRFTEN);
+
+	tempreg = FLASH->ACR & ~((1 << FLASH_ACR_PRFTEN) | (1 << FLASH_ACR_ICEN) | (1 << FLASH_ACR_DCEN) |
+							(1 << FLASH_ACR_ICRST) | (1 << FLASH_ACR_DCRST));
+
+	if(flush){
+		// A cache may only be reset while it is disabled
+		FLASH->ACR = tempreg;
+		FLASH->ACR = tempreg | (1 << FLASH_ACR_ICRST) | (1 << FLASH_ACR_DCRST);
+		FLASH->ACR = tempreg;
+	}
+
+	FLASH->ACR = tempreg | enable;
+}
@@ -0,0 +1,70 @@
+/*
+ * stm32f407xx_fpu_driver.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#include "stm32f407xx.h"
+#include "stm32f407xx_fpu_driver.h"
+
+#define FPU_CPACR_FULL_ACCESS	((0b11UL << SCB_CPACR_CP10) | (0b11UL << SCB_CPACR_CP11))
+
+/*****************************************************************
+ * @fn			- FPU_IsEnabled
+ *
+ * @brief		- Checks whether FPU instructions can be executed
+ *
+ * @return		- 1 if CP10 and CP11 have full access, 0 otherwise
+ *
+ * @Note		- Without it the first FPU instruction raises a UsageFault (NOCP)
+ */
+uint8_t FPU_IsEnabled(void){
+	return (*SCB_CPACR & FPU_CPACR_FULL_ACCESS) == FPU_CPACR_FULL_ACCESS;
+}
+
+/*****************************************************************
+ * @fn			- FPU_SetStacking
+ *
+ * @brief		- Selects how exception entry saves the FPU registers
+ *
+ * @param[in]	- Mode, possible values from @FPUStacking
+ *
+ * @return		- none
+ *
+ * @Note		- Call it from thread mode with no handler active, it only changes the
+ * 				  frames of later exceptions. FPU_STACKING_NONE corrupts the FPU registers
+ * 				  of the interrupted code as soon as one handler uses the FPU, including
+ * 				  library calls compiled for the FPU.
+ */
+void FPU_SetStacking(uint8_t Mode){
+	uint32_t tempreg = *FPU_FPCCR;
+
+	tempreg &= ~((1UL << FPU_FPCCR_ASPEN) | (1UL << FPU_FPCCR_LSPEN));
+	if(Mode == FPU_STACKING_LAZY)
+		tempreg |= (1UL << FPU_FPCCR_ASPEN) | (1UL << FPU_FPCCR_LSPEN);
+	else if(Mode == FPU_STACKING_ALWAYS)
+		tempreg |= (1UL << FPU_FPCCR_ASPEN);
+	*FPU_FPCCR = tempreg;
+
+	__asm volatile ("dsb\n\tisb" ::: "memory");
+}
+
+/*****************************************************************
+ * @fn			- FPU_GetStacking
+ *
+ * @brief		- Returns how exception entry saves the FPU registers
+ *
+ * @return		- Mode from @FPUStacking
+ *
+ * @Note		- LSPEN without ASPEN has no effect and reads as FPU_STACKING_NONE
+ */
+uint8_t FPU_GetStacking(void){
+	uint32_t fpccr = *FPU_FPCCR;
+
+	if(!(fpccr & (1UL << FPU_FPCCR_ASPEN)))
+		return FPU_STACKING_NONE;
+	if(fpccr & (1UL << FPU_FPCCR_LSPEN))
+		return FPU_STACKING_LAZY;
+	return FPU_STACKING_ALWAYS;
+}
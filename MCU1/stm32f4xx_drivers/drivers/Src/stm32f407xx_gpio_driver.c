@@ -301,34 +301,11 @@ void GPIO_ToggleOutputPin(GPIO_RegDef_t *pGPIOx, uint8_t pinNumber){
  *
  * @return		- none
  *
- * @Note		- none
+ * @Note		- Forwards to the NVIC driver
  */
 void GPIO_IRQInterruptConfig(uint8_t IRQNumber, uint32_t IRQPriority, uint8_t EnorDi){
-	if (EnorDi == ENABLE){
-		if (IRQNumber >= 0 && IRQNumber <= 31){
-			// Program ISER0 Register
-			*NVIC_ISER0 |= (1 << IRQNumber);
-		} else if (IRQNumber >= 32 && IRQNumber <= 63) {
-			// Program ISER1 Register
-			*NVIC_ISER1 |= (1 << (IRQNumber % 32));
-		} else if (IRQNumber >= 64 && IRQNumber <= 95) {
-			// Program ISER2 Register
-			*NVIC_ISER2 |= (1 << (IRQNumber % 32));
-		}
-	} else {
-		if (IRQNumber >= 0 && IRQNumber <= 31){
-			// Program ICER0 Register
-			*NVIC_ICER0 |= (1 << IRQNumber);
-		} else if (IRQNumber >= 32 && IRQNumber <= 63) {
-			// Program ICER1 Register
-			*NVIC_ICER1 |= (1 << (IRQNumber % 32));
-		} else if (IRQNumber >= 64 && IRQNumber <= 95) {
-			// Program ICER2 Register
-			*NVIC_ICER2 |= (1 << (IRQNumber % 32));
-		}
-	}
-
-	GPIO_IRQPriorityConfig(IRQNumber, IRQPriority);
+	NVIC_IRQInterruptConfig(IRQNumber, EnorDi);
+	NVIC_IRQPriorityConfig(IRQNumber, IRQPriority);
 }
 
 /*****************************************************************
@@ -341,17 +318,10 @@ void GPIO_IRQInterruptConfig(uint8_t IRQNumber, uint32_t IRQPriority, uint8_t En
  *
  * @return		- none
  *
- * @Note		- none
+ * @Note		- Forwards to NVIC_IRQPriorityConfig
  */
 void GPIO_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority){
-	uint8_t iprx = IRQNumber / 4;
-	uint8_t iprx_section = IRQNumber % 4;
-
-	uint8_t shift_amount = ( 8 * iprx_section ) + (8 - NO_PRIORITY_BITS_IMPLEMENTED);
-
-	__vo uint32_t* iprReg = (__vo uint32_t*)(NVIC_IPR_BASE_ADDR + (4 * iprx));
-
-	*iprReg |= (IRQPriority << (shift_amount));
+	NVIC_IRQPriorityConfig(IRQNumber, IRQPriority);
 }
 
 /*****************************************************************
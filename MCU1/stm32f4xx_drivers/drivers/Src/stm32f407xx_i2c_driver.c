@@ -8,10 +8,35 @@
 #include "stm32f407xx.h"
 #include "stm32f407xx_i2c_driver.h"
 
+// Bound on the CR1.STOP polls of the job queue, made from EVT_Dispatch and never from the
+// I2C interrupt. A STOP takes about one SCL period (10 us at 100 kHz), this is over 100 us
+// of CR1 reads at 168 MHz.
+#define I2C_STOP_WAIT_LOOPS		20000U
+
+// EVT_Event_t Code of the EVT_TYPE_I2C_QUEUE events
+#define I2C_QUEUE_EVT_START		0	// Start the head job once the previous STOP is out
+#define I2C_QUEUE_EVT_RESTART	1	// START of the read segment of a job which asked for a STOP in between
+
 // STATIC FUNCTIONS
 
 static void I2C_MasterHandleRXNEInterrupt(I2C_Handle_t* pI2CHandle);
 static void I2C_MasterHandleTXEInterrupt(I2C_Handle_t* pI2CHandle);
+static uint8_t I2C_DMACanStart(DMA_Handle_t *pDMAHandle, uint8_t *pBuffer, uint32_t len);
+static void I2C_DMAConfigStream(I2C_Handle_t *pI2CHandle, DMA_Handle_t *pDMAHandle, uint8_t direction);
+static void I2C_DMATxEventHandle(DMA_Handle_t *pDMAHandle, uint8_t AppEv);
+static void I2C_DMARxEventHandle(DMA_Handle_t *pDMAHandle, uint8_t AppEv);
+static uint8_t I2C_MemStart(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t memMode);
+static void I2C_MemReadDataPhase(I2C_Handle_t *pI2CHandle);
+static void I2C_MemReadRestart(I2C_Handle_t *pI2CHandle);
+static void I2C_NotifyComplete(I2C_Handle_t *pI2CHandle, uint8_t AppEv);
+static void I2C_NotifyError(I2C_Handle_t *pI2CHandle, uint8_t AppEv);
+static void I2C_JobStart(I2C_Handle_t *pI2CHandle);
+static void I2C_JobDeferredHandle(EVT_Event_t *pEvent);
+static void I2C_JobFail(I2C_Handle_t *pI2CHandle, I2C_Job_t *pJob, uint8_t AppEv);
+static uint8_t I2C_WaitStop(I2C_RegDef_t *pI2Cx);
+static void I2C_ConfigClock(I2C_Handle_t *pI2CHandle, uint32_t pclk1);
+static void I2C_ClockChangeHandle(RCC_ClockListener_t *pListener, const RCC_ClockTree_t *pClocks);
+static uint8_t I2C_ClockBusy(RCC_ClockListener_t *pListener);
 
 /*****************************************************************
  * @fn			- I2C_ExecuteAddressPhase
@@ -34,44 +59,35 @@ static void I2C_ExecuteAddressPhase(I2C_RegDef_t *pI2Cx, uint8_t slaveAddr, uint
 }
 
 /*****************************************************************
- * @fn			- I2C_ExecuteAddressPhase
+ * @fn			- I2C_ClearADDRFlag
  *
  * @brief		- This static function clears the ADDR flag in the I2C peripheral
  *
- * @param[in]	- Pointer to I2C base address
+ * @param[in]	- Pointer to I2C Handle
  *
  * @return		- none
  *
- * @Note		- none
+ * @Note		- Must be called right after SR1 showed ADDR, nothing may read SR2 before
  */
 static void I2C_ClearADDRFlag(I2C_Handle_t *pI2CHandle){
+	I2C_RegDef_t *pI2Cx = pI2CHandle->pI2Cx;
 	uint32_t dummy_read;
-	// Check for device mode
-	if(pI2CHandle->pI2Cx->SR2 & (1 << I2C_SR2_MSL)){
-		// device is in master mode
-		if(pI2CHandle->TxRxState == I2C_BUSY_IN_RX){
-			if(pI2CHandle->RxSize == 1){
-				// First disable the ACK
-				I2C_ManageAcking(pI2CHandle->pI2Cx, I2C_ACK_DISABLE);
 
-				// Clear the ADDR flag (Read SR1, read SR2)
-				dummy_read = pI2CHandle->pI2Cx->SR1;
-				dummy_read = pI2CHandle->pI2Cx->SR2;
-				(void)dummy_read;
-			} else {
-				// Clear the ADDR flag (Read SR1, read SR2)
-				dummy_read = pI2CHandle->pI2Cx->SR1;
-				dummy_read = pI2CHandle->pI2Cx->SR2;
-				(void)dummy_read;
-			}
-		}
-	} else {
-		// device is in slave mode
-		// Clear the ADDR flag (Read SR1, read SR2)
-		dummy_read = pI2CHandle->pI2Cx->SR1;
-		dummy_read = pI2CHandle->pI2Cx->SR2;
-		(void)dummy_read;
-	}
+	// Reading SR2 is what clears ADDR, so master mode is taken from the handle: only the
+	// master transfers set I2C_BUSY_IN_RX. A single byte read has to be NACKed, ACK must
+	// be off before ADDR is cleared (RM0090 27.3.3).
+	if(pI2CHandle->TxRxState == I2C_BUSY_IN_RX && pI2CHandle->RxSize == 1)
+		I2C_ManageAcking(pI2Cx, I2C_ACK_DISABLE);
+
+	// Clear the ADDR flag (Read SR1, read SR2)
+	dummy_read = pI2Cx->SR1;
+	dummy_read = pI2Cx->SR2;
+	(void)dummy_read;
+
+	// With DMA no RXNE interrupt follows, so STOP goes in while the byte is still on the bus
+	if(pI2CHandle->TxRxState == I2C_BUSY_IN_RX && pI2CHandle->RxSize == 1 &&
+			(pI2Cx->CR2 & (1 << I2C_CR2_DMAEN)) && pI2CHandle->sr == I2C_DISABLE_RS)
+		I2C_GenerateStopCondition(pI2Cx);
 }
 
 // Main API's
@@ -125,10 +141,8 @@ void I2C_Init(I2C_Handle_t *pI2CHandle){
 	tempreg |= (pI2CHandle->I2C_Config.AckControl << 10);
 	pI2CHandle->pI2Cx->CR1 = tempreg;
 
-	// Configure the FREQ field of CR2
-	tempreg = 0;
-	tempreg = RCC_GetPCLK1Value() / 1000000U;
-	pI2CHandle->pI2Cx->CR2 = (tempreg & 0x3F);
+	// CR2 starts clean, I2C_ConfigClock fills in FREQ
+	pI2CHandle->pI2Cx->CR2 = 0;
 
 	// Address configuration
 	tempreg = 0;
@@ -141,36 +155,43 @@ void I2C_Init(I2C_Handle_t *pI2CHandle){
 	// Bit 14 of OAR1 has to be kept at 1 by software, for some reason
 	pI2CHandle->pI2Cx->OAR1 |= (1 << 14);
 
-	// CCR calculations
-	uint16_t ccr_value = 0;
-	if(pI2CHandle->I2C_Config.SCLSpeed <= I2C_SCL_SPEED_SM){
-		// Mode is standard mode
-		pI2CHandle->pI2Cx->CCR &= ~(1 << I2C_CCR_FS);
-		ccr_value = RCC_GetPCLK1Value() / (2 * pI2CHandle->I2C_Config.SCLSpeed);
-		tempreg |= ccr_value & (0xFFF);
-	} else {
-		// Mode is fast mode
-		pI2CHandle->pI2Cx->CCR |= (1 << I2C_CCR_FS);
-
-		if(pI2CHandle->I2C_Config.FMDutyCycle == I2C_FM_DUTY_2){
-			ccr_value = RCC_GetPCLK1Value() / (3 * pI2CHandle->I2C_Config.SCLSpeed);
-		} else {
-			ccr_value = RCC_GetPCLK1Value() / (25 * pI2CHandle->I2C_Config.SCLSpeed);
-		}
-
-		tempreg |= ccr_value & (0xFFF);
-	}
+	// FREQ, CCR and TRISE all follow from PCLK1
+	I2C_ConfigClock(pI2CHandle, RCC_GetPCLK1Value());
 
-	pI2CHandle->pI2Cx->CCR |= (tempreg);
+	// Software state, DMA streams are attached later by I2C_DMAInit
+	pI2CHandle->TxRxState = I2C_READY;
+	pI2CHandle->pDMATx = NULL;
+	pI2CHandle->pDMARx = NULL;
+	pI2CHandle->MemMode = I2C_MEM_NONE;
+	pI2CHandle->MemDataLen = 0;
+	pI2CHandle->pJobHead = NULL;
+	pI2CHandle->pJobTail = NULL;
+}
 
-	//TRISE Configuration
-	if(pI2CHandle->I2C_Config.SCLSpeed <= I2C_SCL_SPEED_SM){
-		tempreg = (RCC_GetPCLK1Value() / 1000000U) + 1;
+/*****************************************************************
+ * @fn			- I2C_ClockTrackingControl
+ *
+ * @brief		- Keeps the SCL frequency right across RCC clock changes
+ *
+ * @param[in]	- Pointer to I2C Handle
+ * @param[in]	- ENABLE or DISABLE macro
+ *
+ * @return		- none
+ *
+ * @Note		- Registers the handle with RCC, FREQ, CCR and TRISE are recomputed
+ * 				  whenever PCLK1 changes. The handle must stay valid (not on the stack)
+ * 				  until tracking is disabled again. RCC_SetPerformanceLevel waits for
+ * 				  interrupt-driven transfers and queued jobs to finish before switching.
+ */
+void I2C_ClockTrackingControl(I2C_Handle_t *pI2CHandle, uint8_t EnorDi){
+	if(EnorDi == ENABLE){
+		pI2CHandle->ClockListener.pParent = pI2CHandle;
+		pI2CHandle->ClockListener.Callback = I2C_ClockChangeHandle;
+		pI2CHandle->ClockListener.IsBusy = I2C_ClockBusy;
+		RCC_RegisterClockListener(&pI2CHandle->ClockListener);
 	} else {
-		tempreg = ((RCC_GetPCLK1Value() * 300) /1000000U) + 1;
+		RCC_UnregisterClockListener(&pI2CHandle->ClockListener);
 	}
-
-	pI2CHandle->pI2Cx->TRISE =  (tempreg & 0x3F);
 }
 
 /*****************************************************************
@@ -354,7 +375,7 @@ void I2C_MasterReceiveData(I2C_Handle_t *pI2CHandle, uint8_t *pRxBuffer, uint32_
 		I2C_ClearADDRFlag(pI2CHandle);
 
 		// Wair until RxNE becomes 1
-		while(I2C_GetSR1FlagStatus(pI2CHandle->pI2Cx, I2C_RxNE_FLAG) == FLAG_RESET)
+		while(I2C_GetSR1FlagStatus(pI2CHandle->pI2Cx, I2C_RxNE_FLAG) == FLAG_RESET);
 
 		// Generate STOP condition
 		if (sr == I2C_DISABLE_RS)
@@ -457,26 +478,11 @@ void I2C_PeripheralControl(I2C_Handle_t* pI2CHandle, uint8_t EnorDi){
  *
  * @return		- none
  *
- * @Note		- none
+ * @Note		- Forwards to the NVIC driver
  */
 void I2C_IRQInterruptConfig(uint8_t IRQNumber, uint32_t IRQPriority, uint8_t EnorDi){
-	if (EnorDi == ENABLE){
-		if (IRQNumber < 32)
-			*NVIC_ISER0 |= (1 << IRQNumber);
-		else if (IRQNumber >= 32 && IRQNumber < 64)
-			*NVIC_ISER1 |= (1 << (IRQNumber % 32));
-		else if (IRQNumber >= 64 && IRQNumber < 96)
-			*NVIC_ISER2 |= (1 << (IRQNumber % 32));
-	} else if (EnorDi == DISABLE){
-		if (IRQNumber < 32)
-			*NVIC_ICER0 |= (1 << IRQNumber);
-		else if (IRQNumber >= 32 && IRQNumber < 64)
-			*NVIC_ICER1 |= (1 << (IRQNumber % 32));
-		else if (IRQNumber >= 64 && IRQNumber < 96)
-			*NVIC_ICER2 |= (1 << (IRQNumber % 32));
-	}
-
-	I2C_IRQPriorityConfig(IRQNumber, IRQPriority);
+	NVIC_IRQInterruptConfig(IRQNumber, EnorDi);
+	NVIC_IRQPriorityConfig(IRQNumber, IRQPriority);
 }
 
 /*****************************************************************
@@ -489,17 +495,52 @@ void I2C_IRQInterruptConfig(uint8_t IRQNumber, uint32_t IRQPriority, uint8_t Eno
  *
  * @return		- none
  *
- * @Note		- none
+ * @Note		- Forwards to NVIC_IRQPriorityConfig
  */
 void I2C_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority){
-	uint8_t iprx = IRQNumber / 4;
-	uint8_t iprx_section = IRQNumber % 4;
-
-	uint8_t shift_amount = ( 8 * iprx_section ) + (8 - NO_PRIORITY_BITS_IMPLEMENTED);
+	NVIC_IRQPriorityConfig(IRQNumber, IRQPriority);
+}
 
-	__vo uint32_t* iprReg = (__vo uint32_t*)(NVIC_IPR_BASE_ADDR + (4 * iprx));
+/*****************************************************************
+ * @fn			- I2C_IRQBind
+ *
+ * @brief		- Routes the event and error IRQs of the handle's peripheral straight to
+ * 				  I2C_EV_IRQHandling and I2C_ER_IRQHandling for this handle
+ *
+ * @param[in]	- I2C Handle struct
+ *
+ * @return		- NVIC_OK, or NVIC_ERR_IRQ for an unknown peripheral or a failed bind, in
+ * 				  which case neither IRQ is left bound
+ *
+ * @Note		- Replaces I2Cx_EV_IRQHandler/I2Cx_ER_IRQHandler functions in the
+ * 				  application, see NVIC_IRQBind. Enabling the IRQs is still up to
+ * 				  I2C_IRQInterruptConfig.
+ */
+uint8_t I2C_IRQBind(I2C_Handle_t *pI2CHandle){
+	uint8_t evIRQ, erIRQ;
+
+	if(pI2CHandle->pI2Cx == I2C1){
+		evIRQ = IRQ_NO_I2C1_EV;
+		erIRQ = IRQ_NO_I2C1_ER;
+	}else if(pI2CHandle->pI2Cx == I2C2){
+		evIRQ = IRQ_NO_I2C2_EV;
+		erIRQ = IRQ_NO_I2C2_ER;
+	}else if(pI2CHandle->pI2Cx == I2C3){
+		evIRQ = IRQ_NO_I2C3_EV;
+		erIRQ = IRQ_NO_I2C3_ER;
+	}else
+		return NVIC_ERR_IRQ;
+
+	if(NVIC_IRQBind(evIRQ, (NVIC_IRQHandler_t)I2C_EV_IRQHandling, pI2CHandle) != NVIC_OK)
+		return NVIC_ERR_IRQ;
+
+	// Both or neither, an event IRQ without its error IRQ would hang on the first error
+	if(NVIC_IRQBind(erIRQ, (NVIC_IRQHandler_t)I2C_ER_IRQHandling, pI2CHandle) != NVIC_OK){
+		NVIC_IRQUnbind(evIRQ);
+		return NVIC_ERR_IRQ;
+	}
 
-	*iprReg |= (IRQPriority << (shift_amount));
+	return NVIC_OK;
 }
 
 /*****************************************************************
@@ -514,7 +555,7 @@ void I2C_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority){
  * @Note		- none
  */
 
-static void I2C_MasterHandleTXEInterrupt(I2C_Handle_t* pI2CHandle){
+static __isr_ramfunc void I2C_MasterHandleTXEInterrupt(I2C_Handle_t* pI2CHandle){
 	if(pI2CHandle->TxLen > 0){
 		// Load the data into DR
 		pI2CHandle->pI2Cx->DR = *(pI2CHandle->pTxBuffer);
@@ -524,6 +565,21 @@ static void I2C_MasterHandleTXEInterrupt(I2C_Handle_t* pI2CHandle){
 
 		// Increment the buffer address
 		pI2CHandle->pTxBuffer++;
+	} else if(pI2CHandle->MemDataLen > 0){
+		// Register address is out, carry on with the data of a memory write
+		if(pI2CHandle->MemMode == I2C_MEM_WRITE_DMA){
+			// DMA takes over on the same TXE, the final BTF closes the transfer
+			pI2CHandle->pI2Cx->CR2 &= ~(1 << I2C_CR2_ITBUFEN);
+			DMA_StartTransfer(pI2CHandle->pDMATx, (uint32_t)pI2CHandle->pMemData,
+					(uint32_t)&pI2CHandle->pI2Cx->DR, pI2CHandle->MemDataLen);
+			pI2CHandle->pI2Cx->CR2 |= (1 << I2C_CR2_DMAEN);
+		} else {
+			pI2CHandle->pTxBuffer = pI2CHandle->pMemData;
+			pI2CHandle->TxLen = pI2CHandle->MemDataLen;
+			I2C_MasterHandleTXEInterrupt(pI2CHandle);
+		}
+		pI2CHandle->MemDataLen = 0;
+		pI2CHandle->MemMode = I2C_MEM_NONE;
 	}
 }
 
@@ -538,7 +594,7 @@ static void I2C_MasterHandleTXEInterrupt(I2C_Handle_t* pI2CHandle){
  *
  * @Note		- none
  */
-static void I2C_MasterHandleRXNEInterrupt(I2C_Handle_t* pI2CHandle){
+static __isr_ramfunc void I2C_MasterHandleRXNEInterrupt(I2C_Handle_t* pI2CHandle){
 	// We have to do data reception
 	if(pI2CHandle->RxSize == 1){
 		*(pI2CHandle->pRxBuffer) = pI2CHandle->pI2Cx->DR;
@@ -553,7 +609,9 @@ static void I2C_MasterHandleRXNEInterrupt(I2C_Handle_t* pI2CHandle){
 		*pI2CHandle->pRxBuffer = pI2CHandle->pI2Cx->DR;
 		pI2CHandle->pRxBuffer++;
 		pI2CHandle->RxLen--;
-	} else if (pI2CHandle->RxSize == 0){
+	}
+
+	if (pI2CHandle->RxLen == 0){
 		// Close the I2C data reception and notify the application
 
 		// Generate the stop condition
@@ -564,7 +622,7 @@ static void I2C_MasterHandleRXNEInterrupt(I2C_Handle_t* pI2CHandle){
 		I2C_CloseReceiveData(pI2CHandle);
 
 		// Notify the application
-		I2C_ApplicationEventCallback(pI2CHandle, I2C_EV_RX_CMPLT);
+		I2C_NotifyComplete(pI2CHandle, I2C_EV_RX_CMPLT);
 	}
 }
 
@@ -579,8 +637,9 @@ static void I2C_MasterHandleRXNEInterrupt(I2C_Handle_t* pI2CHandle){
  *
  * @Note		- none
  */
-void I2C_EV_IRQHandling(I2C_Handle_t *pI2CHandle){
+__isr_ramfunc void I2C_EV_IRQHandling(I2C_Handle_t *pI2CHandle){
 	uint32_t temp1, temp2, temp3;
+	PROF_IRQ_ENTER(PROF_I2C_EV_IRQProbe);
 
 	temp1 = pI2CHandle->pI2Cx->CR2 & (1 << I2C_CR2_ITEVTEN);
 	temp2 = pI2CHandle->pI2Cx->CR2 & (1 << I2C_CR2_ITBUFEN);
@@ -602,7 +661,8 @@ void I2C_EV_IRQHandling(I2C_Handle_t *pI2CHandle){
 	// 		 When slave mode, address matched with own address
 	temp3 = pI2CHandle->pI2Cx->SR1 & (1 << I2C_SR1_ADDR);
 	if(temp1 && temp3){
-		// ADDR flag is set
+		// ADDR flag is set. For a single byte DMA read this also NACKs the byte and
+		// programs STOP, there is no LAST to do it.
 		I2C_ClearADDRFlag(pI2CHandle);
 	}
 
@@ -616,7 +676,11 @@ void I2C_EV_IRQHandling(I2C_Handle_t *pI2CHandle){
 			// Check if TX is empty, meaning that the transmission is over
 			if(pI2CHandle->pI2Cx->SR1 & (1 << I2C_SR1_TxE)){
 				// BTF & TXE = 1
-				if(pI2CHandle->TxLen == 0){
+				if(pI2CHandle->TxLen == 0 && (pI2CHandle->MemMode == I2C_MEM_READ_IT ||
+						pI2CHandle->MemMode == I2C_MEM_READ_DMA)){
+					// Register address is out, turn around with a repeated start
+					I2C_MemReadDataPhase(pI2CHandle);
+				} else if(pI2CHandle->TxLen == 0 && pI2CHandle->MemDataLen == 0){
 					// Generate the stop condition
 					if(pI2CHandle->sr == I2C_DISABLE_RS)
 					I2C_GenerateStopCondition(pI2CHandle->pI2Cx);
@@ -625,7 +689,7 @@ void I2C_EV_IRQHandling(I2C_Handle_t *pI2CHandle){
 					I2C_CloseSendData(pI2CHandle);
 
 					// Notify the application the transmission has been complete
-					I2C_ApplicationEventCallback(pI2CHandle, I2C_EV_TX_CMPLT);
+					I2C_NotifyComplete(pI2CHandle, I2C_EV_TX_CMPLT);
 				}
 			}
 
@@ -650,7 +714,7 @@ void I2C_EV_IRQHandling(I2C_Handle_t *pI2CHandle){
 	if (temp1 && temp2 && temp3){
 		// TXE flag is set
 		// Check for device mode
-		if(pI2CHandle->pI2Cx->SR1 & (1 << I2C_SR2_MSL) ){
+		if(pI2CHandle->pI2Cx->SR2 & (1 << I2C_SR2_MSL) ){
 			// Device is in master mode
 			// Data transmission
 			if(pI2CHandle->TxRxState == I2C_BUSY_IN_TX){
@@ -682,6 +746,8 @@ void I2C_EV_IRQHandling(I2C_Handle_t *pI2CHandle){
 				I2C_ApplicationEventCallback(pI2CHandle, I2C_EV_DATA_RCV);
 		}
 	}
+
+	PROF_IRQ_EXIT(PROF_I2C_EV_IRQProbe);
 }
 
 /*****************************************************************
@@ -695,10 +761,11 @@ void I2C_EV_IRQHandling(I2C_Handle_t *pI2CHandle){
  *
  * @Note		- none
  */
-void I2C_ER_IRQHandling(I2C_Handle_t *pI2CHandle)
+__isr_ramfunc void I2C_ER_IRQHandling(I2C_Handle_t *pI2CHandle)
 {
 
 	uint32_t temp1,temp2;
+	PROF_IRQ_ENTER(PROF_I2C_ER_IRQProbe);
 
     //Know the status of ITERREN control bit in the CR2
 	temp2 = (pI2CHandle->pI2Cx->CR2) & ( 1 << I2C_CR2_ITERREN);
@@ -714,7 +781,7 @@ void I2C_ER_IRQHandling(I2C_Handle_t *pI2CHandle)
 		pI2CHandle->pI2Cx->SR1 &= ~( 1 << I2C_SR1_BERR);
 
 		// Implement the code to notify the application about the error
-	   I2C_ApplicationEventCallback(pI2CHandle, I2C_ERROR_BERR);
+	   I2C_NotifyError(pI2CHandle, I2C_ERROR_BERR);
 	}
 
 /***********************Check for arbitration lost error************************************/
@@ -727,7 +794,7 @@ void I2C_ER_IRQHandling(I2C_Handle_t *pI2CHandle)
 		pI2CHandle->pI2Cx->SR1 &= ~( 1 << I2C_SR1_ARLO);
 
 		// Implement the code to notify the application about the error
-		I2C_ApplicationEventCallback(pI2CHandle, I2C_ERROR_ARLO);
+		I2C_NotifyError(pI2CHandle, I2C_ERROR_ARLO);
 	}
 
 /***********************Check for ACK failure error************************************/
@@ -740,7 +807,7 @@ void I2C_ER_IRQHandling(I2C_Handle_t *pI2CHandle)
 	    // Implement the code to clear the ACK failure error flag
 		pI2CHandle->pI2Cx->SR1 &= ~( 1 << I2C_SR1_AF);
 		// Implement the code to notify the application about the error
-		I2C_ApplicationEventCallback(pI2CHandle, I2C_ERROR_AF);
+		I2C_NotifyError(pI2CHandle, I2C_ERROR_AF);
 	}
 
 /***********************Check for Overrun/underrun error************************************/
@@ -752,7 +819,7 @@ void I2C_ER_IRQHandling(I2C_Handle_t *pI2CHandle)
 	    // Implement the code to clear the Overrun/underrun error flag
 		pI2CHandle->pI2Cx->SR1 &= ~( 1 << I2C_SR1_OVR);
 		// Implement the code to notify the application about the error
-		I2C_ApplicationEventCallback(pI2CHandle, I2C_ERROR_OVR);
+		I2C_NotifyError(pI2CHandle, I2C_ERROR_OVR);
 	}
 
 /***********************Check for Time out error************************************/
@@ -764,9 +831,10 @@ void I2C_ER_IRQHandling(I2C_Handle_t *pI2CHandle)
 	    // Implement the code to clear the Time out error flag
 		pI2CHandle->pI2Cx->SR1 &= ~( 1 << I2C_SR1_TIME_OUT);
 		// Implement the code to notify the application about the error
-		I2C_ApplicationEventCallback(pI2CHandle, I2C_ERROR_TIMEOUT);
+		I2C_NotifyError(pI2CHandle, I2C_ERROR_TIMEOUT);
 	}
 
+	PROF_IRQ_EXIT(PROF_I2C_ER_IRQProbe);
 }
 
 // Interrupt send and receive API's
@@ -861,6 +929,438 @@ uint8_t I2C_MasterReceiveDataIT(I2C_Handle_t *pI2CHandle, uint8_t *pRxBuffer, ui
 	return busystate;
 }
 
+// DMA send and receive API's
+
+/*****************************************************************
+ * @fn			- I2C_DMAInit
+ *
+ * @brief		- Allocates and configures the DMA streams used by an I2C peripheral
+ *
+ * @param[in]	- Pointer to I2C Handle
+ * @param[in]	- DMA handle to use for transmission, or NULL
+ * @param[in]	- DMA handle to use for reception, or NULL
+ *
+ * @return		- DMA_OK or DMA_ERR_NO_STREAM
+ *
+ * @Note		- Call after I2C_Init. The application still has to enable the stream IRQs
+ * 				  and the I2C event and error IRQs.
+ */
+uint8_t I2C_DMAInit(I2C_Handle_t *pI2CHandle, DMA_Handle_t *pDMATx, DMA_Handle_t *pDMARx){
+	uint8_t txReq, rxReq;
+
+	if(pI2CHandle->pI2Cx == I2C1){
+		txReq = DMA_REQ_I2C1_TX;
+		rxReq = DMA_REQ_I2C1_RX;
+	} else if(pI2CHandle->pI2Cx == I2C2){
+		txReq = DMA_REQ_I2C2_TX;
+		rxReq = DMA_REQ_I2C2_RX;
+	} else {
+		txReq = DMA_REQ_I2C3_TX;
+		rxReq = DMA_REQ_I2C3_RX;
+	}
+
+	pI2CHandle->pDMATx = pDMATx;
+	pI2CHandle->pDMARx = pDMARx;
+
+	if(pDMATx){
+		if(DMA_AllocateStream(pDMATx, txReq) != DMA_OK)
+			return DMA_ERR_NO_STREAM;
+		I2C_DMAConfigStream(pI2CHandle, pDMATx, DMA_DIR_MEM_TO_PERIPH);
+		pDMATx->XferEventCallback = I2C_DMATxEventHandle;
+	}
+
+	if(pDMARx){
+		if(DMA_AllocateStream(pDMARx, rxReq) != DMA_OK)
+			return DMA_ERR_NO_STREAM;
+		I2C_DMAConfigStream(pI2CHandle, pDMARx, DMA_DIR_PERIPH_TO_MEM);
+		pDMARx->XferEventCallback = I2C_DMARxEventHandle;
+	}
+
+	return DMA_OK;
+}
+
+/*****************************************************************
+ * @fn			- I2C_MasterSendDataDMA
+ *
+ * @brief		- This function sends data with the data phase done by DMA
+ *
+ * @param[in]	- Pointer to I2C Handle
+ * @param[in]	- Pointer to data buffer
+ * @param[in]	- Length of Tx buffer (1 to DMA_MAX_ITEMS)
+ * @param[in]	- Address of slave to send data to
+ * @param[in]	- Repeated start enable or disable
+ *
+ * @return		- Status, I2C_ERR_DMA if the stream is missing, the buffer is in CCM RAM
+ * 				  or len is out of range
+ *
+ * @Note		- Only SB, ADDR and the final BTF reach I2C_EV_IRQHandling, ITBUFEN stays off.
+ * 				  The last BTF generates STOP and reports I2C_EV_TX_CMPLT.
+ */
+uint8_t I2C_MasterSendDataDMA(I2C_Handle_t *pI2CHandle, uint8_t *pTxBuffer, uint32_t len, uint8_t slaveAddr, uint8_t sr){
+	uint8_t busystate = pI2CHandle->TxRxState;
+
+	if(!I2C_DMACanStart(pI2CHandle->pDMATx, pTxBuffer, len))
+		return I2C_ERR_DMA;
+
+	if((busystate != I2C_BUSY_IN_TX) && (busystate != I2C_BUSY_IN_RX)){
+		pI2CHandle->pTxBuffer = pTxBuffer;
+		pI2CHandle->TxLen = 0;		// The BTF handler sees an exhausted buffer once DMA is done
+		pI2CHandle->TxRxState = I2C_BUSY_IN_TX;
+		pI2CHandle->DevAddr = slaveAddr;
+		pI2CHandle->sr = sr;
+
+		// 1. Arm the stream, requests start once ADDR is cleared
+		DMA_StartTransfer(pI2CHandle->pDMATx, (uint32_t)pTxBuffer, (uint32_t)&pI2CHandle->pI2Cx->DR, len);
+		pI2CHandle->pI2Cx->CR2 |= (1 << I2C_CR2_DMAEN);
+
+		// 2. Generate START
+		I2C_GenerateStartCondition(pI2CHandle->pI2Cx);
+
+		// 3. Event and error interrupts only, the data phase belongs to DMA
+		pI2CHandle->pI2Cx->CR2 |= (1 << I2C_CR2_ITEVTEN) | (1 << I2C_CR2_ITERREN);
+	}
+
+	return busystate;
+}
+
+/*****************************************************************
+ * @fn			- I2C_MasterReceiveDataDMA
+ *
+ * @brief		- This function receives data with the data phase done by DMA
+ *
+ * @param[in]	- Pointer to I2C Handle
+ * @param[in]	- Pointer to data buffer
+ * @param[in]	- Length of Rx buffer (1 to DMA_MAX_ITEMS)
+ * @param[in]	- Address of slave to receive data from
+ * @param[in]	- Repeated start enable or disable
+ *
+ * @return		- Status, I2C_ERR_DMA if the stream is missing, the buffer is in CCM RAM
+ * 				  or len is out of range
+ *
+ * @Note		- For N >= 2, LAST makes the hardware NACK the final byte and STOP is set from
+ * 				  the DMA transfer complete interrupt. For N = 1, the ADDR interrupt clears ACK
+ * 				  before it reads SR1/SR2 and sets STOP straight after (RM0090 27.3.3).
+ */
+uint8_t I2C_MasterReceiveDataDMA(I2C_Handle_t *pI2CHandle, uint8_t *pRxBuffer, uint32_t len, uint8_t slaveAddr, uint8_t sr){
+	uint8_t busystate = pI2CHandle->TxRxState;
+
+	if(!I2C_DMACanStart(pI2CHandle->pDMARx, pRxBuffer, len))
+		return I2C_ERR_DMA;
+
+	if((busystate != I2C_BUSY_IN_TX) && (busystate != I2C_BUSY_IN_RX)){
+		pI2CHandle->pRxBuffer = pRxBuffer;
+		pI2CHandle->RxLen = len;
+		pI2CHandle->TxRxState = I2C_BUSY_IN_RX;
+		pI2CHandle->RxSize = len;	// I2C_ClearADDRFlag clears ACK when this is 1
+		pI2CHandle->DevAddr = slaveAddr;
+		pI2CHandle->sr = sr;
+
+		// 1. ACK every byte but the last one
+		I2C_ManageAcking(pI2CHandle->pI2Cx, I2C_ACK_ENABLE);
+		if(len >= 2)
+			pI2CHandle->pI2Cx->CR2 |= (1 << I2C_CR2_LAST);
+		else
+			pI2CHandle->pI2Cx->CR2 &= ~(1 << I2C_CR2_LAST);
+
+		// 2. Arm the stream
+		DMA_StartTransfer(pI2CHandle->pDMARx, (uint32_t)&pI2CHandle->pI2Cx->DR, (uint32_t)pRxBuffer, len);
+		pI2CHandle->pI2Cx->CR2 |= (1 << I2C_CR2_DMAEN);
+
+		// 3. Generate START
+		I2C_GenerateStartCondition(pI2CHandle->pI2Cx);
+
+		// 4. Event and error interrupts only
+		pI2CHandle->pI2Cx->CR2 |= (1 << I2C_CR2_ITEVTEN) | (1 << I2C_CR2_ITERREN);
+	}
+
+	return busystate;
+}
+
+// Register (memory) access API's
+
+/*****************************************************************
+ * @fn			- I2C_MemWrite
+ *
+ * @brief		- Writes len bytes starting at a register of the slave
+ *
+ * @param[in]	- Pointer to I2C Handle
+ * @param[in]	- Address of slave
+ * @param[in]	- Register (memory) address
+ * @param[in]	- Register address width, possible values from @MemAddrSize
+ * @param[in]	- Pointer to data buffer
+ * @param[in]	- Length of data to write
+ *
+ * @return		- none
+ *
+ * @Note		- START, address, register, data and STOP without a gap in between
+ */
+void I2C_MemWrite(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t *pTxBuffer, uint32_t len){
+	I2C_RegDef_t *pI2Cx = pI2CHandle->pI2Cx;
+
+	// 1. START and address phase
+	I2C_GenerateStartCondition(pI2Cx);
+	while (I2C_GetSR1FlagStatus(pI2Cx, I2C_SB_FLAG) == FLAG_RESET);
+	I2C_ExecuteAddressPhase(pI2Cx, slaveAddr, WRITE);
+	while (I2C_GetSR1FlagStatus(pI2Cx, I2C_ADDR_FLAG) == FLAG_RESET);
+	I2C_ClearADDRFlag(pI2CHandle);
+
+	// 2. Register address, MSB first
+	if(memAddrSize == I2C_MEMADD_SIZE_16BIT){
+		while(I2C_GetSR1FlagStatus(pI2Cx, I2C_TxE_FLAG) == FLAG_RESET);
+		pI2Cx->DR = (uint8_t)(memAddr >> 8);
+	}
+	while(I2C_GetSR1FlagStatus(pI2Cx, I2C_TxE_FLAG) == FLAG_RESET);
+	pI2Cx->DR = (uint8_t)memAddr;
+
+	// 3. Data
+	for(uint32_t i = 0; i < len; i++){
+		while(I2C_GetSR1FlagStatus(pI2Cx, I2C_TxE_FLAG) == FLAG_RESET);
+		pI2Cx->DR = pTxBuffer[i];
+	}
+
+	// 4. Wait for TXE and BTF, then STOP
+	while ((I2C_GetSR1FlagStatus(pI2Cx, I2C_BTF_FLAG) == FLAG_RESET) ||
+			(I2C_GetSR1FlagStatus(pI2Cx, I2C_TxE_FLAG) == FLAG_RESET));
+	I2C_GenerateStopCondition(pI2Cx);
+}
+
+/*****************************************************************
+ * @fn			- I2C_MemRead
+ *
+ * @brief		- Reads len bytes starting at a register of the slave
+ *
+ * @param[in]	- Pointer to I2C Handle
+ * @param[in]	- Address of slave
+ * @param[in]	- Register (memory) address
+ * @param[in]	- Register address width, possible values from @MemAddrSize
+ * @param[in]	- Pointer to data buffer
+ * @param[in]	- Length of data to read
+ *
+ * @return		- none
+ *
+ * @Note		- Register write, repeated START and the whole read in one transaction
+ */
+void I2C_MemRead(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t *pRxBuffer, uint32_t len){
+	uint8_t addr[2];
+
+	if(memAddrSize == I2C_MEMADD_SIZE_16BIT){
+		addr[0] = (uint8_t)(memAddr >> 8);
+		addr[1] = (uint8_t)memAddr;
+	} else {
+		addr[0] = (uint8_t)memAddr;
+	}
+
+	I2C_MasterSendData(pI2CHandle, addr, memAddrSize, slaveAddr, I2C_ENABLE_RS);
+	I2C_MasterReceiveData(pI2CHandle, pRxBuffer, len, slaveAddr, I2C_DISABLE_RS);
+}
+
+/*****************************************************************
+ * @fn			- I2C_MemWriteIT
+ *
+ * @brief		- Interrupt driven register write
+ *
+ * @param[in]	- Pointer to I2C Handle
+ * @param[in]	- Address of slave
+ * @param[in]	- Register (memory) address
+ * @param[in]	- Register address width, possible values from @MemAddrSize
+ * @param[in]	- Pointer to data buffer
+ * @param[in]	- Length of data to write
+ *
+ * @return		- Status
+ *
+ * @Note		- The TXE handler moves from the register address to the data on its own,
+ * 				  I2C_EV_TX_CMPLT is reported after STOP
+ */
+uint8_t I2C_MemWriteIT(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t *pTxBuffer, uint32_t len){
+	uint8_t busystate = pI2CHandle->TxRxState;
+
+	if((busystate != I2C_BUSY_IN_TX) && (busystate != I2C_BUSY_IN_RX)){
+		pI2CHandle->pMemData = pTxBuffer;
+		pI2CHandle->MemDataLen = len;
+		I2C_MemStart(pI2CHandle, slaveAddr, memAddr, memAddrSize, I2C_MEM_WRITE_IT);
+	}
+
+	return busystate;
+}
+
+/*****************************************************************
+ * @fn			- I2C_MemReadIT
+ *
+ * @brief		- Interrupt driven register read
+ *
+ * @param[in]	- Pointer to I2C Handle
+ * @param[in]	- Address of slave
+ * @param[in]	- Register (memory) address
+ * @param[in]	- Register address width, possible values from @MemAddrSize
+ * @param[in]	- Pointer to data buffer
+ * @param[in]	- Length of data to read
+ *
+ * @return		- Status
+ *
+ * @Note		- The whole write-then-read sequence is a state machine in I2C_EV_IRQHandling:
+ * 				  the BTF after the register address issues the repeated START itself.
+ * 				  I2C_EV_RX_CMPLT is the only event the application sees.
+ */
+uint8_t I2C_MemReadIT(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t *pRxBuffer, uint32_t len){
+	uint8_t busystate = pI2CHandle->TxRxState;
+
+	if((busystate != I2C_BUSY_IN_TX) && (busystate != I2C_BUSY_IN_RX)){
+		pI2CHandle->pRxBuffer = pRxBuffer;
+		pI2CHandle->RxLen = len;
+		pI2CHandle->RxSize = len;
+		I2C_MemStart(pI2CHandle, slaveAddr, memAddr, memAddrSize, I2C_MEM_READ_IT);
+	}
+
+	return busystate;
+}
+
+/*****************************************************************
+ * @fn			- I2C_MemWriteDMA
+ *
+ * @brief		- Register write with the data phase done by DMA
+ *
+ * @param[in]	- Pointer to I2C Handle
+ * @param[in]	- Address of slave
+ * @param[in]	- Register (memory) address
+ * @param[in]	- Register address width, possible values from @MemAddrSize
+ * @param[in]	- Pointer to data buffer
+ * @param[in]	- Length of data to write (1 to DMA_MAX_ITEMS)
+ *
+ * @return		- Status, I2C_ERR_DMA if the stream is missing, the buffer is in CCM RAM
+ * 				  or len is out of range
+ *
+ * @Note		- The register address goes out from the TXE interrupt, then the Tx stream
+ * 				  takes over. Requires I2C_DMAInit.
+ */
+uint8_t I2C_MemWriteDMA(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t *pTxBuffer, uint32_t len){
+	uint8_t busystate = pI2CHandle->TxRxState;
+
+	if(!I2C_DMACanStart(pI2CHandle->pDMATx, pTxBuffer, len))
+		return I2C_ERR_DMA;
+
+	if((busystate != I2C_BUSY_IN_TX) && (busystate != I2C_BUSY_IN_RX)){
+		pI2CHandle->pMemData = pTxBuffer;
+		pI2CHandle->MemDataLen = len;
+		I2C_MemStart(pI2CHandle, slaveAddr, memAddr, memAddrSize, I2C_MEM_WRITE_DMA);
+	}
+
+	return busystate;
+}
+
+/*****************************************************************
+ * @fn			- I2C_MemReadDMA
+ *
+ * @brief		- Register read with the data phase done by DMA
+ *
+ * @param[in]	- Pointer to I2C Handle
+ * @param[in]	- Address of slave
+ * @param[in]	- Register (memory) address
+ * @param[in]	- Register address width, possible values from @MemAddrSize
+ * @param[in]	- Pointer to data buffer
+ * @param[in]	- Length of data to read (1 to DMA_MAX_ITEMS)
+ *
+ * @return		- Status, I2C_ERR_DMA if the stream is missing, the buffer is in CCM RAM
+ * 				  or len is out of range
+ *
+ * @Note		- Same state machine as I2C_MemReadIT, the repeated START arms the Rx stream
+ * 				  with the LAST/NACK sequencing of I2C_MasterReceiveDataDMA. Requires I2C_DMAInit.
+ */
+uint8_t I2C_MemReadDMA(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t *pRxBuffer, uint32_t len){
+	uint8_t busystate = pI2CHandle->TxRxState;
+
+	if(!I2C_DMACanStart(pI2CHandle->pDMARx, pRxBuffer, len))
+		return I2C_ERR_DMA;
+
+	if((busystate != I2C_BUSY_IN_TX) && (busystate != I2C_BUSY_IN_RX)){
+		pI2CHandle->pRxBuffer = pRxBuffer;
+		pI2CHandle->RxLen = len;
+		pI2CHandle->RxSize = len;
+		I2C_MemStart(pI2CHandle, slaveAddr, memAddr, memAddrSize, I2C_MEM_READ_DMA);
+	}
+
+	return busystate;
+}
+
+// Job queue API's
+
+/*****************************************************************
+ * @fn			- I2C_QueueJob
+ *
+ * @brief		- Appends a job to the queue of an I2C peripheral
+ *
+ * @param[in]	- Pointer to I2C Handle
+ * @param[in]	- Pointer to the job descriptor
+ *
+ * @return		- I2C_READY if the job starts right away, I2C_BUSY_IN_TX if it is queued,
+ * 				  I2C_ERR_BUSY if a transfer outside the queue is in progress, I2C_ERR_QUEUE
+ * 				  if the event queue is not ready or full
+ *
+ * @Note		- Jobs run on the interrupt state machine, the I2C event and error IRQs must be
+ * 				  enabled. A START may only be requested once the previous STOP is out, that
+ * 				  wait is posted to the event queue (EVT_TYPE_I2C_QUEUE) and never done in the
+ * 				  I2C interrupt, so the queue needs EVT_Init. When a job finishes its Callback
+ * 				  runs right away, the next job starts from EVT_Dispatch. If the event queue
+ * 				  is full the remaining jobs end with I2C_ERROR_QUEUE, a STOP which never
+ * 				  clears ends them with I2C_ERROR_TIMEOUT. Jobs report through their Callback
+ * 				  instead of I2C_ApplicationEventCallback. The queue cannot share the bus with
+ * 				  the plain IT/DMA calls, their completion would be taken for the job's.
+ */
+uint8_t I2C_QueueJob(I2C_Handle_t *pI2CHandle, I2C_Job_t *pJob){
+	uint8_t state = I2C_BUSY_IN_TX;
+	uint32_t primask;
+
+	if(!EVT_IsReady())
+		return I2C_ERR_QUEUE;
+
+	pJob->pNext = NULL;
+	EVT_RegisterHandler(EVT_TYPE_I2C_QUEUE, I2C_JobDeferredHandle);
+
+	// The ISR pops from the head, so link under a critical section
+	primask = IRQ_SaveAndDisable();
+
+	// A busy handle with an empty queue is running a transfer which is not a job
+	if(pI2CHandle->pJobHead == NULL && pI2CHandle->TxRxState != I2C_READY){
+		IRQ_Restore(primask);
+		return I2C_ERR_BUSY;
+	}
+
+	if(pI2CHandle->pJobTail)
+		pI2CHandle->pJobTail->pNext = pJob;
+	else
+		pI2CHandle->pJobHead = pJob;
+	pI2CHandle->pJobTail = pJob;
+
+	if(pI2CHandle->pJobHead == pJob && pI2CHandle->TxRxState == I2C_READY){
+		// The queue was idle, a transfer before it may still have its STOP pending
+		if(EVT_Post(EVT_TYPE_I2C_QUEUE, I2C_QUEUE_EVT_START, pI2CHandle, 0) == EVT_OK){
+			state = I2C_READY;
+		} else {
+			pI2CHandle->pJobHead = NULL;
+			pI2CHandle->pJobTail = NULL;
+			state = I2C_ERR_QUEUE;
+		}
+	}
+
+	IRQ_Restore(primask);
+
+	return state;
+}
+
+/*****************************************************************
+ * @fn			- I2C_QueueIsIdle
+ *
+ * @brief		- Checks whether every queued job has finished
+ *
+ * @param[in]	- Pointer to I2C Handle
+ *
+ * @return		- 1 if the queue is empty, 0 otherwise
+ *
+ * @Note		- none
+ */
+uint8_t I2C_QueueIsIdle(I2C_Handle_t *pI2CHandle){
+	return (pI2CHandle->pJobHead == NULL) ? 1 : 0;
+}
+
 // Close communications
 
 /*****************************************************************
@@ -911,3 +1411,315 @@ void I2C_CloseReceiveData(I2C_Handle_t *pI2CHandle){
 	if(pI2CHandle->I2C_Config.AckControl == I2C_ACK_ENABLE)
 		I2C_ManageAcking(pI2CHandle->pI2Cx, ENABLE);
 }
+
+static uint8_t I2C_DMACanStart(DMA_Handle_t *pDMAHandle, uint8_t *pBuffer, uint32_t len){
+	// Checked before START, a stream which refuses to run would leave the bus held
+	if(pDMAHandle == NULL || pDMAHandle->pDMAx == NULL || DMA_IS_CCM_ADDR(pBuffer))
+		return 0;
+	return (len > 0 && len <= DMA_MAX_ITEMS);
+}
+
+static void I2C_DMAConfigStream(I2C_Handle_t *pI2CHandle, DMA_Handle_t *pDMAHandle, uint8_t direction){
+	pDMAHandle->pParent = pI2CHandle;
+	pDMAHandle->DMAConfig.Direction = direction;
+	pDMAHandle->DMAConfig.Mode = DMA_MODE_NORMAL;
+	pDMAHandle->DMAConfig.Priority = DMA_PRIORITY_HIGH;
+	pDMAHandle->DMAConfig.PeriphDataSize = DMA_DATA_SIZE_BYTE;
+	pDMAHandle->DMAConfig.MemDataSize = DMA_DATA_SIZE_BYTE;
+	pDMAHandle->DMAConfig.PeriphInc = DISABLE;
+	pDMAHandle->DMAConfig.MemInc = ENABLE;
+	pDMAHandle->DMAConfig.FIFOMode = DMA_FIFO_MODE_DIRECT;
+	pDMAHandle->DMAConfig.FIFOThreshold = DMA_FIFO_THRESHOLD_1QUARTER;
+	pDMAHandle->DMAConfig.PeriphBurst = DMA_BURST_SINGLE;
+	pDMAHandle->DMAConfig.MemBurst = DMA_BURST_SINGLE;
+
+	DMA_Init(pDMAHandle);
+}
+
+static void I2C_DMATxEventHandle(DMA_Handle_t *pDMAHandle, uint8_t AppEv){
+	I2C_Handle_t *pI2CHandle = (I2C_Handle_t*)pDMAHandle->pParent;
+
+	// The last byte is still in DR, the BTF event finishes the transfer
+	if(AppEv == DMA_EVENT_FULL_CMPLT){
+		pI2CHandle->pI2Cx->CR2 &= ~(1 << I2C_CR2_DMAEN);
+	} else if(AppEv == DMA_EVENT_TRANSFER_ERR){
+		pI2CHandle->pI2Cx->CR2 &= ~(1 << I2C_CR2_DMAEN);
+		I2C_GenerateStopCondition(pI2CHandle->pI2Cx);
+		I2C_CloseSendData(pI2CHandle);
+		I2C_NotifyError(pI2CHandle, I2C_ERROR_DMA);
+	}
+}
+
+static void I2C_DMARxEventHandle(DMA_Handle_t *pDMAHandle, uint8_t AppEv){
+	I2C_Handle_t *pI2CHandle = (I2C_Handle_t*)pDMAHandle->pParent;
+
+	if(AppEv == DMA_EVENT_FULL_CMPLT){
+		// 1. The last byte was NACKed by LAST, release the bus (already done for a single byte)
+		if(pI2CHandle->sr == I2C_DISABLE_RS && pI2CHandle->RxSize > 1)
+			I2C_GenerateStopCondition(pI2CHandle->pI2Cx);
+
+		// 2. Leave DMA mode and restore ACK
+		pI2CHandle->pI2Cx->CR2 &= ~((1 << I2C_CR2_DMAEN) | (1 << I2C_CR2_LAST));
+		I2C_CloseReceiveData(pI2CHandle);
+		I2C_NotifyComplete(pI2CHandle, I2C_EV_RX_CMPLT);
+	} else if(AppEv == DMA_EVENT_TRANSFER_ERR){
+		pI2CHandle->pI2Cx->CR2 &= ~((1 << I2C_CR2_DMAEN) | (1 << I2C_CR2_LAST));
+		I2C_GenerateStopCondition(pI2CHandle->pI2Cx);
+		I2C_CloseReceiveData(pI2CHandle);
+		I2C_NotifyError(pI2CHandle, I2C_ERROR_DMA);
+	}
+}
+
+static uint8_t I2C_MemStart(I2C_Handle_t *pI2CHandle, uint8_t slaveAddr, uint16_t memAddr, uint8_t memAddrSize, uint8_t memMode){
+	// 1. The register address is sent as a regular interrupt driven write
+	if(memAddrSize == I2C_MEMADD_SIZE_16BIT){
+		pI2CHandle->MemAddrBuf[0] = (uint8_t)(memAddr >> 8);
+		pI2CHandle->MemAddrBuf[1] = (uint8_t)memAddr;
+	} else {
+		pI2CHandle->MemAddrBuf[0] = (uint8_t)memAddr;
+	}
+	pI2CHandle->pTxBuffer = pI2CHandle->MemAddrBuf;
+	pI2CHandle->TxLen = memAddrSize;
+	pI2CHandle->MemMode = memMode;
+	pI2CHandle->TxRxState = I2C_BUSY_IN_TX;
+	pI2CHandle->DevAddr = slaveAddr;
+	pI2CHandle->sr = I2C_DISABLE_RS;
+
+	// 2. START, the rest happens in I2C_EV_IRQHandling
+	I2C_GenerateStartCondition(pI2CHandle->pI2Cx);
+	pI2CHandle->pI2Cx->CR2 |= (1 << I2C_CR2_ITBUFEN) | (1 << I2C_CR2_ITEVTEN) | (1 << I2C_CR2_ITERREN);
+
+	return I2C_READY;
+}
+
+static void I2C_MemReadDataPhase(I2C_Handle_t *pI2CHandle){
+	I2C_RegDef_t *pI2Cx = pI2CHandle->pI2Cx;
+
+	// A job may ask for a STOP between its segments instead of a repeated START. CR1 must
+	// not be written again until STOP clears, so the rest goes through the event queue
+	// with the event interrupts off meanwhile (TXE stays set until the STOP is out).
+	if(pI2CHandle->pJobHead && pI2CHandle->pJobHead->sr == I2C_DISABLE_RS){
+		I2C_GenerateStopCondition(pI2Cx);
+		pI2Cx->CR2 &= ~((1 << I2C_CR2_ITEVTEN) | (1 << I2C_CR2_ITBUFEN));
+		if(EVT_Post(EVT_TYPE_I2C_QUEUE, I2C_QUEUE_EVT_RESTART, pI2CHandle, 0) != EVT_OK){
+			pI2CHandle->MemMode = I2C_MEM_NONE;
+			I2C_CloseSendData(pI2CHandle);
+			I2C_NotifyComplete(pI2CHandle, I2C_ERROR_QUEUE);
+		}
+		return;
+	}
+
+	I2C_MemReadRestart(pI2CHandle);
+}
+
+static void I2C_MemReadRestart(I2C_Handle_t *pI2CHandle){
+	I2C_RegDef_t *pI2Cx = pI2CHandle->pI2Cx;
+	uint8_t memMode = pI2CHandle->MemMode;
+
+	pI2CHandle->MemMode = I2C_MEM_NONE;
+	pI2CHandle->TxRxState = I2C_BUSY_IN_RX;
+	pI2CHandle->sr = I2C_DISABLE_RS;
+	I2C_ManageAcking(pI2Cx, I2C_ACK_ENABLE);
+	pI2Cx->CR2 |= (1 << I2C_CR2_ITEVTEN) | (1 << I2C_CR2_ITBUFEN);
+
+	if(memMode == I2C_MEM_READ_DMA){
+		// Data phase by DMA, keep only the event interrupts for SB and ADDR
+		pI2Cx->CR2 &= ~(1 << I2C_CR2_ITBUFEN);
+		if(pI2CHandle->RxSize >= 2)
+			pI2Cx->CR2 |= (1 << I2C_CR2_LAST);
+		else
+			pI2Cx->CR2 &= ~(1 << I2C_CR2_LAST);
+		DMA_StartTransfer(pI2CHandle->pDMARx, (uint32_t)&pI2Cx->DR, (uint32_t)pI2CHandle->pRxBuffer,
+				pI2CHandle->RxSize);
+		pI2Cx->CR2 |= (1 << I2C_CR2_DMAEN);
+	}
+
+	// Repeated START, SB then sends the address with the read bit
+	I2C_GenerateStartCondition(pI2Cx);
+}
+
+static void I2C_JobStart(I2C_Handle_t *pI2CHandle){
+	I2C_Job_t *pJob = pI2CHandle->pJobHead;
+
+	if(pJob->TxLen > 0 && pJob->RxLen > 0){
+		// Write then read, BTF turns the bus around like a memory read
+		pI2CHandle->pRxBuffer = pJob->pRxBuffer;
+		pI2CHandle->RxLen = pJob->RxLen;
+		pI2CHandle->RxSize = pJob->RxLen;
+		pI2CHandle->MemMode = I2C_MEM_READ_IT;
+		I2C_MasterSendDataIT(pI2CHandle, pJob->pTxBuffer, pJob->TxLen, pJob->SlaveAddr, I2C_ENABLE_RS);
+	} else if(pJob->RxLen > 0){
+		I2C_ManageAcking(pI2CHandle->pI2Cx, I2C_ACK_ENABLE);
+		I2C_MasterReceiveDataIT(pI2CHandle, pJob->pRxBuffer, pJob->RxLen, pJob->SlaveAddr, I2C_DISABLE_RS);
+	} else {
+		I2C_MasterSendDataIT(pI2CHandle, pJob->pTxBuffer, pJob->TxLen, pJob->SlaveAddr, I2C_DISABLE_RS);
+	}
+}
+
+static void I2C_JobDeferredHandle(EVT_Event_t *pEvent){
+	I2C_Handle_t *pI2CHandle = (I2C_Handle_t*)pEvent->pContext;
+	I2C_Job_t *pFailed;
+	uint32_t primask;
+
+	if(pEvent->Code == I2C_QUEUE_EVT_RESTART){
+		// An error interrupt may have ended the job meanwhile
+		if(pI2CHandle->TxRxState != I2C_BUSY_IN_TX || pI2CHandle->MemMode == I2C_MEM_NONE)
+			return;
+		if(I2C_WaitStop(pI2CHandle->pI2Cx))
+			I2C_MemReadRestart(pI2CHandle);
+		else
+			I2C_NotifyError(pI2CHandle, I2C_ERROR_TIMEOUT);
+		return;
+	}
+
+	if(pI2CHandle->pJobHead == NULL || pI2CHandle->TxRxState != I2C_READY)
+		return;
+
+	// The previous STOP has to be on the bus before the next START is requested
+	if(I2C_WaitStop(pI2CHandle->pI2Cx)){
+		I2C_JobStart(pI2CHandle);
+		return;
+	}
+
+	// It never went out, the whole queue fails with the bus
+	primask = IRQ_SaveAndDisable();
+	pFailed = pI2CHandle->pJobHead;
+	pI2CHandle->pJobHead = NULL;
+	pI2CHandle->pJobTail = NULL;
+	IRQ_Restore(primask);
+
+	I2C_JobFail(pI2CHandle, pFailed, I2C_ERROR_TIMEOUT);
+}
+
+static void I2C_JobFail(I2C_Handle_t *pI2CHandle, I2C_Job_t *pJob, uint8_t AppEv){
+	I2C_Job_t *pNext;
+
+	// Detached first, a Callback which queues again starts a new queue
+	while(pJob){
+		pNext = pJob->pNext;
+		if(pJob->Callback)
+			pJob->Callback(pI2CHandle, pJob, AppEv);
+		pJob = pNext;
+	}
+}
+
+static uint8_t I2C_WaitStop(I2C_RegDef_t *pI2Cx){
+	uint32_t loops = I2C_STOP_WAIT_LOOPS;
+
+	while(pI2Cx->CR1 & (1 << I2C_CR1_STOP)){
+		if(--loops == 0)
+			return 0;
+	}
+
+	return 1;
+}
+
+static void I2C_NotifyComplete(I2C_Handle_t *pI2CHandle, uint8_t AppEv){
+	I2C_Job_t *pJob = pI2CHandle->pJobHead;
+	I2C_Job_t *pFailed = NULL;
+
+	if(!pJob){
+		I2C_ApplicationEventCallback(pI2CHandle, AppEv);
+		return;
+	}
+
+	// Pop the job, the next one starts from EVT_Dispatch once this job's STOP is out.
+	// The head stays in place meanwhile, so I2C_QueueJob only links behind it.
+	pI2CHandle->pJobHead = pJob->pNext;
+	if(pI2CHandle->pJobHead){
+		if(EVT_Post(EVT_TYPE_I2C_QUEUE, I2C_QUEUE_EVT_START, pI2CHandle, 0) != EVT_OK){
+			pFailed = pI2CHandle->pJobHead;
+			pI2CHandle->pJobHead = NULL;
+			pI2CHandle->pJobTail = NULL;
+		}
+	} else {
+		pI2CHandle->pJobTail = NULL;
+	}
+
+	// Only now report, the callback may queue the same job again
+	if(pJob->Callback)
+		pJob->Callback(pI2CHandle, pJob, AppEv);
+
+	I2C_JobFail(pI2CHandle, pFailed, I2C_ERROR_QUEUE);
+}
+
+static void I2C_NotifyError(I2C_Handle_t *pI2CHandle, uint8_t AppEv){
+	if(!pI2CHandle->pJobHead){
+		I2C_ApplicationEventCallback(pI2CHandle, AppEv);
+		return;
+	}
+
+	// Abort the job in progress, after an arbitration loss the bus is not ours to stop
+	if(AppEv != I2C_ERROR_ARLO)
+		I2C_GenerateStopCondition(pI2CHandle->pI2Cx);
+
+	pI2CHandle->MemMode = I2C_MEM_NONE;
+	if(pI2CHandle->TxRxState == I2C_BUSY_IN_RX)
+		I2C_CloseReceiveData(pI2CHandle);
+	else
+		I2C_CloseSendData(pI2CHandle);
+
+	I2C_NotifyComplete(pI2CHandle, AppEv);
+}
+
+static void I2C_ConfigClock(I2C_Handle_t *pI2CHandle, uint32_t pclk1){
+	uint32_t tempreg;
+	uint16_t ccr_value;
+
+	// Configure the FREQ field of CR2
+	tempreg = pI2CHandle->pI2Cx->CR2 & ~0x3F;
+	tempreg |= (pclk1 / 1000000U) & 0x3F;
+	pI2CHandle->pI2Cx->CR2 = tempreg;
+
+	// CCR calculations
+	tempreg = 0;
+	if(pI2CHandle->I2C_Config.SCLSpeed <= I2C_SCL_SPEED_SM){
+		// Mode is standard mode
+		ccr_value = pclk1 / (2 * pI2CHandle->I2C_Config.SCLSpeed);
+	} else {
+		// Mode is fast mode
+		tempreg |= (1 << I2C_CCR_FS);
+
+		if(pI2CHandle->I2C_Config.FMDutyCycle == I2C_FM_DUTY_2){
+			ccr_value = pclk1 / (3 * pI2CHandle->I2C_Config.SCLSpeed);
+		} else {
+			tempreg |= (1 << I2C_CCR_DUTY);
+			ccr_value = pclk1 / (25 * pI2CHandle->I2C_Config.SCLSpeed);
+		}
+	}
+	tempreg |= ccr_value & (0xFFF);
+	pI2CHandle->pI2Cx->CCR = tempreg;
+
+	// TRISE Configuration, max rise time 1000 ns (SM) or 300 ns (FM) in PCLK1 cycles, plus one
+	if(pI2CHandle->I2C_Config.SCLSpeed <= I2C_SCL_SPEED_SM){
+		tempreg = (pclk1 / 1000000U) + 1;
+	} else {
+		tempreg = (((pclk1 / 1000000U) * 300) / 1000U) + 1;
+	}
+
+	pI2CHandle->pI2Cx->TRISE = (tempreg & 0x3F);
+}
+
+static void I2C_ClockChangeHandle(RCC_ClockListener_t *pListener, const RCC_ClockTree_t *pClocks){
+	I2C_Handle_t *pI2CHandle = (I2C_Handle_t*)pListener->pParent;
+	uint32_t pe = pI2CHandle->pI2Cx->CR1 & (1 << I2C_CR1_PE);
+
+	// CCR and TRISE may only be written with the peripheral disabled
+	pI2CHandle->pI2Cx->CR1 &= ~(1 << I2C_CR1_PE);
+	I2C_ConfigClock(pI2CHandle, pClocks->PCLK1);
+	pI2CHandle->pI2Cx->CR1 |= pe;
+
+	// PE = 0 cleared ACK
+	if(pe && pI2CHandle->I2C_Config.AckControl == I2C_ACK_ENABLE)
+		I2C_ManageAcking(pI2CHandle->pI2Cx, I2C_ACK_ENABLE);
+}
+
+static uint8_t I2C_ClockBusy(RCC_ClockListener_t *pListener){
+	I2C_Handle_t *pI2CHandle = (I2C_Handle_t*)pListener->pParent;
+
+	// SR2 is not read here, that would clear a pending ADDR
+	if(pI2CHandle->TxRxState != I2C_READY || pI2CHandle->pJobHead != NULL)
+		return 1;
+
+	return 0;
+}
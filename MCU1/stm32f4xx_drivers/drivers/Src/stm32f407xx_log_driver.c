@@ -0,0 +1,155 @@
+/*
+ * stm32f407xx_log_driver.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#include "stm32f407xx.h"
+#include "stm32f407xx_log_driver.h"
+
+#define LOG_BUF_MASK		(LOG_BUF_WORDS - 1)
+
+/*
+ * Word ring shared by every producer
+ * logHead is advanced with LDREX/STREX to reserve a record, so producers of any
+ * priority need no lock. A record becomes visible when its header is written last.
+ * logTail is only written by LOG_Process, which zeroes every word it consumed.
+ * Kept in CCM RAM, the CPU is the only one accessing it.
+ */
+static __ccmram_bss __vo uint32_t logBuf[LOG_BUF_WORDS];
+static __ccmram_bss __vo uint32_t logHead;
+static __ccmram_bss __vo uint32_t logTail;
+
+// Records which did not fit, and how many of them have been reported
+static __vo uint32_t logDropped = 0;
+static uint32_t logDroppedSent = 0;
+
+// HELPER FUNCTION PROTOTYPES
+static uint8_t log_itm_enabled(void);
+static void log_itm_send(uint32_t word);
+
+/*****************************************************************
+ * @fn			- LOG_Init
+ *
+ * @brief		- Enables the ITM and the stimulus port of the log stream
+ *
+ * @return		- none
+ *
+ * @Note		- The SWO pin and its baud rate (TPIU) are set up by the debugger when
+ * 				  SWV is enabled, with HCLK as core clock. Without a debugger nothing
+ * 				  would empty the ITM FIFO, the ITM is left off and the records are
+ * 				  drained and thrown away.
+ */
+void LOG_Init(void){
+	if(!(*CORE_DHCSR & (1 << CORE_DHCSR_C_DEBUGEN)))
+		return;
+
+	*CORE_DEMCR |= (1 << CORE_DEMCR_TRCENA);
+
+	*ITM_LAR = ITM_LAR_KEY;
+	*ITM_TCR |= (1 << ITM_TCR_ITMENA);
+	*ITM_TER |= (1UL << LOG_ITM_PORT);
+}
+
+/*****************************************************************
+ * @fn			- LOG_Write
+ *
+ * @brief		- Stores one record, used by LOG_PRINT
+ *
+ * @param[in]	- Format ID (address of the format string)
+ * @param[in]	- Number of arguments
+ * @param[in]	- Arguments
+ *
+ * @return		- none
+ *
+ * @Note		- Never blocks. If the buffer is full the record is counted as dropped.
+ */
+void LOG_Write(uint32_t id, uint32_t nargs, const uint32_t *pArgs){
+	uint32_t head, len = nargs + 1;
+
+	// 1. Reserve len words, retried if another context reserved in between
+	do{
+		head = logHead;
+		if((head - logTail) + len > LOG_BUF_WORDS){
+			__atomic_fetch_add(&logDropped, 1, __ATOMIC_RELAXED);
+			return;
+		}
+	} while(!__atomic_compare_exchange_n(&logHead, &head, head + len, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	// 2. Arguments, then the header which publishes the record
+	for(uint32_t i = 0; i < nargs; i++)
+		logBuf[(head + 1 + i) & LOG_BUF_MASK] = pArgs[i];
+
+	MEM_Barrier();
+	logBuf[head & LOG_BUF_MASK] = LOG_HDR_VALID | (nargs << LOG_HDR_NARGS) | (id & LOG_HDR_ID_MASK);
+}
+
+/*****************************************************************
+ * @fn			- LOG_Process
+ *
+ * @brief		- Sends the buffered records over ITM
+ *
+ * @return		- none
+ *
+ * @Note		- Single consumer: call from one context only (main loop or a deferred
+ * 				  work handler). Stops at the first record still being written.
+ * 				  Every word goes out as one 32-bit stimulus write.
+ */
+void LOG_Process(void){
+	uint32_t tail, hdr, nargs, dropped;
+	uint8_t itm = log_itm_enabled();
+
+	while(1){
+		tail = logTail;
+		hdr = logBuf[tail & LOG_BUF_MASK];
+		if(!(hdr & LOG_HDR_VALID))
+			break;
+		MEM_Barrier();
+
+		nargs = (hdr >> LOG_HDR_NARGS) & 0x7;
+
+		for(uint32_t i = 0; i <= nargs; i++){
+			if(itm)
+				log_itm_send(logBuf[(tail + i) & LOG_BUF_MASK]);
+			// A stale word could pass for a header once the ring wraps
+			logBuf[(tail + i) & LOG_BUF_MASK] = 0;
+		}
+
+		MEM_Barrier();
+		logTail = tail + 1 + nargs;
+	}
+
+	dropped = logDropped;
+	if(dropped != logDroppedSent){
+		if(itm){
+			log_itm_send(LOG_HDR_VALID | (1UL << LOG_HDR_NARGS) | LOG_ID_DROPPED);
+			log_itm_send(dropped - logDroppedSent);
+		}
+		logDroppedSent = dropped;
+	}
+}
+
+/*****************************************************************
+ * @fn			- LOG_GetDropped
+ *
+ * @brief		- Returns how many records did not fit into the buffer
+ *
+ * @return		- Number of dropped records since start-up
+ *
+ * @Note		- none
+ */
+uint32_t LOG_GetDropped(void){
+	return logDropped;
+}
+
+static uint8_t log_itm_enabled(void){
+	// A stimulus port of a disabled ITM never reports ready
+	return ((*ITM_TCR & (1 << ITM_TCR_ITMENA)) && (*ITM_TER & (1UL << LOG_ITM_PORT))) ? 1 : 0;
+}
+
+static void log_itm_send(uint32_t word){
+	// Bit 0 reads 1 while the stimulus FIFO can take another write
+	while(!(*ITM_STIM(LOG_ITM_PORT) & 1));
+	*ITM_STIM(LOG_ITM_PORT) = word;
+}
@@ -0,0 +1,359 @@
+/*
+ * stm32f407xx_nvic_driver.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#include "stm32f407xx.h"
+#include "stm32f407xx_nvic_driver.h"
+
+/*
+ * SRAM copy of the vector table for NVIC_RelocateVectorTable
+ * VTOR needs the table aligned to its size rounded up to a power of two (392 -> 512 bytes)
+ */
+static uint32_t nvicRamVectors[NVIC_NUM_VECTORS] __attribute__((aligned(512)));
+
+/*
+ * Handler and context of every IRQ bound with NVIC_IRQBind, read by nvic_dispatch.
+ * Kept in CCM RAM, only the CPU reads it and the lookup never waits behind DMA.
+ */
+typedef struct{
+	NVIC_IRQHandler_t	Handler;
+	void				*pContext;
+}NVIC_Binding_t;
+
+static __ccmram_bss NVIC_Binding_t nvicBindings[NVIC_NUM_IRQS];
+
+// Vector table of the startup code, bound IRQs get their entry back from it
+extern const uint32_t g_pfnVectors[];
+
+// HELPER FUNCTION PROTOTYPES
+static void nvic_dispatch(void);
+
+/*****************************************************************
+ * @fn			- NVIC_IRQInterruptConfig
+ *
+ * @brief		- Enables or disables an interrupt in the NVIC
+ *
+ * @param[in]	- IRQ Number
+ * @param[in]	- ENABLE or DISABLE
+ *
+ * @return		- none
+ *
+ * @Note		- ISER/ICER are write-one registers, zero bits have no effect, so a single
+ * 				  store is enough and other interrupts are never touched
+ */
+void NVIC_IRQInterruptConfig(uint8_t IRQNumber, uint8_t EnorDi){
+	if(EnorDi == ENABLE)
+		NVIC->ISER[IRQNumber >> 5] = (1UL << (IRQNumber & 0x1F));
+	else
+		NVIC->ICER[IRQNumber >> 5] = (1UL << (IRQNumber & 0x1F));
+}
+
+/*****************************************************************
+ * @fn			- NVIC_IRQPriorityConfig
+ *
+ * @brief		- Sets the priority of an interrupt
+ *
+ * @param[in]	- IRQ Number
+ * @param[in]	- IRQ Priority to set from 0-15, see NVIC_EncodePriority
+ *
+ * @return		- none
+ *
+ * @Note		- The priority registers are byte accessible, one store replaces the old
+ * 				  value without touching the three neighbouring IRQs
+ */
+void NVIC_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority){
+	NVIC->IP[IRQNumber] = (uint8_t)(IRQPriority << (8 - NO_PRIORITY_BITS_IMPLEMENTED));
+}
+
+/*****************************************************************
+ * @fn			- NVIC_GetPriority
+ *
+ * @brief		- Reads back the priority of an interrupt
+ *
+ * @param[in]	- IRQ Number
+ *
+ * @return		- IRQ Priority from 0-15
+ *
+ * @Note		- none
+ */
+uint32_t NVIC_GetPriority(uint8_t IRQNumber){
+	return NVIC->IP[IRQNumber] >> (8 - NO_PRIORITY_BITS_IMPLEMENTED);
+}
+
+/*****************************************************************
+ * @fn			- NVIC_SetPriorityGrouping
+ *
+ * @brief		- Splits the priority bits into preempt and sub-priority
+ *
+ * @param[in]	- Priority group, possible values from @PriorityGroup
+ *
+ * @return		- none
+ *
+ * @Note		- Set it once at start-up before any priority is assigned, the meaning
+ * 				  of every programmed priority changes with it
+ */
+void NVIC_SetPriorityGrouping(uint8_t PriorityGroup){
+	uint32_t tempreg = *SCB_AIRCR;
+
+	// The key must accompany every write, it reads back as something else
+	tempreg &= ~((0xFFFFUL << SCB_AIRCR_VECTKEY) | (0b111 << SCB_AIRCR_PRIGROUP));
+	tempreg |= (SCB_AIRCR_VECTKEY_VALUE << SCB_AIRCR_VECTKEY);
+	tempreg |= ((PriorityGroup & 0b111) << SCB_AIRCR_PRIGROUP);
+	*SCB_AIRCR = tempreg;
+}
+
+/*****************************************************************
+ * @fn			- NVIC_GetPriorityGrouping
+ *
+ * @brief		- Returns the current priority grouping
+ *
+ * @return		- Priority group, possible values from @PriorityGroup
+ *
+ * @Note		- Values below NVIC_PRIGROUP_4_0 behave like NVIC_PRIGROUP_4_0
+ */
+uint8_t NVIC_GetPriorityGrouping(void){
+	return (*SCB_AIRCR >> SCB_AIRCR_PRIGROUP) & 0b111;
+}
+
+/*****************************************************************
+ * @fn			- NVIC_EncodePriority
+ *
+ * @brief		- Builds an IRQ priority from preempt and sub-priority for the current grouping
+ *
+ * @param[in]	- Preempt priority, lower numbers interrupt higher ones
+ * @param[in]	- Sub-priority, orders pending IRQs of the same preempt priority
+ *
+ * @return		- IRQ Priority from 0-15 for NVIC_IRQPriorityConfig
+ *
+ * @Note		- Values which do not fit the grouping are truncated
+ */
+uint32_t NVIC_EncodePriority(uint32_t PreemptPriority, uint32_t SubPriority){
+	uint32_t group = NVIC_GetPriorityGrouping();
+	uint32_t subBits, preemptBits;
+
+	// PRIGROUP counts the sub-priority bits of the full 8-bit field, only the top ones exist
+	subBits = (group + 1 > (8 - NO_PRIORITY_BITS_IMPLEMENTED)) ? (group + 1 - (8 - NO_PRIORITY_BITS_IMPLEMENTED)) : 0;
+	preemptBits = NO_PRIORITY_BITS_IMPLEMENTED - subBits;
+
+	return ((PreemptPriority & ((1UL << preemptBits) - 1)) << subBits) |
+			(SubPriority & ((1UL << subBits) - 1));
+}
+
+/*****************************************************************
+ * @fn			- NVIC_SetPending
+ *
+ * @brief		- Marks an interrupt pending, it is taken as soon as its priority allows
+ *
+ * @param[in]	- IRQ Number
+ *
+ * @return		- none
+ *
+ * @Note		- Software trigger, also works while the IRQ is disabled (it then waits)
+ */
+void NVIC_SetPending(uint8_t IRQNumber){
+	NVIC->ISPR[IRQNumber >> 5] = (1UL << (IRQNumber & 0x1F));
+}
+
+/*****************************************************************
+ * @fn			- NVIC_ClearPending
+ *
+ * @brief		- Removes a pending interrupt which has not been taken yet
+ *
+ * @param[in]	- IRQ Number
+ *
+ * @return		- none
+ *
+ * @Note		- A peripheral still holding its request sets it pending again
+ */
+void NVIC_ClearPending(uint8_t IRQNumber){
+	NVIC->ICPR[IRQNumber >> 5] = (1UL << (IRQNumber & 0x1F));
+}
+
+/*****************************************************************
+ * @fn			- NVIC_GetPending
+ *
+ * @brief		- Checks whether an interrupt is pending
+ *
+ * @param[in]	- IRQ Number
+ *
+ * @return		- 1 if pending, 0 otherwise
+ *
+ * @Note		- none
+ */
+uint8_t NVIC_GetPending(uint8_t IRQNumber){
+	return (NVIC->ISPR[IRQNumber >> 5] >> (IRQNumber & 0x1F)) & 1;
+}
+
+/*****************************************************************
+ * @fn			- NVIC_GetActive
+ *
+ * @brief		- Checks whether an interrupt handler is running or has been preempted
+ *
+ * @param[in]	- IRQ Number
+ *
+ * @return		- 1 if active, 0 otherwise
+ *
+ * @Note		- none
+ */
+uint8_t NVIC_GetActive(uint8_t IRQNumber){
+	return (NVIC->IABR[IRQNumber >> 5] >> (IRQNumber & 0x1F)) & 1;
+}
+
+/*****************************************************************
+ * @fn			- NVIC_RelocateVectorTable
+ *
+ * @brief		- Copies the active vector table to SRAM and points VTOR at the copy
+ *
+ * @return		- none
+ *
+ * @Note		- Vector fetches then no longer wait for flash, which matters at high
+ * 				  HCLK with flash wait states and the ART caches cold. Handlers added to
+ * 				  the flash table afterwards are not seen. Does nothing if the SRAM table
+ * 				  is already active.
+ */
+void NVIC_RelocateVectorTable(void){
+	const uint32_t *pTable = NVIC_GetVectorTable();
+	uint32_t primask;
+
+	if(pTable == nvicRamVectors)
+		return;
+
+	primask = IRQ_SaveAndDisable();
+
+	for(uint32_t i = 0; i < NVIC_NUM_VECTORS; i++)
+		nvicRamVectors[i] = pTable[i];
+
+	NVIC_SetVectorTable(nvicRamVectors);
+
+	IRQ_Restore(primask);
+}
+
+/*****************************************************************
+ * @fn			- NVIC_SetVectorTable
+ *
+ * @brief		- Points VTOR at a vector table
+ *
+ * @param[in]	- Table of NVIC_NUM_VECTORS entries, 512 byte aligned
+ *
+ * @return		- none
+ *
+ * @Note		- Pass (const uint32_t*)FLASH_BASEADDR to go back to the table of the
+ * 				  startup code
+ */
+void NVIC_SetVectorTable(const uint32_t *pTable){
+	// The table must be complete before an exception can fetch from it
+	MEM_Barrier();
+	*SCB_VTOR = (uint32_t)pTable;
+	__asm volatile ("dsb" ::: "memory");
+}
+
+/*****************************************************************
+ * @fn			- NVIC_GetVectorTable
+ *
+ * @brief		- Returns the vector table in use
+ *
+ * @return		- Pointer to the first entry (initial stack pointer)
+ *
+ * @Note		- A VTOR of 0 is the boot alias of flash, FLASH_BASEADDR is returned
+ * 				  for it
+ */
+const uint32_t *NVIC_GetVectorTable(void){
+	uint32_t vtor = *SCB_VTOR;
+
+	if(vtor == 0)
+		vtor = FLASH_BASEADDR;
+
+	return (const uint32_t*)vtor;
+}
+
+/*****************************************************************
+ * @fn			- NVIC_IRQBind
+ *
+ * @brief		- Routes an IRQ to a handler with a context pointer
+ *
+ * @param[in]	- IRQ Number
+ * @param[in]	- Handler, gets the context as its argument
+ * @param[in]	- Context, e.g. the driver handle
+ *
+ * @return		- NVIC_OK, or NVIC_ERR_IRQ for an IRQ number the device does not have
+ * 				  or a NULL handler
+ *
+ * @Note		- Moves the vector table to SRAM first (NVIC_RelocateVectorTable) and
+ * 				  points the IRQ's entry at a shared dispatcher. It reads the active IRQ
+ * 				  from IPSR and tail-calls the handler, so the handle can live anywhere
+ * 				  and no <name>_IRQHandler forwarding function is needed. Bindings stop
+ * 				  working if another table is selected with NVIC_SetVectorTable.
+ * 				  The IRQ may be enabled, it switches with interrupts masked.
+ */
+uint8_t NVIC_IRQBind(uint8_t IRQNumber, NVIC_IRQHandler_t Handler, void *pContext){
+	uint32_t primask;
+
+	if(IRQNumber >= NVIC_NUM_IRQS || Handler == NULL)
+		return NVIC_ERR_IRQ;
+
+	NVIC_RelocateVectorTable();
+
+	primask = IRQ_SaveAndDisable();
+
+	nvicBindings[IRQNumber].Handler = Handler;
+	nvicBindings[IRQNumber].pContext = pContext;
+
+	// The binding must be complete before the vector can lead to it
+	MEM_Barrier();
+	nvicRamVectors[16 + IRQNumber] = (uint32_t)nvic_dispatch;
+	__asm volatile ("dsb" ::: "memory");
+
+	IRQ_Restore(primask);
+
+	return NVIC_OK;
+}
+
+/*****************************************************************
+ * @fn			- NVIC_IRQUnbind
+ *
+ * @brief		- Gives an IRQ its handler from the startup vector table back
+ *
+ * @param[in]	- IRQ Number
+ *
+ * @return		- NVIC_OK, or NVIC_ERR_IRQ for an IRQ number the device does not have
+ *
+ * @Note		- Usually Default_Handler or a <name>_IRQHandler of the application.
+ * 				  Disable the IRQ first if neither should run.
+ */
+uint8_t NVIC_IRQUnbind(uint8_t IRQNumber){
+	uint32_t primask;
+
+	if(IRQNumber >= NVIC_NUM_IRQS)
+		return NVIC_ERR_IRQ;
+
+	primask = IRQ_SaveAndDisable();
+
+	if(NVIC_GetVectorTable() == nvicRamVectors){
+		nvicRamVectors[16 + IRQNumber] = g_pfnVectors[16 + IRQNumber];
+		__asm volatile ("dsb" ::: "memory");
+	}
+
+	nvicBindings[IRQNumber].Handler = NULL;
+	nvicBindings[IRQNumber].pContext = NULL;
+
+	IRQ_Restore(primask);
+
+	return NVIC_OK;
+}
+
+/*
+ * Vector of every bound IRQ. IPSR holds the exception number, 16 + IRQ number.
+ * Compiles to a few loads and a branch (sibling call) when optimized, without a stack frame.
+ */
+static __isr_ramfunc void nvic_dispatch(void){
+	uint32_t ipsr;
+	NVIC_Binding_t *pBinding;
+
+	__asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+	pBinding = &nvicBindings[(ipsr & 0x1FF) - 16];
+
+	pBinding->Handler(pBinding->pContext);
+}
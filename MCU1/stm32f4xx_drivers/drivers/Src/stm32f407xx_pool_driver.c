@@ -0,0 +1,284 @@
+/*
+ * stm32f407xx_pool_driver.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#include "stm32f407xx.h"
+#include "stm32f407xx_pool_driver.h"
+#include <stdio.h>
+
+// Backing memory of the built-in size classes
+static POOL_SECTION POOL_MEMORY(poolMem0, POOL_CLASS0_SIZE, POOL_CLASS0_BLOCKS);
+static POOL_SECTION POOL_MEMORY(poolMem1, POOL_CLASS1_SIZE, POOL_CLASS1_BLOCKS);
+static POOL_SECTION POOL_MEMORY(poolMem2, POOL_CLASS2_SIZE, POOL_CLASS2_BLOCKS);
+static POOL_SECTION POOL_MEMORY(poolMem3, POOL_CLASS3_SIZE, POOL_CLASS3_BLOCKS);
+
+static POOL_Handle_t poolClasses[POOL_NUM_CLASSES];
+
+// HELPER FUNCTION PROTOTYPES
+static void pool_dump_pool(POOL_Handle_t *pPool);
+#if POOL_DEBUG
+static uint8_t pool_mark(POOL_Handle_t *pPool, void *pBlock, uint8_t inUse);
+#endif
+
+/*****************************************************************
+ * @fn			- POOL_Init
+ *
+ * @brief		- Splits a memory area into equal blocks and links them as free
+ *
+ * @param[in]	- Pointer to pool
+ * @param[in]	- Word-aligned memory, at least NumBlocks blocks long (see POOL_MEMORY)
+ * @param[in]	- Block size in bytes, rounded up to a multiple of 4
+ * @param[in]	- Number of blocks
+ *
+ * @return		- none
+ *
+ * @Note		- The pool must not be in use
+ */
+void POOL_Init(POOL_Handle_t *pPool, void *pMem, uint16_t BlockSize, uint16_t NumBlocks){
+	uint8_t *pBlock;
+
+	pPool->BlockSize = POOL_BLOCK_SIZE(BlockSize);
+	pPool->NumBlocks = NumBlocks;
+	pPool->pStart = (uint8_t*)pMem;
+	pPool->pEnd = pPool->pStart + (uint32_t)pPool->BlockSize * NumBlocks;
+
+	pPool->pFree = NULL;
+	for(pBlock = pPool->pEnd; pBlock > pPool->pStart; ){
+		pBlock -= pPool->BlockSize;
+		*(void**)pBlock = pPool->pFree;
+		pPool->pFree = pBlock;
+	}
+
+	pPool->Used = 0;
+	pPool->HighWater = 0;
+	pPool->Failures = 0;
+	pPool->BadFrees = 0;
+#if POOL_DEBUG
+	for(uint32_t i = 0; i < sizeof(pPool->InUse) / sizeof(pPool->InUse[0]); i++)
+		pPool->InUse[i] = 0;
+#endif
+}
+
+/*****************************************************************
+ * @fn			- POOL_Alloc
+ *
+ * @brief		- Takes one block from a pool
+ *
+ * @param[in]	- Pointer to pool
+ *
+ * @return		- Block, or NULL if the pool is empty
+ *
+ * @Note		- Constant time, interrupts are masked for a few instructions
+ */
+void *POOL_Alloc(POOL_Handle_t *pPool){
+	void *pBlock;
+	uint32_t primask = IRQ_SaveAndDisable();
+
+	pBlock = pPool->pFree;
+	if(pBlock != NULL){
+		pPool->pFree = *(void**)pBlock;
+		if(++pPool->Used > pPool->HighWater)
+			pPool->HighWater = pPool->Used;
+#if POOL_DEBUG
+		pool_mark(pPool, pBlock, 1);
+#endif
+	} else {
+		pPool->Failures++;
+	}
+
+	IRQ_Restore(primask);
+
+	return pBlock;
+}
+
+/*****************************************************************
+ * @fn			- POOL_Free
+ *
+ * @brief		- Gives a block back to its pool
+ *
+ * @param[in]	- Pointer to pool
+ * @param[in]	- Block from POOL_Alloc of the same pool
+ *
+ * @return		- none
+ *
+ * @Note		- NULL is ignored. Pointers outside the pool or not at a block boundary, and
+ * 				  frees with no block handed out, are refused and counted in BadFrees. With
+ * 				  POOL_DEBUG a block which is already free is refused as well.
+ */
+void POOL_Free(POOL_Handle_t *pPool, void *pBlock){
+	uint32_t primask;
+
+	if(pBlock == NULL)
+		return;
+
+	primask = IRQ_SaveAndDisable();
+
+	// Range and block alignment, then Used must not wrap: with no block out, this is a double free
+	if(!POOL_Owns(pPool, pBlock) || pPool->Used == 0){
+		pPool->BadFrees++;
+		IRQ_Restore(primask);
+		return;
+	}
+
+#if POOL_DEBUG
+	if(!pool_mark(pPool, pBlock, 0)){
+		pPool->BadFrees++;
+		IRQ_Restore(primask);
+		return;
+	}
+#endif
+
+	*(void**)pBlock = pPool->pFree;
+	pPool->pFree = pBlock;
+	pPool->Used--;
+
+	IRQ_Restore(primask);
+}
+
+/*****************************************************************
+ * @fn			- POOL_Owns
+ *
+ * @brief		- Tells whether a pointer is the start of a block of a pool
+ *
+ * @param[in]	- Pointer to pool
+ * @param[in]	- Pointer to check
+ *
+ * @return		- 1 if it is, else 0
+ *
+ * @Note		- none
+ */
+uint8_t POOL_Owns(POOL_Handle_t *pPool, void *pBlock){
+	uint8_t *p = (uint8_t*)pBlock;
+
+	if(p < pPool->pStart || p >= pPool->pEnd)
+		return 0;
+
+	return ((uint32_t)(p - pPool->pStart) % pPool->BlockSize) == 0;
+}
+
+/*****************************************************************
+ * @fn			- POOL_ClassesInit
+ *
+ * @brief		- Sets up the built-in size classes used by POOL_Malloc
+ *
+ * @return		- none
+ *
+ * @Note		- Call once at start-up, before the first POOL_Malloc
+ */
+void POOL_ClassesInit(void){
+	POOL_Init(&poolClasses[0], poolMem0, POOL_CLASS0_SIZE, POOL_CLASS0_BLOCKS);
+	POOL_Init(&poolClasses[1], poolMem1, POOL_CLASS1_SIZE, POOL_CLASS1_BLOCKS);
+	POOL_Init(&poolClasses[2], poolMem2, POOL_CLASS2_SIZE, POOL_CLASS2_BLOCKS);
+	POOL_Init(&poolClasses[3], poolMem3, POOL_CLASS3_SIZE, POOL_CLASS3_BLOCKS);
+}
+
+/*****************************************************************
+ * @fn			- POOL_Malloc
+ *
+ * @brief		- Allocates a block of at least size bytes from the size classes
+ *
+ * @param[in]	- Size in bytes
+ *
+ * @return		- Block, or NULL if no class has a free block large enough
+ *
+ * @Note		- Takes the smallest class which fits, a larger one if that class is
+ * 				  empty. At most POOL_NUM_CLASSES pools are tried.
+ */
+void *POOL_Malloc(uint32_t size){
+	void *pBlock;
+
+	for(uint8_t i = 0; i < POOL_NUM_CLASSES; i++){
+		if(poolClasses[i].BlockSize < size)
+			continue;
+
+		pBlock = POOL_Alloc(&poolClasses[i]);
+		if(pBlock != NULL)
+			return pBlock;
+	}
+
+	return NULL;
+}
+
+/*****************************************************************
+ * @fn			- POOL_Release
+ *
+ * @brief		- Gives a block from POOL_Malloc back to its size class
+ *
+ * @param[in]	- Block, NULL is ignored
+ *
+ * @return		- none
+ *
+ * @Note		- none
+ */
+void POOL_Release(void *pBlock){
+	for(uint8_t i = 0; i < POOL_NUM_CLASSES; i++){
+		if(POOL_Owns(&poolClasses[i], pBlock)){
+			POOL_Free(&poolClasses[i], pBlock);
+			return;
+		}
+	}
+}
+
+/*****************************************************************
+ * @fn			- POOL_GetClass
+ *
+ * @brief		- Returns one of the built-in size classes, e.g. for its counters
+ *
+ * @param[in]	- Class index from 0 to POOL_NUM_CLASSES - 1
+ *
+ * @return		- Pointer to the pool, NULL for an invalid index
+ *
+ * @Note		- none
+ */
+POOL_Handle_t *POOL_GetClass(uint8_t Class){
+	if(Class >= POOL_NUM_CLASSES)
+		return NULL;
+
+	return &poolClasses[Class];
+}
+
+/*****************************************************************
+ * @fn			- POOL_Dump
+ *
+ * @brief		- Prints the usage of every size class
+ *
+ * @return		- none
+ *
+ * @Note		- Uses printf, call from thread mode
+ */
+void POOL_Dump(void){
+	for(uint8_t i = 0; i < POOL_NUM_CLASSES; i++)
+		pool_dump_pool(&poolClasses[i]);
+}
+
+static void pool_dump_pool(POOL_Handle_t *pPool){
+	printf("%4u B: %u/%u used, high water %u, failures %lu, bad frees %lu\n",
+			pPool->BlockSize, pPool->Used, pPool->NumBlocks, pPool->HighWater, pPool->Failures,
+			pPool->BadFrees);
+}
+
+#if POOL_DEBUG
+// Sets the in-use bit of a block, returns 0 if it already had that value (untracked blocks pass)
+static uint8_t pool_mark(POOL_Handle_t *pPool, void *pBlock, uint8_t inUse){
+	uint32_t index = (uint32_t)((uint8_t*)pBlock - pPool->pStart) / pPool->BlockSize;
+	uint32_t bit = 1UL << (index % 32);
+	uint32_t *pWord;
+
+	if(index >= POOL_DEBUG_MAX_BLOCKS)
+		return 1;
+	pWord = &pPool->InUse[index / 32];
+
+	if(((*pWord & bit) != 0) == inUse)
+		return 0;
+
+	if(inUse)
+		*pWord |= bit;
+	else
+		*pWord &= ~bit;
+
+	return 1;
+}
+#endif
@@ -0,0 +1,263 @@
+/*
+ * stm32f407xx_prof_driver.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#include "stm32f407xx.h"
+#include "stm32f407xx_prof_driver.h"
+#include <stdio.h>
+
+// Every probe which shows up in PROF_Dump
+static PROF_Probe_t *profProbes = NULL;
+
+// Cycles of two back-to-back CYCCNT reads, taken off every sample
+static uint32_t profOverhead = 0;
+
+#if PROF_IRQ_INSTRUMENTATION
+PROF_IRQProbe_t PROF_SPI_IRQProbe;
+PROF_IRQProbe_t PROF_I2C_EV_IRQProbe;
+PROF_IRQProbe_t PROF_I2C_ER_IRQProbe;
+PROF_IRQProbe_t PROF_USART_IRQProbe;
+PROF_IRQProbe_t PROF_DMA_IRQProbe;
+#endif
+
+// HELPER FUNCTION PROTOTYPES
+static uint8_t prof_bucket(uint32_t cycles);
+static void prof_dump_probe(PROF_Probe_t *pProbe);
+
+/*****************************************************************
+ * @fn			- PROF_Init
+ *
+ * @brief		- Starts the DWT cycle counter and measures the probe overhead
+ *
+ * @return		- none
+ *
+ * @Note		- With PROF_IRQ_INSTRUMENTATION the driver IRQ handler probes are
+ * 				  registered here. Samples are core clock cycles, they get longer in
+ * 				  time when HCLK is lowered.
+ */
+void PROF_Init(void){
+	uint32_t start;
+
+	*CORE_DEMCR |= (1 << CORE_DEMCR_TRCENA);
+	*CORE_DWT_CTRL |= (1 << CORE_DWT_CTRL_CYCCNTENA);
+
+	start = *CORE_DWT_CYCCNT;
+	profOverhead = *CORE_DWT_CYCCNT - start;
+
+#if PROF_IRQ_INSTRUMENTATION
+	PROF_IRQProbeInit(&PROF_SPI_IRQProbe, "SPI_IRQHandling", "SPI_IRQHandling latency");
+	PROF_IRQProbeInit(&PROF_I2C_EV_IRQProbe, "I2C_EV_IRQHandling", "I2C_EV_IRQHandling latency");
+	PROF_IRQProbeInit(&PROF_I2C_ER_IRQProbe, "I2C_ER_IRQHandling", "I2C_ER_IRQHandling latency");
+	PROF_IRQProbeInit(&PROF_USART_IRQProbe, "USART_IRQHandling", "USART_IRQHandling latency");
+	PROF_IRQProbeInit(&PROF_DMA_IRQProbe, "DMA_IRQHandling", "DMA_IRQHandling latency");
+#endif
+}
+
+/*****************************************************************
+ * @fn			- PROF_ProbeInit
+ *
+ * @brief		- Clears a probe and adds it to the dump list
+ *
+ * @param[in]	- Pointer to probe
+ * @param[in]	- Name printed by PROF_Dump
+ *
+ * @return		- none
+ *
+ * @Note		- Calling it again for the same probe only clears it
+ */
+void PROF_ProbeInit(PROF_Probe_t *pProbe, const char *pName){
+	PROF_Probe_t *pIter;
+
+	pProbe->pName = pName;
+	PROF_Reset(pProbe);
+
+	for(pIter = profProbes; pIter != NULL; pIter = pIter->pNext)
+		if(pIter == pProbe)
+			return;
+
+	// Append, so the dump comes out in registration order
+	pProbe->pNext = NULL;
+	if(profProbes == NULL){
+		profProbes = pProbe;
+	} else {
+		for(pIter = profProbes; pIter->pNext != NULL; pIter = pIter->pNext);
+		pIter->pNext = pProbe;
+	}
+}
+
+/*****************************************************************
+ * @fn			- PROF_IRQProbeInit
+ *
+ * @brief		- Prepares the duration and latency probes of an interrupt handler
+ *
+ * @param[in]	- Pointer to IRQ probe
+ * @param[in]	- Name of the duration probe
+ * @param[in]	- Name of the latency probe
+ *
+ * @return		- none
+ *
+ * @Note		- none
+ */
+void PROF_IRQProbeInit(PROF_IRQProbe_t *pProbe, const char *pName, const char *pLatencyName){
+	pProbe->Triggered = 0;
+	PROF_ProbeInit(&pProbe->Duration, pName);
+	PROF_ProbeInit(&pProbe->Latency, pLatencyName);
+}
+
+/*****************************************************************
+ * @fn			- PROF_Reset
+ *
+ * @brief		- Drops the samples of a probe
+ *
+ * @param[in]	- Pointer to probe
+ *
+ * @return		- none
+ *
+ * @Note		- none
+ */
+void PROF_Reset(PROF_Probe_t *pProbe){
+	uint32_t primask = IRQ_SaveAndDisable();
+
+	pProbe->Count = 0;
+	pProbe->Min = 0xFFFFFFFF;
+	pProbe->Max = 0;
+	pProbe->Total = 0;
+	for(uint8_t i = 0; i < PROF_HIST_BUCKETS; i++)
+		pProbe->Hist[i] = 0;
+
+	IRQ_Restore(primask);
+}
+
+/*****************************************************************
+ * @fn			- PROF_ResetAll
+ *
+ * @brief		- Drops the samples of every registered probe
+ *
+ * @return		- none
+ *
+ * @Note		- none
+ */
+void PROF_ResetAll(void){
+	PROF_Probe_t *pIter;
+
+	for(pIter = profProbes; pIter != NULL; pIter = pIter->pNext)
+		PROF_Reset(pIter);
+}
+
+/*****************************************************************
+ * @fn			- PROF_Record
+ *
+ * @brief		- Adds one sample to a probe
+ *
+ * @param[in]	- Pointer to probe
+ * @param[in]	- Length of the sample in cycles, measurement overhead included
+ *
+ * @return		- none
+ *
+ * @Note		- Interrupt safe, a probe may be fed from several priorities
+ */
+__isr_ramfunc void PROF_Record(PROF_Probe_t *pProbe, uint32_t cycles){
+	uint32_t primask;
+
+	cycles = (cycles > profOverhead) ? (cycles - profOverhead) : 0;
+
+	primask = IRQ_SaveAndDisable();
+
+	pProbe->Count++;
+	pProbe->Total += cycles;
+	if(cycles < pProbe->Min)
+		pProbe->Min = cycles;
+	if(cycles > pProbe->Max)
+		pProbe->Max = cycles;
+	pProbe->Hist[prof_bucket(cycles)]++;
+
+	IRQ_Restore(primask);
+}
+
+/*****************************************************************
+ * @fn			- PROF_GetMean
+ *
+ * @brief		- Returns the average sample of a probe
+ *
+ * @param[in]	- Pointer to probe
+ *
+ * @return		- Mean in cycles, 0 without samples
+ *
+ * @Note		- none
+ */
+uint32_t PROF_GetMean(PROF_Probe_t *pProbe){
+	if(pProbe->Count == 0)
+		return 0;
+
+	return (uint32_t)(pProbe->Total / pProbe->Count);
+}
+
+/*****************************************************************
+ * @fn			- PROF_IRQTrigger
+ *
+ * @brief		- Pends an interrupt from software and arms its latency probe
+ *
+ * @param[in]	- Pointer to the IRQ probe of the handler
+ * @param[in]	- IRQ Number which runs that handler
+ *
+ * @return		- none
+ *
+ * @Note		- The handler finds no peripheral flag set and returns. Called regularly
+ * 				  (e.g. from a SYSTICK timer) while the application runs, the latency
+ * 				  histogram shows how long the IRQ waits behind masked sections and
+ * 				  higher priority handlers.
+ */
+void PROF_IRQTrigger(PROF_IRQProbe_t *pProbe, uint8_t IRQNumber){
+	pProbe->TriggerStamp = *CORE_DWT_CYCCNT;
+	pProbe->Triggered = 1;
+	NVIC_SetPending(IRQNumber);
+}
+
+/*****************************************************************
+ * @fn			- PROF_Dump
+ *
+ * @brief		- Prints every registered probe with its histogram
+ *
+ * @return		- none
+ *
+ * @Note		- Uses printf, call from the main loop only
+ */
+void PROF_Dump(void){
+	PROF_Probe_t *pIter;
+
+	printf("---- profile, %lu Hz core clock ----\n", RCC_GetHCLKValue());
+	for(pIter = profProbes; pIter != NULL; pIter = pIter->pNext)
+		prof_dump_probe(pIter);
+}
+
+static __isr_ramfunc uint8_t prof_bucket(uint32_t cycles){
+	if(cycles == 0)
+		return 0;
+	return 31 - __builtin_clz(cycles);
+}
+
+static void prof_dump_probe(PROF_Probe_t *pProbe){
+	PROF_Probe_t copy;
+	uint32_t primask;
+
+	// Snapshot, so that a handler running meanwhile does not tear the numbers
+	primask = IRQ_SaveAndDisable();
+	copy = *pProbe;
+	IRQ_Restore(primask);
+
+	if(copy.Count == 0){
+		printf("%s: no samples\n", copy.pName);
+		return;
+	}
+
+	printf("%s: n %lu, min %lu, max %lu, mean %lu cycles\n", copy.pName, copy.Count, copy.Min, copy.Max,
+			PROF_GetMean(&copy));
+
+	for(uint8_t i = 0; i < PROF_HIST_BUCKETS; i++){
+		if(copy.Hist[i])
+			printf("  %10lu..%-10lu %lu\n", (i == 0) ? 0UL : (1UL << i), (2UL << i) - 1, copy.Hist[i]);
+	}
+}
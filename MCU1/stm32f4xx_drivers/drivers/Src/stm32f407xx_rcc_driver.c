@@ -5,12 +5,52 @@
  *      Author: linkachu
  */
 
+#include "stm32f407xx.h"
 #include "stm32f407xx_rcc_driver.h"
 
 uint16_t AHBPrescaler[] = {2, 4, 8, 16, 64, 128, 256, 512};
 uint16_t APB1Prescaler[] = {2, 4, 8, 16};
 uint16_t APB2Prescaler[] = {2, 4, 8, 16};
 
+// Polling limit while waiting for an oscillator or the PLL to lock
+#define RCC_TIMEOUT		100000
+
+static uint32_t rcc_ahb_div(uint8_t hpre);
+static uint32_t rcc_apb_div(uint8_t ppre);
+static uint8_t rcc_wait_flag(uint32_t flag);
+static uint8_t rcc_pll_start(RCC_ClkConfig_t *pClkConfig);
+static uint8_t rcc_listeners_busy(void);
+static uint32_t rcc_cycles_now(void);
+
+// Bus frequencies as of the last RCC_UpdateClockTree
+static RCC_ClockTree_t rccClocks;
+static uint8_t rccClocksValid = 0;
+
+// Drivers to tell when rccClocks changes
+static RCC_ClockListener_t *rccListeners = NULL;
+
+// Polling limit while waiting for the drivers to finish their transfers
+#define RCC_IDLE_TIMEOUT	1000000
+
+// Operating points of RCC_SetPerformanceLevel, indexed by @PerformanceLevel
+static const RCC_ClkConfig_t rccPerfLevels[] = {
+	// HSI 16 MHz
+	{ RCC_CLK_SRC_HSI, RCC_PLL_SRC_HSE, 8, 336, 2, 7, RCC_AHB_DIV1, RCC_APB_DIV1, RCC_APB_DIV1, RCC_VOS_SCALE2 },
+	// HSE 8 MHz
+	{ RCC_CLK_SRC_HSE, RCC_PLL_SRC_HSE, 8, 336, 2, 7, RCC_AHB_DIV1, RCC_APB_DIV1, RCC_APB_DIV1, RCC_VOS_SCALE2 },
+	// PLL 84 MHz: VCO 336 MHz / 4, 48 MHz clock 336 / 7
+	{ RCC_CLK_SRC_PLL, RCC_PLL_SRC_HSE, 8, 336, 4, 7, RCC_AHB_DIV1, RCC_APB_DIV2, RCC_APB_DIV1, RCC_VOS_SCALE2 },
+	// PLL 120 MHz: VCO 240 MHz / 2, 48 MHz clock 240 / 5
+	{ RCC_CLK_SRC_PLL, RCC_PLL_SRC_HSE, 8, 240, 2, 5, RCC_AHB_DIV1, RCC_APB_DIV4, RCC_APB_DIV2, RCC_VOS_SCALE2 },
+	// PLL 168 MHz: VCO 336 MHz / 2, 48 MHz clock 336 / 7
+	{ RCC_CLK_SRC_PLL, RCC_PLL_SRC_HSE, 8, 336, 2, 7, RCC_AHB_DIV1, RCC_APB_DIV4, RCC_APB_DIV2, RCC_VOS_SCALE1 },
+};
+
+// Not known until the first RCC_GetPerformanceLevel: SystemInit runs ahead of the .data
+// copy and may stay on HSI, so the level it left is read back from the hardware
+#define RCC_PERF_UNKNOWN	0xFE
+static uint8_t rccPerfLevel = RCC_PERF_UNKNOWN;
+
 /*****************************************************************
  * @fn			- RCC_GetPCLK1Value
  *
@@ -18,91 +58,517 @@ uint16_t APB2Prescaler[] = {2, 4, 8, 16};
  *
  * @return		- APB1 Clock speed
  *
- * @Note		- none
+ * @Note		- Served from the clock tree cache
  */
 uint32_t RCC_GetPCLK1Value(void){
-	uint32_t pclk1, apb1p, ahbp, systemClk, temp;
+	return RCC_GetClockTree()->PCLK1;
+}
 
-	uint8_t clksrc;
-	clksrc = (RCC->CFGR >> 2) & 0b11;
+/*****************************************************************
+ * @fn			- RCC_GetPCLK2Value
+ *
+ * @brief		- This function retrieves the clock speed of the APB2 bus
+ *
+ * @return		- APB2 Clock speed
+ *
+ * @Note		- Served from the clock tree cache
+ */
+uint32_t RCC_GetPCLK2Value(void){
+	return RCC_GetClockTree()->PCLK2;
+}
+
+/*****************************************************************
+ * @fn			- RCC_GetSYSCLKValue
+ *
+ * @brief		- This function retrieves the system clock frequency
+ *
+ * @return		- SYSCLK in Hz
+ *
+ * @Note		- Served from the clock tree cache
+ */
+uint32_t RCC_GetSYSCLKValue(void){
+	return RCC_GetClockTree()->SYSCLK;
+}
+
+/*****************************************************************
+ * @fn			- RCC_GetHCLKValue
+ *
+ * @brief		- This function retrieves the clock speed of the AHB bus (core clock)
+ *
+ * @return		- HCLK in Hz
+ *
+ * @Note		- Served from the clock tree cache
+ */
+uint32_t RCC_GetHCLKValue(void){
+	return RCC_GetClockTree()->HCLK;
+}
+
+/*****************************************************************
+ * @fn			- RCC_GetClockTree
+ *
+ * @brief		- Returns the cached bus frequencies
+ *
+ * @return		- Pointer to the clock tree, valid for the lifetime of the program
+ *
+ * @Note		- The first call decodes RCC, later calls cost a load
+ */
+const RCC_ClockTree_t* RCC_GetClockTree(void){
+	if(!rccClocksValid)
+		RCC_UpdateClockTree();
+
+	return &rccClocks;
+}
+
+/*****************************************************************
+ * @fn			- RCC_UpdateClockTree
+ *
+ * @brief		- Decodes CFGR/PLLCFGR into the clock tree cache and notifies the
+ * 				  registered listeners if anything changed
+ *
+ * @return		- none
+ *
+ * @Note		- RCC_ConfigSystemClock calls this itself. Call it after touching
+ * 				  the RCC clock registers directly. Not from interrupt context.
+ */
+void RCC_UpdateClockTree(void){
+	RCC_ClockTree_t tree;
+	RCC_ClockListener_t *pListener;
+	uint32_t cfgr = RCC->CFGR;
+	uint8_t clksrc, changed;
+
+	// SWS tells which source is actually in use
+	clksrc = (cfgr >> RCC_CFGR_SWS) & 0b11;
 
 	// System clock is HSI
-	if(clksrc == 0){
-		systemClk = 16000000;
-	}
+	tree.SYSCLK = HSI_VALUE;
 	// System clock is HSE
-	else if(clksrc == 1){
-		systemClk = 8000000;
-	}
+	if(clksrc == RCC_CLK_SRC_HSE)
+		tree.SYSCLK = HSE_VALUE;
 	// System clock is PLL
-	else if (clksrc == 2){
-		// Not used in this course
-		// systemClk = RCC_GetPLLOutputClock();
+	else if(clksrc == RCC_CLK_SRC_PLL)
+		tree.SYSCLK = RCC_GetPLLOutputClock();
+
+	tree.HCLK = tree.SYSCLK / rcc_ahb_div((cfgr >> RCC_CFGR_HPRE) & 0b1111);
+	tree.PCLK1 = tree.HCLK / rcc_apb_div((cfgr >> RCC_CFGR_PPRE1) & 0b111);
+	tree.PCLK2 = tree.HCLK / rcc_apb_div((cfgr >> RCC_CFGR_PPRE2) & 0b111);
+
+	changed = rccClocksValid &&
+			(tree.SYSCLK != rccClocks.SYSCLK || tree.HCLK != rccClocks.HCLK ||
+			 tree.PCLK1 != rccClocks.PCLK1 || tree.PCLK2 != rccClocks.PCLK2);
+
+	rccClocks = tree;
+	rccClocksValid = 1;
+
+	if(changed){
+		for(pListener = rccListeners; pListener != NULL; pListener = pListener->pNext)
+			pListener->Callback(pListener, &rccClocks);
 	}
+}
 
-	//AHB Prescaler starts at the fourth bit
-	temp = (RCC->CFGR >> 4) & 0b1111;
-	if (temp < 0b1000)
-		ahbp = 1;
-	else
-		ahbp = AHBPrescaler[temp - 0b1000];
+/*****************************************************************
+ * @fn			- RCC_RegisterClockListener
+ *
+ * @brief		- Adds a listener which is called whenever the bus frequencies change
+ *
+ * @param[in]	- Pointer to listener, with Callback (and pParent) filled in
+ *
+ * @return		- none
+ *
+ * @Note		- The listener is linked in, it must stay valid until unregistered.
+ * 				  Drivers wrap this in X_ClockTrackingControl.
+ */
+void RCC_RegisterClockListener(RCC_ClockListener_t *pListener){
+	RCC_ClockListener_t *pIter;
 
-	//APB1 prescaler starts at 10th bit
-	temp = (RCC->CFGR >> 10) & 0b111;
-	if (temp < 0b100)
-		apb1p = 1;
+	// Registering twice would make the list circular
+	for(pIter = rccListeners; pIter != NULL; pIter = pIter->pNext)
+		if(pIter == pListener)
+			return;
+
+	pListener->pNext = rccListeners;
+	rccListeners = pListener;
+}
+
+/*****************************************************************
+ * @fn			- RCC_UnregisterClockListener
+ *
+ * @brief		- Removes a listener added with RCC_RegisterClockListener
+ *
+ * @param[in]	- Pointer to listener
+ *
+ * @return		- none
+ *
+ * @Note		- none
+ */
+void RCC_UnregisterClockListener(RCC_ClockListener_t *pListener){
+	RCC_ClockListener_t **ppIter;
+
+	for(ppIter = &rccListeners; *ppIter != NULL; ppIter = &(*ppIter)->pNext){
+		if(*ppIter == pListener){
+			*ppIter = pListener->pNext;
+			pListener->pNext = NULL;
+			return;
+		}
+	}
+}
+
+/*****************************************************************
+ * @fn			- RCC_GetPLLOutputClock
+ *
+ * @brief		- This function decodes PLLCFGR into the main PLL output frequency
+ *
+ * @return		- PLL output (P) clock in Hz
+ *
+ * @Note		- Valid whether or not the PLL is currently selected as SYSCLK
+ */
+uint32_t RCC_GetPLLOutputClock(void){
+	uint32_t pllcfgr = RCC->PLLCFGR;
+	uint32_t pllin, pllm, plln, pllp;
+
+	if(pllcfgr & (1 << RCC_PLLCFGR_PLLSRC))
+		pllin = HSE_VALUE;
 	else
-		apb1p = APB1Prescaler[temp - 0b100];
+		pllin = HSI_VALUE;
+
+	pllm = (pllcfgr >> RCC_PLLCFGR_PLLM) & 0x3F;
+	plln = (pllcfgr >> RCC_PLLCFGR_PLLN) & 0x1FF;
+	pllp = (((pllcfgr >> RCC_PLLCFGR_PLLP) & 0b11) + 1) * 2;
 
-	pclk1 = systemClk/(ahbp * apb1p);
+	if(pllm == 0)
+		return 0;
 
-	return pclk1;
+	// VCO input is a whole number of Hz for the usual crystal/PLLM pairs, so divide first
+	return ((pllin / pllm) * plln) / pllp;
 }
 
 /*****************************************************************
- * @fn			- RCC_GetPCLK2Value
+ * @fn			- RCC_ConfigSystemClock
  *
- * @brief		- This function retrieves the clock speed of the APB2 bus
+ * @brief		- Switches SYSCLK to a new source and sets the bus prescalers
  *
- * @return		- APB2 Clock speed
+ * @param[in]	- Pointer to clock configuration
  *
- * @Note		- none
+ * @return		- RCC_OK or one of the RCC_ERR_x codes, nothing is touched on RCC_ERR_CONFIG
+ *
+ * @Note		- Order: limits check, oscillators, regulator scale and flash latency up,
+ * 				  PLL (re)programming with SYSCLK parked on HSI (skipped when it is
+ * 				  already locked with the same factors), prescalers and switch,
+ * 				  then latency and scale down. Wait states follow FLASH_SetVoltageRange and
+ * 				  the accelerator setting of FLASH_AcceleratorControl is re-applied.
+ * 				  Drivers with clock tracking enabled re-tune their dividers from the
+ * 				  listener callbacks, other peripherals have to be re-initialized.
  */
-uint32_t RCC_GetPCLK2Value(void){
-	uint32_t pclk2, apb2p, ahbp, systemClk, temp;
+uint8_t RCC_ConfigSystemClock(RCC_ClkConfig_t *pClkConfig){
+	uint32_t sysclk, hclk, vcoin, vco, tempreg;
+	uint8_t latency, curLatency;
+
+	// 1. Target frequencies, checked against the device limits
+	if(pClkConfig->ClockSource == RCC_CLK_SRC_HSI){
+		sysclk = HSI_VALUE;
+	} else if(pClkConfig->ClockSource == RCC_CLK_SRC_HSE){
+		sysclk = HSE_VALUE;
+	} else if(pClkConfig->ClockSource == RCC_CLK_SRC_PLL){
+		if(pClkConfig->PLLM < 2 || pClkConfig->PLLM > 63 ||
+				pClkConfig->PLLN < 50 || pClkConfig->PLLN > 432 ||
+				pClkConfig->PLLP < 2 || pClkConfig->PLLP > 8 || (pClkConfig->PLLP & 1) ||
+				pClkConfig->PLLQ < 2 || pClkConfig->PLLQ > 15)
+			return RCC_ERR_CONFIG;
+
+		vcoin = (pClkConfig->PLLSource == RCC_PLL_SRC_HSE) ? HSE_VALUE : HSI_VALUE;
+		vcoin /= pClkConfig->PLLM;
+		vco = vcoin * pClkConfig->PLLN;
+		if(vcoin < 1000000 || vcoin > 2000000 || vco < 100000000 || vco > 432000000)
+			return RCC_ERR_CONFIG;
+
+		sysclk = vco / pClkConfig->PLLP;
+	} else {
+		return RCC_ERR_CONFIG;
+	}
+
+	hclk = sysclk / rcc_ahb_div(pClkConfig->AHBPrescaler);
+	if(hclk > ((pClkConfig->VoltageScale == RCC_VOS_SCALE1) ? RCC_HCLK_MAX : RCC_HCLK_MAX_SCALE2) ||
+			(hclk / rcc_apb_div(pClkConfig->APB1Prescaler)) > RCC_PCLK1_MAX ||
+			(hclk / rcc_apb_div(pClkConfig->APB2Prescaler)) > RCC_PCLK2_MAX)
+		return RCC_ERR_CONFIG;
+
+	// Too fast for the flash at the supply range set with FLASH_SetVoltageRange
+	latency = FLASH_GetLatency(hclk);
+	if(latency == FLASH_LATENCY_INVALID)
+		return RCC_ERR_CONFIG;
+
+	// 2. Oscillators. HSI stays on, it is the parking clock while the PLL is reprogrammed.
+	RCC->CR |= (1 << RCC_CR_HSION);
+	while(!(RCC->CR & (1 << RCC_CR_HSIRDY)));
+
+	if(pClkConfig->ClockSource == RCC_CLK_SRC_HSE ||
+			(pClkConfig->ClockSource == RCC_CLK_SRC_PLL && pClkConfig->PLLSource == RCC_PLL_SRC_HSE)){
+		RCC->CR |= (1 << RCC_CR_HSEON);
+		if(rcc_wait_flag(1 << RCC_CR_HSERDY))
+			return RCC_ERR_HSE_TIMEOUT;
+	}
+
+	// 3. Going up: regulator scale and wait states before the clock gets faster
+	PWR_PCLK_EN();
+	if(pClkConfig->VoltageScale == RCC_VOS_SCALE1)
+		PWR->CR |= (1 << PWR_CR_VOS);
+
+	curLatency = (FLASH->ACR >> FLASH_ACR_LATENCY) & 0b111;
+	if(latency > curLatency)
+		FLASH_SetLatency(latency);
+
+	// 4. PLL, left alone if it already runs with these factors
+	if(pClkConfig->ClockSource == RCC_CLK_SRC_PLL){
+		if(rcc_pll_start(pClkConfig))
+			return RCC_ERR_PLL_TIMEOUT;
+	}
+
+	// 5. APB buses at /16 across the switch so neither exceeds its limit in between,
+	//    then AHB prescaler, source and the final APB prescalers
+	RCC->CFGR |= (0b111 << RCC_CFGR_PPRE1) | (0b111 << RCC_CFGR_PPRE2);
+
+	tempreg = RCC->CFGR;
+	tempreg &= ~(0b1111 << RCC_CFGR_HPRE);
+	tempreg |= (pClkConfig->AHBPrescaler << RCC_CFGR_HPRE);
+	RCC->CFGR = tempreg;
+
+	tempreg = RCC->CFGR;
+	tempreg &= ~(0b11 << RCC_CFGR_SW);
+	tempreg |= (pClkConfig->ClockSource << RCC_CFGR_SW);
+	RCC->CFGR = tempreg;
+	while(((RCC->CFGR >> RCC_CFGR_SWS) & 0b11) != pClkConfig->ClockSource);
+
+	tempreg = RCC->CFGR;
+	tempreg &= ~((0b111 << RCC_CFGR_PPRE1) | (0b111 << RCC_CFGR_PPRE2));
+	tempreg |= (pClkConfig->APB1Prescaler << RCC_CFGR_PPRE1);
+	tempreg |= (pClkConfig->APB2Prescaler << RCC_CFGR_PPRE2);
+	RCC->CFGR = tempreg;
+
+	// 6. Final wait states (fewer when going down) and the prefetch/caches back on,
+	//    then the lower regulator scale once the clock is slower
+	FLASH_ConfigForHCLK(hclk);
+	if(pClkConfig->VoltageScale == RCC_VOS_SCALE2)
+		PWR->CR &= ~(1 << PWR_CR_VOS);
+
+	// 7. Refresh the cache and let the drivers re-tune their dividers
+	rccPerfLevel = RCC_PERF_CUSTOM;
+	RCC_UpdateClockTree();
+
+	return RCC_OK;
+}
+
+/*****************************************************************
+ * @fn			- RCC_SetPerformanceLevel
+ *
+ * @brief		- Switches to one of the preset operating points
+ *
+ * @param[in]	- Level, possible values from @PerformanceLevel
+ * @param[in]	- Where to store the switch latency in core cycles, may be NULL
+ *
+ * @return		- RCC_OK, RCC_ERR_BUSY if a tracked driver did not go idle,
+ * 				  or an error code of RCC_ConfigSystemClock
+ *
+ * @Note		- HSE and the PLL are started and locked before anything is stopped.
+ * 				  Then the function waits until no driver with clock tracking reports a
+ * 				  transfer in progress and switches with interrupts masked, so no
+ * 				  interrupt-driven transfer can start until every listener has re-tuned.
+ * 				  The latency covers that masked section only, counted by CYCCNT at
+ * 				  whatever core clock ran at the time. Oscillators the new level does
+ * 				  not use are stopped afterwards. Bytes arriving on a receive-only line
+ * 				  (circular DMA or Rx FIFO) during the switch can still be lost.
+ */
+uint8_t RCC_SetPerformanceLevel(uint8_t Level, uint32_t *pCycles){
+	RCC_ClkConfig_t clk;
+	uint32_t primask, start, timeout = RCC_IDLE_TIMEOUT;
+	uint8_t status;
+
+	if(Level >= (sizeof(rccPerfLevels) / sizeof(rccPerfLevels[0])))
+		return RCC_ERR_CONFIG;
+	clk = rccPerfLevels[Level];
+
+	// 1. Slow parts first while the drivers keep running: HSE start-up and PLL lock.
+	//    The PLL can only be prepared here if it is not the current SYSCLK.
+	if(clk.ClockSource != RCC_CLK_SRC_HSI){
+		RCC->CR |= (1 << RCC_CR_HSEON);
+		if(rcc_wait_flag(1 << RCC_CR_HSERDY))
+			return RCC_ERR_HSE_TIMEOUT;
+	}
+	if(clk.ClockSource == RCC_CLK_SRC_PLL && ((RCC->CFGR >> RCC_CFGR_SWS) & 0b11) != RCC_CLK_SRC_PLL){
+		if(rcc_pll_start(&clk))
+			return RCC_ERR_PLL_TIMEOUT;
+	}
+
+	// 2. Wait for the tracked drivers to go idle, the check is repeated with interrupts
+	//    masked because a completion callback may have queued the next transfer
+	while(1){
+		primask = IRQ_SaveAndDisable();
+		if(!rcc_listeners_busy())
+			break;
+		IRQ_Restore(primask);
+		if(--timeout == 0)
+			return RCC_ERR_BUSY;
+	}
+
+	// 3. Switch, the listeners re-tune from inside RCC_ConfigSystemClock
+	start = rcc_cycles_now();
+	status = RCC_ConfigSystemClock(&clk);
+	if(pCycles != NULL)
+		*pCycles = rcc_cycles_now() - start;
+	IRQ_Restore(primask);
+
+	if(status != RCC_OK)
+		return status;
+	rccPerfLevel = Level;
+
+	// 4. Stop what the new level does not need
+	if(clk.ClockSource != RCC_CLK_SRC_PLL){
+		RCC->CR &= ~(1 << RCC_CR_PLLON);
+		if(clk.ClockSource != RCC_CLK_SRC_HSE)
+			RCC->CR &= ~(1 << RCC_CR_HSEON);
+	}
+
+	return RCC_OK;
+}
 
+/*****************************************************************
+ * @fn			- RCC_GetPerformanceLevel
+ *
+ * @brief		- Returns the operating point set last
+ *
+ * @return		- Level from @PerformanceLevel, RCC_PERF_CUSTOM after a direct
+ * 				  RCC_ConfigSystemClock
+ *
+ * @Note		- Until the first switch it is taken from CFGR.SWS: RCC_PERF_HSI16 for the
+ * 				  reset clock, RCC_PERF_PLL168 when SystemInit got the PLL running
+ */
+uint8_t RCC_GetPerformanceLevel(void){
 	uint8_t clksrc;
-	clksrc = (RCC->CFGR >> 2) & 0b11;
 
-	// System clock is HSI
-	if(clksrc == 0){
-		systemClk = 16000000;
+	if(rccPerfLevel == RCC_PERF_UNKNOWN){
+		clksrc = (RCC->CFGR >> RCC_CFGR_SWS) & 0b11;
+		if(clksrc == RCC_CLK_SRC_HSI)
+			rccPerfLevel = RCC_PERF_HSI16;
+		else if(clksrc == RCC_CLK_SRC_PLL && RCC_EARLY_PLL)
+			rccPerfLevel = RCC_PERF_PLL168;
+		else
+			rccPerfLevel = RCC_PERF_CUSTOM;
 	}
-	// System clock is HSE
-	else if(clksrc == 1){
-		systemClk = 8000000;
+
+	return rccPerfLevel;
+}
+
+#if RCC_EARLY_PLL
+/*****************************************************************
+ * @fn			- SystemInit
+ *
+ * @brief		- Switches to the RCC_PERF_PLL168 operating point before the C run-time
+ * 				  is set up
+ *
+ * @return		- none
+ *
+ * @Note		- Called by Reset_Handler ahead of the .data copy and the .bss fill, so
+ * 				  these already run at 168 MHz. Nothing in here may use a variable
+ * 				  with static storage, only registers, locals and const data.
+ * 				  The flash driver settings are not initialized yet, so the wait states
+ * 				  and its default accelerator bits are written directly.
+ * 				  Stays on HSI if HSE or the PLL do not come up.
+ */
+void SystemInit(void){
+	RCC_ClkConfig_t clk = rccPerfLevels[RCC_PERF_PLL168];
+	uint32_t tempreg;
+
+	RCC->CR |= (1 << RCC_CR_HSEON);
+	if(rcc_wait_flag(1 << RCC_CR_HSERDY))
+		return;
+
+	PWR_PCLK_EN();
+	PWR->CR |= (1 << PWR_CR_VOS);
+
+	if(rcc_pll_start(&clk))
+		return;
+
+	FLASH_SetLatency(5);
+	FLASH->ACR |= (1 << FLASH_ACR_PRFTEN) | (1 << FLASH_ACR_ICEN) | (1 << FLASH_ACR_DCEN);
+
+	tempreg = RCC->CFGR;
+	tempreg &= ~((0b1111 << RCC_CFGR_HPRE) | (0b111 << RCC_CFGR_PPRE1) | (0b111 << RCC_CFGR_PPRE2));
+	tempreg |= (clk.AHBPrescaler << RCC_CFGR_HPRE);
+	tempreg |= (clk.APB1Prescaler << RCC_CFGR_PPRE1);
+	tempreg |= (clk.APB2Prescaler << RCC_CFGR_PPRE2);
+	RCC->CFGR = tempreg;
+
+	RCC->CFGR = (RCC->CFGR & ~(0b11 << RCC_CFGR_SW)) | (RCC_CLK_SRC_PLL << RCC_CFGR_SW);
+	while(((RCC->CFGR >> RCC_CFGR_SWS) & 0b11) != RCC_CLK_SRC_PLL);
+}
+#endif
+
+static uint32_t rcc_ahb_div(uint8_t hpre){
+	if(hpre < 0b1000)
+		return 1;
+	return AHBPrescaler[hpre - 0b1000];
+}
+
+static uint32_t rcc_apb_div(uint8_t ppre){
+	if(ppre < 0b100)
+		return 1;
+	return APB1Prescaler[ppre - 0b100];
+}
+
+static uint8_t rcc_wait_flag(uint32_t flag){
+	uint32_t timeout = RCC_TIMEOUT;
+
+	while(!(RCC->CR & flag)){
+		if(--timeout == 0)
+			return 1;
 	}
-	// System clock is PLL
-	else if (clksrc == 2){
-		// Not used in this course
-		// systemClk = RCC_GetPLLOutputClock();
+	return 0;
+}
+
+static uint8_t rcc_pll_start(RCC_ClkConfig_t *pClkConfig){
+	uint32_t tempreg;
+
+	// Reserved bits must keep their reset value
+	tempreg = RCC->PLLCFGR;
+	tempreg &= ~((0x3F << RCC_PLLCFGR_PLLM) | (0x1FF << RCC_PLLCFGR_PLLN) | (0b11 << RCC_PLLCFGR_PLLP) |
+				(1 << RCC_PLLCFGR_PLLSRC) | (0xF << RCC_PLLCFGR_PLLQ));
+	tempreg |= (pClkConfig->PLLM << RCC_PLLCFGR_PLLM);
+	tempreg |= (pClkConfig->PLLN << RCC_PLLCFGR_PLLN);
+	tempreg |= (((pClkConfig->PLLP / 2) - 1) << RCC_PLLCFGR_PLLP);
+	tempreg |= (pClkConfig->PLLSource << RCC_PLLCFGR_PLLSRC);
+	tempreg |= (pClkConfig->PLLQ << RCC_PLLCFGR_PLLQ);
+
+	if((RCC->CR & (1 << RCC_CR_PLLRDY)) && RCC->PLLCFGR == tempreg)
+		return 0;
+
+	// The PLL can only be reprogrammed while it is off, park SYSCLK on HSI meanwhile
+	if(((RCC->CFGR >> RCC_CFGR_SWS) & 0b11) == RCC_CLK_SRC_PLL){
+		RCC->CFGR &= ~(0b11 << RCC_CFGR_SW);
+		while(((RCC->CFGR >> RCC_CFGR_SWS) & 0b11) != RCC_CLK_SRC_HSI);
 	}
 
-	// AHB Prescaler starts at the fourth bit
-	temp = (RCC->CFGR >> 4) & 0b1111;
-	if (temp < 0b1000)
-		ahbp = 1;
-	else
-		ahbp = AHBPrescaler[temp - 0b1000];
+	RCC->CR &= ~(1 << RCC_CR_PLLON);
+	while(RCC->CR & (1 << RCC_CR_PLLRDY));
 
-	// APB2 prescaler starts at 13th bit
-	temp = (RCC->CFGR >> 13) & 0b111;
-	if (temp < 0b100)
-		apb2p = 1;
-	else
-		apb2p = APB2Prescaler[temp - 0b100];
+	RCC->PLLCFGR = tempreg;
+
+	RCC->CR |= (1 << RCC_CR_PLLON);
+	return rcc_wait_flag(1 << RCC_CR_PLLRDY);
+}
 
-	pclk2 = systemClk/(ahbp * apb2p);
+static uint8_t rcc_listeners_busy(void){
+	RCC_ClockListener_t *pListener;
 
-	return pclk2;
+	for(pListener = rccListeners; pListener != NULL; pListener = pListener->pNext){
+		if(pListener->IsBusy != NULL && pListener->IsBusy(pListener))
+			return 1;
+	}
+	return 0;
+}
+
+static uint32_t rcc_cycles_now(void){
+	// Started here if nobody else did, a running counter is left as it is
+	if(!(*CORE_DWT_CTRL & (1 << CORE_DWT_CTRL_CYCCNTENA))){
+		*CORE_DEMCR |= (1 << CORE_DEMCR_TRCENA);
+		*CORE_DWT_CTRL |= (1 << CORE_DWT_CTRL_CYCCNTENA);
+	}
+	return *CORE_DWT_CYCCNT;
 }
@@ -8,11 +8,37 @@
 #include "stm32f407xx_spi_driver.h"
 #include "stm32f407xx.h"
 
+// EVT_Event_t Code of the EVT_TYPE_SPI_QUEUE events
+#define SPI_QUEUE_EVT_NEXT	0	// Release the completed descriptor and start the next one
+#define SPI_QUEUE_EVT_START	1	// Start the head of an idle queue
+
 
 // HELPER FUNCTION PROTOTYPES
 static void spi_txe_interrupt_handle(SPI_Handle_t *pSPIHandle);
 static void spi_rxne_interrupt_handle(SPI_Handle_t *pSPIHandle);
 static void spi_ovr_err_interrupt_handle(SPI_Handle_t *pSPIHandle);
+static void spi_dma_config_stream(SPI_Handle_t *pSPIHandle, DMA_Handle_t *pDMAHandle, uint8_t direction);
+static uint8_t spi_dma_can_start(DMA_Handle_t *pDMAHandle, uint8_t *pBuffer, uint32_t len);
+static void spi_dma_set_mem_inc(DMA_Handle_t *pDMAHandle, uint8_t EnorDi);
+static void spi_dma_tx_event_handle(DMA_Handle_t *pDMAHandle, uint8_t AppEv);
+static void spi_dma_rx_event_handle(DMA_Handle_t *pDMAHandle, uint8_t AppEv);
+static void spi_queue_start(SPI_Handle_t *pSPIHandle);
+static void spi_queue_complete(SPI_Handle_t *pSPIHandle, uint8_t status);
+static void spi_queue_next(SPI_Handle_t *pSPIHandle);
+static void spi_queue_deferred_handle(EVT_Event_t *pEvent);
+static void spi_queue_flush(SPI_Handle_t *pSPIHandle);
+static void spi_queue_dma_abort(SPI_Handle_t *pSPIHandle);
+static void spi_queue_write_frame(SPI_Handle_t *pSPIHandle);
+static void spi_queue_interrupt_handle(SPI_Handle_t *pSPIHandle);
+static void spi_cs_delay(uint16_t us);
+static void spi_dma_set_data_size(DMA_Handle_t *pDMAHandle, uint8_t size);
+static uint32_t spi_get_pclk(SPI_RegDef_t *pSPIx, const RCC_ClockTree_t *pClocks);
+static void spi_clock_change_handle(RCC_ClockListener_t *pListener, const RCC_ClockTree_t *pClocks);
+static uint8_t spi_clock_busy(RCC_ClockListener_t *pListener);
+
+// Source of the dummy frames clocked out during a receive, and sink for frames nobody wants
+static uint16_t spiDummyTx = 0xFFFF;
+static uint16_t spiDummyRx;
 
 /*****************************************************************
  * @fn			- SPI_PeriClockControl
@@ -93,12 +119,53 @@ void SPI_Init(SPI_Handle_t *pSPIHandle){
 
 	// 7. SSM Configuration
 	tempreg |= (pSPIHandle->SPIConfig.SSM << SPI_CR1_SSM);
-	SPI_SSIControl(pSPIHandle->pSPIx, ENABLE);
+	tempreg |= (1 << SPI_CR1_SSI);
 
 	// 8. Frame Format Configuration
 	tempreg |= (pSPIHandle->SPIConfig.FrameFormat << SPI_CR1_LSB_FIRST);
 
-	pSPIHandle->pSPIx->CR1 |= tempreg;
+	// Assign rather than OR, so a second SPI_Init really replaces the old settings.
+	// This also leaves SPE cleared as required while the configuration changes.
+	pSPIHandle->pSPIx->CR1 = tempreg;
+
+	// 9. Software state, DMA streams are attached later by SPI_DMAInit
+	pSPIHandle->pTxBuffer = NULL;
+	pSPIHandle->pRxBuffer = NULL;
+	pSPIHandle->TxLen = 0;
+	pSPIHandle->RxLen = 0;
+	pSPIHandle->TxState = SPI_READY;
+	pSPIHandle->RxState = SPI_READY;
+	pSPIHandle->pDMATx = NULL;
+	pSPIHandle->pDMARx = NULL;
+	pSPIHandle->pXferHead = NULL;
+	pSPIHandle->pXferTail = NULL;
+}
+
+/*****************************************************************
+ * @fn			- SPI_ClockTrackingControl
+ *
+ * @brief		- Keeps SCLK at or below its current frequency across RCC clock changes
+ *
+ * @param[in]	- Pointer to SPI Handle
+ * @param[in]	- ENABLE or DISABLE macros
+ *
+ * @return		- none
+ *
+ * @Note		- Call after SPI_Init. The SCLK frequency at that moment becomes the limit,
+ * 				  the prescaler is re-picked from it whenever PCLK changes. The handle must
+ * 				  stay valid (not on the stack) until tracking is disabled again. Devices of
+ * 				  an SPI_Bus_t keep their own cached prescaler, add them again after a change.
+ */
+void SPI_ClockTrackingControl(SPI_Handle_t *pSPIHandle, uint8_t EnorDi){
+	if(EnorDi == ENABLE){
+		pSPIHandle->SclkMaxHz = spi_get_pclk(pSPIHandle->pSPIx, RCC_GetClockTree()) >> (pSPIHandle->SPIConfig.SclkSpeed + 1);
+		pSPIHandle->ClockListener.pParent = pSPIHandle;
+		pSPIHandle->ClockListener.Callback = spi_clock_change_handle;
+		pSPIHandle->ClockListener.IsBusy = spi_clock_busy;
+		RCC_RegisterClockListener(&pSPIHandle->ClockListener);
+	} else {
+		RCC_UnregisterClockListener(&pSPIHandle->ClockListener);
+	}
 }
 
 /*****************************************************************
@@ -266,6 +333,77 @@ void SPI_ReceiveData(SPI_RegDef_t *pSPIx, uint8_t* pRxBuffer, uint32_t len){
 	}
 }
 
+/*****************************************************************
+ * @fn			- SPI_TransmitReceive
+ *
+ * @brief		- Full-duplex polled transfer, sends and receives len frames
+ *
+ * @param[in]	- Pointer to SPI peripheral base address
+ * @param[in]	- Pointer to buffer containing information to send, or NULL to send dummy frames
+ * @param[in]	- Pointer to buffer to store information in, or NULL to discard it
+ * @param[in]	- Number of frames to exchange
+ *
+ * @return		- none
+ *
+ * @Note		- The next frame is written as soon as TXE is set, so the shift register never
+ * 				  runs dry. At most two frames are in flight, one in the shift register and one
+ * 				  in DR, which keeps the unread frames below the overrun limit. DFF is checked
+ * 				  once per call.
+ */
+void SPI_TransmitReceive(SPI_RegDef_t *pSPIx, uint8_t* pTxBuffer, uint8_t* pRxBuffer, uint32_t len){
+	uint32_t txLeft = len;
+	uint32_t rxLeft = len;
+
+	// A missing buffer becomes a fixed location which is not advanced
+	uint16_t dummyTx = 0xFFFF;
+	uint16_t dummyRx;
+	uint8_t txStep = pTxBuffer ? 1 : 0;
+	uint8_t rxStep = pRxBuffer ? 1 : 0;
+
+	if(!pTxBuffer)
+		pTxBuffer = (uint8_t*)&dummyTx;
+	if(!pRxBuffer)
+		pRxBuffer = (uint8_t*)&dummyRx;
+
+	if(pSPIx->CR1 & (1 << SPI_CR1_DFF)){
+		uint16_t *pTx = (uint16_t*)pTxBuffer;
+		uint16_t *pRx = (uint16_t*)pRxBuffer;
+
+		while(rxLeft > 0){
+			// 1. Refill DR while fewer than two frames are unread
+			if(txLeft > 0 && (rxLeft - txLeft) < 2 && (pSPIx->SR & SPI_TXE_FLAG)){
+				pSPIx->DR = *pTx;
+				pTx += txStep;
+				txLeft--;
+			}
+
+			// 2. Drain whatever has arrived
+			if(pSPIx->SR & SPI_RXNE_FLAG){
+				*pRx = pSPIx->DR;
+				pRx += rxStep;
+				rxLeft--;
+			}
+		}
+	} else {
+		uint8_t *pTx = pTxBuffer;
+		uint8_t *pRx = pRxBuffer;
+
+		while(rxLeft > 0){
+			if(txLeft > 0 && (rxLeft - txLeft) < 2 && (pSPIx->SR & SPI_TXE_FLAG)){
+				pSPIx->DR = *pTx;
+				pTx += txStep;
+				txLeft--;
+			}
+
+			if(pSPIx->SR & SPI_RXNE_FLAG){
+				*pRx = pSPIx->DR;
+				pRx += rxStep;
+				rxLeft--;
+			}
+		}
+	}
+}
+
 // Data Send and Receive from interrupts
 
 /*****************************************************************
@@ -336,6 +474,429 @@ uint8_t SPI_ReceiveDataIT(SPI_Handle_t *pSPIHandle, uint8_t* pRxBuffer, uint32_t
 	return state;
 }
 
+// DMA Data Send and Receive
+
+/*****************************************************************
+ * @fn			- SPI_DMAInit
+ *
+ * @brief		- Allocates and configures the DMA streams used by a SPI peripheral
+ *
+ * @param[in]	- Pointer to SPI Handle
+ * @param[in]	- DMA handle to use for transmission, or NULL
+ * @param[in]	- DMA handle to use for reception, or NULL
+ *
+ * @return		- DMA_OK or DMA_ERR_NO_STREAM
+ *
+ * @Note		- Call after SPI_Init, the data size of the streams follows the DFF setting.
+ * 				  The application still has to enable the stream IRQs (see DMA_GetIRQNumber)
+ * 				  and call DMA_IRQHandling from the DMAx_Streamy_IRQHandler.
+ */
+uint8_t SPI_DMAInit(SPI_Handle_t *pSPIHandle, DMA_Handle_t *pDMATx, DMA_Handle_t *pDMARx){
+	uint8_t txReq, rxReq;
+
+	if(pSPIHandle->pSPIx == SPI1){
+		txReq = DMA_REQ_SPI1_TX;
+		rxReq = DMA_REQ_SPI1_RX;
+	} else if(pSPIHandle->pSPIx == SPI2){
+		txReq = DMA_REQ_SPI2_TX;
+		rxReq = DMA_REQ_SPI2_RX;
+	} else {
+		txReq = DMA_REQ_SPI3_TX;
+		rxReq = DMA_REQ_SPI3_RX;
+	}
+
+	pSPIHandle->pDMATx = pDMATx;
+	pSPIHandle->pDMARx = pDMARx;
+
+	if(pDMATx){
+		if(DMA_AllocateStream(pDMATx, txReq) != DMA_OK)
+			return DMA_ERR_NO_STREAM;
+		spi_dma_config_stream(pSPIHandle, pDMATx, DMA_DIR_MEM_TO_PERIPH);
+		pDMATx->XferEventCallback = spi_dma_tx_event_handle;
+	}
+
+	if(pDMARx){
+		if(DMA_AllocateStream(pDMARx, rxReq) != DMA_OK)
+			return DMA_ERR_NO_STREAM;
+		spi_dma_config_stream(pSPIHandle, pDMARx, DMA_DIR_PERIPH_TO_MEM);
+		pDMARx->XferEventCallback = spi_dma_rx_event_handle;
+	}
+
+	return DMA_OK;
+}
+
+/*****************************************************************
+ * @fn			- SPI_SendDataDMA
+ *
+ * @brief		- This sends information via SPI with the transfer done by DMA
+ *
+ * @param[in]	- Pointer to SPI Handle
+ * @param[in]	- Pointer to buffer containing information to send
+ * @param[in]	- Number of frames to send (1 to DMA_MAX_ITEMS)
+ *
+ * @return		- State before the call, SPI_BUSY_IN_TX means nothing was started.
+ * 				  SPI_ERR_DMA if there is no Tx stream, the buffer is in CCM RAM or len is
+ * 				  out of range.
+ *
+ * @Note		- SPI_EVENT_TX_CMPLT is reported once the last frame is in DR. Wait for
+ * 				  BSY to clear before disabling the peripheral.
+ */
+uint8_t SPI_SendDataDMA(SPI_Handle_t *pSPIHandle, uint8_t* pTxBuffer, uint32_t len){
+	uint8_t state = pSPIHandle->TxState;
+
+	if(!spi_dma_can_start(pSPIHandle->pDMATx, pTxBuffer, len))
+		return SPI_ERR_DMA;
+
+	if(state != SPI_BUSY_IN_TX){
+		pSPIHandle->pTxBuffer = pTxBuffer;
+		pSPIHandle->TxLen = len;
+		pSPIHandle->TxState = SPI_BUSY_IN_TX;
+
+		// 1. Program the stream: memory -> DR
+		spi_dma_set_mem_inc(pSPIHandle->pDMATx, ENABLE);
+		DMA_StartTransfer(pSPIHandle->pDMATx, (uint32_t)pTxBuffer, (uint32_t)&pSPIHandle->pSPIx->DR, len);
+
+		// 2. Let the SPI raise Tx requests, the first one fires immediately since TXE is set
+		pSPIHandle->pSPIx->CR2 |= (1 << SPI_CR2_TXDMAEN);
+	}
+
+	return state;
+}
+
+/*****************************************************************
+ * @fn			- SPI_ReceiveDataDMA
+ *
+ * @brief		- This function receives data via SPI with the transfer done by DMA
+ *
+ * @param[in]	- Pointer to SPI Handle
+ * @param[in]	- Pointer to buffer to store information in
+ * @param[in]	- Number of frames to receive (1 to DMA_MAX_ITEMS)
+ *
+ * @return		- State before the call, SPI_BUSY_IN_RX means nothing was started.
+ * 				  SPI_ERR_DMA if a needed stream is missing, the buffer is in CCM RAM or len
+ * 				  is out of range.
+ *
+ * @Note		- A full-duplex master has to clock the data in, so dummy frames are sent
+ * 				  through the Tx stream (both streams must be set up with SPI_DMAInit)
+ */
+uint8_t SPI_ReceiveDataDMA(SPI_Handle_t *pSPIHandle, uint8_t* pRxBuffer, uint32_t len){
+	uint8_t state = pSPIHandle->RxState;
+
+	if(state == SPI_BUSY_IN_RX)
+		return state;
+
+	if((pSPIHandle->pSPIx->CR1 & (1 << SPI_CR1_MSTR)) &&
+			pSPIHandle->SPIConfig.BusConfig != SPI_BUS_CONFIG_SIMPLEX_RXONLY)
+		return SPI_TransferDMA(pSPIHandle, NULL, pRxBuffer, len);
+
+	if(!spi_dma_can_start(pSPIHandle->pDMARx, pRxBuffer, len))
+		return SPI_ERR_DMA;
+
+	pSPIHandle->pRxBuffer = pRxBuffer;
+	pSPIHandle->RxLen = len;
+	pSPIHandle->RxState = SPI_BUSY_IN_RX;
+
+	spi_dma_set_mem_inc(pSPIHandle->pDMARx, ENABLE);
+	DMA_StartTransfer(pSPIHandle->pDMARx, (uint32_t)&pSPIHandle->pSPIx->DR, (uint32_t)pRxBuffer, len);
+	pSPIHandle->pSPIx->CR2 |= (1 << SPI_CR2_RXDMAEN);
+
+	return state;
+}
+
+/*****************************************************************
+ * @fn			- SPI_TransferDMA
+ *
+ * @brief		- Full-duplex transfer with both directions handled by DMA
+ *
+ * @param[in]	- Pointer to SPI Handle
+ * @param[in]	- Pointer to Tx buffer, or NULL to send dummy frames
+ * @param[in]	- Pointer to Rx buffer, or NULL to discard received frames
+ * @param[in]	- Number of frames to exchange (1 to DMA_MAX_ITEMS)
+ *
+ * @return		- SPI_READY if the transfer was started, otherwise the busy state or
+ * 				  SPI_ERR_DMA if a stream is missing, a buffer is in CCM RAM or len is out of range
+ *
+ * @Note		- Reports SPI_EVENT_TX_CMPLT and then SPI_EVENT_RX_CMPLT. The transfer is
+ * 				  over when SPI_EVENT_RX_CMPLT arrives.
+ */
+uint8_t SPI_TransferDMA(SPI_Handle_t *pSPIHandle, uint8_t* pTxBuffer, uint8_t* pRxBuffer, uint32_t len){
+	uint8_t state = (pSPIHandle->TxState != SPI_READY) ? pSPIHandle->TxState : pSPIHandle->RxState;
+
+	if(state != SPI_READY)
+		return state;
+	if(!spi_dma_can_start(pSPIHandle->pDMATx, pTxBuffer, len) || !spi_dma_can_start(pSPIHandle->pDMARx, pRxBuffer, len))
+		return SPI_ERR_DMA;
+
+	pSPIHandle->pTxBuffer = pTxBuffer;
+	pSPIHandle->pRxBuffer = pRxBuffer;
+	pSPIHandle->TxLen = len;
+	pSPIHandle->RxLen = len;
+	pSPIHandle->TxState = SPI_BUSY_IN_TX;
+	pSPIHandle->RxState = SPI_BUSY_IN_RX;
+
+	// 1. Drain any stale frame so the first request really belongs to this transfer
+	SPI_ClearOVRFlag(pSPIHandle->pSPIx);
+
+	// 2. Rx stream first (RM0090 28.3.9), a missing buffer means a fixed sink
+	if(pRxBuffer){
+		spi_dma_set_mem_inc(pSPIHandle->pDMARx, ENABLE);
+		DMA_StartTransfer(pSPIHandle->pDMARx, (uint32_t)&pSPIHandle->pSPIx->DR, (uint32_t)pRxBuffer, len);
+	} else {
+		spi_dma_set_mem_inc(pSPIHandle->pDMARx, DISABLE);
+		DMA_StartTransfer(pSPIHandle->pDMARx, (uint32_t)&pSPIHandle->pSPIx->DR, (uint32_t)&spiDummyRx, len);
+	}
+	pSPIHandle->pSPIx->CR2 |= (1 << SPI_CR2_RXDMAEN);
+
+	// 3. Then the Tx stream, a missing buffer means the same dummy frame over and over
+	if(pTxBuffer){
+		spi_dma_set_mem_inc(pSPIHandle->pDMATx, ENABLE);
+		DMA_StartTransfer(pSPIHandle->pDMATx, (uint32_t)pTxBuffer, (uint32_t)&pSPIHandle->pSPIx->DR, len);
+	} else {
+		spi_dma_set_mem_inc(pSPIHandle->pDMATx, DISABLE);
+		DMA_StartTransfer(pSPIHandle->pDMATx, (uint32_t)&spiDummyTx, (uint32_t)&pSPIHandle->pSPIx->DR, len);
+	}
+	pSPIHandle->pSPIx->CR2 |= (1 << SPI_CR2_TXDMAEN);
+
+	return SPI_READY;
+}
+
+// Transfer queue
+
+/*****************************************************************
+ * @fn			- SPI_QueueTransfer
+ *
+ * @brief		- Appends a transfer descriptor to the queue of a SPI peripheral
+ *
+ * @param[in]	- Pointer to SPI Handle
+ * @param[in]	- Pointer to the transfer descriptor
+ *
+ * @return		- SPI_READY if the transfer started right away, SPI_BUSY_IN_TX if it is queued,
+ * 				  SPI_ERR_QUEUE if it drives CS and the event queue is not ready or full
+ *
+ * @Note		- Queued transfers are full-duplex and chained from the SPI interrupt, or from
+ * 				  the Rx DMA completion when both streams were set up with SPI_DMAInit. The
+ * 				  next descriptor starts without going back to the application. Chip select
+ * 				  is driven through BSRR, the pin must already be configured as an output.
+ * 				  Selecting and releasing CS (setup delay, BSY wait, hold delay) is posted to
+ * 				  the event queue (EVT_TYPE_SPI_QUEUE) and never waited for in an interrupt,
+ * 				  so descriptors with CS need EVT_Init. If the event queue is full when a
+ * 				  descriptor completes, CS is raised at once and the whole queue ends with
+ * 				  SPI_EVENT_QUEUE_ERR. Do not mix queued transfers with the other IT/DMA
+ * 				  calls on the same handle.
+ */
+uint8_t SPI_QueueTransfer(SPI_Handle_t *pSPIHandle, SPI_Transfer_t *pXfer){
+	uint8_t state = SPI_BUSY_IN_TX;
+	uint32_t primask;
+
+	// Chip-select timing is only ever waited for from EVT_Dispatch
+	if(pXfer->pCSPort && !EVT_IsReady())
+		return SPI_ERR_QUEUE;
+
+	pXfer->pNext = NULL;
+	pXfer->Status = SPI_XFER_OK;
+	EVT_RegisterHandler(EVT_TYPE_SPI_QUEUE, spi_queue_deferred_handle);
+
+	// The ISR pops from the head, so link under a critical section
+	primask = IRQ_SaveAndDisable();
+
+	if(pSPIHandle->pXferTail)
+		pSPIHandle->pXferTail->pNext = pXfer;
+	else
+		pSPIHandle->pXferHead = pXfer;
+	pSPIHandle->pXferTail = pXfer;
+
+	if(pSPIHandle->pXferHead == pXfer){
+		state = SPI_READY;
+
+		// The queue was idle. This may be a Callback in interrupt context, so a start
+		// with CS setup timing goes through the event queue too.
+		if(pXfer->pCSPort && EVT_Post(EVT_TYPE_SPI_QUEUE, SPI_QUEUE_EVT_START, pSPIHandle, 0) != EVT_OK){
+			pSPIHandle->pXferHead = NULL;
+			pSPIHandle->pXferTail = NULL;
+			state = SPI_ERR_QUEUE;
+		}
+	}
+
+	IRQ_Restore(primask);
+
+	if(state == SPI_READY && !pXfer->pCSPort)
+		spi_queue_start(pSPIHandle);
+
+	return state;
+}
+
+/*****************************************************************
+ * @fn			- SPI_QueueIsIdle
+ *
+ * @brief		- Checks whether every queued transfer has finished
+ *
+ * @param[in]	- Pointer to SPI Handle
+ *
+ * @return		- 1 if the queue is empty, 0 otherwise
+ *
+ * @Note		- none
+ */
+uint8_t SPI_QueueIsIdle(SPI_Handle_t *pSPIHandle){
+	return (pSPIHandle->pXferHead == NULL) ? 1 : 0;
+}
+
+// Multi-device bus
+
+/*****************************************************************
+ * @fn			- SPI_BusInit
+ *
+ * @brief		- Prepares a bus object shared by several devices on one SPI peripheral
+ *
+ * @param[in]	- Pointer to the bus object
+ * @param[in]	- Pointer to an initialized SPI Handle (master, software slave management)
+ *
+ * @return		- none
+ *
+ * @Note		- The CR1 bits which are common to all devices (MSTR, bus configuration, SSM/SSI)
+ * 				  are taken from the peripheral as SPI_Init left it
+ */
+void SPI_BusInit(SPI_Bus_t *pBus, SPI_Handle_t *pSPIHandle){
+	pBus->pSPIHandle = pSPIHandle;
+	pBus->pActiveDevice = NULL;
+	pBus->CR1 = pSPIHandle->pSPIx->CR1 & ~(1 << SPI_CR1_SPE);
+	pBus->BaseCR1 = pBus->CR1 & ~SPI_BUS_DEVICE_CR1_MASK;
+}
+
+/*****************************************************************
+ * @fn			- SPI_BusAddDevice
+ *
+ * @brief		- Computes the cached CR1 value of a device and parks its chip select high
+ *
+ * @param[in]	- Pointer to the bus object
+ * @param[in]	- Pointer to the device, with its Sclk speed, DFF, CPOL, CPHA, frame format and CS pin filled in
+ *
+ * @return		- none
+ *
+ * @Note		- The CS pin must already be configured as an output
+ */
+void SPI_BusAddDevice(SPI_Bus_t *pBus, SPI_Device_t *pDevice){
+	uint16_t tempreg = pBus->BaseCR1;
+
+	tempreg |= (pDevice->SclkSpeed << SPI_CR1_BR);
+	tempreg |= (pDevice->DFF << SPI_CR1_DFF);
+	tempreg |= (pDevice->CPOL << SPI_CR1_CPOL);
+	tempreg |= (pDevice->CPHA << SPI_CR1_CPHA);
+	tempreg |= (pDevice->FrameFormat << SPI_CR1_LSB_FIRST);
+	pDevice->CR1 = tempreg;
+
+	if(pDevice->pCSPort)
+		pDevice->pCSPort->BSRR = (1 << pDevice->CSPin);
+}
+
+/*****************************************************************
+ * @fn			- SPI_BusAcquire
+ *
+ * @brief		- Switches the bus to a device's settings and pulls its chip select low
+ *
+ * @param[in]	- Pointer to the bus object
+ * @param[in]	- Pointer to the device
+ *
+ * @return		- 1 if CR1 had to be reprogrammed, 0 if the cached settings already matched
+ *
+ * @Note		- A device still selected without SPI_BusRelease is deselected first, once its
+ * 				  last frame has left (TXE set, BSY clear). CR1 is only written when the settings
+ * 				  differ: SPE is dropped, the new value goes in while SPE is 0 and SPE is set
+ * 				  last, as the reference manual requires for BR/CPOL/CPHA/DFF changes.
+ */
+uint8_t SPI_BusAcquire(SPI_Bus_t *pBus, SPI_Device_t *pDevice){
+	SPI_Handle_t *pSPIHandle = pBus->pSPIHandle;
+	SPI_RegDef_t *pSPIx = pSPIHandle->pSPIx;
+	SPI_Device_t *pPrevious = pBus->pActiveDevice;
+	uint8_t reprogrammed = 0;
+
+	// 1. Let the previous device's last frame finish, two devices must never be selected at once
+	if((pPrevious && pPrevious != pDevice) || pDevice->CR1 != pBus->CR1){
+		while(!(pSPIx->SR & SPI_TXE_FLAG));
+		while(pSPIx->SR & SPI_BSY_FLAG);
+	}
+	if(pPrevious && pPrevious != pDevice && pPrevious->pCSPort)
+		pPrevious->pCSPort->BSRR = (1 << pPrevious->CSPin);
+
+	if(pDevice->CR1 != pBus->CR1){
+		// 2. Disable, reprogram with SPE still 0, then enable
+		if(pSPIx->CR1 & (1 << SPI_CR1_SPE))
+			pSPIx->CR1 = pBus->CR1;
+		pSPIx->CR1 = pDevice->CR1;
+		pSPIx->CR1 = pDevice->CR1 | (1 << SPI_CR1_SPE);
+
+		// 3. Keep the handle and any attached DMA streams in step with the frame size
+		if(((pDevice->CR1 ^ pBus->CR1) & (1 << SPI_CR1_DFF))){
+			uint8_t size = pDevice->DFF ? DMA_DATA_SIZE_HALFWORD : DMA_DATA_SIZE_BYTE;
+			if(pSPIHandle->pDMATx)
+				spi_dma_set_data_size(pSPIHandle->pDMATx, size);
+			if(pSPIHandle->pDMARx)
+				spi_dma_set_data_size(pSPIHandle->pDMARx, size);
+		}
+		pSPIHandle->SPIConfig.SclkSpeed = pDevice->SclkSpeed;
+		pSPIHandle->SPIConfig.DFF = pDevice->DFF;
+		pSPIHandle->SPIConfig.CPOL = pDevice->CPOL;
+		pSPIHandle->SPIConfig.CPHA = pDevice->CPHA;
+		pSPIHandle->SPIConfig.FrameFormat = pDevice->FrameFormat;
+
+		pBus->CR1 = pDevice->CR1;
+		reprogrammed = 1;
+	} else if(!(pSPIx->CR1 & (1 << SPI_CR1_SPE))){
+		pSPIx->CR1 = pDevice->CR1 | (1 << SPI_CR1_SPE);
+	}
+
+	pBus->pActiveDevice = pDevice;
+
+	if(pDevice->pCSPort)
+		pDevice->pCSPort->BSRR = (1 << (pDevice->CSPin + 16));
+
+	return reprogrammed;
+}
+
+/*****************************************************************
+ * @fn			- SPI_BusRelease
+ *
+ * @brief		- Waits for the last frame and releases the chip select of the active device
+ *
+ * @param[in]	- Pointer to the bus object
+ *
+ * @return		- none
+ *
+ * @Note		- SPE is left set, the next SPI_BusAcquire decides whether it has to drop
+ */
+void SPI_BusRelease(SPI_Bus_t *pBus){
+	SPI_RegDef_t *pSPIx = pBus->pSPIHandle->pSPIx;
+	SPI_Device_t *pDevice = pBus->pActiveDevice;
+
+	while(!(pSPIx->SR & SPI_TXE_FLAG));
+	while(pSPIx->SR & SPI_BSY_FLAG);
+
+	if(pDevice && pDevice->pCSPort)
+		pDevice->pCSPort->BSRR = (1 << pDevice->CSPin);
+
+	pBus->pActiveDevice = NULL;
+}
+
+/*****************************************************************
+ * @fn			- SPI_BusTransfer
+ *
+ * @brief		- Polled full-duplex transfer with one device on a shared bus
+ *
+ * @param[in]	- Pointer to the bus object
+ * @param[in]	- Pointer to the device
+ * @param[in]	- Pointer to Tx buffer, or NULL to send dummy frames
+ * @param[in]	- Pointer to Rx buffer, or NULL to discard received frames
+ * @param[in]	- Number of frames to exchange
+ *
+ * @return		- none
+ *
+ * @Note		- Acquire, SPI_TransmitReceive and release in one call
+ */
+void SPI_BusTransfer(SPI_Bus_t *pBus, SPI_Device_t *pDevice, uint8_t* pTxBuffer, uint8_t* pRxBuffer, uint32_t len){
+	SPI_BusAcquire(pBus, pDevice);
+	SPI_TransmitReceive(pBus->pSPIHandle->pSPIx, pTxBuffer, pRxBuffer, len);
+	SPI_BusRelease(pBus);
+}
+
 // IRQ Handling
 
 /*****************************************************************
@@ -349,18 +910,11 @@ uint8_t SPI_ReceiveDataIT(SPI_Handle_t *pSPIHandle, uint8_t* pRxBuffer, uint32_t
  *
  * @return		- none
  *
- * @Note		- none
+ * @Note		- Forwards to the NVIC driver
  */
 void SPI_IRQInterruptConfig(uint8_t IRQNumber, uint32_t IRQPriority, uint8_t EnorDi){
-	// The enable bits for all three SPIs are in ISER1
-	// The clear bits for all three SPIs are in ICER2
-	if (EnorDi == ENABLE)
-		*NVIC_ISER1 |= (1 << (IRQNumber % 32));
-	else
-		*NVIC_ICER1 |= (1 << (IRQNumber % 32));
-
-
-	SPI_IRQPriorityConfig(IRQNumber, IRQPriority);
+	NVIC_IRQInterruptConfig(IRQNumber, EnorDi);
+	NVIC_IRQPriorityConfig(IRQNumber, IRQPriority);
 }
 
 /*****************************************************************
@@ -373,17 +927,38 @@ void SPI_IRQInterruptConfig(uint8_t IRQNumber, uint32_t IRQPriority, uint8_t Eno
  *
  * @return		- none
  *
- * @Note		- none
+ * @Note		- Forwards to NVIC_IRQPriorityConfig
  */
 void SPI_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority){
-	uint8_t iprx = IRQNumber / 4;
-	uint8_t iprx_section = IRQNumber % 4;
-
-	uint8_t shift_amount = ( 8 * iprx_section ) + (8 - NO_PRIORITY_BITS_IMPLEMENTED);
+	NVIC_IRQPriorityConfig(IRQNumber, IRQPriority);
+}
 
-	__vo uint32_t* iprReg = (__vo uint32_t*)(NVIC_IPR_BASE_ADDR + (4 * iprx));
+/*****************************************************************
+ * @fn			- SPI_IRQBind
+ *
+ * @brief		- Routes the IRQ of the handle's peripheral straight to SPI_IRQHandling
+ * 				  for this handle
+ *
+ * @param[in]	- SPI Handle struct
+ *
+ * @return		- NVIC_OK, or NVIC_ERR_IRQ for an unknown peripheral
+ *
+ * @Note		- Replaces a SPIx_IRQHandler function in the application, see
+ * 				  NVIC_IRQBind. Enabling the IRQ is still up to SPI_IRQInterruptConfig.
+ */
+uint8_t SPI_IRQBind(SPI_Handle_t *pSPIHandle){
+	uint8_t irq;
+
+	if(pSPIHandle->pSPIx == SPI1)
+		irq = IRQ_NO_SPI1;
+	else if(pSPIHandle->pSPIx == SPI2)
+		irq = IRQ_NO_SPI2;
+	else if(pSPIHandle->pSPIx == SPI3)
+		irq = IRQ_NO_SPI3;
+	else
+		return NVIC_ERR_IRQ;
 
-	*iprReg |= (IRQPriority << (shift_amount));
+	return NVIC_IRQBind(irq, (NVIC_IRQHandler_t)SPI_IRQHandling, pSPIHandle);
 }
 
 /*****************************************************************
@@ -398,8 +973,16 @@ void SPI_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority){
  * @Note		- none
  */
 
-void SPI_IRQHandling(SPI_Handle_t *pSPIHandle){
+__isr_ramfunc void SPI_IRQHandling(SPI_Handle_t *pSPIHandle){
 	uint8_t temp1, temp2;
+	PROF_IRQ_ENTER(PROF_SPI_IRQProbe);
+
+	// Queued transfers have their own full-duplex handler
+	if(pSPIHandle->pXferHead){
+		spi_queue_interrupt_handle(pSPIHandle);
+		PROF_IRQ_EXIT(PROF_SPI_IRQProbe);
+		return;
+	}
 
 	// First check for TXE and check that the TXE interrupt was enabled
 	temp1 = pSPIHandle->pSPIx->SR & (SPI_TXE_FLAG);
@@ -426,6 +1009,7 @@ void SPI_IRQHandling(SPI_Handle_t *pSPIHandle){
 		spi_ovr_err_interrupt_handle(pSPIHandle);
 	}
 
+	PROF_IRQ_EXIT(PROF_SPI_IRQProbe);
 }
 
 /*****************************************************************
@@ -500,7 +1084,7 @@ __weak void SPI_ApplicationEventCallback(SPI_Handle_t *pSPIHandle, uint8_t AppEv
 }
 
 // HELPER FUNCTION IMPLEMENTATIONS
-static void spi_txe_interrupt_handle(SPI_Handle_t *pSPIHandle){
+static __isr_ramfunc void spi_txe_interrupt_handle(SPI_Handle_t *pSPIHandle){
 	// Check the DFF bit in CR1
 	if(pSPIHandle->pSPIx->CR1 & (1 << SPI_CR1_DFF)){
 		pSPIHandle->pSPIx->DR = *((uint16_t*)pSPIHandle->pTxBuffer);
@@ -517,7 +1101,7 @@ static void spi_txe_interrupt_handle(SPI_Handle_t *pSPIHandle){
 	}
 }
 
-static void spi_rxne_interrupt_handle(SPI_Handle_t *pSPIHandle){
+static __isr_ramfunc void spi_rxne_interrupt_handle(SPI_Handle_t *pSPIHandle){
 	// 1. Check the DFF bit in CR1
 	if(pSPIHandle->pSPIx->CR1 & (1 << SPI_CR1_DFF)){
 		*((uint16_t*)pSPIHandle->pRxBuffer) = pSPIHandle->pSPIx->DR;
@@ -534,7 +1118,7 @@ static void spi_rxne_interrupt_handle(SPI_Handle_t *pSPIHandle){
 	}
 }
 
-static void spi_ovr_err_interrupt_handle(SPI_Handle_t *pSPIHandle){
+static __isr_ramfunc void spi_ovr_err_interrupt_handle(SPI_Handle_t *pSPIHandle){
 	// 1. Clear the ovr flag
 	if(pSPIHandle->TxState != SPI_BUSY_IN_TX){
 		SPI_ClearOVRFlag(pSPIHandle->pSPIx);
@@ -543,3 +1127,331 @@ static void spi_ovr_err_interrupt_handle(SPI_Handle_t *pSPIHandle){
 	}
 
 }
+
+static void spi_dma_config_stream(SPI_Handle_t *pSPIHandle, DMA_Handle_t *pDMAHandle, uint8_t direction){
+	uint8_t size = (pSPIHandle->SPIConfig.DFF == SPI_DFF_16BITS) ? DMA_DATA_SIZE_HALFWORD : DMA_DATA_SIZE_BYTE;
+
+	pDMAHandle->pParent = pSPIHandle;
+	pDMAHandle->DMAConfig.Direction = direction;
+	pDMAHandle->DMAConfig.Mode = DMA_MODE_NORMAL;
+	pDMAHandle->DMAConfig.Priority = DMA_PRIORITY_HIGH;
+	pDMAHandle->DMAConfig.PeriphDataSize = size;
+	pDMAHandle->DMAConfig.MemDataSize = size;
+	pDMAHandle->DMAConfig.PeriphInc = DISABLE;
+	pDMAHandle->DMAConfig.MemInc = ENABLE;
+	pDMAHandle->DMAConfig.FIFOMode = DMA_FIFO_MODE_DIRECT;
+	pDMAHandle->DMAConfig.FIFOThreshold = DMA_FIFO_THRESHOLD_1QUARTER;
+	pDMAHandle->DMAConfig.PeriphBurst = DMA_BURST_SINGLE;
+	pDMAHandle->DMAConfig.MemBurst = DMA_BURST_SINGLE;
+
+	DMA_Init(pDMAHandle);
+}
+
+static uint8_t spi_dma_can_start(DMA_Handle_t *pDMAHandle, uint8_t *pBuffer, uint32_t len){
+	// Checked before any state changes, DMA_StartTransfer would refuse the same cases
+	if(pDMAHandle == NULL || pDMAHandle->pDMAx == NULL || DMA_IS_CCM_ADDR(pBuffer))
+		return 0;
+	return (len > 0 && len <= DMA_MAX_ITEMS);
+}
+
+static void spi_dma_set_mem_inc(DMA_Handle_t *pDMAHandle, uint8_t EnorDi){
+	// Only legal while the stream is disabled, which it is between transfers
+	if(EnorDi == ENABLE)
+		pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream].CR |= (1 << DMA_SxCR_MINC);
+	else
+		pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream].CR &= ~(1 << DMA_SxCR_MINC);
+}
+
+static void spi_dma_tx_event_handle(DMA_Handle_t *pDMAHandle, uint8_t AppEv){
+	SPI_Handle_t *pSPIHandle = (SPI_Handle_t*)pDMAHandle->pParent;
+
+	if(AppEv == DMA_EVENT_FULL_CMPLT){
+		pSPIHandle->pSPIx->CR2 &= ~(1 << SPI_CR2_TXDMAEN);
+		pSPIHandle->pTxBuffer = NULL;
+		pSPIHandle->TxLen = 0;
+		pSPIHandle->TxState = SPI_READY;
+		// A queued transfer is finished by whichever side completes last
+		if(!pSPIHandle->pXferHead)
+			SPI_ApplicationEventCallback(pSPIHandle, SPI_EVENT_TX_CMPLT);
+		else if(pSPIHandle->RxState == SPI_READY)
+			spi_queue_complete(pSPIHandle, SPI_XFER_OK);
+	} else if(AppEv == DMA_EVENT_TRANSFER_ERR){
+		pSPIHandle->pSPIx->CR2 &= ~(1 << SPI_CR2_TXDMAEN);
+		pSPIHandle->TxState = SPI_READY;
+		SPI_ApplicationEventCallback(pSPIHandle, SPI_EVENT_DMA_ERR);
+		if(pSPIHandle->pXferHead){
+			spi_queue_dma_abort(pSPIHandle);
+			spi_queue_complete(pSPIHandle, SPI_EVENT_DMA_ERR);
+		}
+	}
+}
+
+static void spi_dma_rx_event_handle(DMA_Handle_t *pDMAHandle, uint8_t AppEv){
+	SPI_Handle_t *pSPIHandle = (SPI_Handle_t*)pDMAHandle->pParent;
+
+	if(AppEv == DMA_EVENT_FULL_CMPLT){
+		pSPIHandle->pSPIx->CR2 &= ~(1 << SPI_CR2_RXDMAEN);
+		pSPIHandle->pRxBuffer = NULL;
+		pSPIHandle->RxLen = 0;
+		pSPIHandle->RxState = SPI_READY;
+		if(!pSPIHandle->pXferHead)
+			SPI_ApplicationEventCallback(pSPIHandle, SPI_EVENT_RX_CMPLT);
+		else if(pSPIHandle->TxState == SPI_READY)
+			spi_queue_complete(pSPIHandle, SPI_XFER_OK);
+	} else if(AppEv == DMA_EVENT_TRANSFER_ERR){
+		pSPIHandle->pSPIx->CR2 &= ~(1 << SPI_CR2_RXDMAEN);
+		pSPIHandle->RxState = SPI_READY;
+		SPI_ApplicationEventCallback(pSPIHandle, SPI_EVENT_DMA_ERR);
+		if(pSPIHandle->pXferHead){
+			spi_queue_dma_abort(pSPIHandle);
+			spi_queue_complete(pSPIHandle, SPI_EVENT_DMA_ERR);
+		}
+	}
+}
+
+static void spi_cs_delay(uint16_t us){
+	uint32_t cycles = us * (RCC_GetClockTree()->HCLK / 1000000U);
+	uint32_t start = *CORE_DWT_CYCCNT;
+
+	// EVT_Init started the cycle counter, descriptors with CS are refused without it
+	while((*CORE_DWT_CYCCNT - start) < cycles);
+}
+
+static void spi_queue_start(SPI_Handle_t *pSPIHandle){
+	SPI_Transfer_t *pXfer = pSPIHandle->pXferHead;
+	SPI_RegDef_t *pSPIx = pSPIHandle->pSPIx;
+
+	// 1. Select the device
+	if(pXfer->pCSPort){
+		pXfer->pCSPort->BSRR = (1 << (pXfer->CSPin + 16));
+		spi_cs_delay(pXfer->CSSetupDelay);
+	}
+
+	pSPIx->CR1 |= (1 << SPI_CR1_SPE);
+
+	// 2. With both streams available the whole transfer is handed to DMA, anything
+	//    longer than NDTR can count falls back to the interrupt path
+	if(pSPIHandle->pDMATx && pSPIHandle->pDMARx &&
+			SPI_TransferDMA(pSPIHandle, pXfer->pTxBuffer, pXfer->pRxBuffer, pXfer->len) == SPI_READY)
+		return;
+
+	pSPIHandle->pTxBuffer = pXfer->pTxBuffer;
+	pSPIHandle->pRxBuffer = pXfer->pRxBuffer;
+	pSPIHandle->TxLen = pXfer->len;
+	pSPIHandle->RxLen = pXfer->len;
+	pSPIHandle->TxState = SPI_BUSY_IN_TX;
+	pSPIHandle->RxState = SPI_BUSY_IN_RX;
+
+	// 3. Prime one frame, from then on every RXNE interrupt sends the next one. This
+	//    may run from an interrupt, so there is no TXE wait for a second frame.
+	SPI_ClearOVRFlag(pSPIx);
+	spi_queue_write_frame(pSPIHandle);
+
+	pSPIx->CR2 |= (1 << SPI_CR2_RXNEIE) | (1 << SPI_CR2_ERRIE);
+}
+
+static __isr_ramfunc void spi_queue_write_frame(SPI_Handle_t *pSPIHandle){
+	uint16_t data = 0xFFFF;
+
+	if(pSPIHandle->pSPIx->CR1 & (1 << SPI_CR1_DFF)){
+		if(pSPIHandle->pTxBuffer){
+			data = *((uint16_t*)pSPIHandle->pTxBuffer);
+			pSPIHandle->pTxBuffer += 2;
+		}
+	} else {
+		if(pSPIHandle->pTxBuffer){
+			data = *pSPIHandle->pTxBuffer;
+			pSPIHandle->pTxBuffer++;
+		}
+	}
+
+	pSPIHandle->pSPIx->DR = data;
+	pSPIHandle->TxLen--;
+}
+
+static __isr_ramfunc void spi_queue_interrupt_handle(SPI_Handle_t *pSPIHandle){
+	SPI_RegDef_t *pSPIx = pSPIHandle->pSPIx;
+	uint16_t data;
+
+	// A lost frame can not be made up for, clear OVR and end the descriptor with an error
+	if((pSPIx->SR & SPI_OVR_FLAG) && (pSPIx->CR2 & (1 << SPI_CR2_ERRIE))){
+		SPI_ClearOVRFlag(pSPIx);
+		SPI_ApplicationEventCallback(pSPIHandle, SPI_EVENT_OVR_ERR);
+		spi_queue_complete(pSPIHandle, SPI_EVENT_OVR_ERR);
+		return;
+	}
+
+	if(!(pSPIx->SR & SPI_RXNE_FLAG) || !(pSPIx->CR2 & (1 << SPI_CR2_RXNEIE)))
+		return;
+
+	// 1. Drain the received frame
+	data = pSPIx->DR;
+	if(pSPIHandle->pRxBuffer){
+		if(pSPIx->CR1 & (1 << SPI_CR1_DFF)){
+			*((uint16_t*)pSPIHandle->pRxBuffer) = data;
+			pSPIHandle->pRxBuffer += 2;
+		} else {
+			*pSPIHandle->pRxBuffer = (uint8_t)data;
+			pSPIHandle->pRxBuffer++;
+		}
+	}
+	pSPIHandle->RxLen--;
+
+	// 2. Keep the pipeline full or finish the descriptor
+	if(pSPIHandle->TxLen > 0)
+		spi_queue_write_frame(pSPIHandle);
+	else if(pSPIHandle->RxLen == 0)
+		spi_queue_complete(pSPIHandle, SPI_XFER_OK);
+}
+
+static void spi_queue_complete(SPI_Handle_t *pSPIHandle, uint8_t status){
+	SPI_Transfer_t *pXfer = pSPIHandle->pXferHead;
+
+	pSPIHandle->pSPIx->CR2 &= ~((1 << SPI_CR2_RXNEIE) | (1 << SPI_CR2_ERRIE));
+	pSPIHandle->pTxBuffer = NULL;
+	pSPIHandle->pRxBuffer = NULL;
+	pSPIHandle->TxState = SPI_READY;
+	pSPIHandle->RxState = SPI_READY;
+	pXfer->Status = status;
+
+	// Anything which has to wait (BSY, CS hold/setup delays) leaves the interrupt.
+	// The head stays in place meanwhile, so SPI_QueueTransfer only links behind it.
+	if(pXfer->pCSPort || status != SPI_XFER_OK || (pXfer->pNext && pXfer->pNext->CSSetupDelay)){
+		if(EVT_Post(EVT_TYPE_SPI_QUEUE, SPI_QUEUE_EVT_NEXT, pSPIHandle, 0) != EVT_OK)
+			spi_queue_flush(pSPIHandle);
+		return;
+	}
+
+	spi_queue_next(pSPIHandle);
+}
+
+static void spi_queue_next(SPI_Handle_t *pSPIHandle){
+	SPI_Transfer_t *pXfer = pSPIHandle->pXferHead;
+	SPI_RegDef_t *pSPIx = pSPIHandle->pSPIx;
+	uint8_t startNext;
+	uint32_t primask;
+
+	// 1. Release the device once the last clock edge is out, an aborted descriptor may
+	//    still have a frame in the shift register
+	if(pXfer->pCSPort || pXfer->Status != SPI_XFER_OK)
+		while(pSPIx->SR & SPI_BSY_FLAG);
+	if(pXfer->pCSPort){
+		spi_cs_delay(pXfer->CSHoldDelay);
+		pXfer->pCSPort->BSRR = (1 << pXfer->CSPin);
+	}
+
+	// 2. Pop the descriptor, SPI_QueueTransfer may be linking from an interrupt
+	primask = IRQ_SaveAndDisable();
+	pSPIHandle->pXferHead = pXfer->pNext;
+	if(!pSPIHandle->pXferHead)
+		pSPIHandle->pXferTail = NULL;
+	startNext = (pSPIHandle->pXferHead != NULL);
+	IRQ_Restore(primask);
+
+	// 3. Start the next one before anyone else gets to run
+	if(startNext)
+		spi_queue_start(pSPIHandle);
+
+	// 4. Only now report, the callback may queue the same descriptor again
+	if(pXfer->Callback)
+		pXfer->Callback(pSPIHandle, pXfer);
+}
+
+static void spi_queue_deferred_handle(EVT_Event_t *pEvent){
+	if(pEvent->Code == SPI_QUEUE_EVT_START)
+		spi_queue_start((SPI_Handle_t*)pEvent->pContext);
+	else
+		spi_queue_next((SPI_Handle_t*)pEvent->pContext);
+}
+
+static void spi_queue_flush(SPI_Handle_t *pSPIHandle){
+	SPI_Transfer_t *pXfer, *pNext;
+	uint32_t primask;
+
+	primask = IRQ_SaveAndDisable();
+	pXfer = pSPIHandle->pXferHead;
+	pSPIHandle->pXferHead = NULL;
+	pSPIHandle->pXferTail = NULL;
+	IRQ_Restore(primask);
+
+	// Nothing may wait in the interrupt, CS goes up without the BSY wait and the hold delay
+	if(pXfer->pCSPort)
+		pXfer->pCSPort->BSRR = (1 << pXfer->CSPin);
+	SPI_ApplicationEventCallback(pSPIHandle, SPI_EVENT_QUEUE_ERR);
+
+	// A Callback which queues again finds the event queue full and gets SPI_ERR_QUEUE
+	while(pXfer){
+		pNext = pXfer->pNext;
+		if(pXfer->Status == SPI_XFER_OK)
+			pXfer->Status = SPI_EVENT_QUEUE_ERR;
+		if(pXfer->Callback)
+			pXfer->Callback(pSPIHandle, pXfer);
+		pXfer = pNext;
+	}
+}
+
+static void spi_queue_dma_abort(SPI_Handle_t *pSPIHandle){
+	// One stream failed, stop the other so it reports nothing for the dead descriptor
+	pSPIHandle->pSPIx->CR2 &= ~((1 << SPI_CR2_TXDMAEN) | (1 << SPI_CR2_RXDMAEN));
+	DMA_Abort(pSPIHandle->pDMATx);
+	DMA_Abort(pSPIHandle->pDMARx);
+}
+
+static void spi_dma_set_data_size(DMA_Handle_t *pDMAHandle, uint8_t size){
+	__vo uint32_t *pCR = &pDMAHandle->pDMAx->STREAM[pDMAHandle->Stream].CR;
+
+	pDMAHandle->DMAConfig.PeriphDataSize = size;
+	pDMAHandle->DMAConfig.MemDataSize = size;
+
+	// Only legal while the stream is disabled, which it is between transfers
+	*pCR &= ~((3 << DMA_SxCR_PSIZE) | (3 << DMA_SxCR_MSIZE));
+	*pCR |= (size << DMA_SxCR_PSIZE) | (size << DMA_SxCR_MSIZE);
+}
+
+static uint32_t spi_get_pclk(SPI_RegDef_t *pSPIx, const RCC_ClockTree_t *pClocks){
+	// SPI1 hangs on APB2, SPI2 and SPI3 on APB1
+	if(pSPIx == SPI1)
+		return pClocks->PCLK2;
+	return pClocks->PCLK1;
+}
+
+static void spi_clock_change_handle(RCC_ClockListener_t *pListener, const RCC_ClockTree_t *pClocks){
+	SPI_Handle_t *pSPIHandle = (SPI_Handle_t*)pListener->pParent;
+	uint32_t pclk = spi_get_pclk(pSPIHandle->pSPIx, pClocks);
+	uint32_t spe = pSPIHandle->pSPIx->CR1 & (1 << SPI_CR1_SPE);
+	uint32_t tempreg;
+	uint8_t br = 0;
+
+	// Smallest divider (2 << br) that does not exceed the limit
+	while(br < SPI_SCLK_SPEED_DIV256 && (pclk >> (br + 1)) > pSPIHandle->SclkMaxHz)
+		br++;
+
+	if(br == pSPIHandle->SPIConfig.SclkSpeed)
+		return;
+	pSPIHandle->SPIConfig.SclkSpeed = br;
+
+	// BR must not change while a frame is on the wire
+	if(spe){
+		while(!SPI_GetFlagStatus(pSPIHandle->pSPIx, SPI_TXE_FLAG));
+		while(SPI_GetFlagStatus(pSPIHandle->pSPIx, SPI_BSY_FLAG));
+		pSPIHandle->pSPIx->CR1 &= ~(1 << SPI_CR1_SPE);
+	}
+
+	tempreg = pSPIHandle->pSPIx->CR1 & ~(7 << SPI_CR1_BR);
+	tempreg |= (br << SPI_CR1_BR);
+	pSPIHandle->pSPIx->CR1 = tempreg;
+
+	pSPIHandle->pSPIx->CR1 |= spe;
+}
+
+static uint8_t spi_clock_busy(RCC_ClockListener_t *pListener){
+	SPI_Handle_t *pSPIHandle = (SPI_Handle_t*)pListener->pParent;
+
+	if(pSPIHandle->TxState != SPI_READY || pSPIHandle->RxState != SPI_READY || pSPIHandle->pXferHead != NULL)
+		return 1;
+
+	if((pSPIHandle->pSPIx->CR1 & (1 << SPI_CR1_SPE)) && SPI_GetFlagStatus(pSPIHandle->pSPIx, SPI_BSY_FLAG))
+		return 1;
+
+	return 0;
+}
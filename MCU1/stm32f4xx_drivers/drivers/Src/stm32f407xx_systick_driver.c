@@ -0,0 +1,311 @@
+/*
+ * stm32f407xx_systick_driver.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#include "stm32f407xx.h"
+#include "stm32f407xx_systick_driver.h"
+
+// Milliseconds since SYSTICK_Init, advanced by SYSTICK_IRQHandling
+static __vo uint32_t systickMs = 0;
+
+// HCLK cycles per microsecond, SysTick counts HCLK
+static uint32_t systickCyclesPerUs = 1;
+
+// Running software timers, sorted by expiry
+static SYSTICK_Timer_t *systickTimers = NULL;
+
+// Keeps the reload value right across RCC clock changes
+static RCC_ClockListener_t systickClockListener;
+
+// HELPER FUNCTION PROTOTYPES
+static void systick_load(uint32_t hclk);
+static void systick_clock_change_handle(RCC_ClockListener_t *pListener, const RCC_ClockTree_t *pClocks);
+static void systick_timer_insert(SYSTICK_Timer_t *pTimer);
+static uint8_t systick_timer_unlink(SYSTICK_Timer_t *pTimer);
+
+/*****************************************************************
+ * @fn			- SYSTICK_Init
+ *
+ * @brief		- Starts the 1 ms timebase
+ *
+ * @param[in]	- SysTick exception priority from 0-15
+ *
+ * @return		- none
+ *
+ * @Note		- SysTick_Handler must call SYSTICK_IRQHandling. The reload value follows
+ * 				  HCLK through an RCC clock listener, so ticks stay 1 ms long after
+ * 				  RCC_ConfigSystemClock. Delays may only be used from code running at a
+ * 				  lower priority than SysTick.
+ */
+void SYSTICK_Init(uint32_t IRQPriority){
+	SYSTICK->CTRL = 0;
+
+	*SCB_SHPR_SYSTICK = (uint8_t)(IRQPriority << (8 - NO_PRIORITY_BITS_IMPLEMENTED));
+
+	systick_load(RCC_GetHCLKValue());
+
+	SYSTICK->CTRL = (1 << SYSTICK_CTRL_CLKSOURCE) | (1 << SYSTICK_CTRL_TICKINT) | (1 << SYSTICK_CTRL_ENABLE);
+
+	systickClockListener.pParent = NULL;
+	systickClockListener.Callback = systick_clock_change_handle;
+	systickClockListener.IsBusy = NULL;
+	RCC_RegisterClockListener(&systickClockListener);
+}
+
+/*****************************************************************
+ * @fn			- SYSTICK_GetTick
+ *
+ * @brief		- Returns the milliseconds since SYSTICK_Init
+ *
+ * @return		- Tick count, wraps after 49 days
+ *
+ * @Note		- Compare ticks by subtraction so the wrap does not matter
+ */
+uint32_t SYSTICK_GetTick(void){
+	return systickMs;
+}
+
+/*****************************************************************
+ * @fn			- SYSTICK_GetMicros
+ *
+ * @brief		- Returns the microseconds since SYSTICK_Init
+ *
+ * @return		- Microsecond count, wraps after 71 minutes
+ *
+ * @Note		- Built from the tick count and the SysTick counter. A reload whose
+ * 				  interrupt is still pending is accounted for, so the value does not
+ * 				  step back while interrupts are masked (for up to 1 ms).
+ */
+uint32_t SYSTICK_GetMicros(void){
+	uint32_t ms, val, pend;
+
+	do{
+		ms = systickMs;
+		val = SYSTICK->VAL;
+		pend = (*SCB_ICSR >> SCB_ICSR_PENDSTSET) & 1;
+		// The counter has wrapped but the tick is not counted yet, take a value from after the wrap
+		if(pend)
+			val = SYSTICK->VAL;
+	} while(ms != systickMs);
+
+	return ((ms + pend) * 1000) + ((SYSTICK->LOAD - val) / systickCyclesPerUs);
+}
+
+/*****************************************************************
+ * @fn			- SYSTICK_DelayMs
+ *
+ * @brief		- Waits at least the given number of milliseconds
+ *
+ * @param[in]	- Milliseconds
+ *
+ * @return		- none
+ *
+ * @Note		- The core sleeps (WFI) between interrupts instead of spinning
+ */
+void SYSTICK_DelayMs(uint32_t ms){
+	uint32_t start = systickMs;
+
+	// The current tick is already partly over, wait one more
+	while((systickMs - start) <= ms)
+		__asm volatile ("wfi");
+}
+
+/*****************************************************************
+ * @fn			- SYSTICK_DelayUs
+ *
+ * @brief		- Waits at least the given number of microseconds
+ *
+ * @param[in]	- Microseconds
+ *
+ * @return		- none
+ *
+ * @Note		- Spins, meant for short waits. Use SYSTICK_DelayMs or a deadline for
+ * 				  anything longer than a few hundred microseconds.
+ */
+void SYSTICK_DelayUs(uint32_t us){
+	uint32_t start = SYSTICK_GetMicros();
+
+	while((SYSTICK_GetMicros() - start) < us);
+}
+
+/*****************************************************************
+ * @fn			- SYSTICK_Deadline
+ *
+ * @brief		- Computes a deadline for SYSTICK_Expired
+ *
+ * @param[in]	- Milliseconds from now
+ *
+ * @return		- Deadline in ticks
+ *
+ * @Note		- none
+ */
+uint32_t SYSTICK_Deadline(uint32_t ms){
+	return systickMs + ms;
+}
+
+/*****************************************************************
+ * @fn			- SYSTICK_Expired
+ *
+ * @brief		- Checks whether a deadline has passed, without blocking
+ *
+ * @param[in]	- Deadline from SYSTICK_Deadline
+ *
+ * @return		- 1 if the deadline has passed, 0 otherwise
+ *
+ * @Note		- Works across the tick wrap
+ */
+uint8_t SYSTICK_Expired(uint32_t deadline){
+	return ((int32_t)(systickMs - deadline) >= 0) ? 1 : 0;
+}
+
+/*****************************************************************
+ * @fn			- SYSTICK_TimerStart
+ *
+ * @brief		- Starts (or restarts) a software timer
+ *
+ * @param[in]	- Pointer to timer, with Callback filled in
+ * @param[in]	- Milliseconds until the first expiry
+ * @param[in]	- Period in milliseconds for a periodic timer, 0 for a one-shot timer
+ *
+ * @return		- none
+ *
+ * @Note		- May be called from the timer's own callback
+ */
+void SYSTICK_TimerStart(SYSTICK_Timer_t *pTimer, uint32_t ms, uint32_t periodMs){
+	uint32_t primask = IRQ_SaveAndDisable();
+
+	systick_timer_unlink(pTimer);
+	pTimer->Expiry = systickMs + ms;
+	pTimer->Period = periodMs;
+	systick_timer_insert(pTimer);
+
+	IRQ_Restore(primask);
+}
+
+/*****************************************************************
+ * @fn			- SYSTICK_TimerStop
+ *
+ * @brief		- Stops a software timer
+ *
+ * @param[in]	- Pointer to timer
+ *
+ * @return		- none
+ *
+ * @Note		- Stopping a timer which is not running is harmless
+ */
+void SYSTICK_TimerStop(SYSTICK_Timer_t *pTimer){
+	uint32_t primask = IRQ_SaveAndDisable();
+
+	systick_timer_unlink(pTimer);
+
+	IRQ_Restore(primask);
+}
+
+/*****************************************************************
+ * @fn			- SYSTICK_TimerIsActive
+ *
+ * @brief		- Checks whether a software timer is running
+ *
+ * @param[in]	- Pointer to timer
+ *
+ * @return		- 1 if running, 0 otherwise
+ *
+ * @Note		- none
+ */
+uint8_t SYSTICK_TimerIsActive(SYSTICK_Timer_t *pTimer){
+	SYSTICK_Timer_t *pIter;
+	uint32_t primask = IRQ_SaveAndDisable();
+	uint8_t active = 0;
+
+	for(pIter = systickTimers; pIter != NULL; pIter = pIter->pNext){
+		if(pIter == pTimer){
+			active = 1;
+			break;
+		}
+	}
+
+	IRQ_Restore(primask);
+	return active;
+}
+
+/*****************************************************************
+ * @fn			- SYSTICK_IRQHandling
+ *
+ * @brief		- Advances the tick and runs the expired software timers
+ *
+ * @return		- none
+ *
+ * @Note		- Only the head of the sorted timer list is checked when nothing expires
+ */
+void SYSTICK_IRQHandling(void){
+	SYSTICK_Timer_t *pTimer;
+	uint32_t primask;
+
+	systickMs++;
+
+	while(1){
+		primask = IRQ_SaveAndDisable();
+
+		pTimer = systickTimers;
+		if(pTimer == NULL || (int32_t)(systickMs - pTimer->Expiry) < 0){
+			IRQ_Restore(primask);
+			break;
+		}
+
+		// Re-arm before the callback so that it can stop or restart the timer
+		systickTimers = pTimer->pNext;
+		pTimer->pNext = NULL;
+		if(pTimer->Period){
+			pTimer->Expiry += pTimer->Period;
+			systick_timer_insert(pTimer);
+		}
+
+		IRQ_Restore(primask);
+
+		pTimer->Callback(pTimer);
+	}
+}
+
+static void systick_load(uint32_t hclk){
+	// LOAD is 24 bits wide, enough for 1 ms up to 16.7 GHz
+	SYSTICK->LOAD = (hclk / SYSTICK_TICK_HZ) - 1;
+	// Start the new period right away instead of after the old one ran out
+	SYSTICK->VAL = 0;
+
+	systickCyclesPerUs = hclk / 1000000;
+	if(systickCyclesPerUs == 0)
+		systickCyclesPerUs = 1;
+}
+
+static void systick_clock_change_handle(RCC_ClockListener_t *pListener, const RCC_ClockTree_t *pClocks){
+	systick_load(pClocks->HCLK);
+}
+
+static void systick_timer_insert(SYSTICK_Timer_t *pTimer){
+	SYSTICK_Timer_t **ppIter;
+
+	// Behind timers with the same expiry, so equal timers run in start order
+	for(ppIter = &systickTimers; *ppIter != NULL; ppIter = &(*ppIter)->pNext){
+		if((int32_t)(pTimer->Expiry - (*ppIter)->Expiry) < 0)
+			break;
+	}
+
+	pTimer->pNext = *ppIter;
+	*ppIter = pTimer;
+}
+
+static uint8_t systick_timer_unlink(SYSTICK_Timer_t *pTimer){
+	SYSTICK_Timer_t **ppIter;
+
+	for(ppIter = &systickTimers; *ppIter != NULL; ppIter = &(*ppIter)->pNext){
+		if(*ppIter == pTimer){
+			*ppIter = pTimer->pNext;
+			pTimer->pNext = NULL;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -9,6 +9,18 @@
 #include "stm32f407xx_rcc_driver.h"
 #include "stm32f407xx.h"
 
+// Nonzero power of two, the FIFO indexes wrap with size - 1
+#define USART_FIFO_SIZE_OK(size)	((size) != 0 && ((size) & ((size) - 1)) == 0)
+
+static uint8_t usart_dma_can_start(DMA_Handle_t *pDMAHandle, uint8_t *pBuffer, uint32_t len);
+static void usart_dma_rx_event_handle(DMA_Handle_t *pDMAHandle, uint8_t AppEv);
+static void usart_clock_change_handle(RCC_ClockListener_t *pListener, const RCC_ClockTree_t *pClocks);
+static uint8_t usart_clock_busy(RCC_ClockListener_t *pListener);
+static void usart_rx_ring_process(USART_Handle_t *pUSARTHandle);
+static void usart_rx_span_notify(USART_Handle_t *pUSARTHandle, uint16_t start, uint16_t len);
+static void usart_tx_fifo_handle(USART_Handle_t *pUSARTHandle);
+static void usart_rx_fifo_handle(USART_Handle_t *pUSARTHandle);
+
 /*****************************************************************
  * @fn			- USART_PeriClockControl
  *
@@ -170,6 +182,33 @@ void USART_SetBaudRate(USART_RegDef_t *pUSARTx, uint32_t BaudRate)
 	pUSARTx->BRR = tempreg;
 }
 
+/*****************************************************************
+ * @fn			- USART_ClockTrackingControl
+ *
+ * @brief		- Keeps the baud rate right across RCC clock changes
+ *
+ * @param[in]	- Pointer to USART Handle
+ * @param[in]	- ENABLE or DISABLE macro
+ *
+ * @return		- none
+ *
+ * @Note		- Registers the handle with RCC, BRR is recomputed from the configured
+ * 				  baud rate whenever the bus frequency changes. The handle must stay valid
+ * 				  (not on the stack) until tracking is disabled again.
+ * 				  RCC_SetPerformanceLevel waits for USART_SendDataIT/ReceiveDataIT, the Tx
+ * 				  FIFO and the last frame in the shift register before switching.
+ */
+void USART_ClockTrackingControl(USART_Handle_t *pUSARTHandle, uint8_t EnOrDi){
+	if(EnOrDi == ENABLE){
+		pUSARTHandle->ClockListener.pParent = pUSARTHandle;
+		pUSARTHandle->ClockListener.Callback = usart_clock_change_handle;
+		pUSARTHandle->ClockListener.IsBusy = usart_clock_busy;
+		RCC_RegisterClockListener(&pUSARTHandle->ClockListener);
+	} else {
+		RCC_UnregisterClockListener(&pUSARTHandle->ClockListener);
+	}
+}
+
 /*********************************************************************
  * @fn      		  - USART_Init
  *
@@ -262,6 +301,16 @@ void USART_Init(USART_Handle_t *pUSARTHandle){
 	// Implement the code to configure the baud rate
 	// We will cover this in the lecture. No action required here
 	USART_SetBaudRate(pUSARTHandle->pUSARTx, pUSARTHandle->USART_Config.baudRate);
+
+	// Software state, the DMA stream is attached later by USART_DMAInit
+	pUSARTHandle->TxBusyState = USART_READY;
+	pUSARTHandle->RxBusyState = USART_READY;
+	pUSARTHandle->pDMARx = NULL;
+	pUSARTHandle->pRxRing = NULL;
+	pUSARTHandle->RxRingSize = 0;
+	pUSARTHandle->RxRingTail = 0;
+	pUSARTHandle->TxFifo.pBuf = NULL;
+	pUSARTHandle->RxFifo.pBuf = NULL;
 }
 
 /*********************************************************************
@@ -436,6 +485,265 @@ uint8_t USART_ReceiveDataIT(USART_Handle_t *pUSARTHandle, uint8_t *pRxBuffer, ui
 
 }
 
+/*****************************************************************
+ * @fn			- USART_DMAInit
+ *
+ * @brief		- Allocates and configures the DMA stream used for circular reception
+ *
+ * @param[in]	- Pointer to USART Handle
+ * @param[in]	- DMA handle to use for reception
+ *
+ * @return		- DMA_OK or DMA_ERR_NO_STREAM
+ *
+ * @Note		- Call after USART_Init. The application still has to enable the stream IRQ
+ * 				  and the USART IRQ, both at the same priority.
+ */
+uint8_t USART_DMAInit(USART_Handle_t *pUSARTHandle, DMA_Handle_t *pDMARx){
+	uint8_t rxReq;
+
+	if(pUSARTHandle->pUSARTx == USART1)
+		rxReq = DMA_REQ_USART1_RX;
+	else if(pUSARTHandle->pUSARTx == USART2)
+		rxReq = DMA_REQ_USART2_RX;
+	else if(pUSARTHandle->pUSARTx == USART3)
+		rxReq = DMA_REQ_USART3_RX;
+	else if(pUSARTHandle->pUSARTx == UART4)
+		rxReq = DMA_REQ_UART4_RX;
+	else if(pUSARTHandle->pUSARTx == UART5)
+		rxReq = DMA_REQ_UART5_RX;
+	else
+		rxReq = DMA_REQ_USART6_RX;
+
+	if(DMA_AllocateStream(pDMARx, rxReq) != DMA_OK)
+		return DMA_ERR_NO_STREAM;
+
+	pUSARTHandle->pDMARx = pDMARx;
+	pDMARx->pParent = pUSARTHandle;
+	pDMARx->DMAConfig.Direction = DMA_DIR_PERIPH_TO_MEM;
+	pDMARx->DMAConfig.Mode = DMA_MODE_CIRCULAR;
+	pDMARx->DMAConfig.Priority = DMA_PRIORITY_HIGH;
+	pDMARx->DMAConfig.PeriphDataSize = DMA_DATA_SIZE_BYTE;
+	pDMARx->DMAConfig.MemDataSize = DMA_DATA_SIZE_BYTE;
+	pDMARx->DMAConfig.PeriphInc = DISABLE;
+	pDMARx->DMAConfig.MemInc = ENABLE;
+	pDMARx->DMAConfig.FIFOMode = DMA_FIFO_MODE_DIRECT;
+	pDMARx->DMAConfig.FIFOThreshold = DMA_FIFO_THRESHOLD_1QUARTER;
+	pDMARx->DMAConfig.PeriphBurst = DMA_BURST_SINGLE;
+	pDMARx->DMAConfig.MemBurst = DMA_BURST_SINGLE;
+	DMA_Init(pDMARx);
+
+	pDMARx->XferEventCallback = usart_dma_rx_event_handle;
+
+	return DMA_OK;
+}
+
+/*****************************************************************
+ * @fn			- USART_ReceiveToIdleDMA
+ *
+ * @brief		- Starts continuous reception into a circular buffer filled by DMA
+ *
+ * @param[in]	- Pointer to USART Handle
+ * @param[in]	- Pointer to the ring buffer
+ * @param[in]	- Size of the ring buffer in bytes (max 65535)
+ *
+ * @return		- Rx state before the call, USART_ERR_DMA if no stream is attached, the
+ * 				  size is 0 or the ring is in CCM RAM
+ *
+ * @Note		- Data is handed out in place. Every idle line, half transfer and transfer
+ * 				  complete raises USART_EVENT_RX_SPAN with pRxSpan/RxSpanLen pointing into
+ * 				  the ring (twice when the new data wraps). The span stays valid until DMA
+ * 				  comes around again, so the callback must finish with it within half a ring.
+ * 				  8-bit words only. Requires USART_DMAInit.
+ */
+uint8_t USART_ReceiveToIdleDMA(USART_Handle_t *pUSARTHandle, uint8_t *pRing, uint16_t size){
+	uint8_t rxstate = pUSARTHandle->RxBusyState;
+	uint32_t dummyRead;
+
+	if(rxstate == USART_READY){
+		if(!usart_dma_can_start(pUSARTHandle->pDMARx, pRing, size))
+			return USART_ERR_DMA;
+
+		pUSARTHandle->pRxRing = pRing;
+		pUSARTHandle->RxRingSize = size;
+		pUSARTHandle->RxRingTail = 0;
+
+		// 1. Drop whatever IDLE/ORE state is left over (read SR, then DR)
+		dummyRead = pUSARTHandle->pUSARTx->SR;
+		dummyRead = pUSARTHandle->pUSARTx->DR;
+		(void)dummyRead;
+
+		// 2. Arm the stream, it runs until USART_StopReceiveDMA. No request reaches it
+		//    before DMAR is set, so the handle only turns busy once the stream runs.
+		if(DMA_StartTransfer(pUSARTHandle->pDMARx, (uint32_t)&pUSARTHandle->pUSARTx->DR, (uint32_t)pRing, size) != DMA_OK)
+			return USART_ERR_DMA;
+		pUSARTHandle->RxBusyState = USART_BUSY_IN_RX_DMA;
+		pUSARTHandle->pUSARTx->CR3 |= (1 << USART_CR3_DMAR) | (1 << USART_CR3_EIE);
+
+		// 3. Idle line ends a burst which did not reach a half/full boundary
+		pUSARTHandle->pUSARTx->CR1 |= (1 << USART_CR1_IDLEIE);
+	}
+
+	return rxstate;
+}
+
+/*****************************************************************
+ * @fn			- USART_StopReceiveDMA
+ *
+ * @brief		- Stops circular DMA reception
+ *
+ * @param[in]	- Pointer to USART Handle
+ *
+ * @return		- none
+ *
+ * @Note		- Data received since the last span is not reported
+ */
+void USART_StopReceiveDMA(USART_Handle_t *pUSARTHandle){
+	if(pUSARTHandle->RxBusyState != USART_BUSY_IN_RX_DMA)
+		return;
+
+	pUSARTHandle->pUSARTx->CR1 &= ~(1 << USART_CR1_IDLEIE);
+	pUSARTHandle->pUSARTx->CR3 &= ~((1 << USART_CR3_DMAR) | (1 << USART_CR3_EIE));
+	DMA_Abort(pUSARTHandle->pDMARx);
+
+	pUSARTHandle->RxBusyState = USART_READY;
+}
+
+/*****************************************************************
+ * @fn			- USART_FifoInit
+ *
+ * @brief		- Attaches the Tx and Rx FIFOs used by USART_Write and USART_Read
+ *
+ * @param[in]	- Pointer to USART Handle
+ * @param[in]	- Tx FIFO storage, or NULL
+ * @param[in]	- Size of the Tx FIFO, power of two
+ * @param[in]	- Rx FIFO storage, or NULL
+ * @param[in]	- Size of the Rx FIFO, power of two
+ *
+ * @return		- USART_READY, or USART_ERR_FIFO if a size given with a buffer is not a
+ * 				  power of two, nothing is changed then
+ *
+ * @Note		- Call after USART_Init, with the USART IRQ enabled. Reception into the
+ * 				  FIFO starts right away. 8-bit words only. The size of a NULL FIFO is
+ * 				  ignored, it never takes or holds data.
+ */
+uint8_t USART_FifoInit(USART_Handle_t *pUSARTHandle, uint8_t *pTxBuf, uint32_t txSize, uint8_t *pRxBuf, uint32_t rxSize){
+	// The indexes wrap with a mask
+	if((pTxBuf && !USART_FIFO_SIZE_OK(txSize)) || (pRxBuf && !USART_FIFO_SIZE_OK(rxSize)))
+		return USART_ERR_FIFO;
+
+	// Without a buffer, mask + 1 == 0 leaves no space to write and nothing to read
+	pUSARTHandle->TxFifo.pBuf = pTxBuf;
+	pUSARTHandle->TxFifo.mask = pTxBuf ? (txSize - 1) : 0xFFFFFFFFUL;
+	pUSARTHandle->TxFifo.head = 0;
+	pUSARTHandle->TxFifo.tail = 0;
+
+	pUSARTHandle->RxFifo.pBuf = pRxBuf;
+	pUSARTHandle->RxFifo.mask = pRxBuf ? (rxSize - 1) : 0xFFFFFFFFUL;
+	pUSARTHandle->RxFifo.head = 0;
+	pUSARTHandle->RxFifo.tail = 0;
+
+	if(pRxBuf)
+		pUSARTHandle->pUSARTx->CR1 |= (1 << USART_CR1_RXNEIE);
+
+	return USART_READY;
+}
+
+/*****************************************************************
+ * @fn			- USART_Write
+ *
+ * @brief		- Queues data in the Tx FIFO and returns without waiting for it to be sent
+ *
+ * @param[in]	- Pointer to USART Handle
+ * @param[in]	- Pointer to data
+ * @param[in]	- Length of data
+ *
+ * @return		- Number of bytes queued, less than len if the FIFO is full
+ *
+ * @Note		- Single producer: call from one context only (main loop or one ISR)
+ */
+uint32_t USART_Write(USART_Handle_t *pUSARTHandle, const uint8_t *pData, uint32_t len){
+	USART_Fifo_t *pFifo = &pUSARTHandle->TxFifo;
+	uint32_t head = pFifo->head;
+	uint32_t space = (pFifo->mask + 1) - (head - pFifo->tail);
+	uint32_t i;
+	uint32_t primask;
+
+	if(len > space)
+		len = space;
+
+	for(i = 0; i < len; i++)
+		pFifo->pBuf[(head + i) & pFifo->mask] = pData[i];
+
+	// 1. The data must be in memory before the TXE handler can see the new head
+	MEM_Barrier();
+	pFifo->head = head + len;
+
+	// 2. Kick the TXE interrupt. The USART handler writes CR1 too (TXEIE, TCIE, RXNEIE),
+	//    so the read-modify-write must not be split by it.
+	if(len){
+		primask = IRQ_SaveAndDisable();
+		pUSARTHandle->pUSARTx->CR1 |= (1 << USART_CR1_TXEIE);
+		IRQ_Restore(primask);
+	}
+
+	return len;
+}
+
+/*****************************************************************
+ * @fn			- USART_Read
+ *
+ * @brief		- Takes received data out of the Rx FIFO
+ *
+ * @param[in]	- Pointer to USART Handle
+ * @param[in]	- Pointer to destination buffer
+ * @param[in]	- Maximum number of bytes to read
+ *
+ * @return		- Number of bytes read, 0 if nothing has arrived
+ *
+ * @Note		- Single consumer: call from one context only
+ */
+uint32_t USART_Read(USART_Handle_t *pUSARTHandle, uint8_t *pData, uint32_t len){
+	USART_Fifo_t *pFifo = &pUSARTHandle->RxFifo;
+	uint32_t tail = pFifo->tail;
+	uint32_t count = pFifo->head - tail;
+	uint32_t i;
+
+	if(len > count)
+		len = count;
+
+	// Do not read the slots before the head that published them
+	MEM_Barrier();
+
+	for(i = 0; i < len; i++)
+		pData[i] = pFifo->pBuf[(tail + i) & pFifo->mask];
+
+	// The slots must be read before the RXNE handler may reuse them
+	MEM_Barrier();
+	pFifo->tail = tail + len;
+
+	return len;
+}
+
+/*****************************************************************
+ * @fn			- USART_Flush
+ *
+ * @brief		- Waits until everything queued with USART_Write has left the shift register
+ *
+ * @param[in]	- Pointer to USART Handle
+ *
+ * @return		- none
+ *
+ * @Note		- Only needed before sleeping, changing the baud rate or turning the
+ * 				  transceiver around. Must not be called with the USART IRQ masked.
+ */
+void USART_Flush(USART_Handle_t *pUSARTHandle){
+	// 1. The TXE handler empties the FIFO, the last byte is then in DR
+	while(pUSARTHandle->TxFifo.head != pUSARTHandle->TxFifo.tail);
+
+	// 2. Writing DR cleared TC, it comes back once the last stop bit is out
+	while(!USART_GetFlagStatus(pUSARTHandle->pUSARTx, USART_TC_FLAG));
+}
+
 /*****************************************************************
  * @fn			- USART_IRQInterruptConfig
  *
@@ -446,24 +754,10 @@ uint8_t USART_ReceiveDataIT(USART_Handle_t *pUSARTHandle, uint8_t *pRxBuffer, ui
  *
  * @return		- none
  *
- * @Note		- none
+ * @Note		- Forwards to the NVIC driver
  */
 void USART_IRQInterruptConfig(uint8_t IRQNumber, uint8_t EnOrDi){
-	if (EnOrDi == ENABLE){
-		if (IRQNumber < 32)
-			*NVIC_ISER0 |= (1 << IRQNumber);
-		else if (IRQNumber >= 32 && IRQNumber < 64)
-			*NVIC_ISER1 |= (1 << (IRQNumber % 32));
-		else if (IRQNumber >= 64 && IRQNumber < 96)
-			*NVIC_ISER2 |= (1 << (IRQNumber % 32));
-	} else if (EnOrDi == DISABLE){
-		if (IRQNumber < 32)
-			*NVIC_ICER0 |= (1 << IRQNumber);
-		else if (IRQNumber >= 32 && IRQNumber < 64)
-			*NVIC_ICER1 |= (1 << (IRQNumber % 32));
-		else if (IRQNumber >= 64 && IRQNumber < 96)
-			*NVIC_ICER2 |= (1 << (IRQNumber % 32));
-	}
+	NVIC_IRQInterruptConfig(IRQNumber, EnOrDi);
 }
 
 /*****************************************************************
@@ -476,17 +770,44 @@ void USART_IRQInterruptConfig(uint8_t IRQNumber, uint8_t EnOrDi){
  *
  * @return		- none
  *
- * @Note		- none
+ * @Note		- Forwards to NVIC_IRQPriorityConfig
  */
 void USART_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority){
-	uint8_t iprx = IRQNumber / 4;
-	uint8_t iprx_section = IRQNumber % 4;
-
-	uint8_t shift_amount = ( 8 * iprx_section ) + (8 - NO_PRIORITY_BITS_IMPLEMENTED);
+	NVIC_IRQPriorityConfig(IRQNumber, IRQPriority);
+}
 
-	__vo uint32_t* iprReg = (__vo uint32_t*)(NVIC_IPR_BASE_ADDR + (4 * iprx));
+/*****************************************************************
+ * @fn			- USART_IRQBind
+ *
+ * @brief		- Routes the IRQ of the handle's peripheral straight to USART_IRQHandling
+ * 				  for this handle
+ *
+ * @param[in]	- USART Handle struct
+ *
+ * @return		- NVIC_OK, or NVIC_ERR_IRQ for an unknown peripheral
+ *
+ * @Note		- Replaces a USARTx_IRQHandler function in the application, see
+ * 				  NVIC_IRQBind. Enabling the IRQ is still up to USART_IRQInterruptConfig.
+ */
+uint8_t USART_IRQBind(USART_Handle_t *pUSARTHandle){
+	uint8_t irq;
+
+	if(pUSARTHandle->pUSARTx == USART1)
+		irq = IRQ_NO_USART1;
+	else if(pUSARTHandle->pUSARTx == USART2)
+		irq = IRQ_NO_USART2;
+	else if(pUSARTHandle->pUSARTx == USART3)
+		irq = IRQ_NO_USART3;
+	else if(pUSARTHandle->pUSARTx == UART4)
+		irq = IRQ_NO_UART4;
+	else if(pUSARTHandle->pUSARTx == UART5)
+		irq = IRQ_NO_UART5;
+	else if(pUSARTHandle->pUSARTx == USART6)
+		irq = IRQ_NO_USART6;
+	else
+		return NVIC_ERR_IRQ;
 
-	*iprReg |= (IRQPriority << (shift_amount));
+	return NVIC_IRQBind(irq, (NVIC_IRQHandler_t)USART_IRQHandling, pUSARTHandle);
 }
 
 
@@ -504,10 +825,11 @@ void USART_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority){
  * @Note              - Resolve all the TODOs
 
  */
-void USART_IRQHandling(USART_Handle_t *pUSARTHandle)
+__isr_ramfunc void USART_IRQHandling(USART_Handle_t *pUSARTHandle)
 {
 
 	uint32_t temp1, temp2, temp3;
+	PROF_IRQ_ENTER(PROF_USART_IRQProbe);
 
 /*************************Check for TC flag ********************************************/
 
@@ -616,6 +938,11 @@ void USART_IRQHandling(USART_Handle_t *pUSARTHandle)
 				pUSARTHandle->pUSARTx->CR1 &= ~(1 << USART_CR1_TXEIE);
 			}
 		}
+		else if(pUSARTHandle->TxFifo.pBuf)
+		{
+			//Buffered mode, one byte per TXE out of the Tx FIFO
+			usart_tx_fifo_handle(pUSARTHandle);
+		}
 	}
 
 /*************************Check for RXNE flag ********************************************/
@@ -704,6 +1031,11 @@ void USART_IRQHandling(USART_Handle_t *pUSARTHandle)
 				USART_ApplicationEventCallback(pUSARTHandle, USART_EVENT_RX_CMPLT);
 			}
 		}
+		else if(pUSARTHandle->RxFifo.pBuf)
+		{
+			//Buffered mode, the byte goes into the Rx FIFO
+			usart_rx_fifo_handle(pUSARTHandle);
+		}
 	}
 
 
@@ -737,7 +1069,7 @@ void USART_IRQHandling(USART_Handle_t *pUSARTHandle)
 	temp1 = pUSARTHandle->pUSARTx->SR & (1 << USART_SR_IDLE);
 
 	//Implement the code to check the state of IDLEIE bit in CR1
-	temp2 = pUSARTHandle->pUSARTx->CR3 & ( 1 << USART_SR_IDLE);
+	temp2 = pUSARTHandle->pUSARTx->CR1 & ( 1 << USART_CR1_IDLEIE);
 
 
 	if(temp1 && temp2)
@@ -748,16 +1080,19 @@ void USART_IRQHandling(USART_Handle_t *pUSARTHandle)
 		(void)dummyRead;
 
 		//this interrupt is because of idle
-		USART_ApplicationEventCallback(pUSARTHandle, USART_EVENT_IDLE);
+		if(pUSARTHandle->RxBusyState == USART_BUSY_IN_RX_DMA)
+			usart_rx_ring_process(pUSARTHandle);
+		else
+			USART_ApplicationEventCallback(pUSARTHandle, USART_EVENT_IDLE);
 	}
 
 /*************************Check for Overrun detection flag ********************************************/
 
 	//Implement the code to check the status of ORE flag  in the SR
-	temp1 = pUSARTHandle->pUSARTx->SR & USART_SR_ORE;
+	temp1 = pUSARTHandle->pUSARTx->SR & ( 1 << USART_SR_ORE);
 
 	//Implement the code to check the status of RXNEIE  bit in the CR1
-	temp2 = pUSARTHandle->pUSARTx->CR1 & USART_CR1_RXNEIE;
+	temp2 = pUSARTHandle->pUSARTx->CR1 & ( 1 << USART_CR1_RXNEIE);
 
 
 	if(temp1 && temp2)
@@ -806,7 +1141,139 @@ void USART_IRQHandling(USART_Handle_t *pUSARTHandle)
 		{
 			USART_ApplicationEventCallback(pUSARTHandle, USART_ERREVENT_ORE);
 		}
+
+		//With DMA reception nobody else reads DR, finish the clear sequence here or the IRQ never goes away
+		if((pUSARTHandle->RxBusyState == USART_BUSY_IN_RX_DMA) &&
+				(temp1 & ((1 << USART_SR_FE) | (1 << USART_SR_NF) | (1 << USART_SR_ORE))))
+		{
+			temp3 = pUSARTHandle->pUSARTx->DR;
+		}
 	}
 
 	(void)temp3;
+	PROF_IRQ_EXIT(PROF_USART_IRQProbe);
+}
+
+/*****************************************************************
+ * @fn			- USART_ApplicationEventCallback
+ *
+ * @brief		- Default USART event callback, meant to be overridden by the application
+ *
+ * @param[in]	- Pointer to USART Handle
+ * @param[in]	- Event macro
+ *
+ * @return		- none
+ *
+ * @Note		- none
+ */
+__weak void USART_ApplicationEventCallback(USART_Handle_t *pUSARTHandle, uint8_t AppEv){
+
+}
+
+static void usart_dma_rx_event_handle(DMA_Handle_t *pDMAHandle, uint8_t AppEv){
+	USART_Handle_t *pUSARTHandle = (USART_Handle_t*)pDMAHandle->pParent;
+
+	if(AppEv == DMA_EVENT_HALF_CMPLT || AppEv == DMA_EVENT_FULL_CMPLT){
+		usart_rx_ring_process(pUSARTHandle);
+	} else if(AppEv == DMA_EVENT_TRANSFER_ERR){
+		// The stream is already disabled by hardware
+		USART_StopReceiveDMA(pUSARTHandle);
+		USART_ApplicationEventCallback(pUSARTHandle, USART_ERREVENT_DMA);
+	}
+}
+
+static __isr_ramfunc void usart_rx_ring_process(USART_Handle_t *pUSARTHandle){
+	uint16_t size = pUSARTHandle->RxRingSize;
+	uint16_t tail = pUSARTHandle->RxRingTail;
+	uint16_t head;
+
+	// Write position of the DMA. NDTR counts down and reloads to size after the last item.
+	head = size - DMA_GetRemaining(pUSARTHandle->pDMARx);
+
+	if(head == tail)
+		return;
+
+	if(head > tail){
+		usart_rx_span_notify(pUSARTHandle, tail, head - tail);
+	} else {
+		// Wrapped, hand out the end of the ring first, then the start
+		usart_rx_span_notify(pUSARTHandle, tail, size - tail);
+		if(head > 0)
+			usart_rx_span_notify(pUSARTHandle, 0, head);
+	}
+
+	pUSARTHandle->RxRingTail = (head == size) ? 0 : head;
+}
+
+static void usart_rx_span_notify(USART_Handle_t *pUSARTHandle, uint16_t start, uint16_t len){
+	pUSARTHandle->pRxSpan = &pUSARTHandle->pRxRing[start];
+	pUSARTHandle->RxSpanLen = len;
+	USART_ApplicationEventCallback(pUSARTHandle, USART_EVENT_RX_SPAN);
+}
+
+static __isr_ramfunc void usart_tx_fifo_handle(USART_Handle_t *pUSARTHandle){
+	USART_Fifo_t *pFifo = &pUSARTHandle->TxFifo;
+	uint32_t tail = pFifo->tail;
+
+	if(tail == pFifo->head){
+		// Nothing left, USART_Write sets TXEIE again
+		pUSARTHandle->pUSARTx->CR1 &= ~(1 << USART_CR1_TXEIE);
+		return;
+	}
+
+	MEM_Barrier();
+	pUSARTHandle->pUSARTx->DR = pFifo->pBuf[tail & pFifo->mask];
+	MEM_Barrier();
+	pFifo->tail = tail + 1;
+}
+
+static __isr_ramfunc void usart_rx_fifo_handle(USART_Handle_t *pUSARTHandle){
+	USART_Fifo_t *pFifo = &pUSARTHandle->RxFifo;
+	uint32_t head = pFifo->head;
+	uint8_t data;
+
+	// Reading DR clears RXNE (and ORE), even if the byte has to be dropped
+	if(pUSARTHandle->USART_Config.parityControl == USART_PARITY_DISABLE)
+		data = (uint8_t)(pUSARTHandle->pUSARTx->DR & (uint8_t)0xFF);
+	else
+		data = (uint8_t)(pUSARTHandle->pUSARTx->DR & (uint8_t)0x7F);
+
+	if((head - pFifo->tail) > pFifo->mask){
+		USART_ApplicationEventCallback(pUSARTHandle, USART_ERREVENT_RX_FIFO);
+		return;
+	}
+
+	pFifo->pBuf[head & pFifo->mask] = data;
+	MEM_Barrier();
+	pFifo->head = head + 1;
+}
+
+static void usart_clock_change_handle(RCC_ClockListener_t *pListener, const RCC_ClockTree_t *pClocks){
+	USART_Handle_t *pUSARTHandle = (USART_Handle_t*)pListener->pParent;
+
+	// USART_SetBaudRate reads the already updated clock tree
+	USART_SetBaudRate(pUSARTHandle->pUSARTx, pUSARTHandle->USART_Config.baudRate);
+}
+
+static uint8_t usart_dma_can_start(DMA_Handle_t *pDMAHandle, uint8_t *pBuffer, uint32_t len){
+	if(pDMAHandle == NULL || pDMAHandle->pDMAx == NULL || DMA_IS_CCM_ADDR(pBuffer))
+		return 0;
+	return (len > 0 && len <= DMA_MAX_ITEMS);
+}
+
+static uint8_t usart_clock_busy(RCC_ClockListener_t *pListener){
+	USART_Handle_t *pUSARTHandle = (USART_Handle_t*)pListener->pParent;
+
+	// Circular DMA reception counts too, it never finishes on its own
+	if(pUSARTHandle->TxBusyState == USART_BUSY_IN_TX || pUSARTHandle->RxBusyState != USART_READY)
+		return 1;
+
+	if(pUSARTHandle->TxFifo.head != pUSARTHandle->TxFifo.tail)
+		return 1;
+
+	// TC stays clear until the stop bit of the last frame is out
+	if((pUSARTHandle->pUSARTx->CR1 & (1 << USART_CR1_TE)) && !(pUSARTHandle->pUSARTx->SR & (1 << USART_SR_TC)))
+		return 1;
+
+	return 0;
 }
@@ -0,0 +1,306 @@
+/*
+ * dma_host_test.c
+ *
+ *  Created on: Oct 27, 2022
+ *      Author: linkachu
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "stm32f407xx.h"
+
+/*
+ * Host build of the DMA driver against a register block in RAM
+ * The driver only compares pDMAx with DMA1/DMA2 (clock control, IRQ numbers, stream
+ * bitmaps), every register access goes through the handle, so pointing a handle at
+ * simDMA exercises the real code. Run with "make" in this directory.
+ */
+
+static DMA_RegDef_t simDMA;
+
+static uint32_t failures;
+
+#define CHECK(cond)		do{ if(!(cond)){ printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } }while(0)
+
+// Events seen by the transfer callback and by the application callback
+static uint8_t lastXferEvent, lastAppEvent;
+static uint32_t xferEvents, appEvents;
+
+// NVIC stubs, the host has no interrupt controller
+static uint8_t lastBoundIRQ;
+
+uint8_t NVIC_IRQBind(uint8_t IRQNumber, NVIC_IRQHandler_t Handler, void *pContext){
+	if(IRQNumber >= NVIC_NUM_IRQS || Handler == NULL)
+		return NVIC_ERR_IRQ;
+	lastBoundIRQ = IRQNumber;
+	return NVIC_OK;
+}
+
+void NVIC_IRQInterruptConfig(uint8_t IRQNumber, uint8_t EnorDi){
+}
+
+void NVIC_IRQPriorityConfig(uint8_t IRQNumber, uint32_t IRQPriority){
+}
+
+void DMA_ApplicationEventCallback(DMA_Handle_t *pDMAHandle, uint8_t AppEv){
+	lastAppEvent = AppEv;
+	appEvents++;
+}
+
+static void xfer_event(DMA_Handle_t *pDMAHandle, uint8_t AppEv){
+	lastXferEvent = AppEv;
+	xferEvents++;
+}
+
+static void sim_reset(void){
+	memset((void*)&simDMA, 0, sizeof(simDMA));
+}
+
+static void sim_handle(DMA_Handle_t *pDMAHandle, uint8_t stream, uint8_t channel){
+	memset(pDMAHandle, 0, sizeof(*pDMAHandle));
+	pDMAHandle->pDMAx = &simDMA;
+	pDMAHandle->Stream = stream;
+	pDMAHandle->Channel = channel;
+}
+
+// The hardware drops EN by itself when a normal transfer ends
+static void sim_stream_stopped(DMA_Handle_t *pDMAHandle){
+	simDMA.STREAM[pDMAHandle->Stream].CR &= ~(1 << DMA_SxCR_EN);
+}
+
+static void sim_raise(DMA_Handle_t *pDMAHandle, uint32_t flags){
+	static const uint8_t shift[4] = {0, 6, 16, 22};
+
+	simDMA.LISR = 0;
+	simDMA.HISR = 0;
+	if(pDMAHandle->Stream < 4)
+		simDMA.LISR = flags << shift[pDMAHandle->Stream % 4];
+	else
+		simDMA.HISR = flags << shift[pDMAHandle->Stream % 4];
+}
+
+static void test_init_encoding(void){
+	DMA_Handle_t h;
+
+	// Peripheral stream, direct mode: channel 3, high priority, half-word peripheral,
+	// word memory, memory increment, circular
+	sim_reset();
+	sim_handle(&h, 5, 3);
+	h.DMAConfig.Direction = DMA_DIR_MEM_TO_PERIPH;
+	h.DMAConfig.Mode = DMA_MODE_CIRCULAR;
+	h.DMAConfig.Priority = DMA_PRIORITY_HIGH;
+	h.DMAConfig.PeriphDataSize = DMA_DATA_SIZE_HALFWORD;
+	h.DMAConfig.MemDataSize = DMA_DATA_SIZE_WORD;
+	h.DMAConfig.PeriphInc = DISABLE;
+	h.DMAConfig.MemInc = ENABLE;
+	h.DMAConfig.FIFOMode = DMA_FIFO_MODE_DIRECT;
+	h.DMAConfig.PeriphBurst = DMA_BURST_INC4;
+	simDMA.STREAM[5].FCR = 0xFF;
+	DMA_Init(&h);
+	CHECK(simDMA.STREAM[5].CR == 0x06024D40);
+	CHECK(simDMA.STREAM[5].FCR == 0);		// Bursts only with the FIFO
+	CHECK(simDMA.HIFCR == (0x3DUL << 6));
+	CHECK(h.State == DMA_READY);
+
+	// Memory-to-memory forces the FIFO and ignores circular mode
+	sim_reset();
+	sim_handle(&h, 1, 0);
+	h.DMAConfig.Direction = DMA_DIR_MEM_TO_MEM;
+	h.DMAConfig.Mode = DMA_MODE_CIRCULAR;
+	h.DMAConfig.PeriphInc = ENABLE;
+	h.DMAConfig.MemInc = ENABLE;
+	h.DMAConfig.FIFOMode = DMA_FIFO_MODE_DIRECT;
+	h.DMAConfig.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+	h.DMAConfig.PeriphBurst = DMA_BURST_INC4;
+	h.DMAConfig.MemBurst = DMA_BURST_INC4;
+	DMA_Init(&h);
+	CHECK(simDMA.STREAM[1].CR == 0x00A00680);
+	CHECK(simDMA.STREAM[1].FCR == 0x7);
+	CHECK(simDMA.LIFCR == (0x3DUL << 6));
+
+	// Double buffer implies circular
+	sim_reset();
+	sim_handle(&h, 0, 0);
+	h.DMAConfig.Mode = DMA_MODE_DOUBLE_BUFFER;
+	DMA_Init(&h);
+	CHECK(simDMA.STREAM[0].CR == ((1UL << 18) | (1UL << 8)));
+}
+
+static void test_allocation(void){
+	DMA_Handle_t spi2Tx = {0}, spi2TxAgain = {0}, spi1Rx[3] = {{0}}, m2m = {0};
+
+	// SPI2_TX only exists on DMA1 stream 4 channel 0
+	CHECK(DMA_AllocateStream(&spi2Tx, DMA_REQ_SPI2_TX) == DMA_OK);
+	CHECK(spi2Tx.pDMAx == DMA1 && spi2Tx.Stream == 4 && spi2Tx.Channel == 0);
+	CHECK(DMA_GetIRQNumber(&spi2Tx) == IRQ_NO_DMA1_STREAM4);
+	CHECK(DMA_AllocateStream(&spi2TxAgain, DMA_REQ_SPI2_TX) == DMA_ERR_NO_STREAM);
+
+	// SPI1_RX has two candidates on DMA2, channel 3 on both
+	CHECK(DMA_AllocateStream(&spi1Rx[0], DMA_REQ_SPI1_RX) == DMA_OK);
+	CHECK(spi1Rx[0].pDMAx == DMA2 && spi1Rx[0].Stream == 0 && spi1Rx[0].Channel == 3);
+	CHECK(DMA_GetIRQNumber(&spi1Rx[0]) == IRQ_NO_DMA2_STREAM0);
+	CHECK(DMA_AllocateStream(&spi1Rx[1], DMA_REQ_SPI1_RX) == DMA_OK);
+	CHECK(spi1Rx[1].pDMAx == DMA2 && spi1Rx[1].Stream == 2 && spi1Rx[1].Channel == 3);
+	CHECK(DMA_AllocateStream(&spi1Rx[2], DMA_REQ_SPI1_RX) == DMA_ERR_NO_STREAM);
+
+	// Memory-to-memory takes the first free DMA2 stream
+	CHECK(DMA_AllocateStream(&m2m, DMA_REQ_MEM_TO_MEM) == DMA_OK);
+	CHECK(m2m.pDMAx == DMA2 && m2m.Stream == 1);
+
+	// Releasing detaches the handle. The abort on the way has to reach registers, so
+	// the handle is moved to the simulated block first, which also means the DMA1
+	// bitmap can not be checked here.
+	spi2Tx.pDMAx = &simDMA;
+	DMA_ReleaseStream(&spi2Tx);
+	CHECK(spi2Tx.pDMAx == NULL);
+	CHECK(DMA_StartTransfer(&spi2Tx, 0x20000000, 0x4000380C, 1) == DMA_ERR_NO_STREAM);
+	CHECK(DMA_StartDoubleBuffer(&spi2Tx, 0x4000380C, 0x20000000, 0x20000100, 1) == DMA_ERR_NO_STREAM);
+	CHECK(DMA_GetIRQNumber(&spi2Tx) == DMA_IRQ_NO_INVALID);
+}
+
+static void test_flags(void){
+	DMA_Handle_t h;
+	static const uint8_t shift[8] = {0, 6, 16, 22, 0, 6, 16, 22};
+
+	for(uint8_t stream = 0; stream < 8; stream++){
+		__vo uint32_t *pISR = (stream < 4) ? &simDMA.LISR : &simDMA.HISR;
+		__vo uint32_t *pIFCR = (stream < 4) ? &simDMA.LIFCR : &simDMA.HIFCR;
+		__vo uint32_t *pOtherIFCR = (stream < 4) ? &simDMA.HIFCR : &simDMA.LIFCR;
+
+		sim_reset();
+		sim_handle(&h, stream, 0);
+
+		// Each flag lands in this stream's group of the right register
+		*pISR = DMA_TCIF_FLAG << shift[stream];
+		CHECK(DMA_GetFlagStatus(&h, DMA_TCIF_FLAG) == FLAG_SET);
+		CHECK(DMA_GetFlagStatus(&h, DMA_HTIF_FLAG) == FLAG_RESET);
+		*pISR = DMA_FEIF_FLAG << shift[stream];
+		CHECK(DMA_GetFlagStatus(&h, DMA_FEIF_FLAG) == FLAG_SET);
+
+		// A neighbour's flags are not ours
+		*pISR = ~(DMA_ALL_FLAGS << shift[stream]);
+		CHECK(DMA_GetFlagStatus(&h, DMA_TCIF_FLAG) == FLAG_RESET);
+		CHECK(DMA_GetFlagStatus(&h, DMA_TEIF_FLAG) == FLAG_RESET);
+
+		// Clearing writes exactly this stream's bits, reserved bits stay zero
+		DMA_ClearFlag(&h, DMA_ALL_FLAGS);
+		CHECK(*pIFCR == (0x3DUL << shift[stream]));
+		CHECK(*pOtherIFCR == 0);
+		DMA_ClearFlag(&h, DMA_TCIF_FLAG | (1 << 1));
+		CHECK(*pIFCR == (DMA_TCIF_FLAG << shift[stream]));
+	}
+}
+
+static void test_start(void){
+	DMA_Handle_t h;
+	DMA_Stream_RegDef_t *pStream = &simDMA.STREAM[6];
+
+	sim_reset();
+	sim_handle(&h, 6, 1);
+	h.DMAConfig.Direction = DMA_DIR_MEM_TO_PERIPH;
+	DMA_Init(&h);
+
+	// Length and address checks happen before anything is written
+	CHECK(DMA_StartTransfer(&h, 0x20000000, 0x40005410, 0) == DMA_ERR_LENGTH);
+	CHECK(DMA_StartTransfer(&h, 0x20000000, 0x40005410, DMA_MAX_ITEMS + 1) == DMA_ERR_LENGTH);
+	CHECK(DMA_StartTransfer(&h, 0x10000000, 0x40005410, 4) == DMA_ERR_ADDRESS);
+	CHECK(DMA_StartTransfer(&h, 0x1000FFFF, 0x40005410, 4) == DMA_ERR_ADDRESS);
+	CHECK(pStream->NDTR == 0 && !(pStream->CR & (1 << DMA_SxCR_EN)));
+	CHECK(h.State == DMA_READY);
+
+	// Memory to peripheral: M0AR is the source, PAR the data register
+	CHECK(DMA_StartTransfer(&h, 0x20000100, 0x40005410, DMA_MAX_ITEMS) == DMA_OK);
+	CHECK(pStream->M0AR == 0x20000100 && pStream->PAR == 0x40005410);
+	CHECK(pStream->NDTR == DMA_MAX_ITEMS);
+	CHECK(pStream->CR & (1 << DMA_SxCR_EN));
+	CHECK((pStream->CR & 0x1E) == ((1 << DMA_SxCR_TCIE) | (1 << DMA_SxCR_TEIE) | (1 << DMA_SxCR_DMEIE)));
+	CHECK(h.State == DMA_BUSY);
+	CHECK(DMA_StartTransfer(&h, 0x20000100, 0x40005410, 4) == DMA_BUSY);
+
+	// Double buffer refuses a CCM second buffer too
+	DMA_Abort(&h);
+	CHECK(DMA_StartDoubleBuffer(&h, 0x40005410, 0x20000000, 0x10000400, 8) == DMA_ERR_ADDRESS);
+}
+
+static void test_irq_dispatch(void){
+	DMA_Handle_t h;
+	DMA_Stream_RegDef_t *pStream = &simDMA.STREAM[3];
+
+	sim_reset();
+	sim_handle(&h, 3, 0);
+	h.DMAConfig.Direction = DMA_DIR_PERIPH_TO_MEM;
+	h.XferEventCallback = xfer_event;
+	DMA_Init(&h);
+
+	// Transfer complete in normal mode: stream interrupts off, handle ready
+	CHECK(DMA_StartTransfer(&h, 0x4001300C, 0x20000000, 16) == DMA_OK);
+	sim_stream_stopped(&h);
+	sim_raise(&h, DMA_TCIF_FLAG);
+	xferEvents = 0;
+	DMA_IRQHandling(&h);
+	CHECK(xferEvents == 1 && lastXferEvent == DMA_EVENT_FULL_CMPLT);
+	CHECK(simDMA.LIFCR == (DMA_TCIF_FLAG << 22));
+	CHECK((pStream->CR & 0x1E) == 0);
+	CHECK(h.State == DMA_READY);
+
+	// Half transfer is only reported when it was enabled
+	CHECK(DMA_StartTransfer(&h, 0x4001300C, 0x20000000, 16) == DMA_OK);
+	sim_raise(&h, DMA_HTIF_FLAG);
+	xferEvents = 0;
+	DMA_IRQHandling(&h);
+	CHECK(xferEvents == 0);
+	pStream->CR |= (1 << DMA_SxCR_HTIE);
+	DMA_IRQHandling(&h);
+	CHECK(xferEvents == 1 && lastXferEvent == DMA_EVENT_HALF_CMPLT);
+	CHECK(h.State == DMA_BUSY);
+
+	// Transfer error frees the handle
+	sim_raise(&h, DMA_TEIF_FLAG);
+	DMA_IRQHandling(&h);
+	CHECK(lastXferEvent == DMA_EVENT_TRANSFER_ERR);
+	CHECK(h.State == DMA_READY);
+	sim_stream_stopped(&h);
+
+	// Flags of another stream in the same register are ignored
+	CHECK(DMA_StartTransfer(&h, 0x4001300C, 0x20000000, 16) == DMA_OK);
+	simDMA.LISR = DMA_TCIF_FLAG << 16;
+	xferEvents = 0;
+	DMA_IRQHandling(&h);
+	CHECK(xferEvents == 0 && h.State == DMA_BUSY);
+
+	// Direct mode error, and the application callback without a transfer callback
+	h.XferEventCallback = NULL;
+	sim_raise(&h, DMA_DMEIF_FLAG);
+	appEvents = 0;
+	DMA_IRQHandling(&h);
+	CHECK(appEvents == 1 && lastAppEvent == DMA_EVENT_DIRECT_ERR);
+
+	// FIFO error only with FEIE
+	sim_raise(&h, DMA_FEIF_FLAG);
+	appEvents = 0;
+	DMA_IRQHandling(&h);
+	CHECK(appEvents == 0);
+	pStream->FCR |= (1 << DMA_SxFCR_FEIE);
+	DMA_IRQHandling(&h);
+	CHECK(appEvents == 1 && lastAppEvent == DMA_EVENT_FIFO_ERR);
+
+	// Not a DMA1/DMA2 stream, so there is no IRQ to bind
+	CHECK(DMA_GetIRQNumber(&h) == DMA_IRQ_NO_INVALID);
+	CHECK(DMA_IRQBind(&h) == NVIC_ERR_IRQ);
+}
+
+int main(void){
+	test_init_encoding();
+	test_allocation();
+	test_flags();
+	test_start();
+	test_irq_dispatch();
+
+	if(failures){
+		printf("dma_host_test: %lu check(s) failed\n", (unsigned long)failures);
+		return 1;
+	}
+
+	printf("dma_host_test: all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+#
+# log_decode.py
+#
+#  Created on: Oct 27, 2022
+#      Author: linkachu
+#
+# Turns the binary LOG_PRINT stream of stm32f407xx_log_driver back into text.
+#
+#   log_decode.py firmware.elf swo.bin [--port 1]
+#
+# firmware.elf  the image which produced the log, the format strings are read from
+#               its .log_fmt section
+# swo.bin       raw SWO capture (ITM packets), e.g. from OpenOCD
+#               "tpiu config internal swo.bin uart off <hclk>", or "-" for stdin
+#
+# Only the standard library is used.
+
+import argparse
+import re
+import struct
+import sys
+
+# Must match stm32f407xx_log_driver.h
+LOG_HDR_VALID = 1 << 31
+LOG_HDR_NARGS = 24
+LOG_HDR_ID_MASK = 0x00FFFFFF
+LOG_ID_DROPPED = 0x00FFFFFF
+
+SHT_NOBITS = 8
+
+
+def read_log_formats(elf_path):
+    """Returns {format ID: format string} from the .log_fmt section."""
+    with open(elf_path, 'rb') as f:
+        elf = f.read()
+
+    if elf[:4] != b'\x7fELF' or elf[4] != 1 or elf[5] != 1:
+        sys.exit('%s: not a little-endian ELF32 file' % elf_path)
+
+    e_shoff, = struct.unpack_from('<I', elf, 0x20)
+    e_shentsize, e_shnum, e_shstrndx = struct.unpack_from('<HHH', elf, 0x2E)
+
+    sections = []
+    for i in range(e_shnum):
+        sections.append(struct.unpack_from('<IIIIIIIIII', elf, e_shoff + i * e_shentsize))
+
+    strtab_off = sections[e_shstrndx][4]
+
+    def section_name(sh):
+        end = elf.index(b'\0', strtab_off + sh[0])
+        return elf[strtab_off + sh[0]:end].decode()
+
+    for sh in sections:
+        if section_name(sh) != '.log_fmt':
+            continue
+        if sh[1] == SHT_NOBITS:
+            sys.exit('%s: .log_fmt has no contents' % elf_path)
+
+        addr, offset, size = sh[3], sh[4], sh[5]
+        data = elf[offset:offset + size]
+
+        # Strings are packed back to back, each one ends with its NUL
+        formats = {}
+        start = 0
+        while start < len(data):
+            end = data.index(b'\0', start)
+            formats[(addr + start) & LOG_HDR_ID_MASK] = data[start:end].decode(errors='replace')
+            start = end + 1
+        return formats
+
+    sys.exit('%s: no .log_fmt section, was the firmware built with LOG_PRINT calls?' % elf_path)
+
+
+def itm_words(stream, port):
+    """Yields the 32-bit words written to one stimulus port from a raw ITM packet stream."""
+    i = 0
+    n = len(stream)
+    zeros = 0
+    while i < n:
+        hdr = stream[i]
+        i += 1
+
+        # Synchronisation packet, a run of zeros ended by 0x80
+        if hdr == 0:
+            zeros += 1
+            continue
+        if zeros:
+            zeros = 0
+            if hdr == 0x80:
+                continue
+
+        if hdr & 0x3 == 0:
+            # Overflow, timestamp or extension packet, bit 7 announces payload bytes
+            # which carry a continuation bit of their own
+            if hdr & 0x80:
+                while i < n and stream[i] & 0x80:
+                    i += 1
+                i += 1
+            continue
+
+        size = {1: 1, 2: 2, 3: 4}[hdr & 0x3]
+        payload = stream[i:i + size]
+        i += size
+
+        # Bit 2 set marks hardware source (DWT) packets
+        if hdr & 0x4 or (hdr >> 3) != port or size != 4 or len(payload) != 4:
+            continue
+
+        yield struct.unpack('<I', payload)[0]
+
+
+CONVERSION = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|t)?([diouxXcp%s])')
+
+
+def render(fmt, args):
+    """printf formatting of 32-bit raw arguments, signed where the conversion asks for it."""
+    args = list(args)
+
+    def convert(m):
+        flags, _, conv = m.groups()
+        if conv == '%':
+            return '%'
+        if not args:
+            return '<missing>'
+        value = args.pop(0)
+        if conv in 'di':
+            value = value - (1 << 32) if value & 0x80000000 else value
+            return ('%' + flags + 'd') % value
+        if conv == 'p':
+            return '0x%08x' % value
+        if conv == 's':
+            return '<%%s 0x%08x>' % value
+        if conv == 'c':
+            return chr(value & 0xFF)
+        return ('%' + flags + conv) % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode(formats, words, out):
+    words = iter(words)
+    for hdr in words:
+        if not hdr & LOG_HDR_VALID:
+            # Lost sync (e.g. capture started mid-record), wait for the next header
+            continue
+
+        nargs = (hdr >> LOG_HDR_NARGS) & 0x7
+        args = [next(words, 0) for _ in range(nargs)]
+        fid = hdr & LOG_HDR_ID_MASK
+
+        if fid == LOG_ID_DROPPED:
+            out.write('<%d records dropped>\n' % args[0])
+        elif fid in formats:
+            text = render(formats[fid], args)
+            out.write(text if text.endswith('\n') else text + '\n')
+        else:
+            out.write('<unknown format 0x%06x %s>\n' % (fid, ' '.join('0x%08x' % a for a in args)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode LOG_PRINT records from a SWO capture')
+    parser.add_argument('elf', help='firmware ELF file with the .log_fmt section')
+    parser.add_argument('swo', help='raw SWO/ITM capture, - for stdin')
+    parser.add_argument('--port', type=int, default=1, help='ITM stimulus port (LOG_ITM_PORT), default 1')
+    args = parser.parse_args()
+
+    formats = read_log_formats(args.elf)
+
+    if args.swo == '-':
+        stream = sys.stdin.buffer.read()
+    else:
+        with open(args.swo, 'rb') as f:
+            stream = f.read()
+
+    decode(formats, itm_words(stream, args.port), sys.stdout)
+
+
+if __name__ == '__main__':
+    main()